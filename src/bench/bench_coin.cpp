@@ -0,0 +1,664 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+/**
+ * bench_coin: offline chain-state benchmark.
+ *
+ * Starts a node on a temporary regtest datadir, seeds it with its own delegates and a population of
+ * funded accounts, then produces blocks of synthetic transfers, DEX orders and settles, CDP stakes and
+ * redeems, price feeds and Lua contract calls under mock time. Mempool admission, block packing,
+ * ConnectBlock and the chain state flush are timed and reported with percentiles.
+ *
+ * With -micro=<name> it runs a micro benchmark of a single component instead, see microbench.h.
+ */
+
+#include "microbench.h"
+
+#include "commons/util.h"
+#include "config/chainparams.h"
+#include "config/configuration.h"
+#include "config/scoin.h"
+#include "init.h"
+#include "main.h"
+#include "miner/miner.h"
+#include "net.h"
+#include "persistence/cachewrapper.h"
+#include "tx/cdptx.h"
+#include "tx/coinrewardtx.h"
+#include "tx/cointransfertx.h"
+#include "tx/contracttx.h"
+#include "tx/dextx.h"
+#include "tx/pricefeedtx.h"
+#include "wallet/wallet.h"
+
+#include <stdio.h>
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <boost/algorithm/string.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/thread.hpp>
+
+using namespace std;
+
+static const int32_t DEFAULT_BENCH_ACCOUNTS   = 2000;
+static const int32_t MAX_BENCH_ACCOUNTS       = 60000;  // regids (0, 1000..) of the seeded accounts
+static const int32_t DEFAULT_BENCH_BLOCKS     = 50;
+static const int32_t DEFAULT_BENCH_BLOCK_TXS  = 500;
+static const char *DEFAULT_BENCH_MIX          = "transfer:70,dex:10,cdp:10,contract:10";
+
+static const uint16_t DELEGATE_REGID_INDEX    = 500;
+static const uint16_t ACCOUNT_REGID_INDEX     = 1000;
+
+static const uint64_t BENCH_TX_FEE            = 0.01 * COIN;
+static const uint64_t BENCH_DEPLOY_FEE        = 2 * COIN;
+static const uint64_t BENCH_INVOKE_FEE        = 0.1 * COIN;
+static const uint64_t BENCH_ACCOUNT_BALANCE   = 100000 * COIN;  // of WICC and of WUSD
+static const uint64_t BENCH_CDP_STAKE_AMOUNT  = 1000 * COIN;
+static const uint64_t BENCH_CDP_MINT_AMOUNT   = 100 * COIN;
+static const uint64_t BENCH_WICC_PRICE        = PRICE_BOOST;       // 1 USD
+static const uint64_t BENCH_WGRT_PRICE        = PRICE_BOOST / 10;  // 0.1 USD
+
+static const string BENCH_CONTRACT_CODE =
+    "mylib = require \"mylib\"\n"
+    "\n"
+    "function Main()\n"
+    "  local value = {}\n"
+    "  for i = 1, #contract do\n"
+    "    value[i] = contract[i]\n"
+    "  end\n"
+    "  mylib.WriteData({key = \"bench\" .. contract[1], length = #value, value = value})\n"
+    "end\n"
+    "\n"
+    "Main()\n";
+
+enum BenchTxType {
+    BENCH_TRANSFER = 0,
+    BENCH_DEX,
+    BENCH_CDP,
+    BENCH_CONTRACT,
+    BENCH_PRICE_FEED,
+    BENCH_DEX_SETTLE,
+    BENCH_TX_TYPE_COUNT
+};
+
+static const char *kBenchTxTypeNames[BENCH_TX_TYPE_COUNT] = {"transfer", "dex",       "cdp",
+                                                             "contract", "pricefeed", "settle"};
+
+enum BenchCdpState { CDP_NONE, CDP_STAKING, CDP_OPEN, CDP_REDEEMING };
+
+struct CBenchAccount {
+    CKey key;
+    CRegID regid;
+    BenchCdpState cdpState = CDP_NONE;
+    uint256 cdpTxId;
+};
+
+struct CBenchDeal {
+    uint256 buyOrderId;
+    uint256 sellOrderId;
+    uint64_t assetAmount;
+};
+
+/** Exact latency samples of one benchmark stage */
+class CBenchTimer {
+private:
+    vector<int64_t> vMicros;
+    int64_t nTotalMicros = 0;
+
+public:
+    void Add(int64_t nMicros) {
+        vMicros.push_back(nMicros);
+        nTotalMicros += nMicros;
+    }
+
+    uint64_t GetCount() const { return vMicros.size(); }
+    int64_t GetTotal() const { return nTotalMicros; }
+    int64_t GetAverage() const { return vMicros.empty() ? 0 : nTotalMicros / (int64_t)vMicros.size(); }
+
+    int64_t GetPercentile(double dPercentile) const {
+        if (vMicros.empty())
+            return 0;
+        vector<int64_t> vSorted = vMicros;
+        sort(vSorted.begin(), vSorted.end());
+        size_t nIndex = std::min(vSorted.size() - 1, (size_t)(dPercentile / 100 * vSorted.size()));
+        return vSorted[nIndex];
+    }
+};
+
+struct CBenchStats {
+    CBenchTimer admission;
+    CBenchTimer packing;
+    CBenchTimer processing;
+    uint64_t nBlocks = 0;
+    uint64_t nBlockTxs = 0;  // packed bench txs, reward and price median txs excluded
+    uint64_t vGenerated[BENCH_TX_TYPE_COUNT] = {};
+    uint64_t vRejected[BENCH_TX_TYPE_COUNT]  = {};
+    uint64_t vPacked[BENCH_TX_TYPE_COUNT]    = {};
+    string vRejectReasons[BENCH_TX_TYPE_COUNT];
+};
+
+class CBenchChain {
+private:
+    vector<CBenchAccount> vDelegates;
+    vector<CBenchAccount> vAccounts;
+    CKey matchKey;
+    CRegID contractRegId;
+    uint256 deployTxId;
+    int32_t nDeployHeight = 0;
+    vector<CBenchDeal> vPendingDeals;
+    vector<CBenchDeal> vConfirmedDeals;
+    vector<uint32_t> vWeights;
+    uint32_t nTotalWeight = 0;
+    uint64_t nSeq         = 0;
+    std::mt19937_64 rng;
+
+    // bench txs of the block being built
+    vector<std::shared_ptr<CBaseTx> > vBlockTxs;
+    map<uint256, BenchTxType> mapBlockTxTypes;
+
+public:
+    CBenchChain(const vector<uint32_t> &vWeightsIn) : vWeights(vWeightsIn), rng(1) {
+        for (auto nWeight : vWeights)
+            nTotalWeight += nWeight;
+    }
+
+    bool Seed(int32_t nAccounts);
+    bool ProduceBlock(int32_t nBlockTxs, CBenchStats *pStats);
+
+private:
+    bool SeedAccount(CBenchAccount &account, const CRegID &regid, uint64_t nWicc, uint64_t nWusd, uint64_t nVotes);
+    void GenerateTxs(int32_t nHeight, int32_t nBlockTxs);
+    void AddTx(const std::shared_ptr<CBaseTx> &pTx, const CKey &key, BenchTxType type);
+    CBenchAccount &RandomAccount() { return vAccounts[rng() % vAccounts.size()]; }
+    std::unique_ptr<CBlock> CreateBlock(int32_t nHeight, int64_t nBlockTime);
+    void OnBlockConnected(const CBlock &block);
+};
+
+bool CBenchChain::SeedAccount(CBenchAccount &account, const CRegID &regid, uint64_t nWicc, uint64_t nWusd,
+                              uint64_t nVotes) {
+    account.key.MakeNewKey(true);
+    account.regid = regid;
+
+    CPubKey pubKey = account.key.GetPubKey();
+    CAccount acct(pubKey.GetKeyId(), CNickID(), pubKey);
+    acct.regid          = regid;
+    acct.received_votes = nVotes;
+    if (!acct.OperateBalance(SYMB::WICC, ADD_FREE, nWicc) || !acct.OperateBalance(SYMB::WUSD, ADD_FREE, nWusd))
+        return false;
+
+    return pCdMan->pAccountCache->SaveAccount(acct);
+}
+
+bool CBenchChain::Seed(int32_t nAccounts) {
+    LOCK2(cs_main, pWalletMain->cs_wallet);
+
+    // Outvote the genesis delegates, whose keys are not known here, so that the bench produces
+    // every block. Delegates also stake enough to feed prices.
+    uint64_t nVotes       = IniCfg().GetCoinInitValue() * COIN / 50;
+    uint64_t nStakeAmount = 0;
+    pCdMan->pSysParamCache->GetParam(PRICE_FEED_BCOIN_STAKE_AMOUNT_MIN, nStakeAmount);
+
+    vDelegates.resize(IniCfg().GetTotalDelegateNum());
+    for (size_t i = 0; i < vDelegates.size(); i++) {
+        CBenchAccount &delegate = vDelegates[i];
+        if (!SeedAccount(delegate, CRegID(0, DELEGATE_REGID_INDEX + i), (nStakeAmount + 1000) * COIN, 0, nVotes))
+            return ERRORMSG("Seed() : failed to save delegate account");
+
+        CAccount acct;
+        if (!pCdMan->pAccountCache->GetAccount(delegate.regid, acct) ||
+            !acct.OperateBalance(SYMB::WICC, STAKE, nStakeAmount * COIN) ||
+            !pCdMan->pAccountCache->SaveAccount(acct))
+            return ERRORMSG("Seed() : failed to stake delegate coins");
+
+        if (!pCdMan->pDelegateCache->SetDelegateVotes(delegate.regid, nVotes))
+            return ERRORMSG("Seed() : failed to set delegate votes");
+
+        if (!pWalletMain->AddKey(delegate.key))
+            return ERRORMSG("Seed() : failed to add delegate key to wallet");
+    }
+    pCdMan->pDelegateCache->LoadTopDelegateList();
+
+    vAccounts.resize(nAccounts);
+    for (int32_t i = 0; i < nAccounts; i++) {
+        if (!SeedAccount(vAccounts[i], CRegID(0, ACCOUNT_REGID_INDEX + i), BENCH_ACCOUNT_BALANCE,
+                         BENCH_ACCOUNT_BALANCE, 0))
+            return ERRORMSG("Seed() : failed to save account");
+    }
+
+    matchKey.MakeNewKey(true);
+
+    pCdMan->Flush();
+    mempool.Clear();
+
+    return true;
+}
+
+void CBenchChain::AddTx(const std::shared_ptr<CBaseTx> &pTx, const CKey &key, BenchTxType type) {
+    key.Sign(pTx->ComputeSignatureHash(), pTx->signature);
+    vBlockTxs.push_back(pTx);
+    mapBlockTxTypes[pTx->GetHash()] = type;
+}
+
+void CBenchChain::GenerateTxs(int32_t nHeight, int32_t nBlockTxs) {
+    int32_t nValidHeight = nHeight - 1;
+
+    // price feeds of every delegate
+    vector<CPricePoint> vPricePoints = {CPricePoint(CoinPricePair(SYMB::WICC, SYMB::USD), BENCH_WICC_PRICE),
+                                        CPricePoint(CoinPricePair(SYMB::WGRT, SYMB::USD), BENCH_WGRT_PRICE)};
+    for (const auto &delegate : vDelegates)
+        AddTx(std::make_shared<CPriceFeedTx>(delegate.regid, nValidHeight, SYMB::WICC, BENCH_TX_FEE, vPricePoints),
+              delegate.key, BENCH_PRICE_FEED);
+
+    if (contractRegId.IsEmpty() && deployTxId.IsNull()) {
+        auto pTx           = std::make_shared<CLuaContractDeployTx>();
+        pTx->txUid         = vAccounts[0].regid;
+        pTx->valid_height  = nValidHeight;
+        pTx->llFees        = BENCH_DEPLOY_FEE;
+        pTx->contract      = CLuaContract(BENCH_CONTRACT_CODE, "bench_coin");
+        AddTx(pTx, vAccounts[0].key, BENCH_CONTRACT);
+        deployTxId    = pTx->GetHash();
+        nDeployHeight = nHeight;
+    }
+
+    // settle the orders confirmed by the previous blocks
+    if (!vConfirmedDeals.empty()) {
+        vector<DEXDealItem> vDealItems;
+        for (const auto &deal : vConfirmedDeals) {
+            if (vDealItems.size() == MAX_SETTLE_ITEM_COUNT)
+                break;
+            uint64_t nCoinAmount = CDEXOrderBaseTx::CalcCoinAmount(deal.assetAmount, BENCH_WICC_PRICE);
+            vDealItems.push_back({deal.buyOrderId, deal.sellOrderId, BENCH_WICC_PRICE, nCoinAmount, deal.assetAmount});
+        }
+        vConfirmedDeals.erase(vConfirmedDeals.begin(), vConfirmedDeals.begin() + vDealItems.size());
+        AddTx(std::make_shared<CDEXSettleTx>(SysCfg().GetDexMatchSvcRegId(), nValidHeight, SYMB::WICC, BENCH_TX_FEE,
+                                             vDealItems),
+              matchKey, BENCH_DEX_SETTLE);
+    }
+
+    for (int32_t i = 0; i < nBlockTxs; i++) {
+        uint32_t nPick = rng() % nTotalWeight;
+        int32_t type   = BENCH_TRANSFER;
+        while (nPick >= vWeights[type]) {
+            nPick -= vWeights[type];
+            type++;
+        }
+
+        nSeq++;
+        if (type == BENCH_DEX) {
+            CBenchAccount &buyer  = RandomAccount();
+            CBenchAccount &seller = RandomAccount();
+            uint64_t nAmount      = COIN + nSeq;
+            auto pBuyTx  = std::make_shared<CDEXBuyLimitOrderTx>(buyer.regid, nValidHeight, SYMB::WICC, BENCH_TX_FEE,
+                                                                SYMB::WUSD, SYMB::WICC, nAmount, BENCH_WICC_PRICE);
+            auto pSellTx = std::make_shared<CDEXSellLimitOrderTx>(seller.regid, nValidHeight, SYMB::WICC, BENCH_TX_FEE,
+                                                                  SYMB::WUSD, SYMB::WICC, nAmount, BENCH_WICC_PRICE);
+            AddTx(pBuyTx, buyer.key, BENCH_DEX);
+            AddTx(pSellTx, seller.key, BENCH_DEX);
+            vPendingDeals.push_back({pBuyTx->GetHash(), pSellTx->GetHash(), nAmount});
+            continue;
+        }
+
+        if (type == BENCH_CDP) {
+            CBenchAccount &account = RandomAccount();
+            ComboMoney cmFee;
+            cmFee.symbol = SYMB::WICC;
+            cmFee.amount = BENCH_TX_FEE;
+            cmFee.unit   = COIN_UNIT::SAWI;
+            if (account.cdpState == CDP_NONE) {
+                ComboMoney cmStake = cmFee, cmMint = cmFee;
+                cmStake.amount = BENCH_CDP_STAKE_AMOUNT;
+                cmMint.symbol  = SYMB::WUSD;
+                cmMint.amount  = BENCH_CDP_MINT_AMOUNT;
+                auto pTx = std::make_shared<CCDPStakeTx>(account.regid, nValidHeight, cmFee, cmStake, cmMint);
+                AddTx(pTx, account.key, BENCH_CDP);
+                account.cdpState = CDP_STAKING;
+                account.cdpTxId  = pTx->GetHash();
+                continue;
+            } else if (account.cdpState == CDP_OPEN) {
+                AddTx(std::make_shared<CCDPRedeemTx>(account.regid, cmFee, nValidHeight, account.cdpTxId,
+                                                     BENCH_CDP_MINT_AMOUNT, BENCH_CDP_STAKE_AMOUNT),
+                      account.key, BENCH_CDP);
+                account.cdpState = CDP_REDEEMING;
+                continue;
+            }
+            // the cdp of the account is still pending, send a transfer instead
+            type = BENCH_TRANSFER;
+        }
+
+        if (type == BENCH_CONTRACT && !contractRegId.IsEmpty()) {
+            CBenchAccount &account = RandomAccount();
+            auto pTx               = std::make_shared<CLuaContractInvokeTx>();
+            pTx->txUid             = account.regid;
+            pTx->app_uid           = contractRegId;
+            pTx->valid_height      = nValidHeight;
+            pTx->llFees            = BENCH_INVOKE_FEE;
+            pTx->coin_amount       = 0;
+            pTx->arguments         = string((const char *)&nSeq, sizeof(nSeq));
+            AddTx(pTx, account.key, BENCH_CONTRACT);
+            continue;
+        }
+
+        CBenchAccount &from = RandomAccount();
+        CBenchAccount &to   = RandomAccount();
+        AddTx(std::make_shared<CCoinTransferTx>(from.regid, to.regid, nValidHeight, SYMB::WICC,
+                                                CBaseTx::nDustAmountThreshold + nSeq, SYMB::WICC, BENCH_TX_FEE, ""),
+              from.key, BENCH_TRANSFER);
+    }
+}
+
+std::unique_ptr<CBlock> CBenchChain::CreateBlock(int32_t nHeight, int64_t nBlockTime) {
+    auto spCW = std::make_shared<CCacheWrapper>(pCdMan);
+
+    std::unique_ptr<CBlock> pBlock;
+    if (nHeight == (int32_t)SysCfg().GetStableCoinGenesisHeight()) {
+        pBlock = CreateStableCoinGenesisBlock();
+        // the DEX matching service account goes to a key of the bench so that it can settle orders
+        if (pBlock && pBlock->vptx.size() == 4)
+            pBlock->vptx[3] = std::make_shared<CCoinRewardTx>(matchKey.GetPubKey(), nHeight, SYMB::WGRT, 0);
+    } else if (GetFeatureForkVersion(nHeight) == MAJOR_VER_R1) {
+        pBlock = CreateNewBlockPreStableCoinRelease(*spCW);
+    } else {
+        pBlock = CreateNewBlockStableCoinRelease(*spCW);
+    }
+    if (!pBlock)
+        return nullptr;
+
+    spCW->delegateCache.Clear();
+    CRegID delegateRegId;
+    CAccount delegate;
+    if (!GetBlockDelegate(nBlockTime, nHeight, *spCW, delegateRegId) ||
+        !spCW->accountCache.GetAccount(delegateRegId, delegate)) {
+        ERRORMSG("CreateBlock() : failed to get the delegate of block %d", nHeight);
+        return nullptr;
+    }
+
+    LOCK2(cs_main, pWalletMain->cs_wallet);
+    if (!CreateBlockRewardTx(nBlockTime, delegate, spCW->accountCache, pBlock.get()))
+        return nullptr;
+
+    return pBlock;
+}
+
+void CBenchChain::OnBlockConnected(const CBlock &block) {
+    AssertLockHeld(cs_main);
+
+    if (block.GetHeight() == SysCfg().GetStableCoinGenesisHeight()) {
+        // pay the settle fees of the matching service
+        CAccount matchAccount;
+        if (pCdMan->pAccountCache->GetAccount(SysCfg().GetDexMatchSvcRegId(), matchAccount) &&
+            matchAccount.OperateBalance(SYMB::WICC, ADD_FREE, BENCH_ACCOUNT_BALANCE))
+            pCdMan->pAccountCache->SaveAccount(matchAccount);
+        pCdMan->Flush();
+    }
+
+    if (!deployTxId.IsNull() && contractRegId.IsEmpty() && (int32_t)block.GetHeight() == nDeployHeight) {
+        for (size_t i = 1; i < block.vptx.size(); i++) {
+            if (block.vptx[i]->GetHash() == deployTxId)
+                contractRegId = CRegID(block.GetHeight(), i);
+        }
+        if (contractRegId.IsEmpty())
+            deployTxId.SetNull();  // redeploy next block
+    }
+
+    for (const auto &deal : vPendingDeals) {
+        CDEXOrderDetail buyOrder, sellOrder;
+        if (pCdMan->pDexCache->GetActiveOrder(deal.buyOrderId, buyOrder) &&
+            pCdMan->pDexCache->GetActiveOrder(deal.sellOrderId, sellOrder))
+            vConfirmedDeals.push_back(deal);
+    }
+    vPendingDeals.clear();
+
+    for (auto &account : vAccounts) {
+        if (account.cdpState == CDP_STAKING || account.cdpState == CDP_REDEEMING) {
+            CUserCDP cdp;
+            account.cdpState = pCdMan->pCdpCache->GetCDP(account.cdpTxId, cdp) ? CDP_OPEN : CDP_NONE;
+        }
+    }
+
+    // unpacked txs are dropped, the next block starts from an empty mempool
+    mempool.Clear();
+}
+
+bool CBenchChain::ProduceBlock(int32_t nBlockTxs, CBenchStats *pStats) {
+    int32_t nHeight;
+    int64_t nBlockTime;
+    {
+        LOCK(cs_main);
+        nHeight    = chainActive.Height() + 1;
+        nBlockTime = chainActive.Tip()->GetBlockTime() + GetBlockInterval(nHeight);
+    }
+    SetMockTime(nBlockTime);
+
+    vBlockTxs.clear();
+    mapBlockTxTypes.clear();
+    // txs are checked against the tip, which must be past the fork for the stable coin tx types
+    if (GetFeatureForkVersion(nHeight - 1) != MAJOR_VER_R1)
+        GenerateTxs(nHeight, pStats ? nBlockTxs : 0);
+
+    {
+        LOCK(cs_main);
+        for (const auto &pTx : vBlockTxs) {
+            BenchTxType type = mapBlockTxTypes[pTx->GetHash()];
+            CValidationState state;
+            int64_t nStart = GetTimeMicros();
+            bool fAccepted = AcceptToMemoryPool(mempool, state, pTx.get(), false);
+            int64_t nTime  = GetTimeMicros() - nStart;
+            if (!pStats)
+                continue;
+
+            pStats->admission.Add(nTime);
+            pStats->vGenerated[type]++;
+            if (!fAccepted) {
+                pStats->vRejected[type]++;
+                if (pStats->vRejectReasons[type].empty())
+                    pStats->vRejectReasons[type] = state.GetRejectReason();
+            }
+        }
+    }
+
+    int64_t nStart = GetTimeMicros();
+    std::unique_ptr<CBlock> pBlock = CreateBlock(nHeight, nBlockTime);
+    int64_t nPackingTime = GetTimeMicros() - nStart;
+    if (!pBlock)
+        return ERRORMSG("ProduceBlock() : failed to create block %d", nHeight);
+
+    LOCK(cs_main);
+    CValidationState state;
+    nStart = GetTimeMicros();
+    if (!ProcessBlock(state, nullptr, pBlock.get()) || chainActive.Tip()->GetBlockHash() != pBlock->GetHash())
+        return ERRORMSG("ProduceBlock() : failed to connect block %d, %s", nHeight, state.GetRejectReason());
+    int64_t nProcessingTime = GetTimeMicros() - nStart;
+
+    if (pStats) {
+        pStats->packing.Add(nPackingTime);
+        pStats->processing.Add(nProcessingTime);
+        pStats->nBlocks++;
+        for (const auto &pTx : pBlock->vptx) {
+            auto it = mapBlockTxTypes.find(pTx->GetHash());
+            if (it == mapBlockTxTypes.end())
+                continue;
+            pStats->vPacked[it->second]++;
+            pStats->nBlockTxs++;
+        }
+    }
+
+    OnBlockConnected(*pBlock);
+    return true;
+}
+
+static void PrintStage(const string &name, uint64_t nCount, uint64_t nTxs, int64_t nTotalMicros, int64_t nAvg,
+                       int64_t nP50, int64_t nP90, int64_t nP99, int64_t nMax) {
+    double dTxRate = nTotalMicros > 0 ? nTxs * 1000000.0 / nTotalMicros : 0;
+    fprintf(stdout, "%-18s %8llu %10.1f %10lld %10lld %10lld %10lld %10lld\n", name.c_str(),
+            (unsigned long long)nCount, dTxRate, (long long)nAvg, (long long)nP50, (long long)nP90, (long long)nP99,
+            (long long)nMax);
+}
+
+static void PrintStage(const string &name, uint64_t nTxs, const CBenchTimer &timer) {
+    PrintStage(name, timer.GetCount(), nTxs, timer.GetTotal(), timer.GetAverage(), timer.GetPercentile(50),
+               timer.GetPercentile(90), timer.GetPercentile(99), timer.GetPercentile(100));
+}
+
+static void PrintStage(const string &name, uint64_t nTxs, const CLatencyHistogram &histogram) {
+    PrintStage(name, histogram.GetCount(), nTxs, histogram.GetAverage() * histogram.GetCount(),
+               histogram.GetAverage(), histogram.GetPercentile(50), histogram.GetPercentile(90),
+               histogram.GetPercentile(99), histogram.GetMax());
+}
+
+static void PrintReport(const CBenchStats &stats) {
+    uint64_t nAdmitted = stats.admission.GetCount();
+
+    fprintf(stdout, "\n%llu blocks, %llu txs packed\n\n", (unsigned long long)stats.nBlocks,
+            (unsigned long long)stats.nBlockTxs);
+    fprintf(stdout, "%-18s %8s %10s %10s %10s %10s %10s %10s\n", "stage", "count", "tx/s", "avg(us)", "p50(us)",
+            "p90(us)", "p99(us)", "max(us)");
+    PrintStage("mempool admission", nAdmitted, stats.admission);
+    PrintStage("block packing", stats.nBlockTxs, stats.packing);
+    PrintStage("ConnectBlock", stats.nBlockTxs, blockConnectLatency);
+    PrintStage("flush", stats.nBlockTxs, blockPersistLatency);
+    PrintStage("ProcessBlock", stats.nBlockTxs, stats.processing);
+    fprintf(stdout, "ConnectBlock and flush percentiles are upper bounds of power-of-two buckets\n\n");
+
+    fprintf(stdout, "%-18s %10s %10s %10s  %s\n", "tx type", "generated", "rejected", "packed", "first reject reason");
+    for (int32_t type = 0; type < BENCH_TX_TYPE_COUNT; type++) {
+        fprintf(stdout, "%-18s %10llu %10llu %10llu  %s\n", kBenchTxTypeNames[type],
+                (unsigned long long)stats.vGenerated[type], (unsigned long long)stats.vRejected[type],
+                (unsigned long long)stats.vPacked[type], stats.vRejectReasons[type].c_str());
+    }
+}
+
+static bool ParseMix(const string &strMix, vector<uint32_t> &vWeights) {
+    vWeights.assign(BENCH_DEX_SETTLE, 0);
+
+    vector<string> vItems;
+    boost::split(vItems, strMix, boost::is_any_of(","));
+    for (const auto &item : vItems) {
+        vector<string> vPair;
+        boost::split(vPair, item, boost::is_any_of(":"));
+        if (vPair.size() != 2)
+            return false;
+
+        auto it = std::find(kBenchTxTypeNames, kBenchTxTypeNames + BENCH_DEX_SETTLE, vPair[0]);
+        if (it == kBenchTxTypeNames + BENCH_DEX_SETTLE)
+            return false;
+        vWeights[it - kBenchTxTypeNames] = atoi(vPair[1]);
+    }
+
+    for (auto nWeight : vWeights) {
+        if (nWeight > 0)
+            return true;
+    }
+    return false;
+}
+
+static void PrintUsage() {
+    fprintf(stdout,
+            "Usage: bench_coin [options] [node options]\n\n"
+            "  -accounts=<n>       Number of funded accounts (default: %d, max: %d)\n"
+            "  -blocks=<n>         Number of measured blocks (default: %d)\n"
+            "  -blocktxs=<n>       User txs generated per block, price feeds and settles excluded (default: %d)\n"
+            "  -mix=<type:weight>  Tx mix of transfer, dex, cdp and contract (default: %s)\n"
+            "  -warmupblocks=<n>   Blocks before the measured ones, at least up to the stable coin fork (default: 3 past the fork)\n"
+            "  -datadir=<dir>      Use this empty datadir instead of a temporary one\n"
+            "  -keepdatadir        Keep the temporary datadir\n"
+            "  -micro=<name>       Only run the micro benchmark of name without a node, one of: %s\n\n"
+            "Other options are passed to the node, e.g. -dbcache or -rpcport.\n",
+            DEFAULT_BENCH_ACCOUNTS, MAX_BENCH_ACCOUNTS, DEFAULT_BENCH_BLOCKS, DEFAULT_BENCH_BLOCK_TXS,
+            DEFAULT_BENCH_MIX, boost::algorithm::join(GetMicroBenchNames(), ", ").c_str());
+}
+
+int main(int argc, char *argv[]) {
+    SetupEnvironment();
+
+    CBaseParams::ParseParameters(argc, argv);
+    if (CBaseParams::IsArgCount("-?") || CBaseParams::IsArgCount("-help")) {
+        PrintUsage();
+        return 0;
+    }
+
+    if (CBaseParams::IsArgCount("-micro")) {
+        if (!RunMicroBench(CBaseParams::GetArg("-micro", ""))) {
+            PrintUsage();
+            return 1;
+        }
+        return 0;
+    }
+
+    int32_t nAccounts  = CBaseParams::GetArg("-accounts", DEFAULT_BENCH_ACCOUNTS);
+    int32_t nBlocks    = CBaseParams::GetArg("-blocks", DEFAULT_BENCH_BLOCKS);
+    int32_t nBlockTxs  = CBaseParams::GetArg("-blocktxs", DEFAULT_BENCH_BLOCK_TXS);
+    int32_t nWarmup    = CBaseParams::GetArg("-warmupblocks", 0);
+    bool fKeepDataDir  = CBaseParams::GetBoolArg("-keepdatadir", false);
+    string strDataDir  = CBaseParams::GetArg("-datadir", "");
+    vector<uint32_t> vWeights;
+    if (nAccounts < 2 || nAccounts > MAX_BENCH_ACCOUNTS || nBlocks <= 0 || nBlockTxs < 0 ||
+        !ParseMix(CBaseParams::GetArg("-mix", DEFAULT_BENCH_MIX), vWeights)) {
+        PrintUsage();
+        return 1;
+    }
+
+    boost::filesystem::path dataDir(strDataDir);
+    bool fTempDataDir = strDataDir.empty();
+    if (fTempDataDir)
+        dataDir = boost::filesystem::temp_directory_path() / boost::filesystem::unique_path("bench_coin_%%%%%%%%");
+    boost::filesystem::create_directories(dataDir);
+
+    // bench defaults first, the options given on the command line override them
+    vector<string> vArgs = {argv[0], "-datadir=" + dataDir.string(), "-nettype=regtest", "-listen=0",
+                            "-dnsseed=0", "-genblock=0"};
+    for (int i = 1; i < argc; i++)
+        vArgs.push_back(argv[i]);
+    vector<const char *> vArgv;
+    for (const auto &arg : vArgs)
+        vArgv.push_back(arg.c_str());
+
+    boost::thread_group threadGroup;
+    bool fRet = false;
+    try {
+        if (!CBaseParams::InitializeParams(vArgv.size(), vArgv.data()) || !SysCfg().InitializeConfig() ||
+            !AppInit(threadGroup) || pWalletMain == nullptr) {
+            fprintf(stderr, "Error: failed to start the node in %s\n", dataDir.string().c_str());
+        } else {
+            int32_t nForkHeight = SysCfg().GetFeatureForkHeight();
+            nWarmup             = std::max<int32_t>(nWarmup, nForkHeight + 3);
+
+            CBenchChain chain(vWeights);
+            CBenchStats stats;
+            fprintf(stdout, "Seeding %d accounts in %s\n", nAccounts, dataDir.string().c_str());
+            fRet = chain.Seed(nAccounts);
+
+            for (int32_t i = 0; fRet && i < nWarmup; i++)
+                fRet = chain.ProduceBlock(0, nullptr);
+
+            blockConnectLatency.Reset();
+            blockPersistLatency.Reset();
+            fprintf(stdout, "Producing %d blocks of %d txs after %d warmup blocks\n", nBlocks, nBlockTxs, nWarmup);
+            for (int32_t i = 0; fRet && i < nBlocks; i++)
+                fRet = chain.ProduceBlock(nBlockTxs, &stats);
+
+            if (fRet)
+                PrintReport(stats);
+            else
+                fprintf(stderr, "Error: failed to produce blocks, see debug.log in %s\n", dataDir.string().c_str());
+        }
+    } catch (std::exception &e) {
+        PrintExceptionContinue(&e, "bench_coin");
+        fRet = false;
+    }
+
+    StartShutdown();
+    Interrupt();
+    threadGroup.interrupt_all();
+    threadGroup.join_all();
+    Shutdown();
+
+    if (fTempDataDir && !fKeepDataDir)
+        boost::filesystem::remove_all(dataDir);
+
+    return fRet ? 0 : 1;
+}
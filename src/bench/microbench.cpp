@@ -0,0 +1,162 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "microbench.h"
+
+#include "commons/random.h"
+#include "commons/util.h"
+#include "config/const.h"
+#include "crypto/hash.h"
+#include "crypto/sha256.h"
+#include "entities/account.h"
+#include "entities/key.h"
+#include "persistence/dbaccess.h"
+
+#include <stdio.h>
+
+using namespace std;
+
+typedef std::pair<CKeyID, TokenSymbol> TokenKey;
+
+template<CacheLayout LAYOUT>
+using TokenCache = CCompositeKVCache<dbk::KEYID_ACCOUNT_TOKEN, TokenKey, CAccountToken, LAYOUT>;
+
+// create, lookup, flush and destroy a tx layer for each transfer of a block
+template<CacheLayout LAYOUT>
+static int64_t BenchTransfers(const vector<TokenKey> &vKeys, int32_t nTxs) {
+    CDBAccess dbAccess(DBNameType::ACCOUNT, true, true);
+    TokenCache<LAYOUT> dbCache(&dbAccess);
+    CAccountToken token;
+    token.free_amount = COIN;
+    for (const auto &key : vKeys)
+        dbCache.SetData(key, token);
+    dbCache.Flush();
+
+    TokenCache<LAYOUT> blockCache(&dbCache);
+    int64_t nStart = GetTimeMicros();
+    for (int32_t i = 0; i < nTxs; i++) {
+        TokenCache<LAYOUT> txCache(&blockCache);
+        const TokenKey &from = vKeys[i % vKeys.size()];
+        const TokenKey &to   = vKeys[(i * 7 + 1) % vKeys.size()];
+
+        CAccountToken fromToken, toToken;
+        txCache.GetData(from, fromToken);
+        txCache.GetData(to, toToken);
+        fromToken.free_amount -= 1;
+        toToken.free_amount += 1;
+        txCache.SetData(from, fromToken);
+        txCache.SetData(to, toToken);
+        txCache.Flush();
+    }
+    return GetTimeMicros() - nStart;
+}
+
+static void BenchCacheLayers() {
+    vector<TokenKey> vKeys;
+    for (int32_t i = 0; i < 2000; i++) {
+        CKeyID keyId;
+        GetRandBytes(keyId.begin(), keyId.size());
+        vKeys.push_back(TokenKey(keyId, SYMB::WICC));
+    }
+
+    const int32_t nTxs = 20000;
+    int64_t nOrderedTime = BenchTransfers<CacheLayout::ORDERED>(vKeys, nTxs);
+    int64_t nHashedTime  = BenchTransfers<CacheLayout::HASHED>(vKeys, nTxs);
+    fprintf(stdout, "%d transfer tx layers: %lld us with ordered layers, %lld us with hashed layers\n", nTxs,
+            (long long)nOrderedTime, (long long)nHashedTime);
+}
+
+static void BenchMerkleRoot() {
+    fprintf(stdout, "sha256 implementation: %s\n", SHA256AutoDetect().c_str());
+
+    // tx counts of an empty, a typical and a full block
+    for (size_t count : {100, 1000, 5000, 20000}) {
+        vector<uint256> vLeaves(count);
+        for (auto &leaf : vLeaves)
+            GetRandBytes(leaf.begin(), leaf.size());
+        const int32_t nRounds = 20;
+
+        int64_t nStart = GetTimeMicros();
+        uint256 reference;
+        for (int32_t i = 0; i < nRounds; i++)
+            reference = ComputeMerkleRootPairwise(vLeaves);
+        int64_t nReferenceTime = (GetTimeMicros() - nStart) / nRounds;
+
+        nStart = GetTimeMicros();
+        uint256 batched;
+        for (int32_t i = 0; i < nRounds; i++)
+            batched = ComputeMerkleRoot(vLeaves);
+        int64_t nBatchedTime = (GetTimeMicros() - nStart) / nRounds;
+
+        fprintf(stdout, "merkle root of %u txs: %lld us one pair at a time, %lld us batched%s\n", (uint32_t)count,
+                (long long)nReferenceTime, (long long)nBatchedTime, batched == reference ? "" : " (MISMATCH)");
+    }
+}
+
+// verify the block signatures of the same few delegates over and over, as a node catching up does
+static int64_t BenchVerify(const vector<CPubKey> &vPubKeys, const vector<vector<unsigned char> > &vSigs,
+                           const uint256 &hashMsg, int32_t nRounds, bool &fAllValid) {
+    int64_t nStart = GetTimeMicros();
+    for (int32_t round = 0; round < nRounds; round++) {
+        for (size_t i = 0; i < vPubKeys.size(); i++)
+            fAllValid &= vPubKeys[i].Verify(hashMsg, vSigs[i]);
+    }
+    return GetTimeMicros() - nStart;
+}
+
+static void BenchPubKeyCache() {
+    ECC_Start();
+
+    string strMsg   = "Block signed by a delegate";
+    uint256 hashMsg = Hash(strMsg.begin(), strMsg.end());
+    vector<CPubKey> vPubKeys;
+    vector<vector<unsigned char> > vSigs;
+    for (int32_t i = 0; i < 11; i++) {
+        CKey key;
+        key.MakeNewKey(true);
+        vPubKeys.push_back(key.GetPubKey());
+        vSigs.push_back(vector<unsigned char>());
+        key.Sign(hashMsg, vSigs.back());
+    }
+
+    const int32_t nRounds = 2000;
+    bool fAllValid        = true;
+    SetPubKeyCacheSize(0);
+    int64_t nUncachedTime = BenchVerify(vPubKeys, vSigs, hashMsg, nRounds, fAllValid);
+    SetPubKeyCacheSize(DEFAULT_PUBKEY_CACHE_SIZE);
+    int64_t nCachedTime = BenchVerify(vPubKeys, vSigs, hashMsg, nRounds, fAllValid);
+    fprintf(stdout, "%d signatures of %u signers: %lld us without the pubkey cache, %lld us with it%s\n",
+            nRounds * (int32_t)vPubKeys.size(), (uint32_t)vPubKeys.size(), (long long)nUncachedTime,
+            (long long)nCachedTime, fAllValid ? "" : " (INVALID)");
+
+    ECC_Stop();
+}
+
+struct CMicroBench {
+    const char *name;
+    void (*run)();
+};
+
+static const CMicroBench kMicroBenches[] = {
+    {"kvcache", &BenchCacheLayers},
+    {"merkle", &BenchMerkleRoot},
+    {"pubkey", &BenchPubKeyCache},
+};
+
+vector<string> GetMicroBenchNames() {
+    vector<string> vNames;
+    for (const auto &bench : kMicroBenches)
+        vNames.push_back(bench.name);
+    return vNames;
+}
+
+bool RunMicroBench(const string &name) {
+    for (const auto &bench : kMicroBenches) {
+        if (name == bench.name) {
+            bench.run();
+            return true;
+        }
+    }
+    return false;
+}
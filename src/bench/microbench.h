@@ -0,0 +1,17 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef BENCH_MICROBENCH_H
+#define BENCH_MICROBENCH_H
+
+#include <string>
+#include <vector>
+
+/** Names of the micro benchmarks, which time a single component without starting a node */
+std::vector<std::string> GetMicroBenchNames();
+
+/** Run the micro benchmark of name and print its timings, false if there is no such benchmark */
+bool RunMicroBench(const std::string &name);
+
+#endif  // BENCH_MICROBENCH_H
@@ -29,7 +29,6 @@
 #include <boost/type_traits/is_fundamental.hpp>
 
 class CAutoFile;
-class CDataStream;
 class CBaseTx;
 
 static const uint32_t MAX_SIZE           = 0x02000000;
@@ -869,17 +868,21 @@ inline void SerConvertValue(const SerializeType &value, OriginType &origin) {
     origin = OriginType(value);
 }
 
-typedef vector<char, zero_after_free_allocator<char> > CSerializeData;
+/** Buffer of database and network data, which is not secret and need not be cleansed when freed */
+typedef vector<char> CSerializeData;
+/** Buffer of wallet and key material, cleansed when freed */
+typedef vector<char, zero_after_free_allocator<char> > CSecureSerializeData;
 
 /** Double ended buffer combining vector and stream-like interfaces.
  *
  * >> and << read and write unformatted data using the above serialization templates.
  * Fills with data in linear time; some stringstream implementations take N^2 time.
  */
-class CDataStream
+template <typename SerializeData>
+class CBaseDataStream
 {
 protected:
-    typedef CSerializeData vector_type;
+    typedef SerializeData vector_type;
     vector_type vch;
     unsigned int nReadPos;
     short state;
@@ -888,48 +891,44 @@ public:
     int nType;
     int nVersion;
 
-    typedef vector_type::allocator_type   allocator_type;
-    typedef vector_type::size_type        size_type;
-    typedef vector_type::difference_type  difference_type;
-    typedef vector_type::reference        reference;
-    typedef vector_type::const_reference  const_reference;
-    typedef vector_type::value_type       value_type;
-    typedef vector_type::iterator         iterator;
-    typedef vector_type::const_iterator   const_iterator;
-    typedef vector_type::reverse_iterator reverse_iterator;
-
-    explicit CDataStream(int nTypeIn, int nVersionIn)
+    typedef typename vector_type::allocator_type   allocator_type;
+    typedef typename vector_type::size_type        size_type;
+    typedef typename vector_type::difference_type  difference_type;
+    typedef typename vector_type::reference        reference;
+    typedef typename vector_type::const_reference  const_reference;
+    typedef typename vector_type::value_type       value_type;
+    typedef typename vector_type::iterator         iterator;
+    typedef typename vector_type::const_iterator   const_iterator;
+    typedef typename vector_type::reverse_iterator reverse_iterator;
+
+    explicit CBaseDataStream(int nTypeIn, int nVersionIn)
     {
         Init(nTypeIn, nVersionIn);
     }
 
-    CDataStream(const_iterator pbegin, const_iterator pend, int nTypeIn, int nVersionIn) : vch(pbegin, pend)
+    CBaseDataStream(const_iterator pbegin, const_iterator pend, int nTypeIn, int nVersionIn) : vch(pbegin, pend)
     {
         Init(nTypeIn, nVersionIn);
     }
 
 #if !defined(_MSC_VER) || _MSC_VER >= 1300
-    CDataStream(const char* pbegin, const char* pend, int nTypeIn, int nVersionIn) : vch(pbegin, pend)
+    CBaseDataStream(const char* pbegin, const char* pend, int nTypeIn, int nVersionIn) : vch(pbegin, pend)
     {
         Init(nTypeIn, nVersionIn);
     }
 #endif
 
-    CDataStream(const vector_type& vchIn, int nTypeIn, int nVersionIn) : vch(vchIn.begin(), vchIn.end())
+    template <typename Allocator>
+    CBaseDataStream(const vector<char, Allocator>& vchIn, int nTypeIn, int nVersionIn) : vch(vchIn.begin(), vchIn.end())
     {
         Init(nTypeIn, nVersionIn);
     }
 
-    CDataStream(const vector<char>& vchIn, int nTypeIn, int nVersionIn) : vch(vchIn.begin(), vchIn.end())
-    {
-        Init(nTypeIn, nVersionIn);
-    }
-
-    CDataStream(const string & str, int nTypeIn, int nVersionIn) : vch(str.begin(), str.end()) {
+    CBaseDataStream(const string & str, int nTypeIn, int nVersionIn) : vch(str.begin(), str.end()) {
         Init(nTypeIn, nVersionIn);
     }
 
-    CDataStream(const vector<unsigned char>& vchIn, int nTypeIn, int nVersionIn) : vch((char*)&vchIn.begin()[0], (char*)&vchIn.end()[0])
+    CBaseDataStream(const vector<unsigned char>& vchIn, int nTypeIn, int nVersionIn) : vch((char*)&vchIn.begin()[0], (char*)&vchIn.end()[0])
     {
         Init(nTypeIn, nVersionIn);
     }
@@ -943,15 +942,15 @@ public:
         exceptmask = ios::badbit | ios::failbit;
     }
 
-    CDataStream& operator+=(const CDataStream& b)
+    CBaseDataStream& operator+=(const CBaseDataStream& b)
     {
         vch.insert(vch.end(), b.begin(), b.end());
         return *this;
     }
 
-    friend CDataStream operator+(const CDataStream& a, const CDataStream& b)
+    friend CBaseDataStream operator+(const CBaseDataStream& a, const CBaseDataStream& b)
     {
-        CDataStream ret = a;
+        CBaseDataStream ret = a;
         ret += b;
         return (ret);
     }
@@ -1075,8 +1074,8 @@ public:
     bool good() const            { return !eof() && (state == 0); }
     void clear(short n)          { state = n; }  // name conflict with vector clear()
     short exceptions()           { return exceptmask; }
-    short exceptions(short mask) { short prev = exceptmask; exceptmask = mask; setstate(0, "CDataStream"); return prev; }
-    CDataStream* rdbuf()         { return this; }
+    short exceptions(short mask) { short prev = exceptmask; exceptmask = mask; setstate(0, "CBaseDataStream"); return prev; }
+    CBaseDataStream* rdbuf()         { return this; }
     int in_avail()               { return size(); }
 
     void SetType(int n)          { nType = n; }
@@ -1086,7 +1085,7 @@ public:
     void ReadVersion()           { *this >> nVersion; }
     void WriteVersion()          { *this << nVersion; }
 
-    CDataStream& read(char* pch, int nSize)
+    CBaseDataStream& read(char* pch, int nSize)
     {
         // Read from the beginning of the buffer
         assert(nSize >= 0);
@@ -1095,7 +1094,7 @@ public:
         {
             if (nReadPosNext > vch.size())
             {
-                setstate(ios::failbit, "CDataStream::read() : end of data");
+                setstate(ios::failbit, "CBaseDataStream::read() : end of data");
                 memset(pch, 0, nSize);
                 nSize = vch.size() - nReadPos;
             }
@@ -1109,7 +1108,7 @@ public:
         return (*this);
     }
 
-    CDataStream& ignore(int nSize)
+    CBaseDataStream& ignore(int nSize)
     {
         // Ignore from the beginning of the buffer
         assert(nSize >= 0);
@@ -1117,7 +1116,7 @@ public:
         if (nReadPosNext >= vch.size())
         {
             if (nReadPosNext > vch.size())
-                setstate(ios::failbit, "CDataStream::ignore() : end of data");
+                setstate(ios::failbit, "CBaseDataStream::ignore() : end of data");
             nReadPos = 0;
             vch.clear();
             return (*this);
@@ -1126,7 +1125,7 @@ public:
         return (*this);
     }
 
-    CDataStream& write(const char* pch, int nSize)
+    CBaseDataStream& write(const char* pch, int nSize)
     {
         // Write to the end of the buffer
         assert(nSize >= 0);
@@ -1150,7 +1149,7 @@ public:
     }
 
     template<typename T>
-    CDataStream& operator<<(const T& obj)
+    CBaseDataStream& operator<<(const T& obj)
     {
         // Serialize to this stream
         ::Serialize(*this, obj, nType, nVersion);
@@ -1158,19 +1157,96 @@ public:
     }
 
     template<typename T>
-    CDataStream& operator>>(T& obj)
+    CBaseDataStream& operator>>(T& obj)
     {
         // Unserialize from this stream
         ::Unserialize(*this, obj, nType, nVersion);
         return (*this);
     }
 
-    void GetAndClear(CSerializeData &data) {
+    void GetAndClear(vector_type &data) {
         data.insert(data.end(), begin(), end());
         clear();
     }
 };
 
+/** Stream of database keys and values and of network messages */
+typedef CBaseDataStream<CSerializeData> CDataStream;
+/** Stream of wallet and key material */
+typedef CBaseDataStream<CSecureSerializeData> CSecureDataStream;
+
+/** Serializes to the end of a string, e.g. to build a database key without a temporary stream */
+class CStringWriter {
+private:
+    string &buffer;
+
+public:
+    int nType;
+    int nVersion;
+
+    CStringWriter(string &bufferIn, int nTypeIn, int nVersionIn)
+        : buffer(bufferIn), nType(nTypeIn), nVersion(nVersionIn) {}
+
+    CStringWriter& write(const char *pch, size_t size) {
+        buffer.append(pch, size);
+        return (*this);
+    }
+
+    template<typename T>
+    CStringWriter& operator<<(const T& obj) {
+        ::Serialize(*this, obj, nType, nVersion);
+        return (*this);
+    }
+};
+
+/**
+ * Unserializes from memory owned by someone else, e.g. a leveldb::Slice, without copying it to a
+ * stream first. The memory must outlive the reader.
+ */
+class CSpanReader {
+private:
+    const char *pBegin;
+    const char *pEnd;
+
+public:
+    int nType;
+    int nVersion;
+
+    CSpanReader(const char *pBeginIn, const char *pEndIn, int nTypeIn, int nVersionIn)
+        : pBegin(pBeginIn), pEnd(pEndIn), nType(nTypeIn), nVersion(nVersionIn) {}
+
+    CSpanReader(const string &str, int nTypeIn, int nVersionIn)
+        : CSpanReader(str.data(), str.data() + str.size(), nTypeIn, nVersionIn) {}
+
+    const char *begin() const { return pBegin; }
+    const char *end() const { return pEnd; }
+    size_t size() const { return pEnd - pBegin; }
+    bool empty() const { return pBegin == pEnd; }
+    bool eof() const { return empty(); }
+
+    CSpanReader& read(char *pch, size_t nSize) {
+        if (nSize > size())
+            throw ios_base::failure("CSpanReader::read() : end of data");
+        if (nSize > 0)
+            memcpy(pch, pBegin, nSize);
+        pBegin += nSize;
+        return (*this);
+    }
+
+    CSpanReader& ignore(size_t nSize) {
+        if (nSize > size())
+            throw ios_base::failure("CSpanReader::ignore() : end of data");
+        pBegin += nSize;
+        return (*this);
+    }
+
+    template<typename T>
+    CSpanReader& operator>>(T& obj) {
+        ::Unserialize(*this, obj, nType, nVersion);
+        return (*this);
+    }
+};
+
 
 
 /** RAII wrapper for FILE*.
@@ -422,11 +422,14 @@ CBaseParams::CBaseParams() {
     fReindex                = false;
     fBenchmark              = false;
     fTxIndex                = false;
+    fAddressIndex           = false;
     fLogFailures            = false;
     nLogMaxSize             = 100 * 1024 * 1024;  // 100M
     nTxCacheHeight          = 500;
     nTimeBestReceived       = 0;
     nCacheSize              = 300 << 10;  // 300K bytes
+    nPruneTarget            = 0;
+    nDbCache                = DEFAULT_DB_CACHE;
     payTxFee                = 10000;
     nDefaultPort            = 0;
     fPrintLogToConsole      = 0;
@@ -68,11 +68,14 @@ protected:
     mutable bool fReindex;
     mutable bool fBenchmark;
     mutable bool fTxIndex;
+    mutable bool fAddressIndex;
     mutable bool fLogFailures;
     mutable bool fGenReceipt;
     mutable int64_t nTimeBestReceived;
     mutable uint64_t payTxFee;
     mutable uint32_t nCacheSize;
+    mutable uint64_t nPruneTarget;  // -prune target of the undo files in bytes, 0 to keep all
+    mutable int64_t nDbCache;       // -dbcache in MiB, bounds the entries kept cached after a chain state flush
     mutable int32_t nTxCacheHeight;
     mutable uint32_t nLogMaxSize;  // to limit the maximum log file size in bytes
     mutable int32_t nMaxForkTime;  // to limit the maximum fork time in seconds.
@@ -124,12 +127,15 @@ public:
         te += strprintf("fReindex:%d\n",                            fReindex);
         te += strprintf("fBenchmark:%d\n",                          fBenchmark);
         te += strprintf("fTxIndex:%d\n",                            fTxIndex);
+        te += strprintf("fAddressIndex:%d\n",                       fAddressIndex);
         te += strprintf("fLogFailures:%d\n",                        fLogFailures);
         te += strprintf("nTimeBestReceived:%llu\n",                 nTimeBestReceived);
         te += strprintf("paytxfee:%llu\n",                          payTxFee);
         te += strprintf("nBlockIntervalPreStableCoinRelease:%u\n",  nBlockIntervalPreStableCoinRelease);
         te += strprintf("nBlockIntervalStableCoinRelease:%u\n",     nBlockIntervalStableCoinRelease);
         te += strprintf("nCacheSize:%u\n",                          nCacheSize);
+        te += strprintf("nPruneTarget:%llu\n",                      nPruneTarget);
+        te += strprintf("nDbCache:%lld\n",                          nDbCache);
         te += strprintf("nTxCacheHeight:%u\n",                      nTxCacheHeight);
         te += strprintf("nLogMaxSize:%u\n",                         nLogMaxSize);
         te += strprintf("nMaxForkTime:%d\n",                        nMaxForkTime);
@@ -185,16 +191,23 @@ public:
     bool IsReindex() const { return fReindex; }
     bool IsBenchmark() const { return fBenchmark; }
     bool IsTxIndex() const { return fTxIndex; }
+    bool IsAddressIndex() const { return fAddressIndex; }
     bool IsLogFailures() const { return fLogFailures; };
     bool IsGenReceipt() const { return fGenReceipt; };
     int64_t GetBestRecvTime() const { return nTimeBestReceived; }
     uint32_t GetCacheSize() const { return nCacheSize; }
+    bool IsPruneMode() const { return nPruneTarget > 0; }
+    uint64_t GetPruneTarget() const { return nPruneTarget; }
+    int64_t GetDbCache() const { return nDbCache; }
     int32_t GetTxCacheHeight() const { return nTxCacheHeight; }
     uint32_t GetLogMaxSize() const { return nLogMaxSize; }
     void SetImporting(bool flag) const { fImporting = flag; }
     void SetReIndex(bool flag) const { fReindex = flag; }
     void SetBenchMark(bool flag) const { fBenchmark = flag; }
     void SetTxIndex(bool flag) const { fTxIndex = flag; }
+    void SetAddressIndex(bool flag) const { fAddressIndex = flag; }
+    void SetPruneTarget(uint64_t target) const { nPruneTarget = target; }
+    void SetDbCache(int64_t nSize) const { nDbCache = nSize; }
     void SetLogFailures(bool flag) const { fLogFailures = flag; }
     void SetGenReceipt(bool flag) const { fGenReceipt = flag; }
     void SetBestRecvTime(int64_t nTime) const { nTimeBestReceived = nTime; }
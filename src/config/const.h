@@ -93,6 +93,56 @@ static const uint32_t MAX_ORPHAN_BLOCKS = 750;
 static const int32_t MAX_BLOCKS_IN_TRANSIT_PER_PEER = 128;
 /** Timeout in seconds before considering a block download peer unresponsive. */
 static const uint32_t BLOCK_DOWNLOAD_TIMEOUT  = 60;
+/** Number of blocks beyond the next one to be connected that header-first sync may request at once. */
+static const int32_t BLOCK_DOWNLOAD_WINDOW = 1024;
+/** Number of blocks that header-first sync keeps in flight to a single peer. */
+static const int32_t MAX_SYNC_BLOCKS_IN_FLIGHT_PER_PEER = 16;
+/** Timeout in seconds before a header-first block request is reassigned to another peer. */
+static const int64_t BLOCK_STALLING_TIMEOUT = 10;
+/** Number of stalls a peer may cause during header-first sync before it gets disconnected. */
+static const int32_t MAX_BLOCK_STALLS_PER_PEER = 3;
+/** Maximum number of headers returned by a single getheaders request. */
+static const int32_t MAX_HEADERS_RESULTS = 2000;
+/** Maximum number of known-but-unconnected headers kept by header-first sync. */
+static const int32_t MAX_PENDING_SYNC_HEADERS = 20000;
+/** Timeout in seconds before falling back to getblocks if the sync peer ignores getheaders. */
+static const int64_t HEADERS_RESPONSE_TIMEOUT = 60;
+/** Version of the compact block relay protocol announced with "sendcmpct" */
+static const uint64_t COMPACT_BLOCKS_VERSION = 1;
+/** Maximum depth of a block served as compact block, deeper ones are sent in full */
+static const int32_t MAX_CMPCTBLOCK_DEPTH = 5;
+/** Maximum depth of a block whose transactions are served by "getblocktxn" */
+static const int32_t MAX_BLOCKTXN_DEPTH = 10;
+/** -txvalidationthreads default, number of threads validating transactions received from peers */
+static const int32_t DEFAULT_TX_VALIDATION_THREADS = 2;
+/** max. -txvalidationthreads */
+static const int32_t MAX_TX_VALIDATION_THREADS = 16;
+/** Maximum number of peer transactions waiting for validation per thread */
+static const uint32_t MAX_TX_VALIDATION_QUEUE_SIZE = 5000;
+/** Maximum number of transactions of a single peer waiting for validation */
+static const uint32_t MAX_TX_VALIDATION_QUEUE_SIZE_PER_PEER = 500;
+/** Number of transactions admitted to the mempool per cs_main acquisition */
+static const uint32_t TX_VALIDATION_BATCH_SIZE = 64;
+/** Maximum number of raw transactions submitted by one submittxrawbatch call */
+static const uint32_t MAX_RPC_TX_BATCH_SIZE = 1000;
+/** Size of the text a streamed RPC reply buffers before sending it as an http chunk */
+static const uint32_t RPC_STREAM_CHUNK_SIZE = 64 * 1024;
+/** -notifyqueuesize default (MiB), event messages queued for a subscriber before they get dropped */
+static const uint32_t DEFAULT_NOTIFY_QUEUE_SIZE = 8;
+/** Maximum number of subscribers connected to the event notification server */
+static const uint32_t MAX_NOTIFY_SUBSCRIBERS = 32;
+
+/** -maxpubkeycachesize default, number of parsed public keys kept for signature verification */
+static const uint32_t DEFAULT_PUBKEY_CACHE_SIZE = 20000;
+
+/** Number of resolved regids kept in the hashed index of an account cache layer */
+static const uint32_t MAX_REGID_INDEX_SIZE = 1000000;
+
+/** Number of address index entries written per batch when building the index of an existing chain */
+static const uint32_t ADDRESS_INDEX_BATCH_SIZE = 100000;
+
+/** Maximum number of threads reading the block index database on startup */
+static const int32_t MAX_BLOCK_INDEX_LOAD_THREADS = 8;
 
 /** Minimum disk space required */
 static const uint64_t MIN_DISK_SPACE = 52428800;
@@ -102,6 +152,12 @@ static const uint32_t MAX_BLOCKFILE_SIZE = 0x8000000;  // 128 MiB
 static const uint32_t BLOCKFILE_CHUNK_SIZE = 0x1000000;  // 16 MiB
 /** The pre-allocation chunk size for rev?????.dat files (since 0.8) */
 static const uint32_t UNDOFILE_CHUNK_SIZE = 0x100000;  // 1 MiB
+/** Number of finalized block files kept memory-mapped for reading blocks and txs */
+static const uint32_t MAX_MAPPED_BLOCK_FILES = sizeof(void *) > 4 ? 32 : 4;
+/** Minimum -prune target (MiB) */
+static const uint64_t MIN_PRUNE_TARGET = 550;
+/** Number of blocks whose undo data is kept in -prune mode beyond the reorg horizon and the tx cache window of the tip */
+static const int32_t MIN_BLOCKS_TO_KEEP = 288;
 /** -dbcache default (MiB) */
 static const int64_t DEFAULT_DB_CACHE = 100;
 /** max. -dbcache in (MiB) */
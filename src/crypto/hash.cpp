@@ -1,4 +1,42 @@
 #include "hash.h"
+#include "crypto/sha256.h"
+
+static_assert(sizeof(uint256) == 32, "merkle levels are hashed as arrays of 64 byte blocks");
+
+void MerkleHashLevel(uint256 *out, const uint256 *in, size_t count)
+{
+    size_t pairs = count / 2;
+    if (pairs > 0)
+        SHA256D64(out[0].begin(), in[0].begin(), pairs);
+
+    if (count % 2 == 1) {
+        uint256 last[2] = {in[count - 1], in[count - 1]};
+        SHA256D64(out[pairs].begin(), last[0].begin(), 1);
+    }
+}
+
+uint256 ComputeMerkleRoot(vector<uint256> vLevel)
+{
+    while (vLevel.size() > 1) {
+        vector<uint256> vNext((vLevel.size() + 1) / 2);
+        MerkleHashLevel(&vNext[0], &vLevel[0], vLevel.size());
+        vLevel.swap(vNext);
+    }
+    return vLevel.empty() ? uint256() : vLevel[0];
+}
+
+uint256 ComputeMerkleRootPairwise(vector<uint256> vLevel)
+{
+    while (vLevel.size() > 1) {
+        vector<uint256> vNext;
+        for (size_t i = 0; i < vLevel.size(); i += 2) {
+            size_t i2 = min(i + 1, vLevel.size() - 1);
+            vNext.push_back(Hash(BEGIN(vLevel[i]), END(vLevel[i]), BEGIN(vLevel[i2]), END(vLevel[i2])));
+        }
+        vLevel.swap(vNext);
+    }
+    return vLevel.empty() ? uint256() : vLevel[0];
+}
 
 inline uint32_t ROTL32 ( uint32_t x, int8_t r )
 {
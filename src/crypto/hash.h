@@ -126,6 +126,22 @@ inline uint160 Hash160(const vector<unsigned char>& vch)
     return Hash160(vch.begin(), vch.end());
 }
 
+/**
+ * Hash one level of a merkle tree: out[i] = Hash(in[2i], in[2i+1]), the last hash paired with itself
+ * if count is odd. out must have room for (count + 1) / 2 hashes and must not overlap in. The pairs
+ * are hashed by the widest SHA256D64 kernel SHA256AutoDetect() found.
+ */
+void MerkleHashLevel(uint256 *out, const uint256 *in, size_t count);
+
+/** Merkle root of the leaves, each level hashed in one batch by MerkleHashLevel() */
+uint256 ComputeMerkleRoot(vector<uint256> vLevel);
+
+/**
+ * Merkle root of the leaves hashed one pair at a time, as blocks did before the batched kernels. It is
+ * the reference the tests and bench_coin check the batched hashing against.
+ */
+uint256 ComputeMerkleRootPairwise(vector<uint256> vLevel);
+
 unsigned int MurmurHash3(unsigned int nHashSeed, const vector<unsigned char>& vDataToHash);
 
 typedef struct
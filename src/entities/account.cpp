@@ -8,6 +8,7 @@
 #include "config/configuration.h"
 #include "config/const.h"
 #include "main.h"
+#include "persistence/accountdb.h"
 
 
  uint64_t CAccount::GetBalance(const TokenSymbol &tokenSymbol, const BalanceType balanceType) {
@@ -17,9 +18,10 @@
  }
 
 bool CAccount::GetBalance(const TokenSymbol &tokenSymbol, const BalanceType balanceType, uint64_t &value) {
+    assert(IsTokenLoaded(tokenSymbol));
     auto iter = tokens.find(tokenSymbol);
     if (iter != tokens.end()) {
-        auto accountToken = iter->second;
+        const CAccountToken &accountToken = iter->second;
         switch (balanceType) {
             case FREE_VALUE:    value = accountToken.free_amount;   return true;
             case STAKED_VALUE:  value = accountToken.staked_amount; return true;
@@ -33,7 +35,7 @@ bool CAccount::GetBalance(const TokenSymbol &tokenSymbol, const BalanceType bala
 
 bool CAccount::OperateBalance(const TokenSymbol &tokenSymbol, const BalanceOpType opType, const uint64_t &value) {
 
-    CAccountToken &accountToken = tokens[tokenSymbol];
+    CAccountToken &accountToken = GetMutableToken(tokenSymbol);
     switch (opType) {
         case ADD_FREE: {
             accountToken.free_amount += value;
@@ -192,7 +194,21 @@ uint64_t CAccount::ComputeBlockInflateInterest(const uint32_t currHeight) const
     return interest;
 }
 
+bool CAccount::IsSameIdentity(const CAccount &other) const {
+    return keyid == other.keyid && regid == other.regid && nickid == other.nickid &&
+           owner_pubkey == other.owner_pubkey && miner_pubkey == other.miner_pubkey &&
+           token_symbols == other.token_symbols && received_votes == other.received_votes &&
+           last_vote_height == other.last_vote_height;
+}
+
+CAccountToken &CAccount::GetMutableToken(const TokenSymbol &tokenSymbol) {
+    assert(IsTokenLoaded(tokenSymbol));
+    token_symbols.insert(tokenSymbol);
+    return tokens[tokenSymbol];
+}
+
 CAccountToken CAccount::GetToken(const TokenSymbol &tokenSymbol) const {
+    assert(IsTokenLoaded(tokenSymbol));
     auto iter = tokens.find(tokenSymbol);
     if (iter != tokens.end())
         return iter->second;
@@ -201,13 +217,17 @@ CAccountToken CAccount::GetToken(const TokenSymbol &tokenSymbol) const {
 }
 
 bool CAccount::SetToken(const TokenSymbol &tokenSymbol, const CAccountToken &accountToken) {
-    tokens[tokenSymbol] = accountToken;
+    GetMutableToken(tokenSymbol) = accountToken;
     return true;
 }
 
 Object CAccount::ToJsonObj() const {
+    return ToJsonObj(*pCdMan->pDelegateCache, chainActive.Height());
+}
+
+Object CAccount::ToJsonObj(CDelegateDBCache &delegateCache, int32_t height) const {
     vector<CCandidateReceivedVote> candidateVotes;
-    pCdMan->pDelegateCache->GetCandidateVotes(regid, candidateVotes);
+    delegateCache.GetCandidateVotes(regid, candidateVotes);
 
     Array candidateVoteArray;
     for (auto &vote : candidateVotes) {
@@ -215,7 +235,7 @@ Object CAccount::ToJsonObj() const {
     }
 
     Object tokenMapObj;
-    for (auto tokenPair : tokens) {
+    for (auto tokenPair : GetTokens()) {
         Object tokenObj;
         const CAccountToken &token = tokenPair.second;
         tokenObj.push_back(Pair("free_amount",      token.free_amount));
@@ -231,7 +251,7 @@ Object CAccount::ToJsonObj() const {
     obj.push_back(Pair("keyid",             keyid.ToString()));
     obj.push_back(Pair("nickid",            nickid.ToString()));
     obj.push_back(Pair("regid",             regid.ToString()));
-    obj.push_back(Pair("regid_mature",      regid.IsMature(chainActive.Height())));
+    obj.push_back(Pair("regid_mature",      regid.IsMature(height)));
     obj.push_back(Pair("owner_pubkey",      owner_pubkey.ToString()));
     obj.push_back(Pair("miner_pubkey",      miner_pubkey.ToString()));
     obj.push_back(Pair("tokens",            tokenMapObj));
@@ -244,7 +264,7 @@ Object CAccount::ToJsonObj() const {
 string CAccount::ToString() const {
     string str;
     string  strTokens = "";
-    for (auto pair : tokens) {
+    for (auto pair : GetTokens()) {
         CAccountToken &token = pair.second;
         strTokens += strprintf ("\n %s: {free=%llu, staked=%llu, frozen=%llu}\n",
                     pair.first, token.free_amount, token.staked_amount, token.frozen_amount);
@@ -10,6 +10,7 @@
 #include <functional>
 #include <map>
 #include <memory>
+#include <set>
 #include <string>
 #include <unordered_map>
 #include <vector>
@@ -25,6 +26,7 @@
 using namespace json_spirit;
 
 class CAccountDBCache;
+class CDelegateDBCache;
 
 enum BalanceType : uint8_t {
     NULL_TYPE    = 0,  //!< invalid type
@@ -78,24 +80,21 @@ public:
     CAccountToken(uint64_t& freeAmount, uint64_t& frozenAmount, uint64_t& stakedAmount, uint64_t& votedAmount)
         : free_amount(freeAmount), frozen_amount(frozenAmount), staked_amount(stakedAmount), voted_amount(votedAmount) {}
 
-    CAccountToken& operator=(const CAccountToken& other) {
-        if (this == &other)
-            return *this;
-
-        this->free_amount   = other.free_amount;
-        this->frozen_amount = other.frozen_amount;
-        this->staked_amount = other.staked_amount;
-        this->voted_amount  = other.voted_amount;
-
-        return *this;
-    }
-
     IMPLEMENT_SERIALIZE(
         READWRITE(VARINT(free_amount));
         READWRITE(VARINT(frozen_amount));
         READWRITE(VARINT(staked_amount));
         READWRITE(VARINT(voted_amount));
     )
+
+    bool operator==(const CAccountToken &other) const {
+        return free_amount == other.free_amount && frozen_amount == other.frozen_amount &&
+               staked_amount == other.staked_amount && voted_amount == other.voted_amount;
+    }
+    bool operator!=(const CAccountToken &other) const { return !(*this == other); }
+
+    bool IsEmpty() const { return free_amount == 0 && frozen_amount == 0 && staked_amount == 0 && voted_amount == 0; }
+    void SetEmpty() { free_amount = 0; frozen_amount = 0; staked_amount = 0; voted_amount = 0; }
 };
 
 typedef map<TokenSymbol, CAccountToken> AccountTokenMap;
@@ -103,6 +102,12 @@ typedef map<TokenSymbol, CAccountToken> AccountTokenMap;
 
 /**
  * Common or Contract Account
+ *
+ * The account is stored as an identity record, which holds the symbols of its tokens, and one
+ * balance record per token. CAccountDBCache reads the balances along with the identity record, all
+ * of them or just the ones a tx uses, so an account is a plain value which doesn't refer to the
+ * cache. Saving it writes the loaded balances which differ from the stored records back and leaves
+ * the records of the balances not loaded alone.
  */
 class CAccount {
 public:
@@ -113,7 +118,7 @@ public:
     CPubKey owner_pubkey;           //!< account public key
     CPubKey miner_pubkey;           //!< miner saving account public key
 
-    AccountTokenMap tokens;         //!< In total, 3 types of coins/tokens:
+    set<TokenSymbol> token_symbols; //!< In total, 3 types of coins/tokens:
                                     //!<    1) system-issued coins: WICC, WGRT
                                     //!<    2) miner-issued stablecoins WUSD|WCNY|...
                                     //!<    3) user-issued tokens (WRC20 compliant)
@@ -124,6 +129,9 @@ public:
 
     mutable uint256 sigHash;        //!< in-memory only
 
+private:
+    AccountTokenMap tokens;         //!< in-memory only: loaded balances of token_symbols, stored apart
+
 public:
     CAccount() : CAccount(CKeyID(), CNickID(), CPubKey()) {}
     CAccount(const CAccount& other) { *this = other; }
@@ -136,9 +144,10 @@ public:
         this->nickid           = other.nickid;
         this->owner_pubkey     = other.owner_pubkey;
         this->miner_pubkey     = other.miner_pubkey;
-        this->tokens           = other.tokens;
+        this->token_symbols    = other.token_symbols;
         this->received_votes   = other.received_votes;
         this->last_vote_height = other.last_vote_height;
+        this->tokens           = other.tokens;
 
         return *this;
     }
@@ -146,7 +155,6 @@ public:
     CAccount(const CKeyID& keyidIn, const CNickID& nickidIn, const CPubKey& ownerPubkeyIn)
         : keyid(keyidIn), nickid(nickidIn), owner_pubkey(ownerPubkeyIn), received_votes(0), last_vote_height(0) {
         miner_pubkey = CPubKey();
-        tokens.clear();
         regid.Clear();
     }
 
@@ -160,13 +168,24 @@ public:
         READWRITE(nickid);
         READWRITE(owner_pubkey);
         READWRITE(miner_pubkey);
-        READWRITE(tokens);
+        READWRITE(token_symbols);
         READWRITE(VARINT(received_votes));
         READWRITE(VARINT(last_vote_height));
     )
 
+    /** Whether the identity records of both accounts are the same, i.e. balances are not compared */
+    bool IsSameIdentity(const CAccount &other) const;
+
     CAccountToken GetToken(const TokenSymbol &tokenSymbol) const;
     bool SetToken(const TokenSymbol &tokenSymbol, const CAccountToken &accountToken);
+    /** Loaded balances of the account, by symbol of token_symbols */
+    const AccountTokenMap &GetTokens() const { return tokens; }
+    /** Replace the balances, e.g. with the ones read along with the identity record */
+    void SetTokens(const AccountTokenMap &tokensIn) { tokens = tokensIn; }
+    /** Whether the balance can be used, i.e. it was loaded or the account doesn't hold the token */
+    bool IsTokenLoaded(const TokenSymbol &tokenSymbol) const {
+        return tokens.count(tokenSymbol) || !token_symbols.count(tokenSymbol);
+    }
 
 
     uint64_t GetBalance(const TokenSymbol &tokenSymbol, const BalanceType balanceType);
@@ -186,11 +205,13 @@ public:
     bool HaveOwnerPubKey() const { return owner_pubkey.IsFullyValid(); }
     bool IsRegistered() const { return owner_pubkey.IsValid(); }
 
-    bool IsEmptyValue() const { return (tokens.size() == 0); }
+    bool IsEmptyValue() const { return token_symbols.empty(); }
     bool IsEmpty() const { return keyid.IsEmpty(); }
     void SetEmpty() { keyid.SetEmpty(); }  // TODO: need set other fields to empty()??
     string ToString() const;
     Object ToJsonObj() const;
+    /** JSON of the account in the given state, e.g. of a chain snapshot */
+    Object ToJsonObj(CDelegateDBCache &delegateCache, int32_t height) const;
 
     void SetRegId(CRegID & regIdIn) { regid = regIdIn; }
 
@@ -199,6 +220,9 @@ public:
 private:
     bool IsBcoinWithinRange(uint64_t nAddMoney);
     bool IsFcoinWithinRange(uint64_t nAddMoney);
+
+    /** Balance of the token to change, added to the account if it doesn't hold it yet */
+    CAccountToken &GetMutableToken(const TokenSymbol &tokenSymbol);
 };
 
 enum AccountType {
@@ -11,13 +11,84 @@
 #include "commons/base58.h"
 #include "commons/common.h"
 #include "commons/random.h"
+#include "config/const.h"
 #include "crypto/hash.h"
+#include "crypto/siphash.h"
 #include "lax_der_parsing.h"
 #include "lax_der_privatekey_parsing.h"
 
+#include <limits>
+#include <mutex>
+#include <unordered_map>
+
 static secp256k1_context *secp256k1_context_verify = nullptr;
 static secp256k1_context *secp256k1_context_sign   = nullptr;
 
+/**
+ * Bounded cache of parsed public keys. The same account and delegate keys sign over and over, caching
+ * them saves the secp256k1 parse of every verification, a field square root for compressed keys.
+ */
+class CPubKeyCache {
+private:
+    struct CPubKeyHasher {
+        uint64_t k0, k1;  // keys may be chosen by peers, so the bucket hash is salted
+        size_t operator()(const CPubKey &pubKey) const {
+            return CSipHasher(k0, k1).Write(pubKey.begin(), pubKey.size()).Finalize();
+        }
+    };
+
+    std::mutex mtx;
+    std::unordered_map<CPubKey, secp256k1_pubkey, CPubKeyHasher> mapParsed;
+    uint32_t nMaxSize = DEFAULT_PUBKEY_CACHE_SIZE;
+
+public:
+    CPubKeyCache()
+        : mapParsed(0, CPubKeyHasher{GetRand(std::numeric_limits<uint64_t>::max()),
+                                     GetRand(std::numeric_limits<uint64_t>::max())}) {}
+
+    void SetMaxSize(uint32_t nMaxSizeIn) {
+        std::unique_lock<std::mutex> lock(mtx);
+        nMaxSize = nMaxSizeIn;
+        if (mapParsed.size() > nMaxSize)
+            mapParsed.clear();
+    }
+
+    bool Parse(const CPubKey &pubKey, secp256k1_pubkey &parsed) {
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            auto it = mapParsed.find(pubKey);
+            if (it != mapParsed.end()) {
+                parsed = it->second;
+                return true;
+            }
+        }
+
+        if (!secp256k1_ec_pubkey_parse(secp256k1_context_verify, &parsed, pubKey.begin(), pubKey.size()))
+            return false;
+
+        std::unique_lock<std::mutex> lock(mtx);
+        if (nMaxSize == 0)
+            return true;
+
+        while (mapParsed.size() >= nMaxSize) {
+            // evict a random entry, like the signature cache
+            size_t nBucket = GetRand(mapParsed.bucket_count());
+            auto it        = mapParsed.begin(nBucket);
+            if (it != mapParsed.end(nBucket))
+                mapParsed.erase(it->first);
+        }
+        mapParsed.emplace(pubKey, parsed);
+        return true;
+    }
+};
+
+static CPubKeyCache &GetPubKeyCache() {
+    static CPubKeyCache cache;
+    return cache;
+}
+
+void SetPubKeyCacheSize(uint32_t nMaxSize) { GetPubKeyCache().SetMaxSize(nMaxSize); }
+
 // Check that the sig has a low R value and will be less than 71 bytes
 bool SigHasLowR(const secp256k1_ecdsa_signature *sig) {
     uint8_t compact_sig[64];
@@ -197,7 +268,7 @@ bool CPubKey::Verify(const uint256 &hash, const vector<uint8_t> &vchSig) const {
 
     secp256k1_pubkey pubkey;
     secp256k1_ecdsa_signature sig;
-    if (!secp256k1_ec_pubkey_parse(secp256k1_context_verify, &pubkey, vch, size())) {
+    if (!GetPubKeyCache().Parse(*this, pubkey)) {
         return false;
     }
     if (!ecdsa_signature_parse_der_lax(secp256k1_context_verify, &sig, vchSig.data(), vchSig.size())) {
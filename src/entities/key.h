@@ -429,4 +429,7 @@ void ECC_Stop();
 /** Check that required EC support is available at runtime. */
 bool ECC_InitSanityCheck();
 
+/** Limit the cache of parsed public keys used by CPubKey::Verify to nMaxSize keys, 0 disables it. */
+void SetPubKeyCacheSize(uint32_t nMaxSize);
+
 #endif  // ENTITIES_KEY_H
@@ -12,6 +12,7 @@
 #include "config/configuration.h"
 #include "addrman.h"
 
+#include "rpc/core/notifyserver.h"
 #include "rpc/core/rpcserver.h"
 #include "vm/luavm/lua/lua.h"
 #include "wallet/wallet.h"
@@ -19,12 +20,15 @@
 #include "main.h"
 #include "miner/miner.h"
 #include "net.h"
+#include "p2p/txvalidator.h"
 #include "persistence/blockdb.h"
 #include "persistence/accountdb.h"
 #include "persistence/txdb.h"
 #include "persistence/contractdb.h"
+#include "persistence/memcachedb.h"
 #include "tx/tx.h"
 #include "commons/util.h"
+#include "crypto/sha256.h"
 #ifdef USE_UPNP
 #include <miniupnpc/miniupnpc.h>
 #include <miniupnpc/miniwget.h>
@@ -63,6 +67,8 @@ using namespace boost;
 CWallet *pWalletMain;
 
 static std::unique_ptr<ECCVerifyHandle> globalVerifyHandle;
+// whether the tx and price point memory caches are complete and may be snapshotted on shutdown
+static bool fMemCachesLoaded = false;
 
 #ifdef WIN32
 // Win32 LevelDB doesn't use filedescriptors, and the ones used for
@@ -136,6 +142,11 @@ void Shutdown() {
 
     StopNode();
     UnregisterNodeSignals(GetNodeSignals());
+    {
+        // the txvalidator workers aren't joined, cs_main waits for one publishing an event
+        LOCK(cs_main);
+        StopNotifyServer();
+    }
 
     {
         LOCK(cs_main);
@@ -146,7 +157,11 @@ void Shutdown() {
         }
 
         if (pCdMan != nullptr) {
+            ResetChainSnapshot();
             pCdMan->Flush();
+            if (fMemCachesLoaded && chainActive.Tip() &&
+                !CMemCacheDB().Write(chainActive.Tip()->GetBlockHash(), *pCdMan->pTxCache, *pCdMan->pPpCache))
+                LogPrint("INFO", "Shutdown() : failed to write the memory cache snapshot\n");
             delete pCdMan;
             pCdMan = nullptr;
         }
@@ -217,6 +232,8 @@ string HelpMessage() {
     strUsage += "  -pid=<file>            " + _("Specify pid file (default: coin.pid)") + "\n";
     strUsage += "  -reindex               " + _("Rebuild block chain index from current blk000??.dat files") + " " + _("on startup") + "\n";
     strUsage += "  -txindex               " + _("Maintain a full transaction index (default: 0)") + "\n";
+    strUsage += "  -addressindex          " + _("Maintain an address to transaction index, see getaddresstxids (default: 0)") + "\n";
+    strUsage += "  -prune=<n>             " + strprintf(_("Delete old undo files to keep them below <n> MiB, at least %u (default: 0 = keep all)"), MIN_PRUNE_TARGET) + "\n";
     strUsage += "  -logfailures           " + _("Log failures into level db in detail (default: 0)") + "\n";
     strUsage += "  -genreceipt               " + _("Whether generate receipt(default: 0)") + "\n";
 
@@ -238,6 +255,7 @@ string HelpMessage() {
     strUsage += "  -onion=<ip:port>       " + _("Use separate SOCKS5 proxy to reach peers via Tor hidden services (default: -proxy)") + "\n";
     strUsage += "  -onlynet=<net>         " + _("Only connect to nodes in network <net> (IPv4, IPv6 or Tor)") + "\n";
     strUsage += "  -port=<port>           " + _("Listen for connections on <port> (default: 8333 or testnet: 18333)") + "\n";
+    strUsage += "  -txvalidationthreads=<n> " + strprintf(_("Number of threads validating transactions received from peers, 0 to validate them in the message handler (default: %d)"), DEFAULT_TX_VALIDATION_THREADS) + "\n";
     strUsage += "  -proxy=<ip:port>       " + _("Connect through SOCKS proxy") + "\n";
     strUsage += "  -ipuri=<ip:port/path>  " + _("IP Reporting Service URI") + "\n";
     strUsage += "  -seednode=<ip>         " + _("Connect to a node to retrieve peer addresses, and disconnect") + "\n";
@@ -285,6 +303,7 @@ string HelpMessage() {
     if (SysCfg().GetBoolArg("-help-debug", false)) {
         strUsage += "  -limitfreerelay=<n>    " + _("Continuously rate-limit free transactions to <n>*1000 bytes per minute (default:15)") + "\n";
         strUsage += "  -maxsigcachesize=<n>   " + _("Limit size of signature cache to <n> entries (default: 50000)") + "\n";
+        strUsage += "  -maxpubkeycachesize=<n> " + strprintf(_("Limit size of parsed public key cache to <n> entries (default: %u)"), DEFAULT_PUBKEY_CACHE_SIZE) + "\n";
     }
     strUsage += "  -minrelaytxfee=<amt>   " + _("Fees smaller than this are considered zero fee (for relaying) (default:") + " " + FormatMoney(CBaseTx::nMinRelayTxFee) + ")" + "\n";
     strUsage += "  -logprinttoconsole     " + _("Send trace/debug info to console instead of debug.log file") + "\n";
@@ -311,6 +330,9 @@ string HelpMessage() {
     strUsage += "  -rpcallowip=<ip>       " + _("Allow JSON-RPC connections from specified IP address") + "\n";
     strUsage += "  -rpcthreads=<n>        " + _("Set the number of threads to service RPC calls (default: 4)") + "\n";
 
+    strUsage += "  -notifyport=<port>     " + _("Publish block, mempool, DEX and CDP events to subscribers connecting to 127.0.0.1:<port> (default: 0, disabled)") + "\n";
+    strUsage += "  -notifyqueuesize=<n>   " + strprintf(_("Maximum per-subscriber queue of event messages, <n>*1 MB (default: %u)"), DEFAULT_NOTIFY_QUEUE_SIZE) + "\n";
+
     strUsage += "\n" + _("RPC SSL options: (see the Coin Wiki for SSL setup instructions)") + "\n";
     strUsage += "  -rpcssl                                  " + _("Use OpenSSL (https) for JSON-RPC connections") + "\n";
     strUsage += "  -rpcsslcertificatechainfile=<file.cert>  " + _("Server certificate file (default: server.cert)") + "\n";
@@ -384,6 +406,51 @@ void ThreadImport(vector<boost::filesystem::path> vImportFiles) {
     }
 }
 
+/** Reread the latest blocks into the tx and price point memory caches */
+static bool LoadMemCachesFromBlocks() {
+    int64_t nStart           = GetTimeMillis();
+    CBlockIndex *pBlockIndex = chainActive.Tip();
+    int32_t nCacheHeight     = SysCfg().GetTxCacheHeight();
+    int32_t nCount           = 0;
+    CBlock block;
+    while (pBlockIndex && nCacheHeight-- > 0) {
+        if (!ReadBlockFromDisk(pBlockIndex, block))
+            return InitError("Failed to read block from disk");
+
+        if (!pCdMan->pTxCache->AddBlockToCache(block))
+            return InitError("Failed to add block to transaction memory cache");
+
+        pBlockIndex = pBlockIndex->pprev;
+        ++nCount;
+    }
+    LogPrint("INFO", "Added the latest %d blocks to transaction memory cache (%dms)\n", nCount, GetTimeMillis() - nStart);
+
+    nStart       = GetTimeMillis();
+    pBlockIndex  = chainActive.Tip();
+    nCacheHeight = 11;  // TODO: parameterize 11.
+    nCount       = 0;
+
+    if (pBlockIndex) {
+        if (!ReadBlockFromDisk(pBlockIndex, block))
+            return InitError("Failed to read block from disk");
+        pCdMan->pPpCache->SetLatestBlockMedianPricePoints(block.GetBlockMedianPrice());
+    }
+
+    while (pBlockIndex && nCacheHeight-- > 0) {
+        if (!ReadBlockFromDisk(pBlockIndex, block))
+            return InitError("Failed to read block from disk");
+
+        if (!pCdMan->pPpCache->AddBlockToCache(block))
+            return InitError("Failed to add block to price point memory cache");
+
+        pBlockIndex = pBlockIndex->pprev;
+        ++nCount;
+    }
+    LogPrint("INFO", "Added the latest %d blocks to price point memory cache (%dms)\n", nCount, GetTimeMillis() - nStart);
+
+    return true;
+}
+
 /** Initialize Coin.
  *  @pre Parameters should be parsed and config file should be read.
  */
@@ -435,9 +502,13 @@ bool AppInit(boost::thread_group &threadGroup) {
     sa_hup.sa_flags = 0;
     sigaction(SIGHUP, &sa_hup, nullptr);
 
+    // Select the widest sha256 kernels the cpu supports, before anything hashes merkle trees
+    string sha256Algo = SHA256AutoDetect();
+
     // Initialize elliptic curve code
     ECC_Start();
     globalVerifyHandle.reset(new ECCVerifyHandle());
+    SetPubKeyCacheSize(max<int64_t>(0, SysCfg().GetArg("-maxpubkeycachesize", DEFAULT_PUBKEY_CACHE_SIZE)));
     // Sanity check
     if (!ECC_InitSanityCheck())
         return fprintf(stderr, "Elliptic curve cryptography sanity check failure. Aborting.");
@@ -522,6 +593,23 @@ bool AppInit(boost::thread_group &threadGroup) {
         }
     }
 
+    // -prune drops the undo files below the reorg horizon, the block files and the tx index stay as
+    // contracts read past txs by their hash
+    int64_t nPruneArg = SysCfg().GetArg("-prune", 0);
+    if (nPruneArg < 0)
+        return InitError(_("Prune cannot be configured with a negative value."));
+    if (nPruneArg > 0) {
+        if ((uint64_t)nPruneArg < MIN_PRUNE_TARGET)
+            return InitError(strprintf(_("Prune configured below the minimum of %u MiB. Please use a higher number."), MIN_PRUNE_TARGET));
+        SysCfg().SetPruneTarget((uint64_t)nPruneArg * 1024 * 1024);
+        LogPrint("INFO", "Prune mode enabled, keeping undo files below %d MiB\n", nPruneArg);
+    }
+
+    int64_t nDbCache = SysCfg().GetArg("-dbcache", DEFAULT_DB_CACHE);
+    nDbCache = std::max(nDbCache, MIN_DB_CACHE);
+    nDbCache = std::min(nDbCache, MAX_DB_CACHE);
+    SysCfg().SetDbCache(nDbCache);
+
     if (SysCfg().GetTxFee() > nHighTransactionFeeWarning) {
         InitWarning(_("Warning: -paytxfee is set very high! This is the transaction fee you will pay if you send a transaction."));
     }
@@ -546,6 +634,8 @@ bool AppInit(boost::thread_group &threadGroup) {
     printf("%s version %s (%s)\n", IniCfg().GetCoinName().c_str(), FormatFullVersion().c_str(), CLIENT_DATE.c_str());
     LogPrint("INFO", "Using OpenSSL version %s\n", SSLeay_version(SSLEAY_VERSION));
     printf("Using OpenSSL version %s\n", SSLeay_version(SSLEAY_VERSION));
+    LogPrint("INFO", "Using the '%s' SHA256 implementation\n", sha256Algo);
+    printf("Using the '%s' SHA256 implementation\n", sha256Algo.c_str());
 #ifdef USE_LUA
     LogPrint("INFO", "Using Lua version %s\n", LUA_RELEASE);
     printf("Using Lua version %s\n", LUA_RELEASE);
@@ -735,12 +825,32 @@ bool AppInit(boost::thread_group &threadGroup) {
                     break;
                 }
 
+                // Databases written before accounts were split into identity and balance records
+                bool fAccountTokens = false;
+                if (!pCdMan->pBlockCache->ReadFlag("accounttokens", fAccountTokens) || !fAccountTokens) {
+                    strLoadError = _("You need to rebuild the database using -reindex to upgrade the account storage");
+                    break;
+                }
+
                 // Check for changed -txindex state
                 if (SysCfg().IsTxIndex() != SysCfg().GetBoolArg("-txindex", true)) {
                     strLoadError = _("You need to rebuild the database using -reindex to change -txindex");
                     break;
                 }
 
+                // Check for changed -addressindex state, an existing chain can be indexed in place
+                if (SysCfg().IsAddressIndex() != SysCfg().GetBoolArg("-addressindex", false)) {
+                    if (SysCfg().IsAddressIndex()) {
+                        strLoadError = _("You need to rebuild the database using -reindex to disable -addressindex");
+                        break;
+                    }
+
+                    if (!BuildAddressIndex()) {
+                        strLoadError = _("Error building address index");
+                        break;
+                    }
+                }
+
                 if (!VerifyDB(SysCfg().GetArg("-checklevel", 3), SysCfg().GetArg("-checkblocks", 288))) {
                     strLoadError = _("Corrupted block database detected");
                     break;
@@ -785,7 +895,7 @@ bool AppInit(boost::thread_group &threadGroup) {
     if (SysCfg().IsArgCount("-printblock")) {
         string strMatch = SysCfg().GetArg("-printblock", "");
         int32_t nFound      = 0;
-        for (map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.begin(); mi != mapBlockIndex.end(); ++mi) {
+        for (BlockMap::iterator mi = mapBlockIndex.begin(); mi != mapBlockIndex.end(); ++mi) {
             uint256 hash = (*mi).first;
             if (strncmp(hash.ToString().c_str(), strMatch.c_str(), strMatch.size()) == 0) {
                 CBlockIndex *pIndex = (*mi).second;
@@ -808,46 +918,25 @@ bool AppInit(boost::thread_group &threadGroup) {
     if (!ActivateBestChain(state))
         return InitError("Failed to connect best block");
 
-    nStart                   = GetTimeMillis();
-    CBlockIndex *pBlockIndex = chainActive.Tip();
-    int32_t nCacheHeight     = SysCfg().GetTxCacheHeight();
-    int32_t nCount           = 0;
-    CBlock block;
-    while (pBlockIndex && nCacheHeight-- > 0) {
-        if (!ReadBlockFromDisk(pBlockIndex, block))
-            return InitError("Failed to read block from disk");
-
-        if (!pCdMan->pTxCache->AddBlockToCache(block))
-            return InitError("Failed to add block to transaction memory cache");
-
-        pBlockIndex = pBlockIndex->pprev;
-        ++nCount;
-    }
-    LogPrint("INFO", "Added the latest %d blocks to transaction memory cache (%dms)\n", nCount, GetTimeMillis() - nStart);
-
-    nStart       = GetTimeMillis();
-    pBlockIndex  = chainActive.Tip();
-    nCacheHeight = 11;  // TODO: parameterize 11.
-    nCount       = 0;
-
-
-    if (pBlockIndex) {
-        if (!ReadBlockFromDisk(pBlockIndex, block))
-            return InitError("Failed to read block from disk");
-        pCdMan->pPpCache->SetLatestBlockMedianPricePoints(block.GetBlockMedianPrice());
+    // load the memory caches from the snapshot of the last clean shutdown, or from the latest blocks
+    nStart = GetTimeMillis();
+    if (chainActive.Tip() &&
+        CMemCacheDB().Read(chainActive.Tip()->GetBlockHash(), *pCdMan->pTxCache, *pCdMan->pPpCache)) {
+        LogPrint("INFO", "Loaded transaction memory cache of %lu blocks and price point memory cache from snapshot (%dms)\n",
+                 pCdMan->pTxCache->GetSize(), GetTimeMillis() - nStart);
+    } else if (!LoadMemCachesFromBlocks()) {
+        return false;
     }
+    fMemCachesLoaded = true;
 
-    while (pBlockIndex && nCacheHeight-- > 0) {
-        if (!ReadBlockFromDisk(pBlockIndex, block))
-            return InitError("Failed to read block from disk");
-
-        if (!pCdMan->pPpCache->AddBlockToCache(block))
-            return InitError("Failed to add block to price point memory cache");
-
-        pBlockIndex = pBlockIndex->pprev;
-        ++nCount;
+    // Read-only RPCs are served from chain snapshots, publish the first one at the loaded tip
+    {
+        LOCK(cs_main);
+        if (chainActive.Tip()) {
+            pCdMan->Flush();
+            PublishChainSnapshot(chainActive.Tip());
+        }
     }
-    LogPrint("INFO", "Added the latest %d blocks to price point memory cache (%dms)\n", nCount, GetTimeMillis() - nStart);
 
     vector<boost::filesystem::path> vImportFiles;
     if (SysCfg().IsArgCount("-loadblock")) {
@@ -874,6 +963,12 @@ bool AppInit(boost::thread_group &threadGroup) {
 
     RandAddSeedPerfmon();
 
+    int32_t nTxValidationThreads = SysCfg().GetArg("-txvalidationthreads", DEFAULT_TX_VALIDATION_THREADS);
+    txValidationQueue.Start(threadGroup, max(0, min(MAX_TX_VALIDATION_THREADS, nTxValidationThreads)));
+
+    if (!StartNotifyServer())
+        return InitError(_("Failed to start the event notification server. "));
+
     StartNode(threadGroup);
 
     if (SysCfg().IsServer()) {
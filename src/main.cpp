@@ -22,6 +22,7 @@
 #include "commons/json/json_spirit_value.h"
 #include "commons/json/json_spirit_writer_template.h"
 #include "p2p/chainmessage.h"
+#include "persistence/blockfilemap.h"
 
 #include <sstream>
 #include <algorithm>
@@ -47,7 +48,9 @@ using namespace boost;
 CCacheDBManager *pCdMan = nullptr;
 CCriticalSection cs_main;
 CTxMemPool mempool;
-map<uint256, CBlockIndex *> mapBlockIndex;
+BlockMap mapBlockIndex;
+CBlockIndexArena blockIndexArena;
+CCriticalSection cs_mapBlockIndex;
 int32_t nSyncTipHeight = 0;
 string externalIp;
 map<uint256, std::shared_ptr<CCacheWrapper> > mapForkCache;
@@ -57,6 +60,8 @@ CChain chainMostWork;
 bool mining;        // could change from time to time due to vote change
 CKeyID minerKeyId;  // miner accout keyId
 CKeyID nodeKeyId;   // 1st keyId of the node
+CLatencyHistogram blockPersistLatency;
+CLatencyHistogram blockConnectLatency;
 
 /** Fees smaller than this (in sawi) are considered zero fee (for relaying and mining) */
 uint64_t CBaseTx::nMinRelayTxFee = 1000;
@@ -94,6 +99,8 @@ namespace {
         for (const auto &hash : state->vBlocksToDownload)
             mapBlocksToDownload.erase(hash);
 
+        blockSyncScheduler.FinalizeNode(nodeid);
+
         mapNodeState.erase(nodeid);
     }
 
@@ -117,8 +124,8 @@ namespace {
     bool operator()(CBlockIndex *pa, CBlockIndex *pb) {
 
         // First sort by most total work, ...
-        if(pa->nChainWork != pb->nChainWork){
-            return (pa->nChainWork < pb->nChainWork) ;
+        if(pa->GetChainWork() != pb->GetChainWork()){
+            return (pa->GetChainWork() < pb->GetChainWork()) ;
         }
 
 
@@ -153,6 +160,20 @@ set<COrphanBlock *, COrphanBlockComparator> setOrphanBlock;  //存的孤立块
 CCriticalSection cs_LastBlockFile;
 CBlockFileInfo infoLastBlockFile;
 int32_t nLastBlockFile = 0;
+// Block and undo files written since they were last committed, guarded by cs_LastBlockFile
+set<int32_t> setDirtyBlockFiles;
+set<int32_t> setDirtyUndoFiles;
+
+// Block and undo file records are serialized here once and written with a single write, guarded by cs_main
+CDataStream ssDiskRecord(SER_DISK, CLIENT_VERSION);
+// Network magic and data size preceding the data of a record
+const uint32_t DISK_RECORD_HEADER_SIZE = sizeof(MessageStartChars) + sizeof(uint32_t);
+// Time spent writing block and undo records since the last WriteChainState, guarded by cs_main
+int64_t nPendingPersistTime = 0;
+// Set when the undo files grew in -prune mode, WriteChainState then looks for files to prune, guarded by cs_main
+bool fCheckForPruning = false;
+// Finalized block files mapped for reading, the file being written is read through stdio
+CBlockFileMap blockFileMap(MAX_MAPPED_BLOCK_FILES);
 
 // Every received block is assigned a unique and increasing identifier, so we
 // know which one to give priority in case of a fork.
@@ -187,6 +208,12 @@ struct CMainSignals {
     // boost::signals2::signal<void (const uint256 &)> Inventory;
     // Tells listeners to broadcast their data.
     boost::signals2::signal<void()> Broadcast;
+    // Notifies listeners of a block connected to or disconnected from the active chain.
+    boost::signals2::signal<void(const CBlock &, const CBlockIndex *)> BlockConnected;
+    boost::signals2::signal<void(const CBlock &, const CBlockIndex *)> BlockDisconnected;
+    // Notifies listeners of a transaction entering or leaving the memory pool.
+    boost::signals2::signal<void(const uint256 &, const CBaseTx *)> TxAddedToMempool;
+    boost::signals2::signal<void(const uint256 &)> TxRemovedFromMempool;
 } g_signals;
 }  // namespace
 
@@ -220,6 +247,22 @@ void SyncTransaction(const uint256 &hash, CBaseTx *pBaseTx, const CBlock *pBlock
 
 void EraseTransaction(const uint256 &hash) { g_signals.EraseTransaction(hash); }
 
+void RegisterChainEventListener(CChainEventListener *pListenerIn) {
+    g_signals.BlockConnected.connect(boost::bind(&CChainEventListener::BlockConnected, pListenerIn, _1, _2));
+    g_signals.BlockDisconnected.connect(boost::bind(&CChainEventListener::BlockDisconnected, pListenerIn, _1, _2));
+    g_signals.TxAddedToMempool.connect(boost::bind(&CChainEventListener::TxAddedToMempool, pListenerIn, _1, _2));
+    g_signals.TxRemovedFromMempool.connect(boost::bind(&CChainEventListener::TxRemovedFromMempool, pListenerIn, _1));
+}
+
+void UnregisterChainEventListener(CChainEventListener *pListenerIn) {
+    g_signals.TxRemovedFromMempool.disconnect(boost::bind(&CChainEventListener::TxRemovedFromMempool, pListenerIn, _1));
+    g_signals.TxAddedToMempool.disconnect(boost::bind(&CChainEventListener::TxAddedToMempool, pListenerIn, _1, _2));
+    g_signals.BlockDisconnected.disconnect(boost::bind(&CChainEventListener::BlockDisconnected, pListenerIn, _1, _2));
+    g_signals.BlockConnected.disconnect(boost::bind(&CChainEventListener::BlockConnected, pListenerIn, _1, _2));
+}
+
+void NotifyTxRemovedFromMempool(const uint256 &hash) { g_signals.TxRemovedFromMempool(hash); }
+
 //////////////////////////////////////////////////////////////////////////////
 //
 // Registration of network node signals.
@@ -302,7 +345,7 @@ CBlockLocator CChain::GetLocator(const CBlockIndex *pIndex) const {
 CBlockIndex *CChain::FindFork(const CBlockLocator &locator) const {
     // Find the first block the caller has in the main chain
     for (const auto &hash : locator.vHave) {
-        map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.find(hash);
+        BlockMap::iterator mi = mapBlockIndex.find(hash);
         if (mi != mapBlockIndex.end()) {
             CBlockIndex *pIndex = (*mi).second;
             if (pIndex && Contains(pIndex))
@@ -418,7 +461,11 @@ bool AcceptToMemoryPool(CTxMemPool &pool, CValidationState &state, CBaseTx *pBas
     if (fRejectInsaneFee && nFees > SysCfg().GetMaxFee())
         return ERRORMSG("AcceptToMemoryPool() : txid: %s pay insane fees, %d > %d", hash.GetHex(), nFees, SysCfg().GetMaxFee());
 
-    return pool.AddUnchecked(hash, entry, state);
+    if (!pool.AddUnchecked(hash, entry, state))
+        return false;
+
+    g_signals.TxAddedToMempool(hash, pBaseTx);
+    return true;
 }
 
 int32_t CMerkleTx::GetDepthInMainChainINTERNAL(CBlockIndex *&pindexRet) const {
@@ -427,7 +474,7 @@ int32_t CMerkleTx::GetDepthInMainChainINTERNAL(CBlockIndex *&pindexRet) const {
     AssertLockHeld(cs_main);
 
     // Find the block it claims to be in
-    map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.find(blockHash);
+    BlockMap::iterator mi = mapBlockIndex.find(blockHash);
     if (mi == mapBlockIndex.end())
         return 0;
     CBlockIndex *pIndex = (*mi).second;
@@ -465,15 +512,10 @@ int32_t GetTxConfirmHeight(const uint256 &hash, CBlockDBCache &blockCache) {
     if (SysCfg().IsTxIndex()) {
         CDiskTxPos diskTxPos;
         if (blockCache.ReadTxIndex(hash, diskTxPos)) {
-            CAutoFile file(OpenBlockFile(diskTxPos, true), SER_DISK, CLIENT_VERSION);
             CBlockHeader header;
-            try {
-                file >> header;
-
-            } catch (std::exception &e) {
-                ERRORMSG("%s : Deserialize or I/O error - %s", __func__, e.what());
+            if (!ReadBlockHeaderFromDisk(diskTxPos, header))
                 return -1;
-            }
+
             return header.GetHeight();
         }
     }
@@ -497,16 +539,8 @@ bool GetTransaction(std::shared_ptr<CBaseTx> &pBaseTx, const uint256 &hash, CBlo
         if (SysCfg().IsTxIndex()) {
             CDiskTxPos diskTxPos;
             if (blockCache.ReadTxIndex(hash, diskTxPos)) {
-                CAutoFile file(OpenBlockFile(diskTxPos, true), SER_DISK, CLIENT_VERSION);
                 CBlockHeader header;
-                try {
-                    file >> header;
-                    fseek(file, diskTxPos.nTxOffset, SEEK_CUR);
-                    file >> pBaseTx;
-                } catch (std::exception &e) {
-                    return ERRORMSG("%s : Deserialize or I/O error - %s", __func__, e.what());
-                }
-                return true;
+                return ReadTxFromDisk(diskTxPos, header, pBaseTx);
             }
         }
     }
@@ -518,34 +552,30 @@ bool GetTransaction(std::shared_ptr<CBaseTx> &pBaseTx, const uint256 &hash, CBlo
 // CBlock and CBlockIndex
 //
 
-bool WriteBlockToDisk(CBlock &block, CDiskBlockPos &pos) {
-    // Open history file to append
-    CAutoFile fileout = CAutoFile(OpenBlockFile(pos), SER_DISK, CLIENT_VERSION);
-    if (!fileout)
-        return ERRORMSG("WriteBlockToDisk : OpenBlockFile failed");
-
-    // Write index header
-    uint32_t nSize = fileout.GetSerializeSize(block);
-    fileout << FLATDATA(SysCfg().MessageStart()) << nSize;
-
-    // Write block
-    int32_t fileOutPos = ftell(fileout);
-    if (fileOutPos < 0)
-        return ERRORMSG("WriteBlockToDisk : ftell failed");
-    pos.nPos = (uint32_t)fileOutPos;
-    fileout << block;
-
-    // Flush stdio buffers and commit to disk before returning
-    fflush(fileout);
-    if (!IsInitialBlockDownload())
-        FileCommit(fileout);
-
-    return true;
+/** Mapped view of a finalized block file, nullptr for the file being written or if it can't be mapped */
+static std::shared_ptr<const CMappedFile> GetMappedBlockFile(int32_t nFile) {
+    {
+        LOCK(cs_LastBlockFile);
+        if (nFile < 0 || nFile >= nLastBlockFile)
+            return nullptr;
+    }
+    return blockFileMap.Get(nFile);
 }
 
 bool ReadBlockFromDisk(const CDiskBlockPos &pos, CBlock &block) {
     block.SetNull();
 
+    std::shared_ptr<const CMappedFile> pFile = GetMappedBlockFile(pos.nFile);
+    if (pFile) {
+        try {
+            CSpanReader reader = pFile->GetReader(pos.nPos, SER_DISK, CLIENT_VERSION);
+            reader >> block;
+        } catch (std::exception &e) {
+            return ERRORMSG("%s : Deserialize error - %s", __func__, e.what());
+        }
+        return true;
+    }
+
     // Open history file to read
     CAutoFile filein = CAutoFile(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
     if (!filein)
@@ -571,12 +601,77 @@ bool ReadBlockFromDisk(const CBlockIndex *pIndex, CBlock &block) {
     return true;
 }
 
+bool ReadBlockHeaderFromDisk(const CDiskBlockPos &pos, CBlockHeader &header) {
+    try {
+        std::shared_ptr<const CMappedFile> pFile = GetMappedBlockFile(pos.nFile);
+        if (pFile) {
+            CSpanReader reader = pFile->GetReader(pos.nPos, SER_DISK, CLIENT_VERSION);
+            reader >> header;
+        } else {
+            CAutoFile file(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+            if (!file)
+                return ERRORMSG("ReadBlockHeaderFromDisk : OpenBlockFile failed");
+            file >> header;
+        }
+    } catch (std::exception &e) {
+        return ERRORMSG("%s : Deserialize or I/O error - %s", __func__, e.what());
+    }
+
+    return true;
+}
+
+bool ReadTxFromDisk(const CDiskTxPos &pos, CBlockHeader &header, std::shared_ptr<CBaseTx> &pBaseTx) {
+    try {
+        std::shared_ptr<const CMappedFile> pFile = GetMappedBlockFile(pos.nFile);
+        if (pFile) {
+            CSpanReader reader = pFile->GetReader(pos.nPos, SER_DISK, CLIENT_VERSION);
+            reader >> header;
+            reader.ignore(pos.nTxOffset);
+            reader >> pBaseTx;
+        } else {
+            CAutoFile file(OpenBlockFile(pos, true), SER_DISK, CLIENT_VERSION);
+            if (!file)
+                return ERRORMSG("ReadTxFromDisk : OpenBlockFile failed");
+            file >> header;
+            fseek(file, pos.nTxOffset, SEEK_CUR);
+            file >> pBaseTx;
+        }
+    } catch (std::exception &e) {
+        return ERRORMSG("%s : Deserialize or I/O error - %s", __func__, e.what());
+    }
+
+    return true;
+}
+
 bool ReadBaseTxFromDisk(const CTxCord txCord, std::shared_ptr<CBaseTx> &pTx) {
-    auto pBlock = std::make_shared<CBlock>();
     const CBlockIndex* pBlockIndex = chainActive[txCord.GetHeight()];
     if (pBlockIndex == nullptr) {
         return ERRORMSG("ReadBaseTxFromDisk error, the height(%d) is exceed current best block height", txCord.GetHeight());
     }
+
+    // Deserialize the txs of a mapped block only up to the wanted one
+    std::shared_ptr<const CMappedFile> pFile = GetMappedBlockFile(pBlockIndex->nFile);
+    if (pFile) {
+        try {
+            CSpanReader reader = pFile->GetReader(pBlockIndex->nDataPos, SER_DISK, CLIENT_VERSION);
+            CBlockHeader header;
+            reader >> header;
+            if (header.GetHash() != pBlockIndex->GetBlockHash())
+                return ERRORMSG("ReadBaseTxFromDisk error, the block hash at height(%d) doesn't match", txCord.GetHeight());
+
+            uint64_t nTxCount = ReadCompactSize(reader);
+            if (txCord.GetIndex() >= nTxCount)
+                return ERRORMSG("ReadBaseTxFromDisk error, the tx(%s) index exceed the tx count of block", txCord.ToString());
+
+            for (uint32_t index = 0; index <= txCord.GetIndex(); index++)
+                reader >> pTx;
+        } catch (std::exception &e) {
+            return ERRORMSG("%s : Deserialize error - %s", __func__, e.what());
+        }
+        return true;
+    }
+
+    auto pBlock = std::make_shared<CBlock>();
     if (!ReadBlockFromDisk(pBlockIndex, *pBlock)) {
         return ERRORMSG("ReadBaseTxFromDisk error, read the block at height(%d) failed!", txCord.GetHeight());
     }
@@ -660,7 +755,7 @@ void CheckForkWarningConditions() {
 
     if (pIndexBestForkTip ||
         (pindexBestInvalid &&
-         pindexBestInvalid->nChainWork > chainActive.Tip()->nChainWork + (GetBlockProof(*chainActive.Tip()) * 6))) {
+         pindexBestInvalid->GetChainWork() > chainActive.Tip()->GetChainWork() + (GetBlockProof(*chainActive.Tip()) * 6))) {
         if (!fLargeWorkForkFound && pIndexBestForkBase) {
             string strCmd = SysCfg().GetArg("-alertnotify", "");
             if (!strCmd.empty()) {
@@ -711,7 +806,7 @@ void CheckForkWarningConditionsOnNewFork(CBlockIndex *pindexNewForkTip) {
     // the 7-block condition and from this always have the most-likely-to-cause-warning fork
     if (pfork &&
         (!pIndexBestForkTip || (pIndexBestForkTip && pindexNewForkTip->height > pIndexBestForkTip->height)) &&
-        pindexNewForkTip->nChainWork - pfork->nChainWork > (GetBlockProof(*pfork) * 7) &&
+        pindexNewForkTip->GetChainWork() - pfork->GetChainWork() > (GetBlockProof(*pfork) * 7) &&
         chainActive.Height() - pindexNewForkTip->height < 72) {
         pIndexBestForkTip  = pindexNewForkTip;
         pIndexBestForkBase = pfork;
@@ -741,21 +836,21 @@ void Misbehaving(NodeId pNode, int32_t howmuch) {
 }
 
 void static InvalidChainFound(CBlockIndex *pIndexNew) {
-    if (!pindexBestInvalid || pIndexNew->nChainWork > pindexBestInvalid->nChainWork) {
+    if (!pindexBestInvalid || pIndexNew->GetChainWork() > pindexBestInvalid->GetChainWork()) {
         pindexBestInvalid = pIndexNew;
         // The current code doesn't actually read the BestInvalidWork entry in
         // the block database anymore, as it is derived from the flags in block
         // index entry. We only write it for backward compatibility.
         // TODO: need to remove the indexBestInvalid
-        //pCdMan->pBlockCache->WriteBestInvalidWork(ArithToUint256(pindexBestInvalid->nChainWork));
+        //pCdMan->pBlockCache->WriteBestInvalidWork(ArithToUint256(pindexBestInvalid->GetChainWork()));
     }
     LogPrint("INFO", "InvalidChainFound: invalid block=%s  height=%d  log2_work=%.8g  date=%s\n",
              pIndexNew->GetBlockHash().ToString(), pIndexNew->height,
-             log(pIndexNew->nChainWork.getdouble()) / log(2.0),
+             log(pIndexNew->GetChainWork().getdouble()) / log(2.0),
              DateTimeStrFormat("%Y-%m-%d %H:%M:%S", pIndexNew->GetBlockTime()));
     LogPrint("INFO", "InvalidChainFound:  current best=%s  height=%d  log2_work=%.8g  date=%s\n",
              chainActive.Tip()->GetBlockHash().ToString(), chainActive.Height(),
-             log(chainActive.Tip()->nChainWork.getdouble()) / log(2.0),
+             log(chainActive.Tip()->GetChainWork().getdouble()) / log(2.0),
              DateTimeStrFormat("%Y-%m-%d %H:%M:%S", chainActive.Tip()->GetBlockTime()));
     CheckForkWarningConditions();
 }
@@ -777,7 +872,7 @@ void static InvalidBlockFound(CBlockIndex *pIndex, const CValidationState &state
 
     if (!state.CorruptionPossible()) {
         pIndex->nStatus |= BLOCK_FAILED_VALID;
-        pCdMan->pBlockIndexDb->WriteBlockIndex(CDiskBlockIndex(pIndex));
+        pCdMan->pBlockIndexDb->UpdateBlockIndex(pIndex);
         setBlockIndexValid.erase(pIndex);
         InvalidChainFound(pIndex);
     }
@@ -788,7 +883,7 @@ bool InvalidateBlock(CValidationState &state, CBlockIndex *pIndex) {
 
     // Mark the block itself as invalid.
     pIndex->nStatus |= BLOCK_FAILED_VALID;
-    pCdMan->pBlockIndexDb->WriteBlockIndex(CDiskBlockIndex(pIndex));
+    pCdMan->pBlockIndexDb->UpdateBlockIndex(pIndex);
     setBlockIndexValid.erase(pIndex);
 
     LogPrint("INFO", "Invalidate block[%d]: %s BLOCK_FAILED_VALID\n", pIndex->height,
@@ -797,7 +892,7 @@ bool InvalidateBlock(CValidationState &state, CBlockIndex *pIndex) {
     while (chainActive.Contains(pIndex)) {
         CBlockIndex *pindexWalk = chainActive.Tip();
         pindexWalk->nStatus |= BLOCK_FAILED_CHILD;
-        pCdMan->pBlockIndexDb->WriteBlockIndex(CDiskBlockIndex(pindexWalk));
+        pCdMan->pBlockIndexDb->UpdateBlockIndex(pindexWalk);
         setBlockIndexValid.erase(pindexWalk);
 
         LogPrint("INFO", "Invalidate block[%d]: %s BLOCK_FAILED_CHILD\n", pindexWalk->height,
@@ -818,12 +913,12 @@ bool ReconsiderBlock(CValidationState &state, CBlockIndex *pIndex) {
     AssertLockHeld(cs_main);
 
     // Remove the invalidity flag from this block and all its descendants.
-    map<uint256, CBlockIndex *>::const_iterator it = mapBlockIndex.begin();
+    BlockMap::const_iterator it = mapBlockIndex.begin();
     int32_t height                                    = pIndex->height;
     while (it != mapBlockIndex.end()) {
         if (it->second->nStatus & BLOCK_FAILED_MASK && it->second->GetAncestor(height) == pIndex) {
             it->second->nStatus &= ~BLOCK_FAILED_MASK;
-            pCdMan->pBlockIndexDb->WriteBlockIndex(CDiskBlockIndex(it->second));
+            pCdMan->pBlockIndexDb->UpdateBlockIndex(it->second);
             setBlockIndexValid.insert(it->second);
             if (it->second == pindexBestInvalid) {
                 // Reset invalid block marker if it was pointing to one of those.
@@ -838,7 +933,7 @@ bool ReconsiderBlock(CValidationState &state, CBlockIndex *pIndex) {
         if (pIndex->nStatus & BLOCK_FAILED_MASK) {
             pIndex->nStatus &= ~BLOCK_FAILED_MASK;
             setBlockIndexValid.insert(pIndex);
-            pCdMan->pBlockIndexDb->WriteBlockIndex(CDiskBlockIndex(pIndex));
+            pCdMan->pBlockIndexDb->UpdateBlockIndex(pIndex);
         }
         pIndex = pIndex->pprev;
     }
@@ -930,6 +1025,13 @@ bool DisconnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CVal
     }
 }
 
+static void CommitDiskFile(FILE *file) {
+    if (file) {
+        FileCommit(file);
+        fclose(file);
+    }
+}
+
 void static FlushBlockFile(bool fFinalize = false) {
     LOCK(cs_LastBlockFile);
 
@@ -950,6 +1052,18 @@ void static FlushBlockFile(bool fFinalize = false) {
         FileCommit(fileOld);
         fclose(fileOld);
     }
+
+    // Older files written since the last flush, e.g. undo data of a block stored before the last file
+    for (int32_t nFile : setDirtyBlockFiles) {
+        if (nFile != nLastBlockFile)
+            CommitDiskFile(OpenBlockFile(CDiskBlockPos(nFile, 0)));
+    }
+    for (int32_t nFile : setDirtyUndoFiles) {
+        if (nFile != nLastBlockFile)
+            CommitDiskFile(OpenUndoFile(CDiskBlockPos(nFile, 0)));
+    }
+    setDirtyBlockFiles.clear();
+    setDirtyUndoFiles.clear();
 }
 
 static bool FindUndoPos(CValidationState &state, int32_t nFile, CDiskBlockPos &pos, uint32_t nAddSize) {
@@ -976,6 +1090,8 @@ static bool FindUndoPos(CValidationState &state, int32_t nFile, CDiskBlockPos &p
     uint32_t nOldChunks = (pos.nPos + UNDOFILE_CHUNK_SIZE - 1) / UNDOFILE_CHUNK_SIZE;
     uint32_t nNewChunks = (nNewSize + UNDOFILE_CHUNK_SIZE - 1) / UNDOFILE_CHUNK_SIZE;
     if (nNewChunks > nOldChunks) {
+        if (SysCfg().IsPruneMode())
+            fCheckForPruning = true;
         if (CheckDiskSpace(nNewChunks * UNDOFILE_CHUNK_SIZE - pos.nPos)) {
             FILE *file = OpenUndoFile(pos);
             if (file) {
@@ -1071,6 +1187,27 @@ bool SaveTxIndex(const uint256 &txid, CCacheWrapper &cw, CValidationState &state
     return true;
 }
 
+/** Index the txs of the block by the addresses they involve, for -addressindex */
+static bool SaveAddressIndex(const CBlock &block, int32_t height, CCacheWrapper &cw, CValidationState &state) {
+    if (!SysCfg().IsAddressIndex())
+        return true;
+
+    for (uint32_t index = 0; index < block.vptx.size(); index++) {
+        const std::shared_ptr<CBaseTx> &pBaseTx = block.vptx[index];
+        set<CKeyID> keyIds;
+        if (!pBaseTx->GetInvolvedKeyIds(cw, keyIds)) {
+            LogPrint("INFO", "SaveAddressIndex() : failed to get involved keyids of tx %s\n", pBaseTx->GetHash().GetHex());
+            continue;
+        }
+
+        for (const auto &keyId : keyIds) {
+            if (!cw.blockCache.SetTxHashByAddress(keyId, height, index, pBaseTx->GetHash()))
+                return state.Abort(_("Failed to write address index"));
+        }
+    }
+    return true;
+}
+
 // compute vote staking interest && revoke votes
 static bool ComputeVoteStakingInterestAndRevokeVotes(const int32_t currHeight, const uint32_t currBlockTime, CCacheWrapper &cw,
                                               CValidationState &state) {
@@ -1332,6 +1469,12 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
         return false;
     }
 
+    // Queue the reward tx for its maturity, disconnecting the block undoes it along with the reward tx
+    if (pIndex->height > 0 && !cw.blockCache.AddMatureRewardTx(pIndex->height + BLOCK_REWARD_MATURITY, block.vptx[0])) {
+        cw.DisableTxUndoLog();
+        return state.Abort(_("ConnectBlock() : failed to queue mature reward tx"));
+    }
+
     for (const auto &item : vPos) {
         if (!SaveTxIndex(item.first, cw, state, item.second)) {
             cw.DisableTxUndoLog();
@@ -1339,27 +1482,43 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
         }
     }
 
+    // Logged with the reward tx as well, so disconnecting the block drops the address index entries
+    if (!SaveAddressIndex(block, pIndex->height, cw, state)) {
+        cw.DisableTxUndoLog();
+        return false;
+    }
+
     blockUndo.vtxundo.push_back(cw.txUndo);
     cw.DisableTxUndoLog();
 
     if (pIndex->height - BLOCK_REWARD_MATURITY > 0) {
         // Deal mature block reward transaction
-        CBlockIndex *pMatureIndex = pIndex;
-        for (int32_t i = 0; i < BLOCK_REWARD_MATURITY; ++i) {
-            pMatureIndex = pMatureIndex->pprev;
-        }
+        cw.EnableTxUndoLog();
+        vector<std::shared_ptr<CBaseTx> > matureRewardTxs;
+        if (cw.blockCache.GetMatureRewardTxs(pIndex->height, matureRewardTxs)) {
+            cw.blockCache.EraseMatureRewardTxs(pIndex->height);
+        } else {
+            // Queued before the mature reward tx queue existed, read it from the mature block
+            CBlockIndex *pMatureIndex = pIndex;
+            for (int32_t i = 0; i < BLOCK_REWARD_MATURITY; ++i) {
+                pMatureIndex = pMatureIndex->pprev;
+            }
 
-        if (nullptr != pMatureIndex) {
-            CBlock matureBlock;
-            if (!ReadBlockFromDisk(pMatureIndex, matureBlock)) {
-                return state.DoS(100, ERRORMSG("ConnectBlock() : read mature block error"), REJECT_INVALID,
-                                 "bad-read-block");
+            if (nullptr != pMatureIndex) {
+                CBlock matureBlock;
+                if (!ReadBlockFromDisk(pMatureIndex, matureBlock)) {
+                    cw.DisableTxUndoLog();
+                    return state.DoS(100, ERRORMSG("ConnectBlock() : read mature block error"), REJECT_INVALID,
+                                     "bad-read-block");
+                }
+                matureRewardTxs.push_back(matureBlock.vptx[0]);
             }
+        }
 
-            cw.EnableTxUndoLog();
+        for (const auto &pMatureRewardTx : matureRewardTxs) {
             CTxExecuteContext context(pIndex->height, -1, pIndex->nFuelRate, pIndex->nTime, &cw, &state);
-            if (!matureBlock.vptx[0]->ExecuteTx(context)) {
-                pCdMan->pLogCache->SetExecuteFail(pIndex->height, matureBlock.vptx[0]->GetHash(), state.GetRejectCode(),
+            if (!pMatureRewardTx->ExecuteTx(context)) {
+                pCdMan->pLogCache->SetExecuteFail(pIndex->height, pMatureRewardTx->GetHash(), state.GetRejectCode(),
                                                   state.GetRejectReason());
                 cw.DisableTxUndoLog();
                 return ERRORMSG("ConnectBlock() : execute mature block reward tx error!");
@@ -1380,11 +1539,8 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
     if (pIndex->GetUndoPos().IsNull() || (pIndex->nStatus & BLOCK_VALID_MASK) < BLOCK_VALID_SCRIPTS) {
         if (pIndex->GetUndoPos().IsNull()) {
             CDiskBlockPos pos;
-            if (!FindUndoPos(state, pIndex->nFile, pos, ::GetSerializeSize(blockUndo, SER_DISK, CLIENT_VERSION) + 40))
-                return ERRORMSG("ConnectBlock() : failed to find undo data's position");
-
-            if (!blockUndo.WriteToDisk(pos, pIndex->pprev->GetBlockHash()))
-                return state.Abort(_("ConnectBlock() : failed to write undo data"));
+            if (!blockUndo.WriteToDisk(state, pIndex->nFile, pos, pIndex->pprev->GetBlockHash()))
+                return ERRORMSG("ConnectBlock() : failed to write undo data");
 
             // Update nUndoPos in block index
             pIndex->nUndoPos = pos.nPos;
@@ -1393,8 +1549,7 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
 
         pIndex->nStatus = (pIndex->nStatus & ~BLOCK_VALID_MASK) | BLOCK_VALID_SCRIPTS;
 
-        CDiskBlockIndex blockIndex(pIndex);
-        if (!pCdMan->pBlockIndexDb->WriteBlockIndex(blockIndex))
+        if (!pCdMan->pBlockIndexDb->UpdateBlockIndex(pIndex))
             return state.Abort(_("ConnectBlock() : failed to write block index"));
     }
 
@@ -1446,9 +1601,96 @@ bool ConnectBlock(CBlock &block, CCacheWrapper &cw, CBlockIndex *pIndex, CValida
     return true;
 }
 
-// Update the on-disk chain state.
-bool static WriteChainState(CValidationState &state) {
+/**
+ * Select the undo files to prune, oldest first, until the undo files fit in the -prune target. Only
+ * the files whose blocks are all below the reorg horizon and the tx cache window of the tip are pruned,
+ * and never the file being written. The block files stay: contracts read any past tx by its hash
+ * through the tx index, so the tx bodies are part of the consensus state.
+ */
+static void FindFilesToPrune(set<int32_t> &setFilesToPrune) {
+    LOCK(cs_LastBlockFile);
+
+    if (chainActive.Tip() == nullptr || SysCfg().IsReindex() || SysCfg().IsImporting())
+        return;
+
+    int32_t height      = chainActive.Height();
+    int32_t nKeepHeight = height - SysCfg().GetMaxForkHeight(height) - SysCfg().GetTxCacheHeight() - MIN_BLOCKS_TO_KEEP;
+    if (nKeepHeight <= 0)
+        return;
+
+    vector<CBlockFileInfo> vInfo(nLastBlockFile);
+    uint64_t nUsage = infoLastBlockFile.nUndoSize;
+    for (int32_t nFile = 0; nFile < nLastBlockFile; nFile++) {
+        pCdMan->pBlockIndexDb->ReadBlockFileInfo(nFile, vInfo[nFile]);
+        nUsage += vInfo[nFile].nUndoSize;
+    }
+
+    uint64_t nTarget = SysCfg().GetPruneTarget();
+    for (int32_t nFile = 0; nFile < nLastBlockFile && nUsage > nTarget; nFile++) {
+        const CBlockFileInfo &info = vInfo[nFile];
+        if (info.nUndoSize == 0 || (int32_t)info.nHeightLast >= nKeepHeight)
+            continue;
+
+        setFilesToPrune.insert(nFile);
+        nUsage -= info.nUndoSize;
+    }
+
+    LogPrint("INFO", "FindFilesToPrune() : %u undo files to prune below height %d, %u MiB of undo files left, target %u MiB\n",
+             setFilesToPrune.size(), nKeepHeight, nUsage / 1024 / 1024, nTarget / 1024 / 1024);
+}
+
+/**
+ * Mark the undo data of the blocks in the files to prune as pruned and drop the undo size from the
+ * files' info, synced to the block index database before the files are unlinked so a crash in between
+ * only leaves unreferenced files.
+ */
+static bool PruneBlockIndex(const set<int32_t> &setFilesToPrune) {
+    for (const auto &item : mapBlockIndex) {
+        CBlockIndex *pIndex = item.second;
+        if (!(pIndex->nStatus & BLOCK_HAVE_UNDO) || !setFilesToPrune.count(pIndex->nFile))
+            continue;
+
+        pIndex->nStatus  = (pIndex->nStatus & ~BLOCK_HAVE_UNDO) | BLOCK_PRUNED;
+        pIndex->nUndoPos = 0;
+        if (!pCdMan->pBlockIndexDb->UpdateBlockIndex(pIndex))
+            return ERRORMSG("PruneBlockIndex() : failed to write block index %s", pIndex->GetBlockHash().ToString());
+    }
+
+    LOCK(cs_LastBlockFile);
+    for (int32_t nFile : setFilesToPrune) {
+        CBlockFileInfo info;
+        if (!pCdMan->pBlockIndexDb->ReadBlockFileInfo(nFile, info))
+            return ERRORMSG("PruneBlockIndex() : failed to read info of block file %d", nFile);
+
+        info.nUndoSize = 0;
+        if (!pCdMan->pBlockIndexDb->WriteBlockFileInfo(nFile, info))
+            return ERRORMSG("PruneBlockIndex() : failed to write info of block file %d", nFile);
+
+        // a pruned undo file must not be reopened, which would create it again
+        setDirtyUndoFiles.erase(nFile);
+    }
+
+    return pCdMan->pBlockIndexDb->Sync();
+}
+
+static void UnlinkPrunedFiles(const set<int32_t> &setFilesToPrune) {
+    for (int32_t nFile : setFilesToPrune) {
+        boost::filesystem::path path = GetDataDir() / "blocks" / strprintf("rev%05u.dat", nFile);
+        boost::system::error_code ec;
+        boost::filesystem::remove(path, ec);
+        if (ec) {
+            LogPrint("INFO", "Unable to remove pruned file %s: %s\n", path.string(), ec.message());
+            continue;
+        }
+        LogPrint("INFO", "Pruned undo file %d\n", nFile);
+    }
+}
+
+// Update the on-disk chain state, pNewTip is the block the state caches are at.
+bool static WriteChainState(CValidationState &state, CBlockIndex *pNewTip) {
     static int64_t nLastWrite = 0;
+    int64_t nStart            = GetTimeMicros();
+    int64_t nCommitTime       = 0;
     uint32_t cachesize        =
         pCdMan->pAccountCache->GetCacheSize() +
         pCdMan->pAssetCache->GetCacheSize() +
@@ -1472,13 +1714,29 @@ bool static WriteChainState(CValidationState &state) {
         if (!CheckDiskSpace(cachesize))
             return state.Error("out of disk space");
 
+        set<int32_t> setFilesToPrune;
+        if (fCheckForPruning) {
+            fCheckForPruning = false;
+            FindFilesToPrune(setFilesToPrune);
+            if (!setFilesToPrune.empty() && !PruneBlockIndex(setFilesToPrune))
+                return state.Abort(_("Failed to write pruned block index"));
+        }
+
+        // The block and undo files are committed together with, and before, the chain state
         FlushBlockFile();
         // pCdMan->pBlockCache->Sync();
         pCdMan->Flush();
+        nCommitTime = GetTimeMicros() - nStart;
+        UnlinkPrunedFiles(setFilesToPrune);
+        if (pNewTip)
+            PublishChainSnapshot(pNewTip);
 
         mapForkCache.clear();
         nLastWrite = GetTimeMicros();
     }
+
+    blockPersistLatency.Add(nPendingPersistTime + nCommitTime);
+    nPendingPersistTime = 0;
     return true;
 }
 
@@ -1554,10 +1812,11 @@ bool static DisconnectTip(CValidationState &state) {
     if (SysCfg().IsBenchmark())
         LogPrint("INFO", "- Disconnect: %.2fms\n", (GetTimeMicros() - nStart) * 0.001);
     // Write the chain state to disk, if necessary.
-    if (!WriteChainState(state))
+    if (!WriteChainState(state, pIndexDelete->pprev))
         return false;
     // Update chainActive and related variables.
     UpdateTip(pIndexDelete->pprev, block);
+    g_signals.BlockDisconnected(block, pIndexDelete);
     // Resurrect mempool transactions from the disconnected block.
     for (const auto &pTx : block.vptx) {
         list<std::shared_ptr<CBaseTx> > removed;
@@ -1605,19 +1864,24 @@ bool static ConnectTip(CValidationState &state, CBlockIndex *pIndexNew) {
         LogPrint("INFO", "uBestBlockHash[%d]: %s\n", nSyncTipHeight, uBestblockHash.GetHex());
     }
 
+    int64_t nConnectTime = GetTimeMicros() - nStart;
+    blockConnectLatency.Add(nConnectTime);
     if (SysCfg().IsBenchmark())
-        LogPrint("INFO", "- Connect: %.2fms\n", (GetTimeMicros() - nStart) * 0.001);
+        LogPrint("INFO", "- Connect: %.2fms\n", nConnectTime * 0.001);
 
     // Write the chain state to disk, if necessary.
-    if (!WriteChainState(state))
+    if (!WriteChainState(state, pIndexNew))
         return false;
 
     // Update chainActive & related variables.
     UpdateTip(pIndexNew, block);
 
     for (auto &pTxItem : block.vptx) {
-        mempool.memPoolTxs.erase(pTxItem->GetHash());
+        uint256 txid = pTxItem->GetHash();
+        if (mempool.memPoolTxs.erase(txid))
+            NotifyTxRemovedFromMempool(txid);
     }
+    g_signals.BlockConnected(block, pIndexNew);
     return true;
 }
 
@@ -1648,7 +1912,7 @@ void static FindMostWorkChain() {
         while (pindexTest && !chainActive.Contains(pindexTest)) {
             if (pindexTest->nStatus & BLOCK_FAILED_MASK) {
                 // Candidate has an invalid ancestor, remove entire chain from the set.
-                if (pindexBestInvalid == nullptr || pIndexNew->nChainWork > pindexBestInvalid->nChainWork)
+                if (pindexBestInvalid == nullptr || pIndexNew->GetChainWork() > pindexBestInvalid->GetChainWork())
                     pindexBestInvalid = pIndexNew;
                 CBlockIndex *pindexFailed = pIndexNew;
                 while (pindexTest != pindexFailed) {
@@ -1738,31 +2002,41 @@ bool AddToBlockIndex(CBlock &block, CValidationState &state, const CDiskBlockPos
         return state.Invalid(ERRORMSG("AddToBlockIndex() : %s already exists", hash.ToString()), 0, "duplicate");
 
     // Construct new block index object
-    CBlockIndex *pIndexNew = new CBlockIndex(block);
-    assert(pIndexNew);
+    CBlockIndex *pIndexNew;
+    {
+        LOCK(cs_mapBlockIndex);
+        pIndexNew  = blockIndexArena.Allocate();
+        *pIndexNew = CBlockIndex(block);
+    }
     {
         LOCK(cs_nBlockSequenceId);
         pIndexNew->nSequenceId = nBlockSequenceId++;
     }
-    map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.insert(make_pair(hash, pIndexNew)).first;
-    // LogPrint("INFO", "in map hash:%s map size:%d\n", hash.GetHex(), mapBlockIndex.size());
-    pIndexNew->pBlockHash                        = &((*mi).first);
-    map<uint256, CBlockIndex *>::iterator miPrev = mapBlockIndex.find(block.GetPrevBlockHash());
-    if (miPrev != mapBlockIndex.end()) {
-        pIndexNew->pprev  = (*miPrev).second;
-        pIndexNew->height = pIndexNew->pprev->height + 1;
-        pIndexNew->BuildSkip();
-    }
-    pIndexNew->nTx        = block.vptx.size();
-    pIndexNew->nChainWork = pIndexNew->height;
-    pIndexNew->nChainTx   = (pIndexNew->pprev ? pIndexNew->pprev->nChainTx : 0) + pIndexNew->nTx;
-    pIndexNew->nFile      = pos.nFile;
-    pIndexNew->nDataPos   = pos.nPos;
-    pIndexNew->nUndoPos   = 0;
-    pIndexNew->nStatus    = BLOCK_VALID_TRANSACTIONS | BLOCK_HAVE_DATA;
+    {
+        // Snapshot readers find the new index only once it is filled in
+        LOCK(cs_mapBlockIndex);
+        BlockMap::iterator mi = mapBlockIndex.insert(make_pair(hash, pIndexNew)).first;
+        // LogPrint("INFO", "in map hash:%s map size:%d\n", hash.GetHex(), mapBlockIndex.size());
+        pIndexNew->pBlockHash                        = &((*mi).first);
+        BlockMap::iterator miPrev = mapBlockIndex.find(block.GetPrevBlockHash());
+        if (miPrev != mapBlockIndex.end()) {
+            pIndexNew->pprev  = (*miPrev).second;
+            pIndexNew->height = pIndexNew->pprev->height + 1;
+            pIndexNew->BuildSkip();
+        }
+        pIndexNew->nTx        = block.vptx.size();
+        pIndexNew->nChainTx   = (pIndexNew->pprev ? pIndexNew->pprev->nChainTx : 0) + pIndexNew->nTx;
+        pIndexNew->nFile      = pos.nFile;
+        pIndexNew->nDataPos   = pos.nPos;
+        pIndexNew->nUndoPos   = 0;
+        pIndexNew->nStatus    = BLOCK_VALID_TRANSACTIONS | BLOCK_HAVE_DATA;
+    }
     setBlockIndexValid.insert(pIndexNew);
 
-    if (!pCdMan->pBlockIndexDb->WriteBlockIndex(CDiskBlockIndex(pIndexNew)))
+    // the signature is only kept on disk
+    CDiskBlockIndex diskIndex(pIndexNew);
+    diskIndex.vSignature = block.GetSignature();
+    if (!pCdMan->pBlockIndexDb->WriteBlockIndex(diskIndex))
         return state.Abort(_("Failed to write block index"));
     int64_t beginTime = GetTimeMillis();
     // New best?
@@ -1841,6 +2115,76 @@ bool FindBlockPos(CValidationState &state, CDiskBlockPos &pos, uint32_t nAddSize
     return true;
 }
 
+/** Start a record in ssDiskRecord, the data is serialized after the header */
+static void BeginDiskRecord() {
+    ssDiskRecord.clear();
+    ssDiskRecord << FLATDATA(SysCfg().MessageStart()) << (uint32_t)0;
+}
+
+/** Fill in the size of the data in the header, return it */
+static uint32_t EndDiskRecord() {
+    uint32_t nSize = ssDiskRecord.size() - DISK_RECORD_HEADER_SIZE;
+    memcpy(&ssDiskRecord[sizeof(MessageStartChars)], &nSize, sizeof(nSize));
+    return nSize;
+}
+
+/** Write ssDiskRecord to file opened at pos, and move pos to the data. It is committed by FlushBlockFile. */
+static bool WriteDiskRecord(FILE *file, CDiskBlockPos &pos) {
+    CAutoFile fileout = CAutoFile(file, SER_DISK, CLIENT_VERSION);
+    if (!fileout)
+        return false;
+
+    fileout.write(&ssDiskRecord[0], ssDiskRecord.size());
+    pos.nPos += DISK_RECORD_HEADER_SIZE;
+    return true;
+}
+
+bool WriteBlockToDisk(CBlock &block, CValidationState &state, CDiskBlockPos &pos, uint32_t height) {
+    int64_t nStart = GetTimeMicros();
+    BeginDiskRecord();
+    ssDiskRecord << block;
+    EndDiskRecord();
+
+    if (!FindBlockPos(state, pos, ssDiskRecord.size(), height, block.GetTime()))
+        return ERRORMSG("WriteBlockToDisk : FindBlockPos failed");
+
+    if (!WriteDiskRecord(OpenBlockFile(pos), pos))
+        return state.Abort(_("Failed to write block"));
+
+    {
+        LOCK(cs_LastBlockFile);
+        setDirtyBlockFiles.insert(pos.nFile);
+    }
+    nPendingPersistTime += GetTimeMicros() - nStart;
+    return true;
+}
+
+bool CBlockUndo::WriteToDisk(CValidationState &state, int32_t nFile, CDiskBlockPos &pos, const uint256 &blockHash) {
+    int64_t nStart = GetTimeMicros();
+    BeginDiskRecord();
+    ssDiskRecord << *this;
+    uint32_t nSize = EndDiskRecord();
+
+    // checksum of the data as serialized above, the same as of the undo data serialized for hashing
+    CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
+    hasher << blockHash;
+    hasher.write(&ssDiskRecord[DISK_RECORD_HEADER_SIZE], nSize);
+    ssDiskRecord << hasher.GetHash();
+
+    if (!FindUndoPos(state, nFile, pos, ssDiskRecord.size()))
+        return ERRORMSG("CBlockUndo::WriteToDisk : FindUndoPos failed");
+
+    if (!WriteDiskRecord(OpenUndoFile(pos), pos))
+        return state.Abort(_("Failed to write undo data"));
+
+    {
+        LOCK(cs_LastBlockFile);
+        setDirtyUndoFiles.insert(pos.nFile);
+    }
+    nPendingPersistTime += GetTimeMicros() - nStart;
+    return true;
+}
+
 bool ProcessForkedChain(const CBlock &block, CBlockIndex *pPreBlockIndex, CValidationState &state) {
     if (pPreBlockIndex->GetBlockHash() == chainActive.Tip()->GetBlockHash())
         return true;  // No fork, return immediately.
@@ -2078,7 +2422,7 @@ bool AcceptBlock(CBlock &block, CValidationState &state, CDiskBlockPos *dbp) {
     CBlockIndex *pBlockIndexPrev = nullptr;
     int32_t height = 0;
     if (block.GetHeight() != 0 || blockHash != SysCfg().GetGenesisBlockHash()) {
-        map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.find(block.GetPrevBlockHash());
+        BlockMap::iterator mi = mapBlockIndex.find(block.GetPrevBlockHash());
         if (mi == mapBlockIndex.end())
             return state.DoS(10, ERRORMSG("AcceptBlock() : prev block not found"), 0, "bad-prevblk");
 
@@ -2114,16 +2458,15 @@ bool AcceptBlock(CBlock &block, CValidationState &state, CDiskBlockPos *dbp) {
 
     // Write block to history file
     try {
-        uint32_t nBlockSize = ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
         CDiskBlockPos blockPos;
-        if (dbp != nullptr)
+        if (dbp != nullptr) {
             blockPos = *dbp;
-
-        if (!FindBlockPos(state, blockPos, nBlockSize + 8, height, block.GetTime(), dbp != nullptr))
-            return ERRORMSG("AcceptBlock() : FindBlockPos failed");
-
-        if (dbp == nullptr && !WriteBlockToDisk(block, blockPos))
-            return state.Abort(_("Failed to write block"));
+            uint32_t nBlockSize = ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
+            if (!FindBlockPos(state, blockPos, nBlockSize + 8, height, block.GetTime(), true))
+                return ERRORMSG("AcceptBlock() : FindBlockPos failed");
+        } else if (!WriteBlockToDisk(block, state, blockPos, height)) {
+            return ERRORMSG("AcceptBlock() : WriteBlockToDisk failed");
+        }
 
         if (!AddToBlockIndex(block, state, blockPos))
             return ERRORMSG("AcceptBlock() : AddToBlockIndex failed");
@@ -2381,24 +2724,17 @@ CMerkleBlock::CMerkleBlock(const CBlock &block, CBloomFilter &filter) {
     txn = CPartialMerkleTree(vHashes, vMatch);
 }
 
-uint256 CPartialMerkleTree::CalcHash(int32_t height, uint32_t pos, const vector<uint256> &vTxid) {
-    if (height == 0) {
-        // hash at height 0 is the txids themself
-        return vTxid[pos];
-    } else {
-        // calculate left hash
-        uint256 left = CalcHash(height - 1, pos * 2, vTxid), right;
-        // calculate right hash if not beyond the end of the array - copy left hash otherwise1
-        if (pos * 2 + 1 < CalcTreeWidth(height - 1))
-            right = CalcHash(height - 1, pos * 2 + 1, vTxid);
-        else
-            right = left;
-        // combine subhashes
-        return Hash(BEGIN(left), END(left), BEGIN(right), END(right));
+void CPartialMerkleTree::CalcHashes(const vector<uint256> &vTxid, vector<vector<uint256> > &vLevels) {
+    vLevels.clear();
+    vLevels.push_back(vTxid);
+    // hash each level in one batch, an odd last hash is combined with itself
+    for (int32_t height = 1; CalcTreeWidth(height - 1) > 1; height++) {
+        vLevels.emplace_back(CalcTreeWidth(height));
+        MerkleHashLevel(&vLevels[height][0], &vLevels[height - 1][0], vLevels[height - 1].size());
     }
 }
 
-void CPartialMerkleTree::TraverseAndBuild(int32_t height, uint32_t pos, const vector<uint256> &vTxid, const vector<bool> &vMatch) {
+void CPartialMerkleTree::TraverseAndBuild(int32_t height, uint32_t pos, const vector<vector<uint256> > &vLevels, const vector<bool> &vMatch) {
     // determine whether this node is the parent of at least one matched txid
     bool fParentOfMatch = false;
     for (uint32_t p = pos << height; p < (pos + 1) << height && p < nTransactions; p++)
@@ -2407,12 +2743,12 @@ void CPartialMerkleTree::TraverseAndBuild(int32_t height, uint32_t pos, const ve
     vBits.push_back(fParentOfMatch);
     if (height == 0 || !fParentOfMatch) {
         // if at height 0, or nothing interesting below, store hash and stop
-        vHash.push_back(CalcHash(height, pos, vTxid));
+        vHash.push_back(vLevels[height][pos]);
     } else {
         // otherwise, don't store any hash, but descend into the subtrees
-        TraverseAndBuild(height - 1, pos * 2, vTxid, vMatch);
+        TraverseAndBuild(height - 1, pos * 2, vLevels, vMatch);
         if (pos * 2 + 1 < CalcTreeWidth(height - 1))
-            TraverseAndBuild(height - 1, pos * 2 + 1, vTxid, vMatch);
+            TraverseAndBuild(height - 1, pos * 2 + 1, vLevels, vMatch);
     }
 }
 
@@ -2443,7 +2779,9 @@ uint256 CPartialMerkleTree::TraverseAndExtract(int32_t height, uint32_t pos,
         else
             right = left;
         // and combine them before returning
-        return Hash(BEGIN(left), END(left), BEGIN(right), END(right));
+        uint256 children[2] = {left, right}, hash;
+        MerkleHashLevel(&hash, children, 2);
+        return hash;
     }
 }
 
@@ -2458,8 +2796,10 @@ CPartialMerkleTree::CPartialMerkleTree(const vector<uint256> &vTxid, const vecto
     while (CalcTreeWidth(height) > 1)
         height++;
 
-    // traverse the partial tree
-    TraverseAndBuild(height, 0, vTxid, vMatch);
+    // hash the whole tree once, then traverse the partial tree
+    vector<vector<uint256> > vLevels;
+    CalcHashes(vTxid, vLevels);
+    TraverseAndBuild(height, 0, vLevels, vMatch);
 }
 
 CPartialMerkleTree::CPartialMerkleTree() : nTransactions(0), fBad(true) {}
@@ -2521,7 +2861,7 @@ bool static LoadBlockIndexDB() {
 
     boost::this_thread::interruption_point();
 
-    // Calculate nChainWork
+    // Calculate nChainTx
     vector<pair<int32_t, CBlockIndex *> > vSortedByHeight;
     vSortedByHeight.reserve(mapBlockIndex.size());
     for (const auto &item : mapBlockIndex) {
@@ -2531,12 +2871,11 @@ bool static LoadBlockIndexDB() {
     sort(vSortedByHeight.begin(), vSortedByHeight.end());
     for (const auto &item : vSortedByHeight) {
         CBlockIndex *pIndex = item.second;
-        pIndex->nChainWork  = pIndex->height;
         pIndex->nChainTx    = (pIndex->pprev ? pIndex->pprev->nChainTx : 0) + pIndex->nTx;
         if ((pIndex->nStatus & BLOCK_VALID_MASK) >= BLOCK_VALID_TRANSACTIONS && !(pIndex->nStatus & BLOCK_FAILED_MASK))
             setBlockIndexValid.insert(pIndex);
         if (pIndex->nStatus & BLOCK_FAILED_MASK &&
-            (!pindexBestInvalid || pIndex->nChainWork > pindexBestInvalid->nChainWork))
+            (!pindexBestInvalid || pIndex->GetChainWork() > pindexBestInvalid->GetChainWork()))
             pindexBestInvalid = pIndex;
         if (pIndex->pprev)
             pIndex->BuildSkip();
@@ -2561,6 +2900,12 @@ bool static LoadBlockIndexDB() {
     SysCfg().SetTxIndex(bTxIndex);
     LogPrint("INFO", "LoadBlockIndexDB(): transaction index %s\n", bTxIndex ? "enabled" : "disabled");
 
+    // Check whether we have an address index
+    bool bAddressIndex = SysCfg().IsAddressIndex();
+    pCdMan->pBlockCache->ReadFlag("addressindex", bAddressIndex);
+    SysCfg().SetAddressIndex(bAddressIndex);
+    LogPrint("INFO", "LoadBlockIndexDB(): address index %s\n", bAddressIndex ? "enabled" : "disabled");
+
     // Load pointer to end of best chain
     uint256 bestBlockHash = pCdMan->pBlockCache->GetBestBlock();
     const auto &it = mapBlockIndex.find(bestBlockHash);
@@ -2601,6 +2946,12 @@ bool VerifyDB(int32_t nCheckLevel, int32_t nCheckDepth) {
         if (pIndex->height < chainActive.Height() - nCheckDepth)
             break;
 
+        // the undo data checked from level 2 on is gone below the pruned height
+        if (nCheckLevel >= 2 && IsBlockUndoPruned(pIndex)) {
+            LogPrint("INFO", "VerifyDB() : undo data pruned below height %d, stop verifying\n", pIndex->height + 1);
+            break;
+        }
+
         CBlock block;
         // check level 0: read from disk
         if (!ReadBlockFromDisk(pIndex, block))
@@ -2666,12 +3017,56 @@ bool VerifyDB(int32_t nCheckLevel, int32_t nCheckDepth) {
 }
 
 void UnloadBlockIndex() {
-    mapBlockIndex.clear();
+    {
+        LOCK(cs_mapBlockIndex);
+        mapBlockIndex.clear();
+        blockIndexArena.Clear();
+    }
     setBlockIndexValid.clear();
     chainActive.SetTip(nullptr);
     pindexBestInvalid = nullptr;
 }
 
+bool BuildAddressIndex() {
+    LOCK(cs_main);
+    LogPrint("INFO", "Building address index up to height %d...\n", chainActive.Height());
+    int64_t nStart = GetTimeMillis();
+
+    CCacheWrapper cw(pCdMan);
+    map<CAddressTxKey, uint256> mapAddressTx;
+    uint64_t nTotal = 0;
+    for (CBlockIndex *pIndex = chainActive.Genesis(); pIndex; pIndex = chainActive.Next(pIndex)) {
+        boost::this_thread::interruption_point();
+
+        CBlock block;
+        if (!ReadBlockFromDisk(pIndex, block))
+            return ERRORMSG("BuildAddressIndex() : failed to read block %d, hash=%s", pIndex->height,
+                            pIndex->GetBlockHash().GetHex());
+
+        for (uint32_t index = 0; index < block.vptx.size(); index++) {
+            set<CKeyID> keyIds;
+            if (!block.vptx[index]->GetInvolvedKeyIds(cw, keyIds))
+                continue;
+
+            for (const auto &keyId : keyIds)
+                mapAddressTx[CAddressTxKey(keyId, pIndex->height, index)] = block.vptx[index]->GetHash();
+        }
+
+        if (mapAddressTx.size() >= ADDRESS_INDEX_BATCH_SIZE || pIndex == chainActive.Tip()) {
+            pCdMan->pBlockDb->BatchWrite<CAddressTxKey, uint256>(dbk::KEYID_TXID, mapAddressTx);
+            nTotal += mapAddressTx.size();
+            mapAddressTx.clear();
+        }
+    }
+
+    SysCfg().SetAddressIndex(true);
+    pCdMan->pBlockCache->WriteFlag("addressindex", true);
+    pCdMan->pBlockCache->Flush();
+
+    LogPrint("INFO", "Built address index of %llu entries in %dms\n", nTotal, GetTimeMillis() - nStart);
+    return true;
+}
+
 bool LoadBlockIndex() {
     // Load block index from databases
     if (!SysCfg().IsReindex() && !LoadBlockIndexDB())
@@ -2688,6 +3083,11 @@ bool InitBlockIndex() {
     // Use the provided setting for -txindex in the new database
     SysCfg().SetTxIndex(SysCfg().GetBoolArg("-txindex", true));
     pCdMan->pBlockCache->WriteFlag("txindex", SysCfg().IsTxIndex());
+    // Likewise for -addressindex
+    SysCfg().SetAddressIndex(SysCfg().GetBoolArg("-addressindex", false));
+    pCdMan->pBlockCache->WriteFlag("addressindex", SysCfg().IsAddressIndex());
+    // Accounts are stored as an identity record plus one record per token balance
+    pCdMan->pBlockCache->WriteFlag("accounttokens", true);
     LogPrint("INFO", "Initializing databases...\n");
 
     // Only add the genesis block if not reindexing (in which case we reuse the one already on disk)
@@ -2695,13 +3095,9 @@ bool InitBlockIndex() {
         try {
             CBlock &block = const_cast<CBlock &>(SysCfg().GenesisBlock());
             // Start new block file
-            uint32_t nBlockSize = ::GetSerializeSize(block, SER_DISK, CLIENT_VERSION);
             CDiskBlockPos blockPos;
             CValidationState state;
-            if (!FindBlockPos(state, blockPos, nBlockSize + 8, 0, block.GetTime()))
-                return ERRORMSG("InitBlockIndex() : FindBlockPos failed");
-
-            if (!WriteBlockToDisk(block, blockPos))
+            if (!WriteBlockToDisk(block, state, blockPos, 0))
                 return ERRORMSG("InitBlockIndex() : writing genesis block to disk failed");
 
             if (!AddToBlockIndex(block, state, blockPos))
@@ -2719,7 +3115,7 @@ void PrintBlockTree() {
     AssertLockHeld(cs_main);
     // pre-compute tree structure
     map<CBlockIndex *, vector<CBlockIndex *> > mapNext;
-    for (map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.begin(); mi != mapBlockIndex.end(); ++mi) {
+    for (BlockMap::iterator mi = mapBlockIndex.begin(); mi != mapBlockIndex.end(); ++mi) {
         CBlockIndex *pIndex = (*mi).second;
         mapNext[pIndex->pprev].push_back(pIndex);
     }
@@ -2949,6 +3345,11 @@ bool static ProcessMessage(CNode *pFrom, string strCommand, CDataStream &vRecv)
            return true;
     }
 
+    else if (strCommand == "headers" && !SysCfg().IsImporting() && !SysCfg().IsReindex()) {
+        if(!ProcessHeadersMessage(pFrom, vRecv))
+            return false ;
+    }
+
     else if (strCommand == "tx") {
         if(!ProcessTxMessage(pFrom, strCommand , vRecv))
             return false ;
@@ -2959,6 +3360,23 @@ bool static ProcessMessage(CNode *pFrom, string strCommand, CDataStream &vRecv)
         ProcessBlockMessage(pFrom, vRecv);
     }
 
+    else if (strCommand == "sendcmpct") {
+        ProcessSendCmpctMessage(pFrom, vRecv);
+    }
+
+    else if (strCommand == "cmpctblock" && !SysCfg().IsImporting() && !SysCfg().IsReindex()) {
+        ProcessCompactBlockMessage(pFrom, vRecv);
+    }
+
+    else if (strCommand == "getblocktxn") {
+        if (!ProcessGetBlockTxnMessage(pFrom, vRecv))
+            return false;
+    }
+
+    else if (strCommand == "blocktxn" && !SysCfg().IsImporting() && !SysCfg().IsReindex()) {
+        ProcessBlockTxnMessage(pFrom, vRecv);
+    }
+
     else if (strCommand == "getaddr") {
         pFrom->vAddrToSend.clear();
         vector<CAddress> vAddr = addrman.GetAddr();
@@ -3099,6 +3517,8 @@ bool ProcessMessages(CNode *pFrom) {
             continue;
         }
 
+        recvToProcessLatency.Add(GetTimeMicros() - msg.nTime);
+
         // Process message
         bool fRet = false;
         try {
@@ -3241,7 +3661,13 @@ bool SendMessages(CNode *pTo, bool fSendTrickle) {
         if (pTo->fStartSync && !SysCfg().IsImporting() && !SysCfg().IsReindex()) {
             pTo->fStartSync = false;
             nSyncTipHeight  = pTo->nStartingHeight;
-            LogPrint("net", "start block sync lead to getblocks\n");
+            LogPrint("net", "start block sync lead to getheaders\n");
+            blockSyncScheduler.StartHeaderSync(pTo);
+        }
+
+        // Fall back to inventory based sync if the sync peer ignores getheaders
+        if (blockSyncScheduler.IsHeaderSyncTimeout(pTo, GetTimeMicros())) {
+            LogPrint("net", "header sync timeout lead to getblocks\n");
             PushGetBlocks(pTo, chainActive.Tip(), uint256());
         }
 
@@ -3311,10 +3737,16 @@ bool SendMessages(CNode *pTo, bool fSendTrickle) {
         // Message: getdata (blocks)
         //
         vector<CInv> vGetData;
+        blockSyncScheduler.CheckStalls(nNow);
+        if (!pTo->fDisconnect)
+            blockSyncScheduler.RequestBlocks(pTo, nNow, vGetData);
+
+        // New blocks are fetched as compact blocks, most of their txs are in our mempool already
+        int32_t nBlockInvType = (state.fSupportsCompactBlocks && !IsInitialBlockDownload()) ? MSG_CMPCT_BLOCK : MSG_BLOCK;
         int32_t index(0);
         while (!pTo->fDisconnect && state.nBlocksToDownload && state.nBlocksInFlight < MAX_BLOCKS_IN_TRANSIT_PER_PEER) {
             uint256 hash = state.vBlocksToDownload.front();
-            vGetData.push_back(CInv(MSG_BLOCK, hash));
+            vGetData.push_back(CInv(nBlockInvType, hash));
             MarkBlockAsInFlight(pTo->GetId(), hash);
             LogPrint("net", "Requesting block [%d] %s from %s, nBlocksInFlight=%d\n",
                      ++index, hash.ToString().c_str(), state.name.c_str(), state.nBlocksInFlight);
@@ -3351,10 +3783,8 @@ class CMainCleanup {
     CMainCleanup() {}
     ~CMainCleanup() {
         // block headers
-        map<uint256, CBlockIndex *>::iterator it1 = mapBlockIndex.begin();
-        for (; it1 != mapBlockIndex.end(); it1++)
-            delete (*it1).second;
         mapBlockIndex.clear();
+        blockIndexArena.Clear();
 
         // orphan blocks
         map<uint256, COrphanBlock *>::iterator it2 = mapOrphanBlocks.begin();
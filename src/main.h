@@ -16,6 +16,7 @@
 #include <map>
 #include <set>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 
@@ -30,6 +31,7 @@
 #include "persistence/block.h"
 #include "persistence/blockdb.h"
 #include "persistence/cachewrapper.h"
+#include "persistence/chainsnapshot.h"
 #include "persistence/delegatedb.h"
 #include "persistence/dexdb.h"
 #include "persistence/logdb.h"
@@ -67,9 +69,18 @@ extern CChain chainActive;
 extern CSignatureCache signatureCache;
 
 extern CTxMemPool mempool;
-extern map<uint256, CBlockIndex *> mapBlockIndex;
+typedef std::unordered_map<uint256, CBlockIndex *, CUint256Hasher> BlockMap;
+extern BlockMap mapBlockIndex;
+/** Owns the entries of mapBlockIndex */
+extern CBlockIndexArena blockIndexArena;
+/** Guards changes to mapBlockIndex, which also hold cs_main, against readers not holding cs_main */
+extern CCriticalSection cs_mapBlockIndex;
 extern uint64_t nLastBlockTx;
 extern uint64_t nLastBlockSize;
+/** Time spent writing a block and its undo data and committing them with the chain state, per block */
+extern CLatencyHistogram blockPersistLatency;
+/** Time spent connecting a block to the chain state caches, per block */
+extern CLatencyHistogram blockConnectLatency;
 extern const string strMessageMagic;
 
 extern bool mining;     // could be changed due to vote change
@@ -81,6 +92,7 @@ static const string NetTypeNames[] = { "MAIN_NET", "TEST_NET", "REGTEST_NET" };
 class CTxUndo;
 class CValidationState;
 class CWalletInterface;
+class CChainEventListener;
 class CTxMemCache;
 class CUserCDP;
 
@@ -96,6 +108,12 @@ void UnregisterAllWallets();
 void SyncTransaction(const uint256 &hash, CBaseTx *pBaseTx, const CBlock *pBlock = nullptr);
 /** Erase Tx from wallets **/
 void EraseTransaction(const uint256 &hash);
+/** Register a listener of chain and mempool events */
+void RegisterChainEventListener(CChainEventListener *pListenerIn);
+/** Unregister a listener of chain and mempool events */
+void UnregisterChainEventListener(CChainEventListener *pListenerIn);
+/** Tell the chain event listeners that a tx left the mempool */
+void NotifyTxRemovedFromMempool(const uint256 &hash);
 /** Register with a network node to receive its signals */
 void RegisterNodeSignals(CNodeSignals &nodeSignals);
 /** Unregister a network node */
@@ -276,6 +294,15 @@ public:
         pReceiptDb      = new CDBAccess(DBNameType::RECEIPT, false, fReIndex);
         pReceiptCache   = new CTxReceiptDBCache(pReceiptDb);
 
+        // -dbcache is shared by the top-level caches in proportion to the db cache sizes
+        vector<CDBAccess *> vDbs = {pSysParamDb, pAccountDb, pAssetDb, pContractDb, pDelegateDb, pCdpDb,
+                                    pClosedCdpDb, pDexDb, pBlockDb, pLogDb, pReceiptDb};
+        uint64_t nTotalSize = 0;
+        for (auto pDb : vDbs)
+            nTotalSize += DBCacheSize[pDb->GetDbNameType()];
+        for (auto pDb : vDbs)
+            pDb->SetCacheBudget((SysCfg().GetDbCache() << 20) / nTotalSize * DBCacheSize[pDb->GetDbNameType()]);
+
         // memory-only cache
         pTxCache        = new CTxMemCache();
         pPpCache        = new CPricePointMemCache();
@@ -343,6 +370,10 @@ public:
         // if (pPpCache)
         //     pPpCache->Flush();
 
+        string report = dbFlushStats.Report();
+        if (!report.empty())
+            LogPrint("dbflush", "flushed clean/dirty entries by prefix:%s\n", report);
+
         return true;
     }
 };  // CCacheDBManager
@@ -361,37 +392,8 @@ public:
         READWRITE(vtxundo);
     )
 
-    bool WriteToDisk(CDiskBlockPos &pos, const uint256 &blockHash) {
-        // Open history file to append
-        CAutoFile fileout = CAutoFile(OpenUndoFile(pos), SER_DISK, CLIENT_VERSION);
-        if (!fileout)
-            return ERRORMSG("CBlockUndo::WriteToDisk : OpenUndoFile failed");
-
-        // Write index header
-        uint32_t nSize = fileout.GetSerializeSize(*this);
-        fileout << FLATDATA(SysCfg().MessageStart()) << nSize;
-
-        // Write undo data
-        long fileOutPos = ftell(fileout);
-        if (fileOutPos < 0)
-            return ERRORMSG("CBlockUndo::WriteToDisk : ftell failed");
-        pos.nPos = (uint32_t)fileOutPos;
-        fileout << *this;
-
-        // calculate & write checksum
-        CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
-        hasher << blockHash;
-        hasher << *this;
-
-        fileout << hasher.GetHash();
-
-        // Flush stdio buffers and commit to disk before returning
-        fflush(fileout);
-        if (!IsInitialBlockDownload())
-            FileCommit(fileout);
-
-        return true;
-    }
+    /** Write the undo data with its checksum to a new position of the undo file nFile, setting pos */
+    bool WriteToDisk(CValidationState &state, int32_t nFile, CDiskBlockPos &pos, const uint256 &blockHash);
 
     bool ReadFromDisk(const CDiskBlockPos &pos, const uint256 &blockHash) {
         // Open history file to read
@@ -475,11 +477,11 @@ protected:
         return (nTransactions + (1 << height) - 1) >> height;
     }
 
-    // calculate the hash of a node in the merkle tree (at leaf level: the txid's themself)
-    uint256 CalcHash(int32_t height, uint32_t pos, const vector<uint256> &vTxid);
+    // calculate the hashes of all nodes in the merkle tree level by level (at leaf level: the txid's themself)
+    void CalcHashes(const vector<uint256> &vTxid, vector<vector<uint256> > &vLevels);
 
     // recursive function that traverses tree nodes, storing the data as bits and hashes
-    void TraverseAndBuild(int32_t height, uint32_t pos, const vector<uint256> &vTxid, const vector<bool> &vMatch);
+    void TraverseAndBuild(int32_t height, uint32_t pos, const vector<vector<uint256> > &vLevels, const vector<bool> &vMatch);
 
     // recursive function that traverses tree nodes, consuming the bits and hashes produced by TraverseAndBuild.
     // it returns the hash of the respective node.
@@ -614,6 +616,17 @@ protected:
     friend void ::UnregisterAllWallets();
 };
 
+/** Chain and mempool events, called under cs_main so the listener must not block */
+class CChainEventListener {
+protected:
+    virtual void BlockConnected(const CBlock &block, const CBlockIndex *pIndex)    = 0;
+    virtual void BlockDisconnected(const CBlock &block, const CBlockIndex *pIndex) = 0;
+    virtual void TxAddedToMempool(const uint256 &hash, const CBaseTx *pBaseTx)    = 0;
+    virtual void TxRemovedFromMempool(const uint256 &hash)                        = 0;
+    friend void ::RegisterChainEventListener(CChainEventListener *);
+    friend void ::UnregisterChainEventListener(CChainEventListener *);
+};
+
 /** Functions for validating blocks and updating the block tree */
 
 /** Undo the effects of this block (with given index) on the UTXO set represented by coins.
@@ -652,6 +665,8 @@ bool LoadExternalBlockFile(FILE *fileIn, CDiskBlockPos *dbp = nullptr);
 bool InitBlockIndex();
 /** Load the block tree and coins database from disk */
 bool LoadBlockIndex();
+/** Build the -addressindex of the active chain from the block files, when enabled on an existing chain */
+bool BuildAddressIndex();
 /** Unload database information */
 void UnloadBlockIndex();
 /** Push getblocks request */
@@ -671,9 +686,16 @@ bool ActivateBestChain(CValidationState &state);
 /** Remove invalidity status from a block and its descendants. */
 bool ReconsiderBlock(CValidationState &state, CBlockIndex *pIndex);
 /** Functions for disk access for blocks */
-bool WriteBlockToDisk(CBlock &block, CDiskBlockPos &pos);
+/** Write the block to a new position of the block files, setting pos. Committed with the chain state. */
+bool WriteBlockToDisk(CBlock &block, CValidationState &state, CDiskBlockPos &pos, uint32_t height);
 bool ReadBlockFromDisk(const CDiskBlockPos &pos, CBlock &block);
 bool ReadBlockFromDisk(const CBlockIndex *pIndex, CBlock &block);
+/** Read only the header of the block at pos */
+bool ReadBlockHeaderFromDisk(const CDiskBlockPos &pos, CBlockHeader &header);
+/** Read the tx at pos, as recorded by -txindex, and the header of its block */
+bool ReadTxFromDisk(const CDiskTxPos &pos, CBlockHeader &header, std::shared_ptr<CBaseTx> &pBaseTx);
+/** Whether the undo data of the block was deleted by -prune, the block data is always kept */
+inline bool IsBlockUndoPruned(const CBlockIndex *pIndex) { return pIndex->nStatus & BLOCK_PRUNED; }
 
 
 bool ReadBaseTxFromDisk(const CTxCord txCord, std::shared_ptr<CBaseTx> &pTx);
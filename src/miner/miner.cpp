@@ -165,17 +165,21 @@ static void ShuffleDelegates(const int32_t nCurHeight, vector<CRegID> &delegateL
     }
 }
 
-bool VerifyRewardTx(const CBlock *pBlock, CCacheWrapper &cwIn, bool bNeedRunTx) {
-    uint32_t maxNonce = SysCfg().GetBlockMaxNonce();
-
+bool GetBlockDelegate(const int64_t currentTime, const int32_t height, CCacheWrapper &cw, CRegID &delegate) {
     vector<CRegID> delegateList;
-    if (!cwIn.delegateCache.GetTopDelegateList(delegateList))
+    if (!cw.delegateCache.GetTopDelegateList(delegateList))
         return false;
 
-    ShuffleDelegates(pBlock->GetHeight(), delegateList);
+    ShuffleDelegates(height, delegateList);
+
+    return GetCurrentDelegate(currentTime, height, delegateList, delegate);
+}
+
+bool VerifyRewardTx(const CBlock *pBlock, CCacheWrapper &cwIn, bool bNeedRunTx) {
+    uint32_t maxNonce = SysCfg().GetBlockMaxNonce();
 
     CRegID regId;
-    if (!GetCurrentDelegate(pBlock->GetTime(), pBlock->GetHeight(), delegateList, regId))
+    if (!GetBlockDelegate(pBlock->GetTime(), pBlock->GetHeight(), cwIn, regId))
         return ERRORMSG("VerifyRewardTx() : failed to get current delegate");
     CAccount curDelegate;
     if (!cwIn.accountCache.GetAccount(regId, curDelegate))
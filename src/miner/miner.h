@@ -84,6 +84,9 @@ std::unique_ptr<CBlock> CreateNewBlockStableCoinRelease(CCacheWrapper &cwIn);
 bool CreateBlockRewardTx(const int64_t currentTime, const CAccount &delegate, CAccountDBCache &accountCache,
                          CBlock *pBlock);
 
+/** Get the delegate scheduled to produce the block of the given height and time */
+bool GetBlockDelegate(const int64_t currentTime, const int32_t height, CCacheWrapper &cw, CRegID &delegate);
+
 bool VerifyRewardTx(const CBlock *pBlock, CCacheWrapper &cwIn, bool bNeedRunTx = false);
 
 /** Check mined block */
@@ -19,6 +19,11 @@
 #include <fcntl.h>
 #endif
 
+#if defined(__linux__)
+#define USE_EPOLL
+#include <sys/epoll.h>
+#endif
+
 #ifdef USE_UPNP
 #include <miniupnpc/miniupnpc.h>
 #include <miniupnpc/miniwget.h>
@@ -30,7 +35,10 @@
 #include <sys/sysinfo.h>
 #include <sys/utsname.h>
 
+#include <chrono>
+#include <condition_variable>
 #include <fstream>
+#include <mutex>
 #include <sstream>
 #include <string>
 #include <thread>
@@ -90,6 +98,19 @@ CCriticalSection cs_nLastNodeId;
 
 static CSemaphore* semOutbound = nullptr;
 
+CLatencyHistogram recvToProcessLatency;
+
+// Wakes ThreadMessageHandler up as soon as there is something to process
+static std::mutex mutexMsgProc;
+static std::condition_variable condMsgProc;
+static bool fMsgProcWake = false;
+
+#ifdef USE_EPOLL
+/** The maximum number of socket events handled per epoll_wait call */
+static const int MAX_EPOLL_EVENTS = 256;
+static SOCKET hEpoll = INVALID_SOCKET;
+#endif
+
 // Signals for message handling
 static CNodeSignals g_signals;
 CNodeSignals& GetNodeSignals() { return g_signals; }
@@ -624,7 +645,8 @@ void CNode::copyStats(CNodeStats& stats) {
 #undef X
 
 // requires LOCK(cs_vRecvMsg)
-bool CNode::ReceiveMsgBytes(const char* pch, unsigned int nBytes) {
+bool CNode::ReceiveMsgBytes(const char* pch, unsigned int nBytes, bool& fComplete) {
+    fComplete = false;
     while (nBytes > 0) {
         // get current incomplete message, or create a new one
         if (vRecvMsg.empty() || vRecvMsg.back().complete()) vRecvMsg.push_back(CNetMessage(SER_NETWORK, nRecvVersion));
@@ -641,6 +663,11 @@ bool CNode::ReceiveMsgBytes(const char* pch, unsigned int nBytes) {
         if (handled < 0)
             return false;
 
+        if (msg.complete()) {
+            msg.nTime = GetTimeMicros();
+            fComplete = true;
+        }
+
         pch += handled;
         nBytes -= handled;
     }
@@ -648,6 +675,50 @@ bool CNode::ReceiveMsgBytes(const char* pch, unsigned int nBytes) {
     return true;
 }
 
+void WakeMessageHandler() {
+    {
+        std::lock_guard<std::mutex> lock(mutexMsgProc);
+        fMsgProcWake = true;
+    }
+    condMsgProc.notify_one();
+}
+
+void CLatencyHistogram::Add(int64_t nMicros) {
+    if (nMicros < 0)
+        nMicros = 0;
+
+    int nBucket = 0;
+    while (nBucket < NUM_BUCKETS - 1 && (nMicros >> nBucket) > 0)
+        nBucket++;
+
+    vCounts[nBucket]++;
+    nCount++;
+    nTotalMicros += nMicros;
+
+    uint64_t nMax = nMaxMicros;
+    while ((uint64_t)nMicros > nMax && !nMaxMicros.compare_exchange_weak(nMax, nMicros)) {
+    }
+}
+
+void CLatencyHistogram::Reset() {
+    for (int i = 0; i < NUM_BUCKETS; i++)
+        vCounts[i] = 0;
+    nCount       = 0;
+    nTotalMicros = 0;
+    nMaxMicros   = 0;
+}
+
+uint64_t CLatencyHistogram::GetPercentile(double dPercentile) const {
+    uint64_t nTarget = (uint64_t)(nCount * dPercentile / 100);
+    uint64_t nSum    = 0;
+    for (int i = 0; i < NUM_BUCKETS - 1; i++) {
+        nSum += vCounts[i];
+        if (nSum > nTarget)
+            return (uint64_t)1 << i;
+    }
+    return nMaxMicros;
+}
+
 int CNetMessage::readHeader(const char* pch, unsigned int nBytes) {
     // copy data to temporary parsing buffer
     unsigned int nRemaining = 24 - nHdrPos;
@@ -733,8 +804,49 @@ void SocketSendData(CNode* pNode) {
 
 static list<CNode*> vNodesDisconnected;
 
+#ifdef USE_EPOLL
+// Decide what to do with a socket based on its edge-triggered readiness, following the same
+// send-before-receive and receive flood rules as the select() loop below.
+static void GetSocketWork(CNode* pNode, bool& fRecv, bool& fSend) {
+    bool fHaveSend = false;
+    {
+        TRY_LOCK(pNode->cs_vSend, lockSend);
+        fHaveSend = lockSend && !pNode->vSendMsg.empty();
+    }
+    if (fHaveSend) {
+        fSend = pNode->fSocketWritable;
+        fRecv = false;
+        return;
+    }
+
+    fSend = false;
+    fRecv = false;
+    if (pNode->fSocketReadable) {
+        TRY_LOCK(pNode->cs_vRecvMsg, lockRecv);
+        fRecv = lockRecv && (pNode->vRecvMsg.empty() || !pNode->vRecvMsg.front().complete() ||
+                             pNode->GetTotalRecvSize() <= ReceiveFloodSize());
+    }
+}
+#endif
+
 void ThreadSocketHandler() {
     unsigned int nPrevNodeCount = 0;
+#ifdef USE_EPOLL
+    hEpoll = epoll_create1(EPOLL_CLOEXEC);
+    if (hEpoll == INVALID_SOCKET) {
+        LogPrint("INFO", "epoll_create1 error %s\n", NetworkErrorString(errno));
+        return;
+    }
+
+    // Listen sockets are level-triggered, one connection is accepted per loop
+    for (auto hListenSocket : vhListenSocket) {
+        struct epoll_event event;
+        event.events  = EPOLLIN;
+        event.data.fd = hListenSocket;
+        if (epoll_ctl(hEpoll, EPOLL_CTL_ADD, hListenSocket, &event) == SOCKET_ERROR)
+            LogPrint("INFO", "epoll_ctl add listen socket error %s\n", NetworkErrorString(errno));
+    }
+#endif
     while (true) {
         //
         // Disconnect nodes
@@ -796,6 +908,71 @@ void ThreadSocketHandler() {
         //
         // Find which sockets have data to receive
         //
+        vector<SOCKET> vListenReady;
+#ifdef USE_EPOLL
+        bool fHaveWork = false;
+        {
+            LOCK(cs_vNodes);
+            for (auto pNode : vNodes) {
+                if (pNode->hSocket == INVALID_SOCKET)
+                    continue;
+
+                if (!pNode->fSocketRegistered) {
+                    struct epoll_event event;
+                    event.events  = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+                    event.data.fd = pNode->hSocket;
+                    if (epoll_ctl(hEpoll, EPOLL_CTL_ADD, pNode->hSocket, &event) == SOCKET_ERROR) {
+                        LogPrint("INFO", "epoll_ctl add socket error %s\n", NetworkErrorString(errno));
+                        pNode->CloseSocketDisconnect();
+                        continue;
+                    }
+                    pNode->fSocketRegistered = true;
+                }
+
+                // Edge-triggered readiness must be consumed before waiting again
+                bool fRecv = false, fSend = false;
+                GetSocketWork(pNode, fRecv, fSend);
+                if (fRecv || fSend)
+                    fHaveWork = true;
+            }
+        }
+
+        struct epoll_event vEvents[MAX_EPOLL_EVENTS];
+        int nEvents = epoll_wait(hEpoll, vEvents, MAX_EPOLL_EVENTS, fHaveWork ? 0 : 50);
+        boost::this_thread::interruption_point();
+
+        if (nEvents == SOCKET_ERROR) {
+            if (errno != EINTR) {
+                LogPrint("INFO", "socket epoll_wait error %s\n", NetworkErrorString(errno));
+                MilliSleep(50);
+            }
+        } else if (nEvents > 0) {
+            LOCK(cs_vNodes);
+            map<SOCKET, CNode*> mapSocketNode;
+            for (auto pNode : vNodes) {
+                if (pNode->hSocket != INVALID_SOCKET)
+                    mapSocketNode[pNode->hSocket] = pNode;
+            }
+
+            for (int i = 0; i < nEvents; i++) {
+                SOCKET hSocket = vEvents[i].data.fd;
+                if (find(vhListenSocket.begin(), vhListenSocket.end(), hSocket) != vhListenSocket.end()) {
+                    vListenReady.push_back(hSocket);
+                    continue;
+                }
+
+                auto it = mapSocketNode.find(hSocket);
+                if (it == mapSocketNode.end())
+                    continue;
+
+                // Errors and hang-ups are detected by the following recv()
+                if (vEvents[i].events & (EPOLLIN | EPOLLERR | EPOLLHUP | EPOLLRDHUP))
+                    it->second->fSocketReadable = true;
+                if (vEvents[i].events & EPOLLOUT)
+                    it->second->fSocketWritable = true;
+            }
+        }
+#else
         struct timeval timeout;
         timeout.tv_sec  = 0;
         timeout.tv_usec = 50000;  // frequency to poll pNode->vSend
@@ -869,11 +1046,16 @@ void ThreadSocketHandler() {
             MilliSleep(timeout.tv_usec / 1000);
         }
 
+        for (auto hListenSocket : vhListenSocket) {
+            if (hListenSocket != INVALID_SOCKET && FD_ISSET(hListenSocket, &fdsetRecv))
+                vListenReady.push_back(hListenSocket);
+        }
+#endif
+
         //
         // Accept new connections
         //
-        for (auto hListenSocket : vhListenSocket)
-            if (hListenSocket != INVALID_SOCKET && FD_ISSET(hListenSocket, &fdsetRecv)) {
+        for (auto hListenSocket : vListenReady) {
                 struct sockaddr_storage sockaddr;
                 socklen_t len  = sizeof(sockaddr);
                 SOCKET hSocket = accept(hListenSocket, (struct sockaddr*)&sockaddr, &len);
@@ -929,15 +1111,23 @@ void ThreadSocketHandler() {
             //
             if (pNode->hSocket == INVALID_SOCKET)
                 continue;
-            if (FD_ISSET(pNode->hSocket, &fdsetRecv) || FD_ISSET(pNode->hSocket, &fdsetError)) {
-                TRY_LOCK(pNode->cs_vRecvMsg, lockRecv);
-                if (lockRecv) {
-                    {
+#ifdef USE_EPOLL
+            bool fRecv = false, fSend = false;
+            GetSocketWork(pNode, fRecv, fSend);
+#else
+            bool fRecv = FD_ISSET(pNode->hSocket, &fdsetRecv) || FD_ISSET(pNode->hSocket, &fdsetError);
+            bool fSend = FD_ISSET(pNode->hSocket, &fdsetSend);
+#endif
+            if (fRecv) {
+                bool fComplete = false;
+                {
+                    TRY_LOCK(pNode->cs_vRecvMsg, lockRecv);
+                    if (lockRecv) {
                         // typical socket buffer is 8K-64K
                         char pchBuf[0x10000];
                         int nBytes = recv(pNode->hSocket, pchBuf, sizeof(pchBuf), MSG_DONTWAIT);
                         if (nBytes > 0) {
-                            if (!pNode->ReceiveMsgBytes(pchBuf, nBytes))
+                            if (!pNode->ReceiveMsgBytes(pchBuf, nBytes, fComplete))
                                 pNode->CloseSocketDisconnect();
                             pNode->nLastRecv = GetTime();
                             pNode->nRecvBytes += nBytes;
@@ -950,8 +1140,10 @@ void ThreadSocketHandler() {
                         } else if (nBytes < 0) {
                             // error
                             int nErr = WSAGetLastError();
-                            if (nErr != WSAEWOULDBLOCK && nErr != WSAEMSGSIZE && nErr != WSAEINTR &&
-                                nErr != WSAEINPROGRESS) {
+                            if (nErr == WSAEWOULDBLOCK) {
+                                // drained, wait for the next edge
+                                pNode->fSocketReadable = false;
+                            } else if (nErr != WSAEMSGSIZE && nErr != WSAEINTR && nErr != WSAEINPROGRESS) {
                                 if (!pNode->fDisconnect)
                                     LogPrint("INFO", "socket recv error %s\n", NetworkErrorString(nErr));
                                 pNode->CloseSocketDisconnect();
@@ -959,6 +1151,8 @@ void ThreadSocketHandler() {
                         }
                     }
                 }
+                if (fComplete)
+                    WakeMessageHandler();
             }
 
             //
@@ -966,9 +1160,14 @@ void ThreadSocketHandler() {
             //
             if (pNode->hSocket == INVALID_SOCKET)
                 continue;
-            if (FD_ISSET(pNode->hSocket, &fdsetSend)) {
+            if (fSend) {
                 TRY_LOCK(pNode->cs_vSend, lockSend);
-                if (lockSend) SocketSendData(pNode);
+                if (lockSend) {
+                    SocketSendData(pNode);
+                    // whatever is left could not be written, wait for the next edge
+                    if (!pNode->vSendMsg.empty())
+                        pNode->fSocketWritable = false;
+                }
             }
 
             //
@@ -1396,6 +1595,10 @@ void ThreadMessageHandler() {
     SetThreadPriority(THREAD_PRIORITY_BELOW_NORMAL);
     while (true) {
         bool fHaveSyncNode = false;
+        {
+            std::lock_guard<std::mutex> lock(mutexMsgProc);
+            fMsgProcWake = false;
+        }
 
         vector<CNode*> vNodesCopy;
         {
@@ -1454,8 +1657,13 @@ void ThreadMessageHandler() {
                 pNode->Release();
         }
 
-        if (fSleep)
-            MilliSleep(100);
+        // Sleep until the socket handler hands over a complete message, but wake up
+        // at least every 100 ms to keep SendMessages going
+        if (fSleep) {
+            std::unique_lock<std::mutex> lock(mutexMsgProc);
+            condMsgProc.wait_for(lock, std::chrono::milliseconds(100), [] { return fMsgProcWake; });
+        }
+        boost::this_thread::interruption_point();
     }
 }
 
@@ -1670,6 +1878,10 @@ public:
                 if (closesocket(hListenSocket) == SOCKET_ERROR)
                     LogPrint("INFO", "closesocket(hListenSocket) failed with error %s\n",
                              NetworkErrorString(WSAGetLastError()));
+#ifdef USE_EPOLL
+        if (hEpoll != INVALID_SOCKET)
+            close(hEpoll);
+#endif
 
         // clean up some globals (to help leak detection)
         for (auto pNode : vNodes)
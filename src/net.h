@@ -19,6 +19,7 @@
 #include "sync.h"
 
 #include <stdint.h>
+#include <atomic>
 #include <deque>
 
 #ifndef WIN32
@@ -57,6 +58,8 @@ bool BindListenPort(const CService& bindAddr, string& strError = REF(string()));
 void StartNode(boost::thread_group& threadGroup);
 bool StopNode();
 void SocketSendData(CNode* pNode);
+/** Wake up the message handler thread, e.g. when a complete message was received */
+void WakeMessageHandler();
 
 typedef int NodeId;
 
@@ -121,6 +124,35 @@ struct LocalServiceInfo {
 extern CCriticalSection cs_mapLocalHost;
 extern map<CNetAddr, LocalServiceInfo> mapLocalHost;
 
+/** Histogram of latencies in microseconds, bucketed by powers of two. Thread safe. */
+class CLatencyHistogram {
+public:
+    // Bucket i counts latencies in [2^(i-1), 2^i) us, the last one everything above
+    static const int NUM_BUCKETS = 24;
+
+private:
+    std::atomic<uint64_t> vCounts[NUM_BUCKETS];
+    std::atomic<uint64_t> nCount;
+    std::atomic<uint64_t> nTotalMicros;
+    std::atomic<uint64_t> nMaxMicros;
+
+public:
+    CLatencyHistogram() { Reset(); }
+
+    void Add(int64_t nMicros);
+    void Reset();
+
+    uint64_t GetCount() const { return nCount; }
+    uint64_t GetAverage() const { return nCount ? nTotalMicros / nCount : 0; }
+    uint64_t GetMax() const { return nMaxMicros; }
+    uint64_t GetBucketCount(int nBucket) const { return vCounts[nBucket]; }
+    /** Upper bound of the bucket holding the given percentile (0-100) in microseconds */
+    uint64_t GetPercentile(double dPercentile) const;
+};
+
+/** Time from a message being completely received to ProcessMessage picking it up */
+extern CLatencyHistogram recvToProcessLatency;
+
 class CNodeStats {
 public:
     NodeId nodeid;
@@ -152,11 +184,14 @@ public:
     CDataStream vRecv;  // received message data
     unsigned int nDataPos;
 
+    int64_t nTime;  // time (in microseconds) the message was completely received
+
     CNetMessage(int nTypeIn, int nVersionIn) : hdrbuf(nTypeIn, nVersionIn), vRecv(nTypeIn, nVersionIn) {
         hdrbuf.resize(24);
         in_data  = false;
         nHdrPos  = 0;
         nDataPos = 0;
+        nTime    = 0;
     }
 
     bool complete() const {
@@ -193,6 +228,11 @@ public:
     uint64_t nRecvBytes;
     int nRecvVersion;
 
+    // socket readiness reported by edge-triggered epoll, only used by the socket handler thread
+    bool fSocketReadable;
+    bool fSocketWritable;
+    bool fSocketRegistered;
+
     int64_t nLastSend;
     int64_t nLastRecv;
     int64_t nLastSendEmpty;
@@ -262,6 +302,9 @@ public:
         nServices                = 0;
         hSocket                  = hSocketIn;
         nRecvVersion             = INIT_PROTO_VERSION;
+        fSocketReadable          = false;
+        fSocketWritable          = true;
+        fSocketRegistered        = false;
         nLastSend                = 0;
         nLastRecv                = 0;
         nSendBytes               = 0;
@@ -344,7 +387,8 @@ public:
     }
 
     // requires LOCK(cs_vRecvMsg)
-    bool ReceiveMsgBytes(const char* pch, unsigned int nBytes);
+    // fComplete is set when at least one message got completed by these bytes
+    bool ReceiveMsgBytes(const char* pch, unsigned int nBytes, bool& fComplete);
 
     // requires LOCK(cs_vRecvMsg)
     void SetRecvVersion(int nVersionIn) {
@@ -0,0 +1,291 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blocksync.h"
+
+#include "main.h"
+
+#include <algorithm>
+
+CBlockSyncScheduler blockSyncScheduler;
+
+void CBlockSyncScheduler::SetNull() {
+    mapPending.clear();
+    mapPendingHeight.clear();
+    for (auto &item : mapPeers) {
+        item.second.nBlocksInFlight  = 0;
+        item.second.nBestKnownHeight = 0;
+    }
+
+    headerSyncNodeId   = -1;
+    nHeaderRequestTime = 0;
+    fHeadersSynced     = false;
+    lastHeaderHash     = uint256();
+    nLastHeaderHeight  = 0;
+    nTotalStalls       = 0;
+}
+
+void CBlockSyncScheduler::PushGetHeaders(CNode *pNode) {
+    CBlockLocator locator = chainActive.GetLocator();
+    // Continue from the last header we know of, the peer will find it in its active chain
+    if (!mapPending.empty() && !lastHeaderHash.IsNull())
+        locator.vHave.insert(locator.vHave.begin(), lastHeaderHash);
+
+    nHeaderRequestTime = GetTimeMicros();
+    pNode->PushMessage("getheaders", locator, uint256());
+    LogPrint("net", "getheaders from peer %s, last header height=%d, pending=%u\n", pNode->addr.ToString(),
+             nLastHeaderHeight, mapPending.size());
+}
+
+void CBlockSyncScheduler::UpdateBestKnownHeight(NodeId nodeId, int32_t height) {
+    CPeerState &peer = mapPeers[nodeId];
+    if (height > peer.nBestKnownHeight)
+        peer.nBestKnownHeight = height;
+}
+
+void CBlockSyncScheduler::Unassign(CPendingBlock &pending) {
+    if (pending.nodeId == -1)
+        return;
+
+    auto it = mapPeers.find(pending.nodeId);
+    if (it != mapPeers.end() && it->second.nBlocksInFlight > 0)
+        it->second.nBlocksInFlight--;
+
+    pending.nodeId       = -1;
+    pending.nRequestTime = 0;
+}
+
+void CBlockSyncScheduler::StartHeaderSync(CNode *pNode) {
+    headerSyncNodeId = pNode->GetId();
+    fHeadersSynced   = false;
+    mapPeers[pNode->GetId()];
+    PushGetHeaders(pNode);
+}
+
+bool CBlockSyncScheduler::IsHeaderSyncTimeout(CNode *pNode, int64_t nNow) {
+    if (pNode->GetId() != headerSyncNodeId || nHeaderRequestTime == 0 ||
+        nNow - nHeaderRequestTime < HEADERS_RESPONSE_TIMEOUT * 1000000)
+        return false;
+
+    LogPrint("INFO", "Peer %s did not answer getheaders in %d seconds\n", pNode->addr.ToString(),
+             HEADERS_RESPONSE_TIMEOUT);
+    headerSyncNodeId   = -1;
+    nHeaderRequestTime = 0;
+    return true;
+}
+
+bool CBlockSyncScheduler::ProcessHeaders(CNode *pFrom, const vector<CBlock> &vHeaders) {
+    if (pFrom->GetId() != headerSyncNodeId) {
+        LogPrint("net", "ignore unrequested headers from peer %s\n", pFrom->addr.ToString());
+        return true;
+    }
+    nHeaderRequestTime = 0;
+
+    if (vHeaders.empty()) {
+        fHeadersSynced   = true;
+        headerSyncNodeId = -1;
+        return true;
+    }
+
+    // The first header must extend either a block we have or the last header we know of
+    uint256 prevHash     = vHeaders[0].GetPrevBlockHash();
+    int32_t nPrevHeight  = 0;
+    auto mi              = mapBlockIndex.find(prevHash);
+    if (mi != mapBlockIndex.end()) {
+        nPrevHeight = mi->second->height;
+    } else if (prevHash == lastHeaderHash && !mapPending.empty()) {
+        nPrevHeight = nLastHeaderHeight;
+    } else {
+        headerSyncNodeId = -1;
+        return ERRORMSG("ProcessHeaders() : headers from peer %s don't connect, prev hash=%s", pFrom->addr.ToString(),
+                        prevHash.GetHex());
+    }
+
+    for (const auto &header : vHeaders) {
+        uint256 hash   = header.GetHash();
+        int32_t height = header.GetHeight();
+        if (header.GetPrevBlockHash() != prevHash || height != nPrevHeight + 1) {
+            headerSyncNodeId = -1;
+            return ERRORMSG("ProcessHeaders() : non-continuous headers from peer %s at height %d",
+                            pFrom->addr.ToString(), height);
+        }
+
+        if (!mapBlockIndex.count(hash)) {
+            auto it = mapPending.find(height);
+            if (it != mapPending.end() && it->second.hash != hash) {
+                // The sync peer switched to another branch, forget the stale entry and what the
+                // peers told about the branch
+                Unassign(it->second);
+                mapPendingHeight.erase(it->second.hash);
+                mapPending.erase(it);
+                for (auto &item : mapPeers)
+                    item.second.nBestKnownHeight = std::min(item.second.nBestKnownHeight, height - 1);
+            }
+            if (!mapPendingHeight.count(hash)) {
+                mapPending[height].hash = hash;
+                mapPendingHeight[hash]  = height;
+            }
+        }
+
+        prevHash    = hash;
+        nPrevHeight = height;
+    }
+
+    lastHeaderHash    = prevHash;
+    nLastHeaderHeight = nPrevHeight;
+    UpdateBestKnownHeight(pFrom->GetId(), nLastHeaderHeight);
+    if (nLastHeaderHeight > nSyncTipHeight)
+        nSyncTipHeight = nLastHeaderHeight;
+
+    LogPrint("net", "received %u headers from peer %s, last header height=%d, pending=%u\n", vHeaders.size(),
+             pFrom->addr.ToString(), nLastHeaderHeight, mapPending.size());
+
+    if (vHeaders.size() < (size_t)MAX_HEADERS_RESULTS) {
+        fHeadersSynced   = true;
+        headerSyncNodeId = -1;
+    } else if (mapPending.size() < (size_t)MAX_PENDING_SYNC_HEADERS) {
+        PushGetHeaders(pFrom);
+    }
+    // otherwise RequestBlocks asks for more once the pending headers drain
+
+    return true;
+}
+
+void CBlockSyncScheduler::AnnounceBlock(NodeId nodeId, const uint256 &hash) {
+    auto it = mapPendingHeight.find(hash);
+    if (it != mapPendingHeight.end()) {
+        UpdateBestKnownHeight(nodeId, it->second);
+        return;
+    }
+
+    auto mi = mapBlockIndex.find(hash);
+    if (mi != mapBlockIndex.end() && chainActive.Contains(mi->second))
+        UpdateBestKnownHeight(nodeId, mi->second->height);
+}
+
+bool CBlockSyncScheduler::ReceiveBlock(CNode *pFrom, const CBlock &block) {
+    auto it = mapPendingHeight.find(block.GetHash());
+    if (it == mapPendingHeight.end())
+        return false;
+
+    CPendingBlock &pending = mapPending[it->second];
+    if (pending.pBlock)
+        return true;  // duplicate
+
+    if (pending.nodeId == pFrom->GetId())
+        mapPeers[pFrom->GetId()].nStalls = 0;
+
+    Unassign(pending);
+    pending.pBlock = std::make_shared<CBlock>(block);
+
+    DrainReceived(pFrom);
+    return true;
+}
+
+void CBlockSyncScheduler::DrainReceived(CNode *pFrom) {
+    while (!mapPending.empty()) {
+        auto it                = mapPending.begin();
+        CPendingBlock &pending = it->second;
+
+        if (mapBlockIndex.count(pending.hash)) {
+            // Arrived through another path (e.g. relayed as a new block)
+            Unassign(pending);
+            mapPendingHeight.erase(pending.hash);
+            mapPending.erase(it);
+            continue;
+        }
+
+        if (!pending.pBlock)
+            break;
+
+        if (!mapBlockIndex.count(pending.pBlock->GetPrevBlockHash())) {
+            // Nothing below the lowest pending block can supply its parent any more
+            LogPrint("INFO", "DrainReceived() : block %s at height %d does not connect, reset header sync\n",
+                     pending.hash.GetHex(), it->first);
+            SetNull();
+            break;
+        }
+
+        std::shared_ptr<CBlock> pBlock = pending.pBlock;
+        mapPendingHeight.erase(pending.hash);
+        mapPending.erase(it);
+
+        CValidationState state;
+        if (!::ProcessBlock(state, pFrom, pBlock.get())) {
+            LogPrint("INFO", "DrainReceived() : ProcessBlock failed for block %s, reset header sync\n",
+                     pBlock->GetHash().GetHex());
+            SetNull();
+            break;
+        }
+    }
+}
+
+void CBlockSyncScheduler::RequestBlocks(CNode *pTo, int64_t nNow, vector<CInv> &vGetData) {
+    CPeerState &peer = mapPeers[pTo->GetId()];
+    if (peer.nStalls >= MAX_BLOCK_STALLS_PER_PEER) {
+        LogPrint("INFO", "Peer %s stalled header-first block download %d times, disconnecting\n",
+                 pTo->addr.ToString(), peer.nStalls);
+        pTo->fDisconnect = true;
+        return;
+    }
+
+    if (pTo->GetId() == headerSyncNodeId && nHeaderRequestTime == 0 && !fHeadersSynced &&
+        mapPending.size() < (size_t)MAX_PENDING_SYNC_HEADERS / 2)
+        PushGetHeaders(pTo);
+
+    int32_t nWindowEnd = chainActive.Height() + BLOCK_DOWNLOAD_WINDOW;
+    for (auto &item : mapPending) {
+        if (item.first > nWindowEnd || peer.nBlocksInFlight >= MAX_SYNC_BLOCKS_IN_FLIGHT_PER_PEER)
+            break;
+
+        // Ask only peers known to have the block, the header sync peer stays one after the sync
+        if (item.first > std::max(pTo->nStartingHeight, peer.nBestKnownHeight))
+            break;
+
+        CPendingBlock &pending = item.second;
+        if (pending.pBlock || pending.nodeId != -1)
+            continue;
+
+        pending.nodeId       = pTo->GetId();
+        pending.nRequestTime = nNow;
+        peer.nBlocksInFlight++;
+        vGetData.push_back(CInv(MSG_BLOCK, pending.hash));
+        LogPrint("net", "Requesting block %d %s from %s, nBlocksInFlight=%d\n", item.first, pending.hash.ToString(),
+                 pTo->addr.ToString(), peer.nBlocksInFlight);
+    }
+}
+
+void CBlockSyncScheduler::CheckStalls(int64_t nNow) {
+    int32_t nWindowEnd = chainActive.Height() + BLOCK_DOWNLOAD_WINDOW;
+    for (auto &item : mapPending) {
+        if (item.first > nWindowEnd)
+            break;
+
+        CPendingBlock &pending = item.second;
+        if (pending.nodeId == -1 || nNow - pending.nRequestTime < BLOCK_STALLING_TIMEOUT * 1000000)
+            continue;
+
+        // A peer asked on the strength of the unverified headers of another one may not have the block
+        nTotalStalls++;
+        CPeerState &peer = mapPeers[pending.nodeId];
+        if (item.first <= peer.nBestKnownHeight)
+            peer.nStalls++;
+        LogPrint("net", "block %d %s requested from peer=%d timed out, reassigning (total stalls=%d)\n", item.first,
+                 pending.hash.ToString(), pending.nodeId, nTotalStalls);
+        Unassign(pending);
+    }
+}
+
+void CBlockSyncScheduler::FinalizeNode(NodeId nodeId) {
+    for (auto &item : mapPending) {
+        if (item.second.nodeId == nodeId)
+            Unassign(item.second);
+    }
+    mapPeers.erase(nodeId);
+
+    if (headerSyncNodeId == nodeId) {
+        headerSyncNodeId   = -1;
+        nHeaderRequestTime = 0;
+    }
+}
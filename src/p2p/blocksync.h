@@ -0,0 +1,105 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef P2P_BLOCKSYNC_H
+#define P2P_BLOCKSYNC_H
+
+#include "commons/uint256.h"
+#include "net.h"
+#include "persistence/block.h"
+
+#include <map>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+/**
+ * Header-first block download scheduler.
+ *
+ * Headers are fetched from a single sync peer (the one picked by StartSync in net.cpp), then the
+ * corresponding blocks are requested in a sliding window from all connected peers, each with its
+ * own in-flight limit. A block is requested from a peer whose version message or whose own headers
+ * and invs show that it has the block. Requests that are not answered in time are handed to another
+ * peer, the timeout counts as a stall of the peer only if the peer itself sent the header or the inv
+ * of the block or of a later one, as the headers of others are not verified yet. The
+ * received blocks are buffered and fed to ProcessBlock in height order so that no block ever goes
+ * through the orphan pool during initial sync.
+ *
+ * All methods require cs_main.
+ */
+class CBlockSyncScheduler {
+private:
+    struct CPendingBlock {
+        uint256 hash;
+        NodeId nodeId;          // peer the block is requested from, -1 when unassigned
+        int64_t nRequestTime;   // time of the getdata request in microseconds
+        std::shared_ptr<CBlock> pBlock;  // set once the block has arrived
+
+        CPendingBlock() : nodeId(-1), nRequestTime(0) {}
+    };
+
+    struct CPeerState {
+        int32_t nBlocksInFlight;
+        int32_t nStalls;
+        int32_t nBestKnownHeight;  // highest block of the pending chain the peer sent as a header or an inv
+
+        CPeerState() : nBlocksInFlight(0), nStalls(0), nBestKnownHeight(0) {}
+    };
+
+    map<int32_t, CPendingBlock> mapPending;  // height -> block known from headers
+    map<uint256, int32_t> mapPendingHeight;  // hash -> height, for blocks in mapPending
+    map<NodeId, CPeerState> mapPeers;
+
+    NodeId headerSyncNodeId;      // peer headers are fetched from, -1 when none
+    int64_t nHeaderRequestTime;   // time of the outstanding getheaders request in microseconds, 0 when none
+    bool fHeadersSynced;          // the sync peer has no more headers for us
+    uint256 lastHeaderHash;
+    int32_t nLastHeaderHeight;
+    uint64_t nTotalStalls;
+
+    void PushGetHeaders(CNode *pNode);
+    void UpdateBestKnownHeight(NodeId nodeId, int32_t height);
+    void Unassign(CPendingBlock &pending);
+    void DrainReceived(CNode *pFrom);
+
+public:
+    CBlockSyncScheduler() { SetNull(); }
+
+    void SetNull();
+
+    /** Whether header-first sync is running (headers outstanding or blocks pending). */
+    bool IsActive() const { return headerSyncNodeId != -1 || !mapPending.empty(); }
+
+    /** Whether the given block hash is scheduled by header-first sync. */
+    bool IsScheduled(const uint256 &hash) const { return mapPendingHeight.count(hash) > 0; }
+
+    /** Start fetching headers from the sync peer. */
+    void StartHeaderSync(CNode *pNode);
+
+    /** Whether the getheaders request sent to pNode was ignored and getblocks should be used instead. */
+    bool IsHeaderSyncTimeout(CNode *pNode, int64_t nNow);
+
+    /** Handle a "headers" message, returns false if the headers don't connect. */
+    bool ProcessHeaders(CNode *pFrom, const vector<CBlock> &vHeaders);
+
+    /** Note that the peer has the block of hash, which it announced with an inv. */
+    void AnnounceBlock(NodeId nodeId, const uint256 &hash);
+
+    /** Handle a received block. Returns true if the block was consumed by the scheduler. */
+    bool ReceiveBlock(CNode *pFrom, const CBlock &block);
+
+    /** Assign blocks of the download window to pTo and append their getdata invs. */
+    void RequestBlocks(CNode *pTo, int64_t nNow, vector<CInv> &vGetData);
+
+    /** Release requests that timed out so that other peers can pick them up. */
+    void CheckStalls(int64_t nNow);
+
+    /** Forget everything about a disconnected peer and reassign its requests. */
+    void FinalizeNode(NodeId nodeId);
+};
+
+extern CBlockSyncScheduler blockSyncScheduler;
+
+#endif  // P2P_BLOCKSYNC_H
@@ -11,6 +11,9 @@
 #include "commons/util.h"
 #include "main.h"
 #include "net.h"
+#include "p2p/blocksync.h"
+#include "p2p/compactblock.h"
+#include "p2p/txvalidator.h"
 
 #include <string>
 #include <vector>
@@ -18,7 +21,6 @@
 using namespace std ;
 
 class CNode ;
-class CDataStream ;
 class CInv ;
 class COrphanBlock ;
 
@@ -71,6 +73,10 @@ namespace {
         int32_t nBlocksToDownload;            //待下载的块个数
         int64_t nLastBlockReceive;        //上一次收到块的时间
         int64_t nLastBlockProcess;        //收到块，处理消息时的时间
+        // Whether this peer announced compact block support with "sendcmpct".
+        bool fSupportsCompactBlocks;
+        // Compact block waiting for the "blocktxn" answer of this peer.
+        std::shared_ptr<CPartialBlock> pPartialBlock;
 
         CNodeState() {
             nMisbehavior      = 0;
@@ -79,6 +85,7 @@ namespace {
             nBlocksInFlight   = 0;
             nLastBlockReceive = 0;
             nLastBlockProcess = 0;
+            fSupportsCompactBlocks = false;
         }
     };
 
@@ -146,17 +153,23 @@ inline void ProcessGetData(CNode *pFrom) {
             boost::this_thread::interruption_point();
             it++;
 
-            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK) {
+            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK || inv.type == MSG_CMPCT_BLOCK) {
                 bool send                                = false;
-                map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.find(inv.hash);
-                if (mi != mapBlockIndex.end()) {
+                BlockMap::iterator mi = mapBlockIndex.find(inv.hash);
+                if (mi != mapBlockIndex.end() && (mi->second->nStatus & BLOCK_HAVE_DATA)) {
                     send = true;
                 }
                 if (send) {
                     // Send block from disk
                     CBlock block;
                     ReadBlockFromDisk((*mi).second, block);
-                    if (inv.type == MSG_BLOCK)
+                    if (inv.type == MSG_CMPCT_BLOCK && chainActive.Height() - mi->second->height <= MAX_CMPCTBLOCK_DEPTH) {
+                        CCompactBlock cmpctBlock(block);
+                        compactBlockStats.nSent++;
+                        compactBlockStats.nSentBytesSaved += ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION) -
+                                                             ::GetSerializeSize(cmpctBlock, SER_NETWORK, PROTOCOL_VERSION);
+                        pFrom->PushMessage("cmpctblock", cmpctBlock);
+                    } else if (inv.type == MSG_BLOCK || inv.type == MSG_CMPCT_BLOCK)
                         pFrom->PushMessage("block", block);
                     else  // MSG_FILTERED_BLOCK)
                     {
@@ -219,7 +232,7 @@ inline void ProcessGetData(CNode *pFrom) {
             // Track requests for our stuff.
             // g_signals.Inventory(inv.hash);
 
-            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK)
+            if (inv.type == MSG_BLOCK || inv.type == MSG_FILTERED_BLOCK || inv.type == MSG_CMPCT_BLOCK)
                 break;
         }
     }
@@ -260,6 +273,11 @@ inline bool AddBlockToQueue(NodeId nodeid, const uint256 &hash) {
         return false;
     }
 
+    // Already handled by header-first sync
+    if (blockSyncScheduler.IsScheduled(hash)) {
+        return false;
+    }
+
     CNodeState *state = State(nodeid);
     if (state == nullptr) {
         return false;
@@ -339,6 +357,9 @@ inline int ProcessVersionMessage(CNode *pFrom, string strCommand, CDataStream &v
     pFrom->PushMessage("verack");
     pFrom->ssSend.SetVersion(min(pFrom->nVersion, PROTOCOL_VERSION));
 
+    // Ask for new blocks as compact blocks, peers not knowing the message ignore it
+    pFrom->PushMessage("sendcmpct", false, COMPACT_BLOCKS_VERSION);
+
     if (!pFrom->fInbound) {
         // Advertise our address
         if (!fNoListen && !IsInitialBlockDownload()) {
@@ -517,31 +538,12 @@ inline bool ProcessTxMessage(CNode* pFrom, string strCommand , CDataStream& vRec
     CInv inv(MSG_TX, pBaseTx->GetHash());
     pFrom->AddInventoryKnown(inv);
 
-    LOCK(cs_main);
-    CValidationState state;
-    if (AcceptToMemoryPool(mempool, state, pBaseTx.get(), true)) {
-        RelayTransaction(pBaseTx.get(), inv.hash);
-        mapAlreadyAskedFor.erase(inv);
-
-        LogPrint("INFO", "AcceptToMemoryPool: %s %s : accepted %s (poolsz %u)\n",
-                 pFrom->addr.ToString(), pFrom->cleanSubVer,
-                 pBaseTx->GetHash().ToString(),
-                 mempool.memPoolTxs.size());
-    }
-
-    int32_t nDoS = 0;
-    if (state.IsInvalid(nDoS)) {
-        LogPrint("INFO", "%s from %s %s was not accepted into the memory pool: %s\n",
-                 pBaseTx->GetHash().ToString(),
-                 pFrom->addr.ToString(),
-                 pFrom->cleanSubVer,
-                 state.GetRejectReason());
-
-        pFrom->PushMessage("reject", strCommand, state.GetRejectCode(), state.GetRejectReason(), inv.hash);
-        // if (nDoS > 0) {
-        //     LogPrint("INFO", "Misebehaving, add to tx hash %s mempool error, Misbehavior add %d", pBaseTx->GetHash().GetHex(), nDoS);
-        //     Misbehaving(pFrom->GetId(), nDoS);
-        // }
+    if (!txValidationQueue.IsEnabled()) {
+        LOCK(cs_main);
+        AcceptTxFromPeer(pFrom, pBaseTx);
+    } else if (!txValidationQueue.Push(pFrom, pBaseTx)) {
+        LogPrint("INFO", "tx validation queue of peer %s is full, drop tx %s\n", pFrom->addr.ToString(),
+                 inv.hash.ToString());
     }
 
     return true ;
@@ -558,7 +560,7 @@ inline bool ProcessGetHeadersMessage(CNode *pFrom, CDataStream &vRecv){
     CBlockIndex *pIndex = nullptr;
     if (locator.IsNull()) {
         // If locator is null, return the hashStop block
-        map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.find(hashStop);
+        BlockMap::iterator mi = mapBlockIndex.find(hashStop);
         if (mi == mapBlockIndex.end())
             return true;
         pIndex = (*mi).second;
@@ -574,7 +576,17 @@ inline bool ProcessGetHeadersMessage(CNode *pFrom, CDataStream &vRecv){
     int32_t nLimit = 2000;
     LogPrint("NET", "getheaders %d to %s\n", (pIndex ? pIndex->height : -1), hashStop.ToString());
     for (; pIndex; pIndex = chainActive.Next(pIndex)) {
-        vHeaders.push_back(pIndex->GetBlockHeader());
+        // the index keeps no signature, read it from the block index db
+        CBlock header = pIndex->GetBlockHeader();
+        vector<unsigned char> vSignature;
+        if (!pCdMan->pBlockIndexDb->ReadBlockSignature(pIndex->GetBlockHash(), vSignature)) {
+            // an unsigned header would be rejected by the peer, send the ones before it only
+            LogPrint("ERROR", "getheaders: failed to read the signature of block %d, hash=%s\n", pIndex->height,
+                     pIndex->GetBlockHash().ToString());
+            break;
+        }
+        header.SetSignature(vSignature);
+        vHeaders.push_back(header);
         if (--nLimit <= 0 || pIndex->GetBlockHash() == hashStop)
             break;
     }
@@ -583,6 +595,18 @@ inline bool ProcessGetHeadersMessage(CNode *pFrom, CDataStream &vRecv){
     return false;
 }
 
+inline bool ProcessHeadersMessage(CNode *pFrom, CDataStream &vRecv) {
+    vector<CBlock> vHeaders;
+    vRecv >> vHeaders;
+    if (vHeaders.size() > (size_t)MAX_HEADERS_RESULTS) {
+        Misbehaving(pFrom->GetId(), 20);
+        return ERRORMSG("message headers size() = %u", vHeaders.size());
+    }
+
+    LOCK(cs_main);
+    return blockSyncScheduler.ProcessHeaders(pFrom, vHeaders);
+}
+
 inline void ProcessGetBlocksMessage(CNode *pFrom, CDataStream &vRecv){
 
     CBlockLocator locator;
@@ -640,6 +664,9 @@ inline bool ProcessInvMessage(CNode *pFrom, CDataStream &vRecv){
         LogPrint("net", "got inventory[%d]: %s %s %d from peer %s\n", nInv, inv.ToString(),
                  fAlreadyHave ? "have" : "new", nBlockHeight, pFrom->addr.ToString());
 
+        if (inv.type == MSG_BLOCK)
+            blockSyncScheduler.AnnounceBlock(pFrom->GetId(), inv.hash);
+
         if (!fAlreadyHave) {
             if (!SysCfg().IsImporting() && !SysCfg().IsReindex()) {
                 if (inv.type == MSG_BLOCK)
@@ -681,6 +708,21 @@ inline bool ProcessGetDataMessage(CNode *pFrom, CDataStream &vRecv){
     return true ;
 }
 
+// Requires cs_main.
+inline void AcceptReceivedBlock(CNode *pFrom, CBlock &block) {
+    uint256 hash = block.GetHash();
+    // Remember who we got this block from.
+    mapBlockSource[hash] = pFrom->GetId();
+    MarkBlockAsReceived(hash, pFrom->GetId());
+
+    // Blocks requested by header-first sync are connected in height order by the scheduler
+    if (blockSyncScheduler.ReceiveBlock(pFrom, block))
+        return;
+
+    CValidationState state;
+    ProcessBlock(state, pFrom, &block);
+}
+
 inline void ProcessBlockMessage(CNode *pFrom, CDataStream &vRecv){
     CBlock block;
     vRecv >> block;
@@ -692,12 +734,145 @@ inline void ProcessBlockMessage(CNode *pFrom, CDataStream &vRecv){
     pFrom->AddInventoryKnown(inv);
 
     LOCK(cs_main);
-    // Remember who we got this block from.
-    mapBlockSource[inv.hash] = pFrom->GetId();
-    MarkBlockAsReceived(inv.hash, pFrom->GetId());
+    AcceptReceivedBlock(pFrom, block);
+}
 
-    CValidationState state;
-    ProcessBlock(state, pFrom, &block);
+inline void ProcessSendCmpctMessage(CNode *pFrom, CDataStream &vRecv) {
+    bool fAnnounce         = false;
+    uint64_t nCmpctVersion = 0;
+    vRecv >> fAnnounce >> nCmpctVersion;
+
+    LOCK(cs_main);
+    if (nCmpctVersion == COMPACT_BLOCKS_VERSION)
+        State(pFrom->GetId())->fSupportsCompactBlocks = true;
+}
+
+// Requires cs_main.
+inline void RequestFullBlock(CNode *pFrom, const uint256 &hash) {
+    compactBlockStats.nFailed++;
+    LogPrint("net", "reconstruction of compact block %s failed, requesting full block from %s\n", hash.ToString(),
+             pFrom->addr.ToString());
+    pFrom->PushMessage("getdata", vector<CInv>(1, CInv(MSG_BLOCK, hash)));
+}
+
+// Requires cs_main.
+inline void AcceptCompactBlock(CNode *pFrom, CPartialBlock &partialBlock, CBlock &block) {
+    uint64_t nBlockSize = ::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION);
+    if (nBlockSize > partialBlock.GetReceivedBytes())
+        compactBlockStats.nBytesSaved += nBlockSize - partialBlock.GetReceivedBytes();
+
+    AcceptReceivedBlock(pFrom, block);
+}
+
+inline void ProcessCompactBlockMessage(CNode *pFrom, CDataStream &vRecv) {
+    uint32_t nMessageSize = vRecv.size();
+    CCompactBlock cmpctBlock;
+    vRecv >> cmpctBlock;
+
+    uint256 hash = cmpctBlock.header.GetHash();
+    LogPrint("net", "received cmpctblock %s (%u short ids, %u prefilled) from %s\n", hash.ToString(),
+             cmpctBlock.shortTxIds.ids.size(), cmpctBlock.vPrefilledTx.size(), pFrom->addr.ToString());
+
+    pFrom->AddInventoryKnown(CInv(MSG_BLOCK, hash));
+
+    LOCK(cs_main);
+    // Compact blocks are only sent in response to our getdata
+    auto itInFlight = mapBlocksInFlight.find(hash);
+    if (itInFlight == mapBlocksInFlight.end() || itInFlight->second.first != pFrom->GetId()) {
+        LogPrint("net", "ignore unrequested cmpctblock %s from %s\n", hash.ToString(), pFrom->addr.ToString());
+        return;
+    }
+
+    compactBlockStats.nReceived++;
+    std::shared_ptr<CPartialBlock> pPartialBlock = std::make_shared<CPartialBlock>();
+    if (!pPartialBlock->InitData(cmpctBlock, mempool, nMessageSize)) {
+        RequestFullBlock(pFrom, hash);
+        return;
+    }
+
+    if (pPartialBlock->GetMissingTxCount() == 0) {
+        CBlock block;
+        if (!pPartialBlock->FillBlock(block, vector<std::shared_ptr<CBaseTx> >())) {
+            RequestFullBlock(pFrom, hash);
+            return;
+        }
+
+        compactBlockStats.nReconstructed++;
+        AcceptCompactBlock(pFrom, *pPartialBlock, block);
+        return;
+    }
+
+    CBlockTxRequest request;
+    request.blockHash = hash;
+    pPartialBlock->GetMissingTxIndexes(request.indexes);
+    compactBlockStats.nTxRequested += request.indexes.size();
+
+    LogPrint("net", "cmpctblock %s misses %u of %u txs, requesting them from %s\n", hash.ToString(),
+             request.indexes.size(), cmpctBlock.GetTxCount(), pFrom->addr.ToString());
+
+    State(pFrom->GetId())->pPartialBlock = pPartialBlock;
+    pFrom->PushMessage("getblocktxn", request);
+}
+
+inline bool ProcessGetBlockTxnMessage(CNode *pFrom, CDataStream &vRecv) {
+    CBlockTxRequest request;
+    vRecv >> request;
+
+    LOCK(cs_main);
+    auto mi = mapBlockIndex.find(request.blockHash);
+    if (mi == mapBlockIndex.end())
+        return ERRORMSG("getblocktxn for unknown block %s from %s", request.blockHash.ToString(),
+                        pFrom->addr.ToString());
+
+    CBlock block;
+    if (!ReadBlockFromDisk(mi->second, block))
+        return ERRORMSG("getblocktxn : failed to read block %s", request.blockHash.ToString());
+
+    // Too old to be a block the peer is reconstructing, just send it
+    if (chainActive.Height() - mi->second->height > MAX_BLOCKTXN_DEPTH) {
+        pFrom->PushMessage("block", block);
+        return true;
+    }
+
+    CBlockTxResponse response;
+    response.blockHash = request.blockHash;
+    response.vptx.reserve(request.indexes.size());
+    for (uint32_t index : request.indexes) {
+        if (index >= block.vptx.size()) {
+            Misbehaving(pFrom->GetId(), 100);
+            return ERRORMSG("getblocktxn with out of range index %u from %s", index, pFrom->addr.ToString());
+        }
+        response.vptx.push_back(block.vptx[index]);
+    }
+
+    pFrom->PushMessage("blocktxn", response);
+    return true;
+}
+
+inline void ProcessBlockTxnMessage(CNode *pFrom, CDataStream &vRecv) {
+    uint32_t nMessageSize = vRecv.size();
+    CBlockTxResponse response;
+    vRecv >> response;
+
+    LOCK(cs_main);
+    CNodeState *state = State(pFrom->GetId());
+    if (!state->pPartialBlock || state->pPartialBlock->GetBlockHash() != response.blockHash) {
+        LogPrint("net", "ignore unrequested blocktxn %s from %s\n", response.blockHash.ToString(),
+                 pFrom->addr.ToString());
+        return;
+    }
+
+    std::shared_ptr<CPartialBlock> pPartialBlock = state->pPartialBlock;
+    state->pPartialBlock.reset();
+
+    CBlock block;
+    if (!pPartialBlock->FillBlock(block, response.vptx, nMessageSize)) {
+        RequestFullBlock(pFrom, response.blockHash);
+        return;
+    }
+
+    compactBlockStats.nReconstructedRoundTrip++;
+    AcceptCompactBlock(pFrom, *pPartialBlock, block);
 }
 
 inline void ProcessMempoolMessage(CNode *pFrom, CDataStream &vRecv){
@@ -0,0 +1,134 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "compactblock.h"
+
+#include "crypto/hash.h"
+#include "crypto/siphash.h"
+#include "main.h"
+
+#include <unordered_map>
+
+CCompactBlockStats compactBlockStats;
+
+CCompactBlock::CCompactBlock(const CBlock &block) : header(block.GetBlockHeader()), nonce(GetRand(UINT64_MAX)) {
+    uint64_t k0, k1;
+    GetShortTxIdKeys(k0, k1);
+
+    shortTxIds.ids.reserve(block.vptx.size());
+    for (uint32_t i = 0; i < block.vptx.size(); i++) {
+        const std::shared_ptr<CBaseTx> &pBaseTx = block.vptx[i];
+        // Txs created by the block producer are never relayed, so no peer can have them
+        if (pBaseTx->IsBlockRewardTx() || pBaseTx->IsPriceMedianTx())
+            vPrefilledTx.push_back(CPrefilledTx(i, pBaseTx));
+        else
+            shortTxIds.ids.push_back(GetShortTxId(k0, k1, pBaseTx->GetHash()));
+    }
+}
+
+void CCompactBlock::GetShortTxIdKeys(uint64_t &k0, uint64_t &k1) const {
+    CHashWriter ss(SER_GETHASH, 0);
+    ss << header << nonce;
+    uint256 hash = ss.GetHash();
+    k0           = hash.GetUint64(0);
+    k1           = hash.GetUint64(1);
+}
+
+uint64_t CCompactBlock::GetShortTxId(uint64_t k0, uint64_t k1, const uint256 &txid) {
+    return SipHashUint256(k0, k1, txid) & 0xffffffffffffULL;
+}
+
+bool CPartialBlock::InitData(const CCompactBlock &cmpctBlock, CTxMemPool &pool, uint32_t nMessageSize) {
+    size_t nTxCount = cmpctBlock.GetTxCount();
+    if (nTxCount == 0 || nTxCount > MAX_BLOCK_SIZE / 100)
+        return ERRORMSG("CPartialBlock::InitData() : invalid tx count %u", nTxCount);
+
+    header         = cmpctBlock.header;
+    nReceivedBytes = nMessageSize;
+    vptx.assign(nTxCount, nullptr);
+
+    vector<bool> vPrefilled(nTxCount, false);
+    for (const auto &prefilled : cmpctBlock.vPrefilledTx) {
+        if (prefilled.index >= nTxCount || vPrefilled[prefilled.index] || !prefilled.pTx)
+            return ERRORMSG("CPartialBlock::InitData() : invalid prefilled tx index %u", prefilled.index);
+
+        vPrefilled[prefilled.index] = true;
+        vptx[prefilled.index]       = prefilled.pTx;
+    }
+
+    // short id -> position in the block, the short ids fill the positions not prefilled in order
+    unordered_map<uint64_t, uint32_t> mapShortIdIndex;
+    mapShortIdIndex.reserve(cmpctBlock.shortTxIds.ids.size());
+    uint32_t index = 0;
+    for (uint64_t shortId : cmpctBlock.shortTxIds.ids) {
+        while (vPrefilled[index])
+            index++;
+
+        if (!mapShortIdIndex.emplace(shortId, index).second)
+            return ERRORMSG("CPartialBlock::InitData() : duplicate short id in block %s", header.GetHash().GetHex());
+        index++;
+    }
+
+    uint64_t k0, k1;
+    cmpctBlock.GetShortTxIdKeys(k0, k1);
+
+    // A short id matched by two mempool txs is ambiguous, the tx has to be requested
+    vector<bool> vCollided(nTxCount, false);
+    {
+        LOCK(pool.cs);
+        for (const auto &item : pool.memPoolTxs) {
+            auto it = mapShortIdIndex.find(CCompactBlock::GetShortTxId(k0, k1, item.first));
+            if (it == mapShortIdIndex.end() || vCollided[it->second])
+                continue;
+
+            if (vptx[it->second]) {
+                vptx[it->second]      = nullptr;
+                vCollided[it->second] = true;
+            } else {
+                vptx[it->second] = item.second.GetTransaction();
+            }
+        }
+    }
+
+    nMissingTx = 0;
+    for (const auto &pBaseTx : vptx) {
+        if (!pBaseTx)
+            nMissingTx++;
+    }
+
+    return true;
+}
+
+void CPartialBlock::GetMissingTxIndexes(vector<uint32_t> &indexes) const {
+    indexes.clear();
+    indexes.reserve(nMissingTx);
+    for (uint32_t i = 0; i < vptx.size(); i++) {
+        if (!vptx[i])
+            indexes.push_back(i);
+    }
+}
+
+bool CPartialBlock::FillBlock(CBlock &block, const vector<std::shared_ptr<CBaseTx> > &vMissingTx,
+                              uint32_t nMessageSize) {
+    if (vMissingTx.size() != nMissingTx)
+        return ERRORMSG("CPartialBlock::FillBlock() : got %u txs, %u missing", vMissingTx.size(), nMissingTx);
+
+    block = CBlock(header);
+    block.vptx.reserve(vptx.size());
+
+    size_t nNextMissing = 0;
+    for (const auto &pBaseTx : vptx) {
+        const std::shared_ptr<CBaseTx> &pTx = pBaseTx ? pBaseTx : vMissingTx[nNextMissing++];
+        if (!pTx)
+            return ERRORMSG("CPartialBlock::FillBlock() : null tx in block %s", header.GetHash().GetHex());
+
+        block.vptx.push_back(pTx);
+    }
+
+    if (block.BuildMerkleTree() != header.GetMerkleRootHash())
+        return ERRORMSG("CPartialBlock::FillBlock() : merkle root mismatch for block %s", header.GetHash().GetHex());
+
+    nReceivedBytes += nMessageSize;
+    return true;
+}
@@ -0,0 +1,176 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef P2P_COMPACTBLOCK_H
+#define P2P_COMPACTBLOCK_H
+
+#include "commons/serialize.h"
+#include "commons/uint256.h"
+#include "persistence/block.h"
+
+#include <atomic>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+class CBaseTx;
+class CTxMemPool;
+
+/** Size in bytes of a short transaction id on the wire. */
+static const uint32_t SHORT_TXID_SIZE = 6;
+
+/** Short transaction ids of a compact block, serialized as SHORT_TXID_SIZE bytes each. */
+class CShortTxIds {
+public:
+    vector<uint64_t> ids;
+
+    unsigned int GetSerializeSize(int nType, int nVersion) const {
+        return GetSizeOfCompactSize(ids.size()) + ids.size() * SHORT_TXID_SIZE;
+    }
+
+    template <typename Stream>
+    void Serialize(Stream &s, int nType, int nVersion) const {
+        WriteCompactSize(s, ids.size());
+        for (uint64_t id : ids) {
+            uint8_t buf[SHORT_TXID_SIZE];
+            for (uint32_t i = 0; i < SHORT_TXID_SIZE; i++)
+                buf[i] = (uint8_t)(id >> (8 * i));
+            s.write((const char *)buf, SHORT_TXID_SIZE);
+        }
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream &s, int nType, int nVersion) {
+        uint64_t nSize = ReadCompactSize(s);
+        ids.clear();
+        ids.reserve(std::min<uint64_t>(nSize, MAX_BLOCK_SIZE / 100));
+        for (uint64_t n = 0; n < nSize; n++) {
+            uint8_t buf[SHORT_TXID_SIZE];
+            s.read((char *)buf, SHORT_TXID_SIZE);
+            uint64_t id = 0;
+            for (uint32_t i = 0; i < SHORT_TXID_SIZE; i++)
+                id |= (uint64_t)buf[i] << (8 * i);
+            ids.push_back(id);
+        }
+    }
+};
+
+/** Transaction sent in full along with a compact block, e.g. the block reward tx no mempool can have. */
+class CPrefilledTx {
+public:
+    uint32_t index;  // position in the block
+    std::shared_ptr<CBaseTx> pTx;
+
+    CPrefilledTx() : index(0) {}
+    CPrefilledTx(uint32_t indexIn, const std::shared_ptr<CBaseTx> &pTxIn) : index(indexIn), pTx(pTxIn) {}
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(VARINT(index));
+        READWRITE(pTx);
+    )
+};
+
+/**
+ * "cmpctblock" message: a block header with a short id for every transaction the receiver is
+ * expected to have in its mempool. Short ids are SipHash-2-4 of the txid keyed by the header and
+ * a per-message nonce, truncated to 48 bits.
+ */
+class CCompactBlock {
+public:
+    CBlockHeader header;
+    uint64_t nonce;
+    CShortTxIds shortTxIds;
+    vector<CPrefilledTx> vPrefilledTx;
+
+    CCompactBlock() : nonce(0) {}
+    explicit CCompactBlock(const CBlock &block);
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(header);
+        READWRITE(nonce);
+        READWRITE(shortTxIds);
+        READWRITE(vPrefilledTx);
+    )
+
+    size_t GetTxCount() const { return shortTxIds.ids.size() + vPrefilledTx.size(); }
+
+    /** SipHash keys of the short ids of this compact block. */
+    void GetShortTxIdKeys(uint64_t &k0, uint64_t &k1) const;
+
+    static uint64_t GetShortTxId(uint64_t k0, uint64_t k1, const uint256 &txid);
+};
+
+/** "getblocktxn" message: positions of the transactions missing to reconstruct a compact block. */
+class CBlockTxRequest {
+public:
+    uint256 blockHash;
+    vector<uint32_t> indexes;
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(blockHash);
+        READWRITE(indexes);
+    )
+};
+
+/** "blocktxn" message: the transactions asked for by a "getblocktxn" message, in the same order. */
+class CBlockTxResponse {
+public:
+    uint256 blockHash;
+    vector<std::shared_ptr<CBaseTx> > vptx;
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(blockHash);
+        READWRITE(vptx);
+    )
+};
+
+/** A block being reconstructed from a compact block and the local mempool. */
+class CPartialBlock {
+private:
+    CBlockHeader header;
+    vector<std::shared_ptr<CBaseTx> > vptx;  // nullptr where the tx is missing
+    uint32_t nMissingTx;
+    uint32_t nReceivedBytes;  // size of the messages received for this block
+
+public:
+    CPartialBlock() : nMissingTx(0), nReceivedBytes(0) {}
+
+    /**
+     * Place the prefilled txs and look up the short ids in the mempool. Returns false if the compact
+     * block is malformed or has colliding short ids, the full block has to be requested then.
+     */
+    bool InitData(const CCompactBlock &cmpctBlock, CTxMemPool &pool, uint32_t nMessageSize);
+
+    uint256 GetBlockHash() const { return header.GetHash(); }
+    uint32_t GetMissingTxCount() const { return nMissingTx; }
+    uint32_t GetReceivedBytes() const { return nReceivedBytes; }
+    void GetMissingTxIndexes(vector<uint32_t> &indexes) const;
+
+    /**
+     * Build the block, taking the missing txs in order from vMissingTx. Returns false if they don't
+     * match or the merkle root doesn't, which means a short id resolved to the wrong tx.
+     */
+    bool FillBlock(CBlock &block, const vector<std::shared_ptr<CBaseTx> > &vMissingTx, uint32_t nMessageSize = 0);
+};
+
+/** Counters of compact block relay, reported by getnettotals. */
+struct CCompactBlockStats {
+    std::atomic<uint64_t> nSent;                    // compact blocks served
+    std::atomic<uint64_t> nSentBytesSaved;          // full block size minus compact block size, summed
+    std::atomic<uint64_t> nReceived;                // compact blocks received
+    std::atomic<uint64_t> nReconstructed;           // reconstructed from the mempool alone
+    std::atomic<uint64_t> nReconstructedRoundTrip;  // reconstructed after a getblocktxn round trip
+    std::atomic<uint64_t> nFailed;                  // fell back to downloading the full block
+    std::atomic<uint64_t> nTxRequested;             // txs asked for with getblocktxn
+    std::atomic<uint64_t> nBytesSaved;              // full block size minus received bytes, summed
+
+    CCompactBlockStats()
+        : nSent(0), nSentBytesSaved(0), nReceived(0), nReconstructed(0), nReconstructedRoundTrip(0), nFailed(0),
+          nTxRequested(0), nBytesSaved(0) {}
+};
+
+extern CCompactBlockStats compactBlockStats;
+
+#endif  // P2P_COMPACTBLOCK_H
@@ -0,0 +1,150 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "txvalidator.h"
+
+#include "main.h"
+
+CTxValidationQueue txValidationQueue;
+
+bool AcceptTxFromPeer(CNode *pFrom, const std::shared_ptr<CBaseTx> &pBaseTx) {
+    AssertLockHeld(cs_main);
+
+    CInv inv(MSG_TX, pBaseTx->GetHash());
+    CValidationState state;
+    bool fAccepted = AcceptToMemoryPool(mempool, state, pBaseTx.get(), true);
+    if (fAccepted) {
+        RelayTransaction(pBaseTx.get(), inv.hash);
+        mapAlreadyAskedFor.erase(inv);
+
+        LogPrint("INFO", "AcceptToMemoryPool: %s %s : accepted %s (poolsz %u)\n",
+                 pFrom->addr.ToString(), pFrom->cleanSubVer,
+                 pBaseTx->GetHash().ToString(),
+                 mempool.memPoolTxs.size());
+    }
+
+    int32_t nDoS = 0;
+    if (state.IsInvalid(nDoS)) {
+        LogPrint("INFO", "%s from %s %s was not accepted into the memory pool: %s\n",
+                 pBaseTx->GetHash().ToString(),
+                 pFrom->addr.ToString(),
+                 pFrom->cleanSubVer,
+                 state.GetRejectReason());
+
+        pFrom->PushMessage("reject", string("tx"), state.GetRejectCode(), state.GetRejectReason(), inv.hash);
+    }
+
+    return fAccepted;
+}
+
+static void VerifyTxSignatureRange(const vector<std::shared_ptr<CBaseTx> > &vTxs, const vector<CPubKey> &vPubKeys,
+                                   size_t nBegin, size_t nStep) {
+    for (size_t i = nBegin; i < vTxs.size(); i += nStep) {
+        CBaseTx *pBaseTx = vTxs[i].get();
+        if (vPubKeys[i].IsValid() && !pBaseTx->signature.empty())
+            VerifySignature(pBaseTx->ComputeSignatureHash(), pBaseTx->signature, vPubKeys[i]);
+    }
+}
+
+void PrecheckTxSignatures(const vector<std::shared_ptr<CBaseTx> > &vTxs, int32_t nThreads) {
+    // Resolve the signers' public keys, which is cheap, under one short cs_main acquisition ...
+    vector<CPubKey> vPubKeys(vTxs.size());
+    {
+        LOCK(cs_main);
+        for (size_t i = 0; i < vTxs.size(); i++) {
+            CBaseTx *pBaseTx = vTxs[i].get();
+            if (pBaseTx->txUid.type() == typeid(CPubKey)) {
+                vPubKeys[i] = pBaseTx->txUid.get<CPubKey>();
+            } else {
+                CAccount account;
+                if (mempool.cw->accountCache.GetAccount(pBaseTx->txUid, account))
+                    vPubKeys[i] = account.owner_pubkey;
+            }
+        }
+    }
+
+    // ... then verify the signatures without it.
+    if (nThreads <= 1 || vTxs.size() <= 1) {
+        VerifyTxSignatureRange(vTxs, vPubKeys, 0, 1);
+        return;
+    }
+
+    boost::thread_group threads;
+    for (int32_t i = 0; i < nThreads; i++)
+        threads.create_thread(
+            boost::bind(&VerifyTxSignatureRange, boost::cref(vTxs), boost::cref(vPubKeys), i, nThreads));
+    threads.join_all();
+}
+
+void CTxValidationQueue::Start(boost::thread_group &threadGroup, int32_t nThreads) {
+    for (int32_t i = 0; i < nThreads; i++) {
+        std::shared_ptr<CWorker> spWorker = std::make_shared<CWorker>();
+        vWorkers.push_back(spWorker);
+        threadGroup.create_thread(boost::bind(&TraceThread<boost::function<void()> >, "txvalid",
+            boost::function<void()>(boost::bind(&CTxValidationQueue::ThreadWorker, this, spWorker))));
+    }
+    LogPrint("INFO", "Using %d threads for peer transaction validation\n", nThreads);
+}
+
+bool CTxValidationQueue::Push(CNode *pFrom, const std::shared_ptr<CBaseTx> &pBaseTx) {
+    assert(IsEnabled());
+    CWorker &worker = *vWorkers[pFrom->GetId() % vWorkers.size()];
+    {
+        boost::unique_lock<boost::mutex> lock(worker.mtx);
+        uint32_t &nQueued = worker.mapQueuedPerPeer[pFrom->GetId()];
+        if (worker.queue.size() >= MAX_TX_VALIDATION_QUEUE_SIZE || nQueued >= MAX_TX_VALIDATION_QUEUE_SIZE_PER_PEER) {
+            if (nQueued == 0)
+                worker.mapQueuedPerPeer.erase(pFrom->GetId());
+            return false;
+        }
+
+        {
+            LOCK(cs_vNodes);
+            pFrom->AddRef();
+        }
+        nQueued++;
+        worker.queue.push_back(CTxItem{pFrom, pBaseTx});
+    }
+    worker.cond.notify_one();
+    return true;
+}
+
+void CTxValidationQueue::ThreadWorker(std::shared_ptr<CWorker> spWorker) {
+    CWorker &worker = *spWorker;
+    while (true) {
+        vector<CTxItem> vItems;
+        {
+            boost::unique_lock<boost::mutex> lock(worker.mtx);
+            while (worker.queue.empty())
+                worker.cond.wait(lock);
+
+            while (!worker.queue.empty() && vItems.size() < TX_VALIDATION_BATCH_SIZE) {
+                CTxItem &item = worker.queue.front();
+                auto it       = worker.mapQueuedPerPeer.find(item.pFrom->GetId());
+                if (--it->second == 0)
+                    worker.mapQueuedPerPeer.erase(it);
+
+                vItems.push_back(item);
+                worker.queue.pop_front();
+            }
+        }
+
+        vector<std::shared_ptr<CBaseTx> > vTxs;
+        for (auto &item : vItems)
+            vTxs.push_back(item.pBaseTx);
+        PrecheckTxSignatures(vTxs, 1);
+
+        {
+            LOCK(cs_main);
+            for (auto &item : vItems)
+                AcceptTxFromPeer(item.pFrom, item.pBaseTx);
+        }
+
+        {
+            LOCK(cs_vNodes);
+            for (auto &item : vItems)
+                item.pFrom->Release();
+        }
+    }
+}
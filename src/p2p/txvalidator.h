@@ -0,0 +1,67 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef P2P_TXVALIDATOR_H
+#define P2P_TXVALIDATOR_H
+
+#include "net.h"
+
+#include <deque>
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <boost/thread.hpp>
+
+class CBaseTx;
+
+/** Validate a transaction received from pFrom and relay it if accepted. Requires cs_main. */
+bool AcceptTxFromPeer(CNode *pFrom, const std::shared_ptr<CBaseTx> &pBaseTx);
+
+/**
+ * Verify the signatures of vTxs on nThreads threads without holding cs_main, only the signers' public
+ * keys are resolved under it. Valid signatures end up in the signature cache and are not verified
+ * again by AcceptToMemoryPool, invalid ones are left for it to reject.
+ */
+void PrecheckTxSignatures(const std::vector<std::shared_ptr<CBaseTx> > &vTxs, int32_t nThreads);
+
+/**
+ * Transactions received from peers are validated by a pool of worker threads instead of the
+ * message handler thread, which is left free to handle blocks and headers.
+ *
+ * Every peer is served by a single worker so that its transactions are validated in the order
+ * they were received. Workers check signatures without holding cs_main, filling the signature
+ * cache, then admit their batch to the mempool under one cs_main acquisition.
+ */
+class CTxValidationQueue {
+private:
+    struct CTxItem {
+        CNode *pFrom;  // referenced while queued
+        std::shared_ptr<CBaseTx> pBaseTx;
+    };
+
+    struct CWorker {
+        boost::mutex mtx;
+        boost::condition_variable cond;
+        std::deque<CTxItem> queue;
+        std::map<NodeId, uint32_t> mapQueuedPerPeer;
+    };
+
+    std::vector<std::shared_ptr<CWorker> > vWorkers;
+
+    void ThreadWorker(std::shared_ptr<CWorker> spWorker);
+
+public:
+    /** Start nThreads workers, transactions are validated inline when nThreads is 0. */
+    void Start(boost::thread_group &threadGroup, int32_t nThreads);
+
+    bool IsEnabled() const { return !vWorkers.empty(); }
+
+    /** Queue a transaction, returns false if the queue of its worker or its peer is full. */
+    bool Push(CNode *pFrom, const std::shared_ptr<CBaseTx> &pBaseTx);
+};
+
+extern CTxValidationQueue txValidationQueue;
+
+#endif  // P2P_TXVALIDATOR_H
@@ -15,12 +15,47 @@ using namespace std;
 
 extern CChain chainActive;
 
+CRegIdLookupStats regIdLookupStats;
+
+// the regid lookups only need the identity record
+static const set<TokenSymbol> NO_TOKEN_SYMBOLS;
+
 bool CAccountDBCache::GetFcoinGenesisAccount(CAccount &fcoinGensisAccount) const {
     return GetAccount(SysCfg().GetFcoinGenesisRegId(), fcoinGensisAccount);
 }
 
 bool CAccountDBCache::GetAccount(const CKeyID &keyId, CAccount &account) const {
-    return accountCache.GetData(keyId, account);
+    return ReadAccount(keyId, account, nullptr);
+}
+
+bool CAccountDBCache::GetAccount(const CUserID &uid, CAccount &account,
+                                 const set<TokenSymbol> &tokenSymbols) const {
+    CKeyID keyId;
+    if (!GetKeyId(uid, keyId))
+        return false;
+
+    return ReadAccount(keyId, account, &tokenSymbols);
+}
+
+bool CAccountDBCache::ReadAccount(const CKeyID &keyId, CAccount &account,
+                                  const set<TokenSymbol> *pTokenSymbols) const {
+    if (!accountCache.GetData(keyId, account))
+        return false;
+
+    // the balances are read right away, the account doesn't refer to this cache afterwards
+    AccountTokenMap tokens;
+    for (const auto &tokenSymbol : account.token_symbols) {
+        if (pTokenSymbols == nullptr || pTokenSymbols->count(tokenSymbol))
+            accountTokenCache.GetData(std::make_pair(keyId, tokenSymbol), tokens[tokenSymbol]);
+    }
+
+    account.SetTokens(tokens);
+    return true;
+}
+
+bool CAccountDBCache::GetAccountToken(const CKeyID &keyId, const TokenSymbol &tokenSymbol,
+                                      CAccountToken &accountToken) const {
+    return accountTokenCache.GetData(std::make_pair(keyId, tokenSymbol), accountToken);
 }
 
 bool CAccountDBCache::GetAccount(const CRegID &regId, CAccount &account) const {
@@ -28,13 +63,47 @@ bool CAccountDBCache::GetAccount(const CRegID &regId, CAccount &account) const {
         return false;
 
     CKeyID keyId;
-    if (regId2KeyIdCache.GetData(regId.ToRawString(), keyId)) {
-        return accountCache.GetData(keyId, account);
+    if (ResolveRegId(regId.ToRawString(), keyId)) {
+        return GetAccount(keyId, account);
     }
 
     return false;
 }
 
+bool CAccountDBCache::ResolveRegId(const string &rawRegId, CKeyID &keyId, uint32_t depth) const {
+    auto it = regIdIndex.find(rawRegId);
+    if (it != regIdIndex.end()) {
+        keyId = it->second;
+        regIdLookupStats.AddHit(depth);
+        return true;
+    }
+
+    const auto &mapData = regId2KeyIdCache.GetMapData();
+    auto itData         = mapData.find(rawRegId);
+    if (itData != mapData.end()) {
+        if (itData->second.IsEmpty()) {
+            regIdLookupStats.nMisses++;
+            return false;
+        }
+        keyId = itData->second;
+        regIdLookupStats.AddHit(depth);
+    } else if (pBaseCache != nullptr) {
+        if (!pBaseCache->ResolveRegId(rawRegId, keyId, depth + 1))
+            return false;
+    } else {
+        if (!regId2KeyIdCache.GetData(rawRegId, keyId)) {
+            regIdLookupStats.nMisses++;
+            return false;
+        }
+        regIdLookupStats.nDbReads++;
+    }
+
+    if (regIdIndex.size() >= MAX_REGID_INDEX_SIZE)
+        regIdIndex.clear();
+    regIdIndex.emplace(rawRegId, keyId);
+    return true;
+}
+
 bool CAccountDBCache::GetAccount(const CUserID &userId, CAccount &account) const {
     bool ret = false;
     if (userId.type() == typeid(CRegID)) {
@@ -57,23 +126,62 @@ bool CAccountDBCache::GetAccount(const CUserID &userId, CAccount &account) const
 }
 
 bool CAccountDBCache::SetAccount(const CKeyID &keyId, const CAccount &account) {
-    accountCache.SetData(keyId, account);
+    WriteAccount(keyId, account);
     return true;
 }
 
 bool CAccountDBCache::SetAccount(const CRegID &regId, const CAccount &account) {
     CKeyID keyId;
-    if (regId2KeyIdCache.GetData(regId.ToRawString(), keyId)) {
-        return accountCache.SetData(keyId, account);
+    if (ResolveRegId(regId.ToRawString(), keyId)) {
+        return WriteAccount(keyId, account);
     }
     return false;
 }
 
+bool CAccountDBCache::WriteAccount(const CKeyID &keyId, const CAccount &account) {
+    // a transfer only changes balances, the identity record is left alone then
+    CAccount oldAccount;
+    bool fFound = accountCache.GetData(keyId, oldAccount);
+    if (!fFound || !oldAccount.IsSameIdentity(account)) {
+        // the balances of tokens the saved account doesn't hold are dropped, as with a single record
+        for (const auto &tokenSymbol : oldAccount.token_symbols) {
+            if (!account.token_symbols.count(tokenSymbol))
+                accountTokenCache.EraseData(std::make_pair(keyId, tokenSymbol));
+        }
+
+        CAccount identity = account;
+        identity.SetTokens(AccountTokenMap());
+        if (!accountCache.SetData(keyId, identity))
+            return false;
+    }
+
+    // the loaded balances replace the stored ones, so the account saved last wins for them like it
+    // did when they were one record, only the records which differ are written
+    for (const auto &item : account.GetTokens()) {
+        auto key = std::make_pair(keyId, item.first);
+        CAccountToken oldToken;
+        accountTokenCache.GetData(key, oldToken);
+        if (oldToken == item.second)
+            continue;
+
+        if (!accountTokenCache.SetData(key, item.second))
+            return false;
+    }
+
+    return true;
+}
+
 bool CAccountDBCache::HaveAccount(const CKeyID &keyId) const {
     return accountCache.HaveData(keyId);
 }
 
 bool CAccountDBCache::EraseAccount(const CKeyID &keyId) {
+    CAccount account;
+    if (accountCache.GetData(keyId, account)) {
+        for (const auto &tokenSymbol : account.token_symbols)
+            accountTokenCache.EraseData(std::make_pair(keyId, tokenSymbol));
+    }
+
     return accountCache.EraseData(keyId);
 }
 
@@ -85,11 +193,12 @@ bool CAccountDBCache::SetKeyId(const CUserID &userId, const CKeyID &keyId) {
 }
 
 bool CAccountDBCache::SetKeyId(const CRegID &regId, const CKeyID &keyId) {
+    regIdIndex.erase(regId.ToRawString());
     return regId2KeyIdCache.SetData(regId.ToRawString(), keyId);
 }
 
 bool CAccountDBCache::GetKeyId(const CRegID &regId, CKeyID &keyId) const {
-    return regId2KeyIdCache.GetData(regId.ToRawString(), keyId);
+    return ResolveRegId(regId.ToRawString(), keyId);
 }
 
 bool CAccountDBCache::GetKeyId(const CUserID &userId, CKeyID &keyId) const {
@@ -109,12 +218,14 @@ bool CAccountDBCache::GetKeyId(const CUserID &userId, CKeyID &keyId) const {
 }
 
 bool CAccountDBCache::EraseKeyId(const CRegID &regId) {
+    regIdIndex.erase(regId.ToRawString());
     return regId2KeyIdCache.EraseData(regId.ToRawString());
 }
 
 bool CAccountDBCache::SaveAccount(const CAccount &account) {
+    regIdIndex.erase(account.regid.ToRawString());
     regId2KeyIdCache.SetData(account.regid.ToRawString(), account.keyid);
-    accountCache.SetData(account.keyid, account);
+    WriteAccount(account.keyid, account);
     nickId2KeyIdCache.SetData(account.nickid, account.keyid);
 
     return true;
@@ -139,7 +250,7 @@ bool CAccountDBCache::GetUserId(const string &addr, CUserID &userId) const {
 
 bool CAccountDBCache::GetRegId(const CKeyID &keyId, CRegID &regId) const {
     CAccount acct;
-    if (accountCache.GetData(keyId, acct)) {
+    if (ReadAccount(keyId, acct, &NO_TOKEN_SYMBOLS)) {
         regId = acct.regid;
         return true;
     }
@@ -153,14 +264,14 @@ bool CAccountDBCache::GetRegId(const CUserID &userId, CRegID &regId) const {
         return true;
     } else if (userId.type() == typeid(CKeyID)) {
         CAccount account;
-        if (GetAccount(userId.get<CKeyID>(), account)) {
+        if (ReadAccount(userId.get<CKeyID>(), account, &NO_TOKEN_SYMBOLS)) {
             regId = account.regid;
 
             return !regId.IsEmpty();
         }
     } else if (userId.type() == typeid(CPubKey)) {
         CAccount account;
-        if (GetAccount(userId.get<CPubKey>().GetKeyId(), account)) {
+        if (ReadAccount(userId.get<CPubKey>().GetKeyId(), account, &NO_TOKEN_SYMBOLS)) {
             regId = account.regid;
 
             return !regId.IsEmpty();
@@ -210,15 +321,20 @@ bool CAccountDBCache::EraseKeyId(const CUserID &userId) {
 }
 
 uint64_t CAccountDBCache::GetAccountFreeAmount(const CKeyID &keyId, const TokenSymbol &tokenSymbol) {
-    CAccount account;
-    GetAccount(keyId, account);
-
-    CAccountToken accountToken = account.GetToken(tokenSymbol);
+    CAccountToken accountToken;
+    GetAccountToken(keyId, tokenSymbol, accountToken);
     return accountToken.free_amount;
 }
 
 bool CAccountDBCache::Flush() {
+    // the regids changed here are resolved from the base's regId2KeyIdCache after the flush
+    if (pBaseCache != nullptr) {
+        for (const auto &item : regId2KeyIdCache.GetMapData())
+            pBaseCache->regIdIndex.erase(item.first);
+    }
+
     accountCache.Flush();
+    accountTokenCache.Flush();
     regId2KeyIdCache.Flush();
     nickId2KeyIdCache.Flush();
 
@@ -227,6 +343,7 @@ bool CAccountDBCache::Flush() {
 
 uint32_t CAccountDBCache::GetCacheSize() const {
     return accountCache.GetCacheSize() +
+        accountTokenCache.GetCacheSize() +
         regId2KeyIdCache.GetCacheSize() +
         nickId2KeyIdCache.GetCacheSize();
 }
@@ -6,8 +6,10 @@
 #ifndef PERSIST_ACCOUNTDB_H
 #define PERSIST_ACCOUNTDB_H
 
+#include <atomic>
 #include <map>
 #include <string>
+#include <unordered_map>
 #include <utility>
 #include <vector>
 #include "commons/arith_uint256.h"
@@ -19,21 +21,44 @@
 class uint256;
 class CKeyID;
 
+/** Cache layer that resolved a regid to its keyid, reported by getinfo. */
+struct CRegIdLookupStats {
+    // Hits at the layer asked, at its base and so on, the last one counts all deeper layers
+    static const int MAX_DEPTH = 4;
+
+    std::atomic<uint64_t> vHits[MAX_DEPTH];
+    std::atomic<uint64_t> nDbReads;  // resolved by reading the database
+    std::atomic<uint64_t> nMisses;   // regid not registered
+
+    CRegIdLookupStats() : nDbReads(0), nMisses(0) {
+        for (auto &hits : vHits)
+            hits = 0;
+    }
+
+    void AddHit(uint32_t depth) { vHits[std::min<uint32_t>(depth, MAX_DEPTH - 1)]++; }
+};
+
+extern CRegIdLookupStats regIdLookupStats;
+
 class CAccountDBCache {
 public:
-    CAccountDBCache() {}
+    CAccountDBCache() : pBaseCache(nullptr) {}
 
     CAccountDBCache(CDBAccess *pDbAccess):
         regId2KeyIdCache(pDbAccess),
         nickId2KeyIdCache(pDbAccess),
-        accountCache(pDbAccess) {
+        accountCache(pDbAccess),
+        accountTokenCache(pDbAccess),
+        pBaseCache(nullptr) {
         assert(pDbAccess->GetDbNameType() == DBNameType::ACCOUNT);
     }
 
     CAccountDBCache(CAccountDBCache *pBase):
         regId2KeyIdCache(pBase->regId2KeyIdCache),
         nickId2KeyIdCache(pBase->nickId2KeyIdCache),
-        accountCache(pBase->accountCache) {}
+        accountCache(pBase->accountCache),
+        accountTokenCache(pBase->accountTokenCache),
+        pBaseCache(pBase) {}
 
     ~CAccountDBCache() {}
 
@@ -43,6 +68,14 @@ public:
     bool GetAccount(const CKeyID &keyId,    CAccount &account) const;
     bool GetAccount(const CRegID &regId,    CAccount &account) const;
     bool GetAccount(const CUserID &uid,     CAccount &account) const;
+    /**
+     * Read the account with the balances of tokenSymbols only, e.g. the ones a transfer moves. The
+     * others are not loaded and saving the account leaves their records alone.
+     */
+    bool GetAccount(const CUserID &uid, CAccount &account, const set<TokenSymbol> &tokenSymbols) const;
+
+    /** Balance of one token of the account without reading the account */
+    bool GetAccountToken(const CKeyID &keyId, const TokenSymbol &tokenSymbol, CAccountToken &accountToken) const;
 
     bool SetAccount(const CKeyID &keyId,    const CAccount &account);
     bool SetAccount(const CRegID &regId,    const CAccount &account);
@@ -80,8 +113,11 @@ public:
 
     void SetBaseViewPtr(CAccountDBCache *pBaseIn) {
         accountCache.SetBase(&pBaseIn->accountCache);
+        accountTokenCache.SetBase(&pBaseIn->accountTokenCache);
         regId2KeyIdCache.SetBase(&pBaseIn->regId2KeyIdCache);
         nickId2KeyIdCache.SetBase(&pBaseIn->nickId2KeyIdCache);
+        pBaseCache = pBaseIn;
+        regIdIndex.clear();
     };
 
     uint64_t GetAccountFreeAmount(const CKeyID &keyId, const TokenSymbol &tokenSymbol);
@@ -90,24 +126,45 @@ public:
 
     void SetDbOpLogMap(CDBOpLogMap *pDbOpLogMapIn) {
         accountCache.SetDbOpLogMap(pDbOpLogMapIn);
+        accountTokenCache.SetDbOpLogMap(pDbOpLogMapIn);
         regId2KeyIdCache.SetDbOpLogMap(pDbOpLogMapIn);
         nickId2KeyIdCache.SetDbOpLogMap(pDbOpLogMapIn);
     }
 
     bool UndoData() {
+        // the restored regids are resolved from regId2KeyIdCache again
+        regIdIndex.clear();
         return accountCache.UndoData() &&
+               accountTokenCache.UndoData() &&
                regId2KeyIdCache.UndoData() &&
                nickId2KeyIdCache.UndoData();
     }
 private:
+    /** Read the identity record and the balances of pTokenSymbols, all balances if it is nullptr */
+    bool ReadAccount(const CKeyID &keyId, CAccount &account, const set<TokenSymbol> *pTokenSymbols) const;
+    /** Write the identity record if it changed and the loaded balances which changed */
+    bool WriteAccount(const CKeyID &keyId, const CAccount &account);
+
+    /**
+     * Resolve a regid through the hashed regIdIndex of each layer, down to the database. A layer
+     * whose regId2KeyIdCache has the regid, e.g. changed in the layer, answers from there.
+     */
+    bool ResolveRegId(const string &rawRegId, CKeyID &keyId, uint32_t depth = 0) const;
+
 /*  CCompositeKVCache     prefixType            key              value           variable           */
 /*  -------------------- --------------------   --------------  -------------   --------------------- */
     // <prefix$RegID -> KeyID>
     CCompositeKVCache< dbk::REGID_KEYID,          string,       CKeyID >         regId2KeyIdCache;
     // <prefix$NickID -> KeyID>
-    CCompositeKVCache< dbk::NICKID_KEYID,         CNickID,      CKeyID>          nickId2KeyIdCache;
+    CCompositeKVCache< dbk::NICKID_KEYID,         CNickID,      CKeyID, CacheLayout::HASHED> nickId2KeyIdCache;
     // <prefix$KeyID -> Account>
-    CCompositeKVCache< dbk::KEYID_ACCOUNT,        CKeyID,       CAccount>        accountCache;
+    CCompositeKVCache< dbk::KEYID_ACCOUNT,        CKeyID,       CAccount, CacheLayout::HASHED> accountCache;
+    // <prefix$KeyID$TokenSymbol -> AccountToken>
+    CCompositeKVCache< dbk::KEYID_ACCOUNT_TOKEN,  std::pair<CKeyID, TokenSymbol>, CAccountToken, CacheLayout::HASHED> accountTokenCache;
+
+    CAccountDBCache *pBaseCache;
+    // <RegID raw string -> KeyID> of regids resolved by this layer, dropped when they change here
+    mutable std::unordered_map<string, CKeyID> regIdIndex;
 
 };
 
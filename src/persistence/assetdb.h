@@ -85,7 +85,7 @@ private:
     // <asset_tokenSymbol -> asset>
     DBAssetCache   assetCache;
     // <asset_trading_pair -> 1>
-    CCompositeKVCache< dbk::ASSET_TRADING_PAIR, CAssetTradingPair,  uint8_t>        assetTradingPairCache;
+    CCompositeKVCache< dbk::ASSET_TRADING_PAIR, CAssetTradingPair,  uint8_t, CacheLayout::HASHED> assetTradingPairCache;
 };
 
 #endif  // PERSIST_ASSETDB_H
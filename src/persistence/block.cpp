@@ -24,17 +24,21 @@ uint256 CBlockHeader::ComputeSignatureHash() const {
 }
 
 uint256 CBlock::BuildMerkleTree() const {
+    // size the whole tree up front, so each level is hashed in one batch into its place
+    size_t nNodes = vptx.size();
+    for (size_t nSize = vptx.size(); nSize > 1; nSize = (nSize + 1) / 2)
+        nNodes += (nSize + 1) / 2;
+
     vMerkleTree.clear();
+    vMerkleTree.reserve(nNodes);
     for (const auto& ptx : vptx) {
         vMerkleTree.push_back(ptx->GetHash());
     }
-    int32_t j = 0;
-    for (int32_t nSize = vptx.size(); nSize > 1; nSize = (nSize + 1) / 2) {
-        for (int32_t i = 0; i < nSize; i += 2) {
-            int32_t i2 = min(i + 1, nSize - 1);
-            vMerkleTree.push_back(Hash(BEGIN(vMerkleTree[j + i]), END(vMerkleTree[j + i]),
-                                       BEGIN(vMerkleTree[j + i2]), END(vMerkleTree[j + i2])));
-        }
+    vMerkleTree.resize(nNodes);
+
+    size_t j = 0;
+    for (size_t nSize = vptx.size(); nSize > 1; nSize = (nSize + 1) / 2) {
+        MerkleHashLevel(&vMerkleTree[j + nSize], &vMerkleTree[j], nSize);
         j += nSize;
     }
     return (vMerkleTree.empty() ? uint256() : vMerkleTree.back());
@@ -39,7 +39,9 @@ enum BlockStatus {
 
     BLOCK_FAILED_VALID          = 32,  // stage after last reached validness failed     0010 0000
     BLOCK_FAILED_CHILD          = 64,  // descends from failed block                    0100 0000
-    BLOCK_FAILED_MASK           = 96   // BLOCK_FAILED_VALID | BLOCK_FAILED_CHILD       0110 0000
+    BLOCK_FAILED_MASK           = 96,  // BLOCK_FAILED_VALID | BLOCK_FAILED_CHILD       0110 0000
+
+    BLOCK_PRUNED                = 128  // undo data deleted by -prune                   1000 0000
 };
 
 
@@ -207,9 +209,6 @@ public:
     // Byte offset within rev?????.dat where this block's undo data is stored
     uint32_t nUndoPos;
 
-    // (memory only) Total amount of work (expected number of hashes) in the chain up to and including this block
-    arith_uint256 nChainWork;
-
     // Number of transactions in this block.
     // Note: in a potential headers-first mode, this number cannot be relied upon
     uint32_t nTx;
@@ -223,17 +222,14 @@ public:
     // (memory only) Sequencial id assigned to distinguish order in which blocks are received.
     uint32_t nSequenceId;
 
-    // block header
+    // block header, the signature is kept in the block index database only, see CBlockIndexDB::ReadBlockSignature
     int32_t nVersion;
     uint256 merkleRootHash;
-    uint256 hashPos;
     uint32_t nTime;
     uint32_t nBits;
     uint32_t nNonce;
     uint64_t nFuel;
     uint32_t nFuelRate;
-    vector<unsigned char> vSignature;
-
 
     CBlockIndex() {
         pBlockHash       = nullptr;
@@ -243,7 +239,6 @@ public:
         nFile            = 0;
         nDataPos         = 0;
         nUndoPos         = 0;
-        nChainWork       = 0;
         nTx              = 0;
         nChainTx         = 0;
         nStatus          = 0;
@@ -251,13 +246,11 @@ public:
 
         nVersion       = 0;
         merkleRootHash = uint256();
-        hashPos        = uint256();
         nTime          = 0;
         nBits          = 0;
         nNonce         = 0;
         nFuel          = 0;
         nFuelRate      = INIT_FUEL_RATES;
-        vSignature.clear();
     }
 
     CBlockIndex(const CBlock &block) {
@@ -268,7 +261,6 @@ public:
         nFile            = 0;
         nDataPos         = 0;
         nUndoPos         = 0;
-        nChainWork       = 0;
         nTx              = 0;
         nChainTx         = 0;
         nStatus          = 0;
@@ -285,7 +277,6 @@ public:
         nNonce         = block.GetNonce();
         nFuel          = block.GetFuel();
         nFuelRate      = block.GetFuelRate();
-        vSignature     = block.GetSignature();
     }
 
     CDiskBlockPos GetBlockPos() const {
@@ -307,6 +298,7 @@ public:
         return ret;
     }
 
+    /** The header without its signature, which has to be read from the block index database */
     CBlockHeader GetBlockHeader() const {
         CBlockHeader block;
         block.SetVersion(nVersion);
@@ -316,12 +308,13 @@ public:
         block.SetTime(nTime);
         block.SetNonce(nNonce);
         block.SetHeight(height);
-        block.SetSignature(vSignature);
 
         return block;
     }
 
     uint256 GetBlockHash() const { return *pBlockHash; }
+    // Total amount of work in the chain up to and including this block, one per block
+    arith_uint256 GetChainWork() const { return arith_uint256(height); }
     int64_t GetBlockTime() const { return (int64_t)nTime; }
     bool CheckIndex() const { return true; }
 
@@ -351,7 +344,7 @@ public:
 
     string ToString() const {
         return strprintf("CBlockIndex(pprev=%p, height=%d, merkle=%s, blockHash=%s, chainWork=%s)", pprev, height,
-                         merkleRootHash.ToString(), GetBlockHash().ToString(), nChainWork.ToString());
+                         merkleRootHash.ToString(), GetBlockHash().ToString(), GetChainWork().ToString());
     }
 
     void Print() const { LogPrint("INFO", "%s\n", ToString()); }
@@ -365,14 +358,45 @@ public:
 };
 
 
+/**
+ * Allocates block index entries from large contiguous chunks instead of one heap allocation each.
+ * The entries stay at their address until Clear(), which frees them all at once.
+ */
+class CBlockIndexArena {
+private:
+    static const size_t CHUNK_SIZE = 4096;
+
+    vector<std::unique_ptr<CBlockIndex[]> > vChunks;
+    size_t nUsed = CHUNK_SIZE;  // entries used in the last chunk
+
+public:
+    CBlockIndex *Allocate() {
+        if (nUsed == CHUNK_SIZE) {
+            vChunks.emplace_back(new CBlockIndex[CHUNK_SIZE]);
+            nUsed = 0;
+        }
+        return &vChunks.back()[nUsed++];
+    }
+
+    size_t Size() const { return vChunks.empty() ? 0 : (vChunks.size() - 1) * CHUNK_SIZE + nUsed; }
+
+    void Clear() {
+        vChunks.clear();
+        nUsed = CHUNK_SIZE;
+    }
+};
+
 /** Used to marshal pointers into hashes for db storage. */
 class CDiskBlockIndex : public CBlockIndex {
 public:
     uint256 hashPrev;
+    // header fields not kept in memory
+    uint256 hashPos;
+    vector<unsigned char> vSignature;
 
     CDiskBlockIndex() : hashPrev(uint256()) {}
 
-    explicit CDiskBlockIndex(CBlockIndex *pIndex) : CBlockIndex(*pIndex) {
+    explicit CDiskBlockIndex(const CBlockIndex *pIndex) : CBlockIndex(*pIndex) {
         hashPrev = (pprev ? pprev->GetBlockHash() : uint256());
     }
 
@@ -11,65 +11,174 @@
 
 #include <stdint.h>
 
+#include <algorithm>
+#include <memory>
+
+#include <boost/thread.hpp>
+
 using namespace std;
 
 
 /********************** CBlockIndexDB ********************************/
+void CBlockIndexDB::CacheSignature(const uint256 &blockHash, const vector<unsigned char> &vSignature) {
+    LOCK(csSignatures);
+    if (!mapSignatures.emplace(blockHash, vSignature).second)
+        return;
+
+    dequeSignatures.push_back(blockHash);
+    if (dequeSignatures.size() > MAX_CACHED_SIGNATURES) {
+        mapSignatures.erase(dequeSignatures.front());
+        dequeSignatures.pop_front();
+    }
+}
+
 bool CBlockIndexDB::WriteBlockIndex(const CDiskBlockIndex &blockIndex) {
-    return Write(dbk::GenDbKey(dbk::BLOCK_INDEX, blockIndex.GetBlockHash()), blockIndex);
+    uint256 blockHash = blockIndex.GetBlockHash();
+    if (!Write(dbk::GenDbKey(dbk::BLOCK_INDEX, blockHash), blockIndex))
+        return false;
+
+    if (!blockIndex.vSignature.empty())
+        CacheSignature(blockHash, blockIndex.vSignature);
+    return true;
+}
+bool CBlockIndexDB::UpdateBlockIndex(const CBlockIndex *pIndex) {
+    CDiskBlockIndex diskIndex(pIndex);
+    CDiskBlockIndex storedIndex;
+    if (!Read(dbk::GenDbKey(dbk::BLOCK_INDEX, pIndex->GetBlockHash()), storedIndex))
+        return ERRORMSG("UpdateBlockIndex() : block index %s not found", pIndex->GetBlockHash().ToString());
+
+    diskIndex.hashPos    = storedIndex.hashPos;
+    diskIndex.vSignature = storedIndex.vSignature;
+    return WriteBlockIndex(diskIndex);
+}
+bool CBlockIndexDB::ReadBlockSignature(const uint256 &blockHash, vector<unsigned char> &vSignature) {
+    {
+        LOCK(csSignatures);
+        auto it = mapSignatures.find(blockHash);
+        if (it != mapSignatures.end()) {
+            vSignature = it->second;
+            return true;
+        }
+    }
+
+    CDiskBlockIndex diskIndex;
+    if (!Read(dbk::GenDbKey(dbk::BLOCK_INDEX, blockHash), diskIndex))
+        return false;
+
+    vSignature = std::move(diskIndex.vSignature);
+    CacheSignature(blockHash, vSignature);
+    return true;
 }
 bool CBlockIndexDB::EraseBlockIndex(const uint256 &blockHash) {
+    {
+        LOCK(csSignatures);
+        if (mapSignatures.erase(blockHash))
+            dequeSignatures.erase(std::find(dequeSignatures.begin(), dequeSignatures.end(), blockHash));
+    }
     return Erase(dbk::GenDbKey(dbk::BLOCK_INDEX, blockHash));
 }
 
-bool CBlockIndexDB::LoadBlockIndexes() {
-    leveldb::Iterator *pCursor = NewIterator();
+bool CBlockIndexDB::ReadBlockIndexRange(const string &strBegin, const string &strEnd,
+                                        vector<pair<uint256, CDiskBlockIndex> > *pIndexes) {
     const std::string &prefix = dbk::GetKeyPrefix(dbk::BLOCK_INDEX);
+    std::unique_ptr<leveldb::Iterator> pCursor(NewIterator());
+    for (pCursor->Seek(strBegin); pCursor->Valid(); pCursor->Next()) {
+        leveldb::Slice slKey = pCursor->key();
+        if (!slKey.starts_with(prefix) || (!strEnd.empty() && slKey.compare(strEnd) >= 0))
+            break;
 
-    pCursor->Seek(prefix);
-
-    // Load mapBlockIndex
-    while (pCursor->Valid()) {
-        boost::this_thread::interruption_point();
         try {
-            leveldb::Slice slKey = pCursor->key();
-            if (slKey.starts_with(prefix)) {
-                leveldb::Slice slValue = pCursor->value();
-                CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
-                CDiskBlockIndex diskIndex;
-                ssValue >> diskIndex;
-
-                // Construct block index object
-                CBlockIndex *pIndexNew    = InsertBlockIndex(diskIndex.GetBlockHash());
-                pIndexNew->pprev          = InsertBlockIndex(diskIndex.hashPrev);
-                pIndexNew->height         = diskIndex.height;
-                pIndexNew->nFile          = diskIndex.nFile;
-                pIndexNew->nDataPos       = diskIndex.nDataPos;
-                pIndexNew->nUndoPos       = diskIndex.nUndoPos;
-                pIndexNew->nVersion       = diskIndex.nVersion;
-                pIndexNew->merkleRootHash = diskIndex.merkleRootHash;
-                pIndexNew->hashPos        = diskIndex.hashPos;
-                pIndexNew->nTime          = diskIndex.nTime;
-                pIndexNew->nBits          = diskIndex.nBits;
-                pIndexNew->nNonce         = diskIndex.nNonce;
-                pIndexNew->nStatus        = diskIndex.nStatus;
-                pIndexNew->nTx            = diskIndex.nTx;
-                pIndexNew->nFuel          = diskIndex.nFuel;
-                pIndexNew->nFuelRate      = diskIndex.nFuelRate;
-                pIndexNew->vSignature     = diskIndex.vSignature;
-
-                if (!pIndexNew->CheckIndex())
-                    return ERRORMSG("LoadBlockIndex() : CheckIndex failed: %s", pIndexNew->ToString());
-
-                pCursor->Next();
-            } else {
-                break;  // if shutdown requested or finished loading block index
-            }
+            leveldb::Slice slValue = pCursor->value();
+            CSpanReader ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            CDiskBlockIndex diskIndex;
+            ssValue >> diskIndex;
+            uint256 blockHash = diskIndex.GetBlockHash();
+            // the signature stays on disk, see ReadBlockSignature()
+            vector<unsigned char>().swap(diskIndex.vSignature);
+            pIndexes->push_back(make_pair(blockHash, std::move(diskIndex)));
         } catch (std::exception &e) {
             return ERRORMSG("%s : Deserialize or I/O error - %s", __func__, e.what());
         }
     }
-    delete pCursor;
+
+    if (!pCursor->status().ok())
+        return ERRORMSG("%s : I/O error - %s", __func__, pCursor->status().ToString());
+
+    return true;
+}
+
+static void ReadBlockIndexRangeWorker(CBlockIndexDB *pDb, const string &strBegin, const string &strEnd,
+                                      vector<pair<uint256, CDiskBlockIndex> > *pIndexes, bool *pRet) {
+    *pRet = pDb->ReadBlockIndexRange(strBegin, strEnd, pIndexes);
+}
+
+bool CBlockIndexDB::LoadBlockIndexes() {
+    // Keys are the prefix followed by the block hash, so the records split evenly over ranges of the
+    // first hash byte. The ranges are deserialized and hashed in parallel, then linked in one pass.
+    const std::string &prefix = dbk::GetKeyPrefix(dbk::BLOCK_INDEX);
+    int32_t nThreads = min<int32_t>(MAX_BLOCK_INDEX_LOAD_THREADS, boost::thread::hardware_concurrency());
+    nThreads         = max<int32_t>(1, nThreads);
+
+    vector<vector<pair<uint256, CDiskBlockIndex> > > vRanges(nThreads);
+    std::unique_ptr<bool[]> pRets(new bool[nThreads]);
+    vector<string> vBounds;
+    for (int32_t i = 0; i <= nThreads; i++) {
+        if (i == 0)
+            vBounds.push_back(prefix);
+        else if (i == nThreads)
+            vBounds.push_back("");  // up to the end of the prefix
+        else
+            vBounds.push_back(prefix + (char)(i * 256 / nThreads));
+    }
+
+    {
+        boost::thread_group threads;
+        for (int32_t i = 0; i < nThreads; i++)
+            threads.create_thread(boost::bind(&ReadBlockIndexRangeWorker, this, vBounds[i], vBounds[i + 1],
+                                              &vRanges[i], &pRets[i]));
+        threads.join_all();
+    }
+
+    boost::this_thread::interruption_point();
+    for (int32_t i = 0; i < nThreads; i++) {
+        if (!pRets[i])
+            return false;
+    }
+
+    // Load mapBlockIndex
+    size_t nIndexes = 0;
+    for (const auto &range : vRanges)
+        nIndexes += range.size();
+    {
+        LOCK(cs_mapBlockIndex);
+        mapBlockIndex.reserve(mapBlockIndex.size() + nIndexes);
+    }
+
+    for (const auto &range : vRanges) {
+        for (const auto &item : range) {
+            const CDiskBlockIndex &diskIndex = item.second;
+
+            // Construct block index object
+            CBlockIndex *pIndexNew    = InsertBlockIndex(item.first);
+            pIndexNew->pprev          = InsertBlockIndex(diskIndex.hashPrev);
+            pIndexNew->height         = diskIndex.height;
+            pIndexNew->nFile          = diskIndex.nFile;
+            pIndexNew->nDataPos       = diskIndex.nDataPos;
+            pIndexNew->nUndoPos       = diskIndex.nUndoPos;
+            pIndexNew->nVersion       = diskIndex.nVersion;
+            pIndexNew->merkleRootHash = diskIndex.merkleRootHash;
+            pIndexNew->nTime          = diskIndex.nTime;
+            pIndexNew->nBits          = diskIndex.nBits;
+            pIndexNew->nNonce         = diskIndex.nNonce;
+            pIndexNew->nStatus        = diskIndex.nStatus;
+            pIndexNew->nTx            = diskIndex.nTx;
+            pIndexNew->nFuel          = diskIndex.nFuel;
+            pIndexNew->nFuelRate      = diskIndex.nFuelRate;
+
+            if (!pIndexNew->CheckIndex())
+                return ERRORMSG("LoadBlockIndex() : CheckIndex failed: %s", pIndexNew->ToString());
+        }
+    }
 
     return true;
 }
@@ -86,15 +195,14 @@ CBlockIndex *InsertBlockIndex(uint256 hash) {
         return nullptr;
 
     // Return existing
-    map<uint256, CBlockIndex *>::iterator mi = mapBlockIndex.find(hash);
+    BlockMap::iterator mi = mapBlockIndex.find(hash);
     if (mi != mapBlockIndex.end())
         return (*mi).second;
 
     // Create new
-    CBlockIndex *pIndexNew = new CBlockIndex();
-    if (!pIndexNew)
-        throw runtime_error("LoadBlockIndex() : new CBlockIndex failed");
-    mi                    = mapBlockIndex.insert(make_pair(hash, pIndexNew)).first;
+    LOCK(cs_mapBlockIndex);
+    CBlockIndex *pIndexNew = blockIndexArena.Allocate();
+    mi                     = mapBlockIndex.insert(make_pair(hash, pIndexNew)).first;
     pIndexNew->pBlockHash = &((*mi).first);
 
     return pIndexNew;
@@ -105,6 +213,8 @@ CBlockIndex *InsertBlockIndex(uint256 hash) {
 uint32_t CBlockDBCache::GetCacheSize() const {
     return
         txDiskPosCache.GetCacheSize() +
+        matureRewardTxCache.GetCacheSize() +
+        addressTxCache.GetCacheSize() +
         flagCache.GetCacheSize() +
         bestBlockHashCache.GetCacheSize() +
         lastBlockFileCache.GetCacheSize() +
@@ -113,6 +223,8 @@ uint32_t CBlockDBCache::GetCacheSize() const {
 
 bool CBlockDBCache::Flush() {
     txDiskPosCache.Flush();
+    matureRewardTxCache.Flush();
+    addressTxCache.Flush();
     flagCache.Flush();
     bestBlockHashCache.Flush();
     lastBlockFileCache.Flush();
@@ -157,6 +269,45 @@ bool CBlockDBCache::WriteTxIndexes(const vector<pair<uint256, CDiskTxPos> > &lis
     return true;
 }
 
+bool CBlockDBCache::GetMatureRewardTxs(int32_t height, vector<std::shared_ptr<CBaseTx> > &rewardTxs) {
+    return matureRewardTxCache.GetData(height, rewardTxs);
+}
+
+bool CBlockDBCache::AddMatureRewardTx(int32_t height, const std::shared_ptr<CBaseTx> &pRewardTx) {
+    vector<std::shared_ptr<CBaseTx> > rewardTxs;
+    matureRewardTxCache.GetData(height, rewardTxs);
+    rewardTxs.push_back(pRewardTx);
+    return matureRewardTxCache.SetData(height, rewardTxs);
+}
+
+bool CBlockDBCache::EraseMatureRewardTxs(int32_t height) {
+    return matureRewardTxCache.EraseData(height);
+}
+
+bool CBlockDBCache::SetTxHashByAddress(const CKeyID &keyId, uint32_t height, uint32_t index, const uint256 &txid) {
+    return addressTxCache.SetData(CAddressTxKey(keyId, height, index), txid);
+}
+
+bool CBlockDBCache::GetTxHashByAddress(const CAddressTxKey &fromKey, uint32_t maxCount,
+                                       vector<pair<CAddressTxKey, uint256> > &txs) {
+    shared_ptr<leveldb::Iterator> pCursor = addressTxCache.GetDbAccessPtr()->NewIterator();
+    pCursor->Seek(dbk::GenDbKey(dbk::KEYID_TXID, fromKey));
+
+    CAddressTxKey key;
+    uint256 txid;
+    for (; pCursor->Valid() && txs.size() < maxCount; pCursor->Next()) {
+        if (!dbk::ParseDbKey(pCursor->key(), dbk::KEYID_TXID, key) || key.keyId != fromKey.keyId)
+            break;
+
+        const leveldb::Slice &slValue = pCursor->value();
+        CSpanReader ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+        ssValue >> txid;
+        txs.emplace_back(key, txid);
+    }
+
+    return true;
+}
+
 bool CBlockDBCache::WriteReindexing(bool fReindexing) {
     if (fReindexing)
         return reindexCache.SetData(true);
@@ -6,22 +6,34 @@
 #ifndef PERSIST_BLOCKDB_H
 #define PERSIST_BLOCKDB_H
 
+#include <deque>
 #include <string>
+#include <tuple>
 #include <utility>
 #include <vector>
 #include "commons/arith_uint256.h"
 #include "leveldbwrapper.h"
 #include "dbaccess.h"
 #include "persistence/block.h"
+#include "sync.h"
 
 #include <map>
 
 /** Access to the block database (blocks/index/) */
 class CBlockIndexDB : public CLevelDBWrapper {
 private:
+    // headers of the tip range are served to syncing peers, keep the signatures of the latest blocks
+    static const size_t MAX_CACHED_SIGNATURES = 2000;
+
+    CCriticalSection csSignatures;
+    std::map<uint256, std::vector<unsigned char> > mapSignatures;
+    std::deque<uint256> dequeSignatures;  // hashes of mapSignatures, oldest first
+
     CBlockIndexDB(const CBlockIndexDB &);
     void operator=(const CBlockIndexDB &);
 
+    void CacheSignature(const uint256 &blockHash, const std::vector<unsigned char> &vSignature);
+
 public:
     CBlockIndexDB(bool fMemory = false, bool fWipe = false) :
         CLevelDBWrapper(GetDataDir() / "blocks" / "index", 2 << 20 /* 2MB */, fMemory, fWipe) {}
@@ -30,14 +42,75 @@ public:
 
 public:
     bool WriteBlockIndex(const CDiskBlockIndex &blockindex);
+    /** Rewrite the in-memory fields of an indexed block, keeping its header fields only stored on disk */
+    bool UpdateBlockIndex(const CBlockIndex *pIndex);
+    /** Read the signature of a block, the ones of the latest written or read blocks come from memory */
+    bool ReadBlockSignature(const uint256 &blockHash, std::vector<unsigned char> &vSignature);
     bool EraseBlockIndex(const uint256 &blockHash);
     bool LoadBlockIndexes();
+    /** Deserialize the block index records of the keys in [strBegin, strEnd), strEnd empty for all the rest */
+    bool ReadBlockIndexRange(const std::string &strBegin, const std::string &strEnd,
+                             std::vector<std::pair<uint256, CDiskBlockIndex> > *pIndexes);
 
     bool ReadBlockFileInfo(int32_t nFile, CBlockFileInfo &fileinfo);
     bool WriteBlockFileInfo(int32_t nFile, const CBlockFileInfo &fileinfo);
 };
 
 
+/**
+ * Key of the address index: a tx involving keyId at a position of the chain. Height and index are
+ * serialized big-endian so that the txs of an address are ordered by their position in the database.
+ */
+class CAddressTxKey {
+public:
+    CKeyID keyId;
+    uint32_t height;
+    uint32_t index;
+
+    CAddressTxKey() : height(0), index(0) {}
+    CAddressTxKey(const CKeyID &keyIdIn, uint32_t heightIn, uint32_t indexIn)
+        : keyId(keyIdIn), height(heightIn), index(indexIn) {}
+
+    bool IsEmpty() const { return keyId.IsEmpty(); }
+    void SetEmpty() { keyId.SetNull(); height = 0; index = 0; }
+
+    bool operator<(const CAddressTxKey &other) const {
+        return std::tie(keyId, height, index) < std::tie(other.keyId, other.height, other.index);
+    }
+
+    unsigned int GetSerializeSize(int nType, int nVersion) const {
+        return keyId.GetSerializeSize(nType, nVersion) + 2 * sizeof(uint32_t);
+    }
+
+    template <typename Stream>
+    void Serialize(Stream &s, int nType, int nVersion) const {
+        keyId.Serialize(s, nType, nVersion);
+        WriteBigEndian(s, height);
+        WriteBigEndian(s, index);
+    }
+
+    template <typename Stream>
+    void Unserialize(Stream &s, int nType, int nVersion) {
+        keyId.Unserialize(s, nType, nVersion);
+        height = ReadBigEndian(s);
+        index  = ReadBigEndian(s);
+    }
+
+private:
+    template <typename Stream>
+    static void WriteBigEndian(Stream &s, uint32_t n) {
+        uint8_t buf[4] = {(uint8_t)(n >> 24), (uint8_t)(n >> 16), (uint8_t)(n >> 8), (uint8_t)n};
+        s.write((const char *)buf, sizeof(buf));
+    }
+
+    template <typename Stream>
+    static uint32_t ReadBigEndian(Stream &s) {
+        uint8_t buf[4];
+        s.read((char *)buf, sizeof(buf));
+        return ((uint32_t)buf[0] << 24) | ((uint32_t)buf[1] << 16) | ((uint32_t)buf[2] << 8) | buf[3];
+    }
+};
+
 /** Access to the block database (blocks/index/) */
 class CBlockDBCache {
 public:
@@ -45,6 +118,8 @@ public:
 
     CBlockDBCache(CDBAccess *pDbAccess):
         txDiskPosCache(pDbAccess),
+        matureRewardTxCache(pDbAccess),
+        addressTxCache(pDbAccess),
         flagCache(pDbAccess),
         bestBlockHashCache(pDbAccess),
         lastBlockFileCache(pDbAccess),
@@ -54,6 +129,8 @@ public:
 
     CBlockDBCache(CBlockDBCache *pBaseIn):
         txDiskPosCache(pBaseIn->txDiskPosCache),
+        matureRewardTxCache(pBaseIn->matureRewardTxCache),
+        addressTxCache(pBaseIn->addressTxCache),
         flagCache(pBaseIn->flagCache),
         bestBlockHashCache(pBaseIn->bestBlockHashCache),
         lastBlockFileCache(pBaseIn->lastBlockFileCache),
@@ -63,11 +140,18 @@ public:
     bool Flush();
     uint32_t GetCacheSize() const;
 
-    bool GetTxHashByAddress(const CKeyID &keyId, uint32_t height, map<string, string > &mapTxHash);
     bool SetTxHashByAddress(const CKeyID &keyId, uint32_t height, uint32_t index, const uint256 &txid);
+    /**
+     * Up to maxCount txs of fromKey.keyId from the position of fromKey on, in chain order. Reads the
+     * database only, so it must be used on a top level cache, e.g. over a chain snapshot.
+     */
+    bool GetTxHashByAddress(const CAddressTxKey &fromKey, uint32_t maxCount,
+                            vector<pair<CAddressTxKey, uint256> > &txs);
 
     void SetBaseViewPtr(CBlockDBCache *pBaseIn) {
         txDiskPosCache.SetBase(&pBaseIn->txDiskPosCache);
+        matureRewardTxCache.SetBase(&pBaseIn->matureRewardTxCache);
+        addressTxCache.SetBase(&pBaseIn->addressTxCache);
         flagCache.SetBase(&pBaseIn->flagCache);
         bestBlockHashCache.SetBase(&pBaseIn->bestBlockHashCache);
         lastBlockFileCache.SetBase(&pBaseIn->lastBlockFileCache);
@@ -77,6 +161,8 @@ public:
 
     void SetDbOpLogMap(CDBOpLogMap *pDbOpLogMapIn) {
         txDiskPosCache.SetDbOpLogMap(pDbOpLogMapIn);
+        matureRewardTxCache.SetDbOpLogMap(pDbOpLogMapIn);
+        addressTxCache.SetDbOpLogMap(pDbOpLogMapIn);
         flagCache.SetDbOpLogMap(pDbOpLogMapIn);
         bestBlockHashCache.SetDbOpLogMap(pDbOpLogMapIn);
         lastBlockFileCache.SetDbOpLogMap(pDbOpLogMapIn);
@@ -85,6 +171,8 @@ public:
 
     bool UndoData() {
         return txDiskPosCache.UndoData() &&
+               matureRewardTxCache.UndoData() &&
+               addressTxCache.UndoData() &&
                flagCache.UndoData() &&
                bestBlockHashCache.UndoData() &&
                lastBlockFileCache.UndoData() &&
@@ -95,6 +183,11 @@ public:
     bool SetTxIndex(const uint256 &txid, const CDiskTxPos &pos);
     bool WriteTxIndexes(const vector<pair<uint256, CDiskTxPos> > &list);
 
+    /** Reward txs are queued by the height they mature at, so that they needn't be read from the block again. */
+    bool GetMatureRewardTxs(int32_t height, vector<std::shared_ptr<CBaseTx> > &rewardTxs);
+    bool AddMatureRewardTx(int32_t height, const std::shared_ptr<CBaseTx> &pRewardTx);
+    bool EraseMatureRewardTxs(int32_t height);
+
     bool ReadLastBlockFile(int32_t &nFile);
     bool WriteLastBlockFile(int nFile);
 
@@ -111,9 +204,13 @@ private:
 /*  CCompositeKVCache      prefixType               key                     value                 variable               */
 /*  ----------------   -------------------------   -----------------------  ------------------   ------------------------ */
     // txId -> DiskTxPos
-    CCompositeKVCache< dbk::TXID_DISKINDEX,         uint256,                  CDiskTxPos >          txDiskPosCache;
+    CCompositeKVCache< dbk::TXID_DISKINDEX,         uint256,                  CDiskTxPos, CacheLayout::HASHED> txDiskPosCache;
+    // height -> reward txs maturing at height
+    CCompositeKVCache< dbk::MATURE_REWARD_TX,       uint32_t,                 vector<std::shared_ptr<CBaseTx> >, CacheLayout::HASHED> matureRewardTxCache;
+    // {keyId, height, index} -> txid, -addressindex
+    CCompositeKVCache< dbk::KEYID_TXID,             CAddressTxKey,            uint256, CacheLayout::HASHED> addressTxCache;
     // flag$name -> bool
-    CCompositeKVCache< dbk::FLAG,                   string,                   bool>                 flagCache;
+    CCompositeKVCache< dbk::FLAG,                   string,                   bool, CacheLayout::HASHED> flagCache;
 
 
 /*  CSimpleKVCache          prefixType             value           variable           */
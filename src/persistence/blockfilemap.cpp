@@ -0,0 +1,84 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilemap.h"
+
+#include "commons/util.h"
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+CMappedFile::~CMappedFile() {
+#ifndef WIN32
+    munmap(const_cast<char *>(pData), nSize);
+#endif
+}
+
+std::shared_ptr<const CMappedFile> CMappedFile::Open(const boost::filesystem::path &path) {
+#ifndef WIN32
+    int fd = open(path.string().c_str(), O_RDONLY);
+    if (fd == -1) {
+        LogPrint("INFO", "Unable to open file %s\n", path.string());
+        return nullptr;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return nullptr;
+    }
+
+    void *pData = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    // the mapping stays valid after the descriptor is closed
+    close(fd);
+    if (pData == MAP_FAILED) {
+        LogPrint("INFO", "Unable to map file %s: %s\n", path.string(), strerror(errno));
+        return nullptr;
+    }
+
+    return std::make_shared<const CMappedFile>((const char *)pData, (size_t)st.st_size);
+#else
+    // no mapping, readers fall back to stdio
+    return nullptr;
+#endif
+}
+
+std::shared_ptr<const CMappedFile> CBlockFileMap::Get(int32_t nFile) {
+    LOCK(cs_blockFileMap);
+
+    auto it = mapFiles.find(nFile);
+    if (it != mapFiles.end()) {
+        lruFiles.splice(lruFiles.begin(), lruFiles, it->second.second);
+        return it->second.first;
+    }
+
+    boost::filesystem::path path = GetDataDir() / "blocks" / strprintf("blk%05u.dat", nFile);
+    std::shared_ptr<const CMappedFile> pFile = CMappedFile::Open(path);
+    if (!pFile)
+        return nullptr;
+
+    lruFiles.push_front(nFile);
+    mapFiles.emplace(nFile, std::make_pair(pFile, lruFiles.begin()));
+    while (mapFiles.size() > nMaxFiles) {
+        mapFiles.erase(lruFiles.back());
+        lruFiles.pop_back();
+    }
+
+    return pFile;
+}
+
+void CBlockFileMap::Erase(int32_t nFile) {
+    LOCK(cs_blockFileMap);
+
+    auto it = mapFiles.find(nFile);
+    if (it == mapFiles.end())
+        return;
+
+    lruFiles.erase(it->second.second);
+    mapFiles.erase(it);
+}
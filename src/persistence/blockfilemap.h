@@ -0,0 +1,69 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PERSIST_BLOCKFILEMAP_H
+#define PERSIST_BLOCKFILEMAP_H
+
+#include "commons/serialize.h"
+#include "sync.h"
+
+#include <boost/filesystem/path.hpp>
+
+#include <list>
+#include <map>
+#include <memory>
+
+/** Read-only memory mapping of a whole file, unmapped when the last reference is released. */
+class CMappedFile {
+private:
+    const char *pData;
+    size_t nSize;
+
+public:
+    CMappedFile(const char *pDataIn, size_t nSizeIn) : pData(pDataIn), nSize(nSizeIn) {}
+    ~CMappedFile();
+
+    CMappedFile(const CMappedFile &) = delete;
+    CMappedFile &operator=(const CMappedFile &) = delete;
+
+    /** Map the file at path, nullptr if it is empty or can't be mapped. */
+    static std::shared_ptr<const CMappedFile> Open(const boost::filesystem::path &path);
+
+    const char *begin() const { return pData; }
+    const char *end() const { return pData + nSize; }
+    size_t size() const { return nSize; }
+
+    /** Reader of the data from nPos to the end of the file, throws if nPos is beyond it. */
+    CSpanReader GetReader(uint32_t nPos, int nType, int nVersion) const {
+        if (nPos > nSize)
+            throw ios_base::failure("CMappedFile::GetReader() : position beyond end of file");
+        return CSpanReader(pData + nPos, end(), nType, nVersion);
+    }
+};
+
+/**
+ * LRU of the mapped blk?????.dat files, so blocks and txs are deserialized in place instead of
+ * opening, seeking and reading the file through stdio for every lookup. Only finalized files may
+ * be mapped, the file being written grows and is truncated when it is left.
+ */
+class CBlockFileMap {
+private:
+    typedef std::list<int32_t> LruList;
+
+    CCriticalSection cs_blockFileMap;
+    size_t nMaxFiles;
+    LruList lruFiles;  // most recently used first
+    std::map<int32_t, std::pair<std::shared_ptr<const CMappedFile>, LruList::iterator>> mapFiles;
+
+public:
+    explicit CBlockFileMap(size_t nMaxFilesIn) : nMaxFiles(nMaxFilesIn) {}
+
+    /** Mapping of the block file, nullptr if it can't be mapped. */
+    std::shared_ptr<const CMappedFile> Get(int32_t nFile);
+
+    /** Drop the mapping of a pruned file, readers still holding it keep it alive. */
+    void Erase(int32_t nFile);
+};
+
+#endif  // PERSIST_BLOCKFILEMAP_H
@@ -65,9 +65,9 @@ private:
     /*  CCompositeKVCache     prefixType     key                            value             variable  */
     /*  ----------------   --------------   ------------                --------------    ----- --------*/
     // cdp{$cdpid} -> CUserCDP
-    CCompositeKVCache<      dbk::CDP,       uint256,                    CUserCDP>           cdpCache;
+    CCompositeKVCache<      dbk::CDP,       uint256,                    CUserCDP, CacheLayout::HASHED> cdpCache;
     // rcdp${CRegID} -> set<cdpid>
-    CCompositeKVCache<      dbk::REGID_CDP, string,                     set<uint256>>       regId2CDPCache;
+    CCompositeKVCache<      dbk::REGID_CDP, string,                     set<uint256>, CacheLayout::HASHED> regId2CDPCache;
     // cdpr{Ratio}{$cdpid} -> CUserCDP
     CCompositeKVCache<      dbk::CDP_RATIO, std::pair<string, uint256>, CUserCDP>           ratioCDPIdCache;
 };
@@ -127,9 +127,9 @@ private:
     /*  CCompositeKVCache     prefixType     key               value             variable  */
     /*  ----------------   --------------   ------------   --------------    ----- --------*/
     // ccdp${closed_cdpid} -> <closedCdpTxId, closeType>
-    CCompositeKVCache< dbk::CLOSED_CDP_TX, uint256, std::pair<uint256, uint8_t> > closedCdpTxCache;
+    CCompositeKVCache< dbk::CLOSED_CDP_TX, uint256, std::pair<uint256, uint8_t>, CacheLayout::HASHED> closedCdpTxCache;
     // ctx${$closed_cdp_txid} -> <closedCdpId, closeType> (no-force-liquidation)
-    CCompositeKVCache< dbk::CLOSED_TX_CDP, uint256, std::pair<uint256, uint8_t> > closedTxCdpCache;
+    CCompositeKVCache< dbk::CLOSED_TX_CDP, uint256, std::pair<uint256, uint8_t>, CacheLayout::HASHED> closedTxCdpCache;
 };
 
 #endif  // PERSIST_CDPDB_H
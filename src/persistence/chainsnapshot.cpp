@@ -0,0 +1,77 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "chainsnapshot.h"
+
+#include "main.h"
+
+static CCriticalSection cs_chainSnapshot;
+static std::shared_ptr<const CChainSnapshot> pChainSnapshot;
+
+CChainSnapshot::CChainSnapshot(CBlockIndex *pTipIn) : pTip(pTipIn) {
+    AssertLockHeld(cs_main);
+    assert(pTip);
+
+    pSysParamDb  = pCdMan->pSysParamDb->GetSnapshot();
+    pAccountDb   = pCdMan->pAccountDb->GetSnapshot();
+    pAssetDb     = pCdMan->pAssetDb->GetSnapshot();
+    pContractDb  = pCdMan->pContractDb->GetSnapshot();
+    pDelegateDb  = pCdMan->pDelegateDb->GetSnapshot();
+    pCdpDb       = pCdMan->pCdpDb->GetSnapshot();
+    pClosedCdpDb = pCdMan->pClosedCdpDb->GetSnapshot();
+    pDexDb       = pCdMan->pDexDb->GetSnapshot();
+    pBlockDb     = pCdMan->pBlockDb->GetSnapshot();
+    pLogDb       = pCdMan->pLogDb->GetSnapshot();
+    pReceiptDb   = pCdMan->pReceiptDb->GetSnapshot();
+
+    uint64_t slideWindow = 0;
+    pCdMan->pSysParamCache->GetParam(SysParamType::MEDIAN_PRICE_SLIDE_WINDOW_BLOCKCOUNT, slideWindow);
+    for (const auto &coinPricePair : {CoinPricePair(SYMB::WICC, SYMB::USD), CoinPricePair(SYMB::WGRT, SYMB::USD)}) {
+        mapMedianPrices[coinPricePair] = pCdMan->pPpCache->GetMedianPrice(pTip->height, slideWindow, coinPricePair);
+    }
+}
+
+CBlockIndex *CChainSnapshot::operator[](int32_t height) const {
+    return pTip->GetAncestor(height);
+}
+
+CBlockIndex *CChainSnapshot::Next(const CBlockIndex *pIndex) const {
+    if (!Contains(pIndex))
+        return nullptr;
+
+    return (*this)[pIndex->height + 1];
+}
+
+uint64_t CChainSnapshot::GetMedianPrice(const CoinPricePair &coinPricePair) const {
+    auto it = mapMedianPrices.find(coinPricePair);
+    return it != mapMedianPrices.end() ? it->second : 0;
+}
+
+CBlockIndex *CChainSnapshot::LookupBlockIndex(const uint256 &hash) {
+    LOCK(cs_mapBlockIndex);
+    auto it = mapBlockIndex.find(hash);
+    return it != mapBlockIndex.end() ? it->second : nullptr;
+}
+
+std::shared_ptr<const CChainSnapshot> GetChainSnapshot() {
+    LOCK(cs_chainSnapshot);
+    return pChainSnapshot;
+}
+
+void PublishChainSnapshot(CBlockIndex *pTip) {
+    std::shared_ptr<const CChainSnapshot> pSnapshot = std::make_shared<CChainSnapshot>(pTip);
+    {
+        LOCK(cs_chainSnapshot);
+        pChainSnapshot.swap(pSnapshot);
+    }
+    // the previous snapshot, if no reader uses it any more, is released here outside the lock
+}
+
+void ResetChainSnapshot() {
+    std::shared_ptr<const CChainSnapshot> pSnapshot;
+    {
+        LOCK(cs_chainSnapshot);
+        pChainSnapshot.swap(pSnapshot);
+    }
+}
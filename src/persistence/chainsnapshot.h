@@ -0,0 +1,75 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PERSIST_CHAINSNAPSHOT_H
+#define PERSIST_CHAINSNAPSHOT_H
+
+#include "block.h"
+#include "dbaccess.h"
+#include "entities/asset.h"
+
+#include <map>
+#include <memory>
+
+/**
+ * Immutable view of the chain state at a tip: the active chain up to the tip, read-only views of
+ * the state databases as of the tip and the median prices at the tip.
+ *
+ * A snapshot is published every time the state caches are flushed to disk at a new tip, i.e. on
+ * every block once synced, so read-only RPCs can use it without holding cs_main. Readers build
+ * their own caches over the database views instead of using the shared pCdMan caches.
+ */
+class CChainSnapshot {
+public:
+    std::shared_ptr<CDBAccess> pSysParamDb;
+    std::shared_ptr<CDBAccess> pAccountDb;
+    std::shared_ptr<CDBAccess> pAssetDb;
+    std::shared_ptr<CDBAccess> pContractDb;
+    std::shared_ptr<CDBAccess> pDelegateDb;
+    std::shared_ptr<CDBAccess> pCdpDb;
+    std::shared_ptr<CDBAccess> pClosedCdpDb;
+    std::shared_ptr<CDBAccess> pDexDb;
+    std::shared_ptr<CDBAccess> pBlockDb;
+    std::shared_ptr<CDBAccess> pLogDb;
+    std::shared_ptr<CDBAccess> pReceiptDb;
+
+private:
+    CBlockIndex *pTip;
+    map<CoinPricePair, uint64_t> mapMedianPrices;
+
+public:
+    /** Take a snapshot of pCdMan, which must just have been flushed at pTipIn. Requires cs_main. */
+    explicit CChainSnapshot(CBlockIndex *pTipIn);
+
+    CBlockIndex *Tip() const { return pTip; }
+    int32_t Height() const { return pTip->height; }
+
+    /** Block index of the snapshot chain at the given height, nullptr if out of range. */
+    CBlockIndex *operator[](int32_t height) const;
+
+    bool Contains(const CBlockIndex *pIndex) const { return pIndex && (*this)[pIndex->height] == pIndex; }
+
+    /** Successor of pIndex in the snapshot chain, nullptr if pIndex is the tip or not in the chain. */
+    CBlockIndex *Next(const CBlockIndex *pIndex) const;
+
+    /** Median price of the tip block, 0 if unknown. */
+    uint64_t GetMedianPrice(const CoinPricePair &coinPricePair) const;
+
+    /**
+     * Look up a block index by hash without cs_main, the index may be of a block not (yet) in the
+     * snapshot chain.
+     */
+    static CBlockIndex *LookupBlockIndex(const uint256 &hash);
+};
+
+/** Latest published chain snapshot, nullptr until the chain state is loaded. */
+std::shared_ptr<const CChainSnapshot> GetChainSnapshot();
+
+/** Publish a snapshot of the chain state at pTip. Requires cs_main. */
+void PublishChainSnapshot(CBlockIndex *pTip);
+
+/** Drop the published snapshot, before the databases are closed. */
+void ResetChainSnapshot();
+
+#endif  // PERSIST_CHAINSNAPSHOT_H
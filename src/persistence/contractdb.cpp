@@ -100,4 +100,10 @@ shared_ptr<CDBContractDatasGetter> CContractDBCache::CreateContractDatasGetter(
     }
     auto prefix = make_pair(contractRegid.ToRawString(), CDBContractKey(contractKeyPrefix));
     return make_shared<CDBContractDatasGetter>(contractDataCache, prefix);
-}
\ No newline at end of file
+}
+
+shared_ptr<CDBContractsGetter> CContractDBCache::CreateContractsGetter(uint32_t maxCount, const CRegID &lastRegid) {
+    assert(contractCache.GetBasePtr() == nullptr && "only support top level cache");
+    string lastKey = lastRegid.IsEmpty() ? "" : lastRegid.ToRawString();
+    return make_shared<CDBContractsGetter>(contractCache, CNullObject(), maxCount, lastKey);
+}
@@ -34,6 +34,10 @@ typedef dbk::CDBTailKey<MAX_CONTRACT_KEY_SIZE> CDBContractKey;
 /*  -------------------- --------------------         ----------------------------  ---------   --------------------- */
     // pair<contractRegId, contractKey> -> contractData
 typedef CCompositeKVCache< dbk::CONTRACT_DATA,        pair<string, CDBContractKey>, string>     DBContractDataCache;
+    // contract $RegId.ToRawString() -> Contract
+typedef CCompositeKVCache< dbk::CONTRACT_DEF,         string,                   CUniversalContract>    DBContractCache;
+
+typedef CDBListGetter<DBContractCache> CDBContractsGetter;
 
 // prefix: pair<contractRegId, contractKey>, support to match part of cotractKey
 class CDBContractDatasGetter: public CDBListGetter<DBContractDataCache, pair<string, CDBContractKey>> {
@@ -103,16 +107,18 @@ public:
 
     shared_ptr<CDBContractDatasGetter> CreateContractDatasGetter(const CRegID &contractRegid,
         const string &contractKeyPrefix, uint32_t count, const string &lastKey);
+    // iterate the contracts in regid order after lastRegid, maxCount = 0 for all of them
+    shared_ptr<CDBContractsGetter> CreateContractsGetter(uint32_t maxCount, const CRegID &lastRegid);
 private:
 /*       type               prefixType               key                     value                 variable               */
 /*  ----------------   -------------------------   -----------------------  ------------------   ------------------------ */
     /////////// ContractDB
     // contract $RegId.ToRawString() -> Contract
-    CCompositeKVCache< dbk::CONTRACT_DEF,         string,                   CUniversalContract >   contractCache;
+    DBContractCache contractCache;
     // pair<contractRegId, contractKey> -> contractData
     DBContractDataCache contractDataCache;
     // pair<contractRegId, accountKey> -> appUserAccount
-    CCompositeKVCache< dbk::CONTRACT_ACCOUNT,     pair<string, string>,     CAppUserAccount >      contractAccountCache;
+    CCompositeKVCache< dbk::CONTRACT_ACCOUNT,     pair<string, string>,     CAppUserAccount, CacheLayout::HASHED> contractAccountCache;
 };
 
 #endif  // PERSIST_CONTRACTDB_H
\ No newline at end of file
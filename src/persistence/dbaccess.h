@@ -8,8 +8,11 @@
 
 #include "commons/uint256.h"
 #include "dbconf.h"
+#include "hashoverlay.h"
 #include "leveldbwrapper.h"
 
+#include <atomic>
+#include <list>
 #include <string>
 #include <vector>
 #include <tuple>
@@ -150,19 +153,30 @@ class CDBAccess {
 public:
     CDBAccess(DBNameType dbNameTypeIn, bool fMemory, bool fWipe) :
               dbNameType(dbNameTypeIn),
-              db( GetDataDir() / "blocks" / ::GetDbName(dbNameTypeIn), DBCacheSize[dbNameTypeIn], fMemory, fWipe ) {}
+              pDb(std::make_shared<CLevelDBWrapper>(GetDataDir() / "blocks" / ::GetDbName(dbNameTypeIn),
+                                                    DBCacheSize[dbNameTypeIn], fMemory, fWipe)) {}
 
-    int64_t GetDbCount() const { return db.GetDbCount(); }
+    /**
+     * Read-only view of the database as it is now, later writes are not visible through it.
+     * The view keeps the database open and can be used from any thread.
+     */
+    std::shared_ptr<CDBAccess> GetSnapshot() const {
+        return std::shared_ptr<CDBAccess>(new CDBAccess(dbNameType, pDb, std::make_shared<CLevelDBSnapshot>(pDb)));
+    }
+
+    bool IsSnapshot() const { return pSnapshot != nullptr; }
+
+    int64_t GetDbCount() const { return pDb->GetDbCount(); }
     template<typename KeyType, typename ValueType>
     bool GetData(const dbk::PrefixType prefixType, const KeyType &key, ValueType &value) const {
         string keyStr = dbk::GenDbKey(prefixType, key);
-        return db.Read(keyStr, value);
+        return pDb->Read(keyStr, value, GetLevelDBSnapshot());
     }
 
     template<typename ValueType>
     bool GetData(const dbk::PrefixType prefixType, ValueType &value) const {
         const string prefix = dbk::GetKeyPrefix(prefixType);
-        return db.Read(prefix, value);
+        return pDb->Read(prefix, value, GetLevelDBSnapshot());
     }
 
     template <typename KeyType>
@@ -172,10 +186,7 @@ public:
         uint32_t count             = 0;
         shared_ptr<leveldb::Iterator> pCursor = NewIterator();
 
-        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
-        const string &prefix = dbk::GetKeyPrefix(prefixType);
-        ssKey.write(prefix.c_str(), prefix.size());
-        pCursor->Seek(ssKey.str());
+        pCursor->Seek(dbk::GetKeyPrefix(prefixType));
 
         for (; (count < maxNum) && pCursor->Valid(); pCursor->Next()) {
             leveldb::Slice slKey = pCursor->key();
@@ -206,10 +217,7 @@ public:
         ValueType value;
         shared_ptr<leveldb::Iterator> pCursor = NewIterator();
 
-        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
-        const string &prefix = dbk::GetKeyPrefix(prefixType);
-        ssKey.write(prefix.c_str(), prefix.size());
-        pCursor->Seek(ssKey.str());
+        pCursor->Seek(dbk::GetKeyPrefix(prefixType));
 
         for (; pCursor->Valid(); pCursor->Next()) {
             leveldb::Slice slKey = pCursor->key();
@@ -219,7 +227,7 @@ public:
 
             // Got an valid element.
             leveldb::Slice slValue = pCursor->value();
-            CDataStream ds(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            CSpanReader ds(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
             ds >> value;
             auto ret = elements.emplace(key, value);
             if (!ret.second) throw runtime_error("alloc new cache item failed");
@@ -236,11 +244,7 @@ public:
         ValueType value;
         shared_ptr<leveldb::Iterator> pCursor = NewIterator();
 
-        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
-        const string &keyPrefix = dbk::GetKeyPrefix(prefixType);
-        ssKey.write(keyPrefix.c_str(), keyPrefix.size());
-        ssKey.write(prefix.c_str(), prefix.size());
-        pCursor->Seek(ssKey.str());
+        pCursor->Seek(dbk::GetKeyPrefix(prefixType) + prefix);
 
         for (; pCursor->Valid(); pCursor->Next()) {
             leveldb::Slice slKey = pCursor->key();
@@ -256,7 +260,7 @@ public:
             } else {
                 // Got an valid element.
                 leveldb::Slice slValue = pCursor->value();
-                CDataStream ds(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+                CSpanReader ds(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
                 ds >> value;
                 auto ret = elements.emplace(key, value);
                 if (!ret.second)
@@ -276,10 +280,7 @@ public:
         ValueType value;
         shared_ptr<leveldb::Iterator> pCursor = NewIterator();
 
-        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
-        const string &keyPrefix = dbk::GetKeyPrefix(prefixType);
-        ssKey.write(keyPrefix.c_str(), keyPrefix.size());
-        pCursor->Seek(ssKey.str());
+        pCursor->Seek(dbk::GetKeyPrefix(prefixType));
 
         for (; pCursor->Valid(); pCursor->Next()) {
             leveldb::Slice slKey = pCursor->key();
@@ -292,7 +293,7 @@ public:
             }
 
             leveldb::Slice slValue = pCursor->value();
-            CDataStream ds(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            CSpanReader ds(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
             ds >> value;
 
             if (elements.count(value)) {
@@ -315,10 +316,7 @@ public:
         KeyType key;
         ValueType value;
         shared_ptr<leveldb::Iterator> pCursor = NewIterator();
-        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
-        const string &prefix = dbk::GetKeyPrefix(prefixType);
-        ssKey.write(prefix.c_str(), prefix.size());
-        pCursor->Seek(ssKey.str());
+        pCursor->Seek(dbk::GetKeyPrefix(prefixType));
 
         for (; pCursor->Valid(); pCursor->Next()) {
             leveldb::Slice slKey = pCursor->key();
@@ -334,7 +332,7 @@ public:
             } else {
                 // Got an valid element.
                 leveldb::Slice slValue = pCursor->value();
-                CDataStream ds(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+                CSpanReader ds(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
                 ds >> value;
                 auto ret = elements.emplace(key, value);
                 if (!ret.second)
@@ -348,11 +346,13 @@ public:
     template<typename KeyType, typename ValueType>
     bool HaveData(const dbk::PrefixType prefixType, const KeyType &key) const {
         string keyStr = dbk::GenDbKey(prefixType, key);
-        return db.Exists(keyStr);
+        return pDb->Exists(keyStr, GetLevelDBSnapshot());
     }
 
     template<typename KeyType, typename ValueType>
-    void BatchWrite(const dbk::PrefixType prefixType, const map<KeyType, ValueType> &mapData) {        CLevelDBBatch batch;
+    void BatchWrite(const dbk::PrefixType prefixType, const map<KeyType, ValueType> &mapData) {
+        assert(!IsSnapshot());
+        CLevelDBBatch batch;
         for (auto item : mapData) {
             string key = dbk::GenDbKey(prefixType, item.first);
             if (db_util::IsEmpty(item.second)) {
@@ -361,11 +361,35 @@ public:
                 batch.Write(key, item.second);
             }
         }
-        db.WriteBatch(batch, true);
+        pDb->WriteBatch(batch, true);
+    }
+
+    /** Write only the dirtyKeys entries of mapData, the others are unchanged copies of the stored ones */
+    template<typename KeyType, typename ValueType>
+    void BatchWrite(const dbk::PrefixType prefixType, const map<KeyType, ValueType> &mapData,
+                    const set<KeyType> &dirtyKeys) {
+        assert(!IsSnapshot());
+        dbFlushStats.Add(prefixType, mapData.size() - dirtyKeys.size(), dirtyKeys.size());
+        if (dirtyKeys.empty())
+            return;
+
+        CLevelDBBatch batch;
+        for (const auto &key : dirtyKeys) {
+            auto it = mapData.find(key);
+            assert(it != mapData.end());
+            string dbKey = dbk::GenDbKey(prefixType, key);
+            if (db_util::IsEmpty(it->second)) {
+                batch.Erase(dbKey);
+            } else {
+                batch.Write(dbKey, it->second);
+            }
+        }
+        pDb->WriteBatch(batch, true);
     }
 
     template<typename ValueType>
     void BatchWrite(const dbk::PrefixType prefixType, ValueType &value) {
+        assert(!IsSnapshot());
         CLevelDBBatch batch;
         const string prefix = dbk::GetKeyPrefix(prefixType);
 
@@ -374,20 +398,50 @@ public:
         } else {
             batch.Write(prefix, value);
         }
-        db.WriteBatch(batch, true);
+        pDb->WriteBatch(batch, true);
     }
 
     DBNameType GetDbNameType() const { return dbNameType; }
 
+    /** Bytes of clean entries the top-level caches of this db may keep after a flush, 0 to keep none */
+    void SetCacheBudget(uint64_t nBudget) { nCacheBudget = nBudget; }
+    uint64_t GetCacheBudget() const { return nCacheBudget; }
+
+    // clean entries kept by the top-level caches, shared by all the caches of this db, including the
+    // ones of snapshot readers running without cs_main
+    void AddCachedSize(uint64_t nSize) { nCachedSize += nSize; }
+    void SubCachedSize(uint64_t nSize) {
+        uint64_t nOld = nCachedSize;
+        while (!nCachedSize.compare_exchange_weak(nOld, nOld - std::min(nSize, nOld)))
+            ;
+    }
+    uint64_t GetCachedSize() const { return nCachedSize; }
+    bool IsOverCacheBudget() const { return nCachedSize > nCacheBudget; }
+
     std::shared_ptr<leveldb::Iterator> NewIterator() {
-        return std::shared_ptr<leveldb::Iterator>(db.NewIterator());
+        return std::shared_ptr<leveldb::Iterator>(pDb->NewIterator(GetLevelDBSnapshot()));
     }
 private:
+    CDBAccess(DBNameType dbNameTypeIn, const std::shared_ptr<CLevelDBWrapper> &pDbIn,
+              const std::shared_ptr<CLevelDBSnapshot> &pSnapshotIn)
+        : dbNameType(dbNameTypeIn), pDb(pDbIn), pSnapshot(pSnapshotIn) {}
+
+    const leveldb::Snapshot *GetLevelDBSnapshot() const { return pSnapshot ? pSnapshot->Get() : nullptr; }
+
     DBNameType dbNameType;
-    mutable CLevelDBWrapper db; // // TODO: remove the mutable declare
+    uint64_t nCacheBudget = 0;
+    std::atomic<uint64_t> nCachedSize{0};
+    std::shared_ptr<CLevelDBWrapper> pDb;
+    std::shared_ptr<CLevelDBSnapshot> pSnapshot;  // null unless this is a read-only view
 };
 
-template<int PREFIX_TYPE_VALUE, typename __KeyType, typename __ValueType>
+/** Storage of the child layers of a CCompositeKVCache, the top-level one is always ordered */
+enum class CacheLayout {
+    ORDERED,  // std::map, needed by the range lookups and the iterators over the cache
+    HASHED    // CHashOverlay, for the caches only read and written by key
+};
+
+template<int PREFIX_TYPE_VALUE, typename __KeyType, typename __ValueType, CacheLayout LAYOUT = CacheLayout::ORDERED>
 class CCompositeKVCache {
 public:
     static const dbk::PrefixType PREFIX_TYPE = (dbk::PrefixType)PREFIX_TYPE_VALUE;
@@ -397,6 +451,14 @@ public:
     typedef typename std::map<KeyType, ValueType> Map;
     typedef typename std::map<KeyType, ValueType>::iterator Iterator;
 
+private:
+    typedef CHashOverlay<KeyType, ValueType> HashOverlay;
+    typedef typename HashOverlay::Entry HashEntry;
+
+    typedef typename std::list<KeyType> LruList;
+    // position in lruKeys and the size accounted to the db cache budget
+    typedef typename std::map<KeyType, std::pair<typename LruList::iterator, uint32_t>> LruIndex;
+
 public:
     /**
      * Default constructor, must use set base to initialize before using.
@@ -414,9 +476,39 @@ public:
         assert(pDbAccess->GetDbNameType() == GetDbNameEnumByPrefix(PREFIX_TYPE));
     };
 
+    CCompositeKVCache(const CCompositeKVCache &other): pBase(nullptr), pDbAccess(nullptr) {
+        operator=(other);
+    }
+
+    ~CCompositeKVCache() {
+        if (pDbAccess != nullptr)
+            pDbAccess->SubCachedSize(nCleanSize);
+    }
+
+    /**
+     * The clean entries kept by a top-level cache are left out, they are in the db and the lru list
+     * of the copy must not point into the one of other.
+     */
+    CCompositeKVCache& operator=(const CCompositeKVCache& other) {
+        if (this == &other)
+            return *this;
+
+        Clear();
+        pBase     = other.pBase;
+        pDbAccess = other.pDbAccess;
+        hashData  = other.hashData;
+        for (const auto &item : other.mapData) {
+            if (!other.lruIndex.count(item.first))
+                mapData.emplace_hint(mapData.end(), item.first, item.second);
+        }
+        dirtyKeys   = other.dirtyKeys;
+        pDbOpLogMap = other.pDbOpLogMap;
+        return *this;
+    }
+
     void SetBase(CCompositeKVCache *pBaseIn) {
         assert(pDbAccess == nullptr);
-        assert(mapData.empty());
+        assert(mapData.empty() && hashData.empty());
         pBase = pBaseIn;
     };
 
@@ -424,8 +516,16 @@ public:
         pDbOpLogMap = pDbOpLogMapIn;
     }
 
+    // Size of the entries to be flushed, the clean ones kept by a top-level cache are not counted
     uint32_t GetCacheSize() const {
-        return ::GetSerializeSize(mapData, SER_DISK, CLIENT_VERSION);
+        uint32_t size = 0;
+        for (const auto &entry : hashData) {
+            if (entry.fDirty)
+                size += GetEntrySize(entry.key, entry.value);
+        }
+        for (const auto &key : dirtyKeys)
+            size += GetEntrySize(key, mapData.at(key));
+        return size;
     }
 
     bool GetTopNElements(const uint32_t maxNum, set<KeyType> &keys) {
@@ -486,9 +586,9 @@ public:
         if (db_util::IsEmpty(key)) {
             return false;
         }
-        auto it = GetDataIt(key);
-        if (it != mapData.end() && !db_util::IsEmpty(it->second)) {
-            value = it->second;
+        const ValueType *pValue = GetDataPtr(key);
+        if (pValue != nullptr && !db_util::IsEmpty(*pValue)) {
+            value = *pValue;
             return true;
         }
         return false;
@@ -498,6 +598,15 @@ public:
         if (db_util::IsEmpty(key)) {
             return false;
         }
+        if (IsHashed()) {
+            HashEntry *pEntry = GetHashEntry(key);
+            if (pEntry == nullptr)
+                pEntry = hashData.Insert(key, *db_util::MakeEmptyValue<ValueType>());
+            AddOpLog(key, pEntry->value);
+            pEntry->value  = value;
+            pEntry->fDirty = true;
+            return true;
+        }
         auto it = GetDataIt(key);
         if (it == mapData.end()) {
             auto emptyValue = db_util::MakeEmptyValue<ValueType>();
@@ -507,6 +616,7 @@ public:
         }
         AddOpLog(key, it->second);
         it->second = value;
+        SetDirty(key);
         return true;
     }
 
@@ -514,54 +624,79 @@ public:
         if (db_util::IsEmpty(key)) {
             return false;
         }
-        auto it = GetDataIt(key);
-        return it != mapData.end() && !db_util::IsEmpty(it->second);
+        const ValueType *pValue = GetDataPtr(key);
+        return pValue != nullptr && !db_util::IsEmpty(*pValue);
     }
 
     bool EraseData(const KeyType &key) {
         if (db_util::IsEmpty(key)) {
             return false;
         }
+        if (IsHashed()) {
+            HashEntry *pEntry = GetHashEntry(key);
+            if (pEntry != nullptr && !db_util::IsEmpty(pEntry->value)) {
+                AddOpLog(key, pEntry->value);
+                db_util::SetEmpty(pEntry->value);
+                pEntry->fDirty = true;
+            }
+            return true;
+        }
         Iterator it = GetDataIt(key);
         if (it != mapData.end() && !db_util::IsEmpty(it->second)) {
             AddOpLog(key, it->second);
             db_util::SetEmpty(it->second);
+            SetDirty(key);
         }
         return true;
     }
 
     void Clear() {
+        hashData.Clear();
         mapData.clear();
+        dirtyKeys.clear();
+        lruKeys.clear();
+        lruIndex.clear();
+        if (pDbAccess != nullptr)
+            pDbAccess->SubCachedSize(nCleanSize);
+        nCleanSize = 0;
     }
 
+    /**
+     * Only the dirty entries are propagated, the clean ones were read from the base or the db.
+     * A top-level cache keeps the flushed entries as clean ones, dropping the least recently
+     * used while the clean entries of its db exceed the db cache budget.
+     */
     void Flush() {
         assert(pBase != nullptr || pDbAccess != nullptr);
         if (pBase != nullptr) {
             assert(pDbAccess == nullptr);
-            for (auto it : mapData) {
-                pBase->mapData[it.first] = it.second;
+            for (const auto &entry : hashData) {
+                if (entry.fDirty)
+                    pBase->SetDirtyData(entry.key, entry.value);
             }
+            for (const auto &key : dirtyKeys)
+                pBase->SetDirtyData(key, mapData.at(key));
         } else if (pDbAccess != nullptr) {
             assert(pBase == nullptr);
-            pDbAccess->BatchWrite<KeyType, ValueType>(PREFIX_TYPE, mapData);
+            pDbAccess->BatchWrite<KeyType, ValueType>(PREFIX_TYPE, mapData, dirtyKeys);
+            if (pDbAccess->GetCacheBudget() > 0) {
+                KeepFlushed();
+                return;
+            }
         }
 
         Clear();
     }
 
-    void UndoData(const CDbOpLog &dbOpLog) {
-        KeyType key;
-        ValueType value;
-        dbOpLog.Get(key, value);
-        mapData[key] = value;
-    }
-
     bool UndoData() {
         if (pDbOpLogMap != nullptr){
             const CDbOpLogs *pDbOpLogs = pDbOpLogMap->GetDbOpLogsPtr(PREFIX_TYPE);
             if (pDbOpLogs != nullptr) {
-                for (auto it = pDbOpLogs->rbegin(); it != pDbOpLogs->rend(); it++) {
-                    UndoData(*it);
+                for (size_t i = pDbOpLogs->size(); i > 0; i--) {
+                    KeyType key;
+                    ValueType value;
+                    pDbOpLogs->Get(i - 1, key, value);
+                    SetDirtyData(key, value);
                 }
             }
             return true;
@@ -582,20 +717,61 @@ public:
         return pRet;
     }
 
-    CCompositeKVCache<PREFIX_TYPE, KeyType, ValueType>* GetBasePtr() { return pBase; }
+    CCompositeKVCache* GetBasePtr() { return pBase; }
 
-    map<KeyType, ValueType>& GetMapData() { return mapData; };
+    map<KeyType, ValueType>& GetMapData() { assert(!IsHashed()); return mapData; };
+    const map<KeyType, ValueType>& GetMapData() const { assert(!IsHashed()); return mapData; };
 private:
+    bool IsHashed() const { return LAYOUT == CacheLayout::HASHED && pBase != nullptr; }
+
+    // the value of key at this layer, copied from the layers below if needed, nullptr if none
+    ValueType *GetDataPtr(const KeyType &key) const {
+        if (IsHashed()) {
+            HashEntry *pEntry = GetHashEntry(key);
+            return pEntry != nullptr ? &pEntry->value : nullptr;
+        }
+        Iterator it = GetDataIt(key);
+        return it != mapData.end() ? &it->second : nullptr;
+    }
+
+    HashEntry *GetHashEntry(const KeyType &key) const {
+        HashEntry *pEntry = hashData.Find(key);
+        if (pEntry != nullptr)
+            return pEntry;
+
+        const ValueType *pBaseValue = pBase->GetDataPtr(key);
+        if (pBaseValue == nullptr)
+            return nullptr;
+        return hashData.Insert(key, *pBaseValue);
+    }
+
+    // set a value flushed from a child layer or restored by UndoData
+    void SetDirtyData(const KeyType &key, const ValueType &value) {
+        if (IsHashed()) {
+            HashEntry *pEntry = hashData.Find(key);
+            if (pEntry == nullptr)
+                pEntry = hashData.Insert(key, value);
+            else
+                pEntry->value = value;
+            pEntry->fDirty = true;
+            return;
+        }
+        mapData[key] = value;
+        SetDirty(key);
+    }
+
     Iterator GetDataIt(const KeyType &key) const {
         Iterator it = mapData.find(key);
         if (it != mapData.end()) {
+            if (pDbAccess != nullptr)
+                TouchClean(key);
             return it;
         } else if (pBase != nullptr){
             // find key-value at base cache
-            auto baseIt = pBase->GetDataIt(key);
-            if (baseIt != pBase->mapData.end()) {
+            const ValueType *pBaseValue = pBase->GetDataPtr(key);
+            if (pBaseValue != nullptr) {
                 // the found key-value add to current mapData
-                auto newRet = mapData.emplace(key, baseIt->second);
+                auto newRet = mapData.emplace(key, *pBaseValue);
                 if (!newRet.second) throw runtime_error("alloc new cache item failed");
                 return newRet.first;
             }
@@ -605,6 +781,7 @@ private:
             if (pDbAccess->GetData(PREFIX_TYPE, key, *pDbValue)) {
                 auto newRet = mapData.emplace(key, *pDbValue);
                 if (!newRet.second) throw runtime_error("alloc new cache item failed");
+                AddClean(key, newRet.first->second);
                 return newRet.first;
             }
         }
@@ -612,7 +789,61 @@ private:
         return mapData.end();
     }
 
+    static uint32_t GetEntrySize(const KeyType &key, const ValueType &value) {
+        return ::GetSerializeSize(key, SER_DISK, CLIENT_VERSION) + ::GetSerializeSize(value, SER_DISK, CLIENT_VERSION);
+    }
+
+    // the clean entries of a top-level cache are kept in lruKeys, most recently used first
+    void AddClean(const KeyType &key, const ValueType &value) const {
+        uint32_t size = GetEntrySize(key, value);
+        lruKeys.push_front(key);
+        lruIndex.emplace(key, std::make_pair(lruKeys.begin(), size));
+        nCleanSize += size;
+        pDbAccess->AddCachedSize(size);
+    }
+
+    void TouchClean(const KeyType &key) const {
+        auto it = lruIndex.find(key);
+        if (it != lruIndex.end())
+            lruKeys.splice(lruKeys.begin(), lruKeys, it->second.first);
+    }
+
+    void RemoveClean(typename LruIndex::iterator it) {
+        lruKeys.erase(it->second.first);
+        nCleanSize -= it->second.second;
+        pDbAccess->SubCachedSize(it->second.second);
+        lruIndex.erase(it);
+    }
+
+    void SetDirty(const KeyType &key) {
+        dirtyKeys.insert(key);
+        if (pDbAccess != nullptr) {
+            auto it = lruIndex.find(key);
+            if (it != lruIndex.end())
+                RemoveClean(it);
+        }
+    }
+
+    // the written entries become clean, erased ones are dropped as the db has no value for them
+    void KeepFlushed() {
+        for (const auto &key : dirtyKeys) {
+            auto it = mapData.find(key);
+            if (db_util::IsEmpty(it->second))
+                mapData.erase(it);
+            else
+                AddClean(key, it->second);
+        }
+        dirtyKeys.clear();
+
+        while (!lruKeys.empty() && pDbAccess->IsOverCacheBudget()) {
+            const KeyType &key = lruKeys.back();
+            mapData.erase(key);
+            RemoveClean(lruIndex.find(key));
+        }
+    }
+
     bool GetTopNElements(const uint32_t maxNum, set<KeyType> &expiredKeys, set<KeyType> &keys) {
+        assert(!IsHashed());
         if (!mapData.empty()) {
             uint32_t count = 0;
             auto iter      = mapData.begin();
@@ -643,6 +874,7 @@ private:
 
     // map<string, ValueType>
     bool GetAllElements(const string &prefix, set<string> &expiredKeys, map<string, ValueType> &elements) {
+        assert(!IsHashed());
         if (!mapData.empty()) {
             auto boundary    = mapData.upper_bound(prefix);
             size_t prefixLen = prefix.size();
@@ -676,6 +908,7 @@ private:
 
     // map<std::pair<string, uint256>, ValueType>
     bool GetAllElements(const string &prefix, set<std::pair<string, uint256>> &expiredKeys, set<ValueType> &elements) {
+        assert(!IsHashed());
         if (!mapData.empty()) {
             static uint256 dummy = uint256S("0xffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffffff");
             auto boundary = mapData.upper_bound(std::make_pair(prefix, dummy));
@@ -703,6 +936,7 @@ private:
     }
 
     bool GetAllElements(set<KeyType> &expiredKeys, map<KeyType, ValueType> &elements) {
+        assert(!IsHashed());
         if (!mapData.empty()) {
             for (auto iter : mapData) {
                 if (db_util::IsEmpty(iter.second)) {
@@ -728,16 +962,18 @@ private:
 
     inline void AddOpLog(const KeyType &key, const ValueType &oldValue) {
         if (pDbOpLogMap != nullptr) {
-            CDbOpLog dbOpLog;
-            dbOpLog.Set(key, oldValue);
-            pDbOpLogMap->AddOpLog(PREFIX_TYPE, dbOpLog);
+            pDbOpLogMap->AddOpLog(PREFIX_TYPE, key, oldValue);
         }
-
     }
 private:
-    mutable CCompositeKVCache<PREFIX_TYPE, KeyType, ValueType> *pBase;
+    mutable CCompositeKVCache *pBase;
     CDBAccess *pDbAccess;
+    mutable HashOverlay hashData;  // child layers of a HASHED cache
     mutable map<KeyType, ValueType> mapData;
+    set<KeyType> dirtyKeys;  // keys of mapData changed at this layer or flushed into it
+    mutable LruList lruKeys;
+    mutable LruIndex lruIndex;
+    mutable uint64_t nCleanSize = 0;
     CDBOpLogMap *pDbOpLogMap = nullptr;
 };
 
@@ -775,6 +1011,7 @@ public:
         } else {
             ptrData = make_shared<ValueType>(*other.ptrData);
         }
+        fDirty = other.fDirty;
         pDbOpLogMap = other.pDbOpLogMap;
         return *this;
     }
@@ -812,6 +1049,7 @@ public:
         }
         AddOpLog(*ptrData);
         *ptrData = value;
+        fDirty = true;
         return true;
     }
 
@@ -825,12 +1063,14 @@ public:
         if (ptr && !db_util::IsEmpty(*ptr)) {
             AddOpLog(*ptr);
             db_util::SetEmpty(*ptr);
+            fDirty = true;
         }
         return true;
     }
 
     void Clear() {
         ptrData = nullptr;
+        fDirty = false;
     }
 
     void Flush() {
@@ -838,28 +1078,31 @@ public:
         if (ptrData) {
             if (pBase != nullptr) {
                 assert(pDbAccess == nullptr);
-                pBase->ptrData = ptrData;
+                if (fDirty) {
+                    pBase->ptrData = ptrData;
+                    pBase->fDirty = true;
+                }
             } else if (pDbAccess != nullptr) {
                 assert(pBase == nullptr);
-                pDbAccess->BatchWrite(PREFIX_TYPE, *ptrData);
+                dbFlushStats.Add(PREFIX_TYPE, fDirty ? 0 : 1, fDirty ? 1 : 0);
+                if (fDirty)
+                    pDbAccess->BatchWrite(PREFIX_TYPE, *ptrData);
             }
             ptrData = nullptr;
+            fDirty = false;
         }
     }
 
-    void UndoData(const CDbOpLog &dbOpLog) {
-        if (!ptrData) {
-            ptrData = db_util::MakeEmptyValue<ValueType>();
-        }
-        dbOpLog.Get(*ptrData);
-    }
-
     bool UndoData() {
         if (pDbOpLogMap != nullptr){
             const CDbOpLogs *pDbOpLogs = pDbOpLogMap->GetDbOpLogsPtr(PREFIX_TYPE);
             if (pDbOpLogs != nullptr) {
-                for (auto it = pDbOpLogs->rbegin(); it != pDbOpLogs->rend(); it++) {
-                    UndoData(*it);
+                for (size_t i = pDbOpLogs->size(); i > 0; i--) {
+                    if (!ptrData) {
+                        ptrData = db_util::MakeEmptyValue<ValueType>();
+                    }
+                    pDbOpLogs->Get(i - 1, *ptrData);
+                    fDirty = true;
                 }
             }
             return true;
@@ -896,16 +1139,14 @@ private:
 
     inline void AddOpLog(const ValueType &oldValue) {
         if (pDbOpLogMap != nullptr) {
-            CDbOpLog dbOpLog;
-            dbOpLog.Set(oldValue);
-            pDbOpLogMap->AddOpLog(PREFIX_TYPE, dbOpLog);
+            pDbOpLogMap->AddOpLog(PREFIX_TYPE, oldValue);
         }
-
     }
 private:
     mutable CSimpleKVCache<PREFIX_TYPE, ValueType> *pBase;
     CDBAccess *pDbAccess;
     mutable std::shared_ptr<ValueType> ptrData = nullptr;
+    bool fDirty = false;  // ptrData changed at this layer or flushed into it
     CDBOpLogMap *pDbOpLogMap = nullptr;
 };
 
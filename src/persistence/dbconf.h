@@ -77,11 +77,13 @@ namespace dbk {
         DEFINE( FLAG,                 "flag",   BLOCK )         /* [prefix] --> $Flag = 1 | 0 */ \
         DEFINE( BEST_BLOCKHASH,       "bbkh",   BLOCK )         /* [prefix] --> $BestBlockHash */ \
         DEFINE( TXID_DISKINDEX,       "tidx",   BLOCK )      /* tidx{$txid} --> $DiskTxPos */ \
+        DEFINE( MATURE_REWARD_TX,     "mrtx",   BLOCK )         /* mrtx{$height} --> {reward txs maturing at $height} */ \
+        DEFINE( KEYID_TXID,           "aidx",   BLOCK )         /* aidx{$KeyId}{$height}{$index} --> $txid, -addressindex */ \
         /**** account db                                                                      */ \
         DEFINE( REGID_KEYID,          "rkey",   ACCOUNT )       /* rkey{$RegID} --> $KeyId */ \
         DEFINE( NICKID_KEYID,         "nkey",   ACCOUNT )       /* nkey{$NickID} --> $KeyId */ \
         DEFINE( KEYID_ACCOUNT,        "idac",   ACCOUNT )       /* idac{$KeyID} --> $CAccount */ \
-        DEFINE( KEYID_ACCOUNT_TOKEN,  "idat",   ACCOUNT )       /* idat{$KeyID}{tokenSymbol} --> $free_amount, $frozen_amount */ \
+        DEFINE( KEYID_ACCOUNT_TOKEN,  "idat",   ACCOUNT )       /* idat{$KeyID}{tokenSymbol} --> $CAccountToken */ \
         /**** contract db                                                                      */ \
         DEFINE( CONTRACT_DEF,         "cdef",   CONTRACT )      /* cdef{$ContractRegId} --> $ContractContent */ \
         DEFINE( CONTRACT_DATA,        "cdat",   CONTRACT )      /* cdat{$RegId}{$DataKey} --> $Data */ \
@@ -155,12 +157,10 @@ namespace dbk {
 
     template<typename KeyElement>
     std::string GenDbKey(PrefixType keyPrefixType, const KeyElement &keyElement) {
-        CDataStream ssKeyTemp(SER_DISK, CLIENT_VERSION);
         assert(keyPrefixType != EMPTY);
-        const string &prefix = GetKeyPrefix(keyPrefixType);
-        ssKeyTemp.write(prefix.c_str(), prefix.size()); // write buffer only, exclude size prefix
-        ssKeyTemp << keyElement;
-        return std::string(ssKeyTemp.begin(), ssKeyTemp.end());
+        std::string key = GetKeyPrefix(keyPrefixType); // write buffer only, exclude size prefix
+        CStringWriter(key, SER_DISK, CLIENT_VERSION) << keyElement;
+        return key;
     }
 
     template<typename KeyElement>
@@ -171,8 +171,7 @@ namespace dbk {
             return false;
         }
 
-        CDataStream ssKeyTemp(slice.data(), slice.data() + slice.size(), SER_DISK, CLIENT_VERSION);
-        ssKeyTemp.ignore(prefix.size());
+        CSpanReader ssKeyTemp(slice.data() + prefix.size(), slice.data() + slice.size(), SER_DISK, CLIENT_VERSION);
         ssKeyTemp >> keyElement;
 
         return true;
@@ -206,11 +205,13 @@ namespace dbk {
             return key.size();
         }
 
-        void Serialize(CDataStream &s, int nType, int nVersion) const {
+        template <typename Stream>
+        void Serialize(Stream &s, int nType, int nVersion) const {
             s.write(key.data(), key.size());
         }
 
-        void Unserialize(CDataStream &s, int nType, int nVersion) {
+        template <typename Stream>
+        void Unserialize(Stream &s, int nType, int nVersion) {
             if (s.size() > MAX_KEY_SIZE) {
                 throw ios_base::failure("CDBTailKey::Unserialize size excceded max size");
             }
@@ -154,7 +154,7 @@ private:
             return false;
 
         try {
-            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            CSpanReader ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
             ssValue >> Base::value;
         } catch(std::exception &e) {
             throw runtime_error(strprintf("CDBPrefixIterator::Parse db value error! %s", HexStr(slValue.ToString())));
@@ -249,12 +249,25 @@ public:
           max_count(maxCount){}
 
     bool Execute() {
+        return ForEach([this](const KeyType &key, const ValueType &value) {
+            data_list.push_back(make_pair(key, value));
+            return true;
+        });
+    }
+
+    /**
+     * Visit the items after the last key in key order without collecting them, so the caller can
+     * stream them out. Stops after max count items, or when func(key, value) returns false.
+     */
+    template<typename Func>
+    bool ForEach(Func func) {
         CMapPrefixIterator<CacheType, PrefixElement, PrefixMatcher> mapIt(db_cache, prefix_element);
         CDBPrefixIterator<CacheType, PrefixElement, PrefixMatcher> dbIt(db_cache, prefix_element);
         mapIt.First(last_key);
         dbIt.First(last_key);
         db_util::SetEmpty(last_key);
 
+        uint32_t count = 0;
         while(mapIt.IsValid() || dbIt.IsValid()) {
             bool isMapData = true, isSameKey = false;
             if (mapIt.IsValid() && dbIt.IsValid()) {
@@ -272,11 +285,19 @@ public:
                 isMapData = false;
             }
 
-            shared_ptr<DataListItem> pItem = nullptr;
+            // an empty value in map is an erased item
+            if (!isMapData || !db_util::IsEmpty(mapIt.value)) {
+                if (max_count != 0 && count >= max_count) {
+                    have_next = true;
+                    break;
+                }
+                count++;
+                bool isContinue = isMapData ? func(mapIt.key, mapIt.value) : func(dbIt.key, dbIt.value);
+                if (!isContinue)
+                    break;
+            }
+
             if (isMapData) {
-                if (!db_util::IsEmpty(mapIt.value)) {
-                    pItem = make_shared<DataListItem>(mapIt.key, mapIt.value);
-                } // else ignore
                 mapIt.Next();
                 if (isSameKey) {
                     assert(dbIt.IsValid());
@@ -284,16 +305,8 @@ public:
                     dbIt.Next();
                 }
             } else { // is db data
-                pItem = make_shared<DataListItem>(dbIt.key, dbIt.value);
                 dbIt.Next();
             }
-            if (pItem != nullptr) {
-                if (max_count != 0 && data_list.size() >= max_count) {
-                    have_next = true;
-                    break;
-                }
-                data_list.push_back(*pItem);
-            }
         }
         return true;
     }
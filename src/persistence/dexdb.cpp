@@ -28,16 +28,17 @@ void DEX_DB::BlockOrdersToJson(const BlockOrders &orders, Object &obj) {
     obj.push_back(Pair("orders", array));
 }
 
-shared_ptr<string> DEX_DB::ParseLastPos(const string &lastPosInfo, DEXBlockOrdersCache::KeyType &lastKey) {
+shared_ptr<string> DEX_DB::ParseLastPos(const CChainSnapshot &snapshot, const string &lastPosInfo,
+                                        DEXBlockOrdersCache::KeyType &lastKey) {
 
     CDataStream ds(lastPosInfo, SER_DISK, CLIENT_VERSION);
     uint256 lastBlockHash;
     ds >> lastBlockHash >> lastKey;
     uint32_t lastHeight = DEX_DB::GetHeight(lastKey);
-    CBlockIndex *pBlockIndex = chainActive[lastHeight];
+    CBlockIndex *pBlockIndex = snapshot[lastHeight];
     if (pBlockIndex == nullptr)
         return make_shared<string>(strprintf("The last_pos_info is not contained in acitve chains,"
-            " last_height=%d, tip_height=%d", lastHeight, chainActive.Height()));
+            " last_height=%d, tip_height=%d", lastHeight, snapshot.Height()));
     if (pBlockIndex->GetBlockHash() != lastBlockHash)
         return make_shared<string>(strprintf("The block of height in last_pos_info does not match with the acitve block,"
             " height=%d, last_block_hash=%s, cur_height_block_hash=%s",
@@ -45,12 +46,13 @@ shared_ptr<string> DEX_DB::ParseLastPos(const string &lastPosInfo, DEXBlockOrder
     return nullptr;
 }
 
-shared_ptr<string> DEX_DB::MakeLastPos(const DEXBlockOrdersCache::KeyType &lastKey, string &lastPosInfo) {
+shared_ptr<string> DEX_DB::MakeLastPos(const CChainSnapshot &snapshot, const DEXBlockOrdersCache::KeyType &lastKey,
+                                       string &lastPosInfo) {
     uint32_t lastHeight = DEX_DB::GetHeight(lastKey);
-    CBlockIndex *pBlockIndex = chainActive[lastHeight];
+    CBlockIndex *pBlockIndex = snapshot[lastHeight];
     if (pBlockIndex == nullptr)
         return make_shared<string>(strprintf("The block of lastKey is not contained in acitve chains,"
-            " last_height=%d, tip_height=%d", lastHeight, chainActive.Height()));
+            " last_height=%d, tip_height=%d", lastHeight, snapshot.Height()));
 
     CDataStream ds(SER_DISK, CLIENT_VERSION);
     ds << pBlockIndex->GetBlockHash() << lastKey;
@@ -125,7 +127,7 @@ private:
             return false;
 
         try {
-            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            CSpanReader ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
             ssValue >> value;
         } catch(std::exception &e) {
             throw runtime_error(strprintf("CDBDexOrderIt::Parse db value error! %s", HexStr(slValue.ToString())));
@@ -280,7 +282,7 @@ private:
         assert(DEX_DB::GetHeight(key) == height || DEX_DB::GetGenerateType(key) == (uint8_t)SYSTEM_GEN_ORDER);
 
         try {
-            CDataStream ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
+            CSpanReader ssValue(slValue.data(), slValue.data() + slValue.size(), SER_DISK, CLIENT_VERSION);
             ssValue >> value;
         } catch(std::exception &e) {
             throw runtime_error(strprintf("CDBDexSysOrderIt::Parse db value error! %s", HexStr(slValue.ToString())));
@@ -15,6 +15,8 @@
 #include "entities/account.h"
 #include "entities/dexorder.h"
 
+class CChainSnapshot;
+
 using namespace std;
 
 /*       type               prefixType                   key                            value                type             */
@@ -41,10 +43,12 @@ namespace DEX_DB {
         return std::get<2>(key);
     }
 
-    // return err str if err happens
-    shared_ptr<string> ParseLastPos(const string &lastPosInfo, DEXBlockOrdersCache::KeyType &lastKey);
+    // return err str if err happens, the position is checked against the chain of the snapshot
+    shared_ptr<string> ParseLastPos(const CChainSnapshot &snapshot, const string &lastPosInfo,
+                                    DEXBlockOrdersCache::KeyType &lastKey);
 
-    shared_ptr<string> MakeLastPos(const DEXBlockOrdersCache::KeyType &lastKey, string &lastPosInfo);
+    shared_ptr<string> MakeLastPos(const CChainSnapshot &snapshot, const DEXBlockOrdersCache::KeyType &lastKey,
+                                   string &lastPosInfo);
 
     void OrderToJson(const uint256 &orderId, const CDEXOrderDetail &order, Object &obj);
 
@@ -141,7 +145,7 @@ private:
 /*  ----------------   -----------------------------  ---------------------------  ------------------   ------------------------ */
     /////////// DexDB
     // order tx id -> active order
-    CCompositeKVCache< dbk::DEX_ACTIVE_ORDER,          uint256,                     CDEXOrderDetail >     activeOrderCache;
+    CCompositeKVCache< dbk::DEX_ACTIVE_ORDER,          uint256,                     CDEXOrderDetail, CacheLayout::HASHED> activeOrderCache;
     DEXBlockOrdersCache    blockOrdersCache;
 };
 
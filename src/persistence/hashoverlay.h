@@ -0,0 +1,174 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PERSIST_HASHOVERLAY_H
+#define PERSIST_HASHOVERLAY_H
+
+#include "commons/serialize.h"
+#include "config/version.h"
+
+#include <algorithm>
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * Insert-only open-addressing hash table holding the few entries a child cache layer gets while
+ * a tx or a block runs on it. Keys are hashed by their serialization and compared with operator<
+ * like in the std::map of the ordered layers. Entries are never removed one by one, an erased
+ * value stays as the empty value until Clear(). The buffers are recycled through a per-thread
+ * pool, so creating a layer for every tx does not allocate once the pool is warm.
+ */
+template<typename K, typename V>
+class CHashOverlay {
+public:
+    struct Entry {
+        K key;
+        V value;
+        uint32_t nHash;
+        bool fDirty;  // changed at this layer or flushed into it
+    };
+
+    typedef typename std::vector<Entry>::iterator Iterator;
+    typedef typename std::vector<Entry>::const_iterator ConstIterator;
+
+private:
+    static const uint32_t MIN_SLOTS           = 16;
+    static const size_t MAX_POOLED_ENTRIES  = 1024;  // larger buffers go back to the heap
+    static const size_t MAX_POOLED_STORAGES = 64;
+
+    struct Storage {
+        std::vector<Entry> entries;   // in insertion order
+        std::vector<uint32_t> slots;  // index in entries + 1, 0 if free, the size is a power of 2
+    };
+
+    struct CStoragePool {
+        std::vector<Storage *> vStorages;
+        ~CStoragePool() {
+            for (auto pStorage : vStorages)
+                delete pStorage;
+        }
+    };
+
+    Storage *pStorage = nullptr;
+
+public:
+    CHashOverlay() {}
+    CHashOverlay(const CHashOverlay &other) { operator=(other); }
+    ~CHashOverlay() { Clear(); }
+
+    CHashOverlay &operator=(const CHashOverlay &other) {
+        if (this == &other)
+            return *this;
+        Clear();
+        if (other.pStorage != nullptr && !other.pStorage->entries.empty()) {
+            pStorage = Acquire();
+            pStorage->entries = other.pStorage->entries;
+            pStorage->slots   = other.pStorage->slots;
+        }
+        return *this;
+    }
+
+    bool empty() const { return pStorage == nullptr || pStorage->entries.empty(); }
+    size_t size() const { return pStorage == nullptr ? 0 : pStorage->entries.size(); }
+
+    Iterator begin() { return GetEntries().begin(); }
+    Iterator end() { return GetEntries().end(); }
+    ConstIterator begin() const { return GetEntries().begin(); }
+    ConstIterator end() const { return GetEntries().end(); }
+
+    /** The entry of key, nullptr if there is none. The pointer is valid until the next Insert(). */
+    Entry *Find(const K &key) const {
+        if (empty())
+            return nullptr;
+        return FindSlot(key, HashKey(key));
+    }
+
+    /** Add the entry of key, which must not be in the table yet. */
+    Entry *Insert(const K &key, const V &value) {
+        if (pStorage == nullptr)
+            pStorage = Acquire();
+
+        std::vector<Entry> &entries = pStorage->entries;
+        if ((entries.size() + 1) * 2 > pStorage->slots.size())
+            Rehash(std::max<uint32_t>(MIN_SLOTS, pStorage->slots.size() * 2));
+
+        uint32_t nHash = HashKey(key);
+        entries.push_back(Entry{key, value, nHash, false});
+        PlaceSlot(nHash, entries.size());
+        return &entries.back();
+    }
+
+    /** Drop all entries and give the buffers back to the pool of this thread. */
+    void Clear() {
+        if (pStorage == nullptr)
+            return;
+
+        CStoragePool &pool = GetPool();
+        if (pStorage->entries.capacity() <= MAX_POOLED_ENTRIES && pool.vStorages.size() < MAX_POOLED_STORAGES) {
+            pStorage->entries.clear();
+            std::fill(pStorage->slots.begin(), pStorage->slots.end(), 0);
+            pool.vStorages.push_back(pStorage);
+        } else {
+            delete pStorage;
+        }
+        pStorage = nullptr;
+    }
+
+private:
+    std::vector<Entry> &GetEntries() const {
+        static std::vector<Entry> emptyEntries;
+        return pStorage == nullptr ? emptyEntries : pStorage->entries;
+    }
+
+    static CStoragePool &GetPool() {
+        static thread_local CStoragePool pool;
+        return pool;
+    }
+
+    static Storage *Acquire() {
+        CStoragePool &pool = GetPool();
+        if (pool.vStorages.empty())
+            return new Storage();
+
+        Storage *pRet = pool.vStorages.back();
+        pool.vStorages.pop_back();
+        return pRet;
+    }
+
+    static uint32_t HashKey(const K &key) {
+        static thread_local std::string buffer;
+        buffer.clear();
+        CStringWriter(buffer, SER_DISK, CLIENT_VERSION) << key;
+        return (uint32_t)std::hash<std::string>()(buffer);
+    }
+
+    Entry *FindSlot(const K &key, uint32_t nHash) const {
+        const std::vector<uint32_t> &slots = pStorage->slots;
+        uint32_t mask                      = slots.size() - 1;
+        for (uint32_t i = nHash & mask; slots[i] != 0; i = (i + 1) & mask) {
+            Entry &entry = pStorage->entries[slots[i] - 1];
+            if (entry.nHash == nHash && !(entry.key < key) && !(key < entry.key))
+                return &entry;
+        }
+        return nullptr;
+    }
+
+    void PlaceSlot(uint32_t nHash, uint32_t nPos) {
+        std::vector<uint32_t> &slots = pStorage->slots;
+        uint32_t mask                = slots.size() - 1;
+        uint32_t i                   = nHash & mask;
+        while (slots[i] != 0)
+            i = (i + 1) & mask;
+        slots[i] = nPos;
+    }
+
+    void Rehash(uint32_t nSlots) {
+        pStorage->slots.assign(nSlots, 0);
+        for (uint32_t i = 0; i < pStorage->entries.size(); i++)
+            PlaceSlot(pStorage->entries[i].nHash, i + 1);
+    }
+};
+
+#endif  // PERSIST_HASHOVERLAY_H
@@ -29,17 +29,43 @@ void ThrowError(const leveldb::Status &status) {
 
 std::string CDBOpLogMap::ToString() const {
     std::string str = "";
-    for (auto itemOpLogs : mapDbOpLogs) {
+    for (const auto &itemOpLogs : mapDbOpLogs) {
         str += strprintf("type:%s {", itemOpLogs.first);
-        for (auto iterDbLog : itemOpLogs.second) {
-            str += iterDbLog.ToString();
-            str += ";";
-        }
+        str += itemOpLogs.second.ToString();
         str += "}";
     }
     return str;
 }
 
+CDBFlushStats dbFlushStats;
+
+std::string CDBFlushStats::Report() {
+    std::string str;
+    for (int32_t i = 0; i < dbk::PREFIX_COUNT; i++) {
+        uint64_t nClean = vCleanPending[i].exchange(0);
+        uint64_t nDirty = vDirtyPending[i].exchange(0);
+        if (nClean > 0 || nDirty > 0)
+            str += strprintf(" %s:%u/%u", dbk::GetKeyPrefix((dbk::PrefixType)i), nClean, nDirty);
+    }
+    return str;
+}
+
+Object CDBFlushStats::ToJson() const {
+    Object obj;
+    for (int32_t i = 0; i < dbk::PREFIX_COUNT; i++) {
+        uint64_t nClean = vClean[i];
+        uint64_t nDirty = vDirty[i];
+        if (nClean == 0 && nDirty == 0)
+            continue;
+
+        Object item;
+        item.push_back(Pair("clean", nClean));
+        item.push_back(Pair("dirty", nDirty));
+        obj.push_back(Pair(dbk::GetKeyPrefix((dbk::PrefixType)i), item));
+    }
+    return obj;
+}
+
 static leveldb::Options GetOptions(size_t nCacheSize) {
     leveldb::Options options;
     options.block_cache       = leveldb::NewLRUCache(nCacheSize / 2);
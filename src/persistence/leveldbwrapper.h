@@ -16,6 +16,9 @@
 #include <boost/filesystem/path.hpp>
 #include <leveldb/db.h>
 #include <leveldb/write_batch.h>
+#include <atomic>
+#include <memory>
+#include <unordered_map>
 
 using namespace json_spirit;
 
@@ -29,38 +32,34 @@ public:
     // for key-value
     template<typename K, typename V>
     void Set(const K& keyIn, const V& valueIn){
+        key.clear();
+        CStringWriter(key, SER_DISK, CLIENT_VERSION) << keyIn;
 
-        CDataStream ssKey(SER_DISK, CLIENT_VERSION);
-        ssKey << keyIn;
-        key = ssKey.str();
-
-        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
-        ssValue << valueIn;
-        value = ssValue.str();
+        value.clear();
+        CStringWriter(value, SER_DISK, CLIENT_VERSION) << valueIn;
     }
 
     // for single value
     template<typename V>
     void Set(const V& valueIn){
-        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
-        ssValue << valueIn;
-        value = ssValue.str();
+        value.clear();
+        CStringWriter(value, SER_DISK, CLIENT_VERSION) << valueIn;
     }
 
     // for key-value
     template<typename K, typename V>
     void Get(K& keyOut, V& valueOut) const {
-        CDataStream ssKey(key, SER_DISK, CLIENT_VERSION);
+        CSpanReader ssKey(key, SER_DISK, CLIENT_VERSION);
         ssKey >> keyOut;
 
-        CDataStream ssValue(value, SER_DISK, CLIENT_VERSION);
+        CSpanReader ssValue(value, SER_DISK, CLIENT_VERSION);
         ssValue >> valueOut;
     }
 
     // for single value
     template<typename V>
     void Get(V& valueOut) const {
-        CDataStream ssValue(value, SER_DISK, CLIENT_VERSION);
+        CSpanReader ssValue(value, SER_DISK, CLIENT_VERSION);
         ssValue >> valueOut;
     }
 
@@ -82,7 +81,161 @@ public:
     }
 };
 
-typedef vector<CDbOpLog> CDbOpLogs;
+/**
+ * Undo logs of one key prefix in a tx: the value of each key the tx writes, as it was before the
+ * first write. Later writes of the key by the same tx need no logs, restoring the first pre-image
+ * undoes them as well. The keys and values are packed in one buffer and serialized like a
+ * vector<CDbOpLog>, so undo data written before is read the same way.
+ */
+class CDbOpLogs {
+private:
+    struct CEntry {
+        uint32_t keyBegin;
+        uint32_t valueBegin;  // end of the key
+        uint32_t valueEnd;
+    };
+
+    string buffer;
+    vector<CEntry> entries;
+    unordered_multimap<uint64_t, uint32_t> keyIndex;  // hash of key -> index of entry
+
+public:
+    // for key-value
+    template<typename K, typename V>
+    void Add(const K &key, const V &value) {
+        uint32_t keyBegin = buffer.size();
+        CStringWriter(buffer, SER_DISK, CLIENT_VERSION) << key;
+        if (!AddKey(keyBegin)) {
+            buffer.resize(keyBegin);
+            return;
+        }
+
+        uint32_t valueBegin = buffer.size();
+        CStringWriter(buffer, SER_DISK, CLIENT_VERSION) << value;
+        entries.push_back({keyBegin, valueBegin, (uint32_t)buffer.size()});
+    }
+
+    // for single value
+    template<typename V>
+    void Add(const V &value) {
+        if (!entries.empty())
+            return;
+
+        CStringWriter(buffer, SER_DISK, CLIENT_VERSION) << value;
+        entries.push_back({0, 0, (uint32_t)buffer.size()});
+    }
+
+    size_t size() const { return entries.size(); }
+
+    // for key-value
+    template<typename K, typename V>
+    void Get(size_t index, K &keyOut, V &valueOut) const {
+        const CEntry &entry = entries[index];
+        CSpanReader ssKey(buffer.data() + entry.keyBegin, buffer.data() + entry.valueBegin, SER_DISK, CLIENT_VERSION);
+        ssKey >> keyOut;
+
+        CSpanReader ssValue(buffer.data() + entry.valueBegin, buffer.data() + entry.valueEnd, SER_DISK, CLIENT_VERSION);
+        ssValue >> valueOut;
+    }
+
+    // for single value
+    template<typename V>
+    void Get(size_t index, V &valueOut) const {
+        const CEntry &entry = entries[index];
+        CSpanReader ssValue(buffer.data() + entry.valueBegin, buffer.data() + entry.valueEnd, SER_DISK, CLIENT_VERSION);
+        ssValue >> valueOut;
+    }
+
+    void Clear() {
+        buffer.clear();
+        entries.clear();
+        keyIndex.clear();
+    }
+
+    unsigned int GetSerializeSize(int nType, int nVersion) const {
+        unsigned int nSize = GetSizeOfCompactSize(entries.size());
+        for (const auto &entry : entries) {
+            nSize += GetSizeOfCompactSize(entry.valueBegin - entry.keyBegin) + entry.valueBegin - entry.keyBegin;
+            nSize += GetSizeOfCompactSize(entry.valueEnd - entry.valueBegin) + entry.valueEnd - entry.valueBegin;
+        }
+        return nSize;
+    }
+
+    template<typename Stream>
+    void Serialize(Stream &s, int nType, int nVersion) const {
+        WriteCompactSize(s, entries.size());
+        for (const auto &entry : entries) {
+            WriteCompactSize(s, entry.valueBegin - entry.keyBegin);
+            s.write(buffer.data() + entry.keyBegin, entry.valueBegin - entry.keyBegin);
+            WriteCompactSize(s, entry.valueEnd - entry.valueBegin);
+            s.write(buffer.data() + entry.valueBegin, entry.valueEnd - entry.valueBegin);
+        }
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream &s, int nType, int nVersion) {
+        Clear();
+        uint64_t count = ReadCompactSize(s);
+        entries.reserve(count);
+        for (uint64_t i = 0; i < count; i++) {
+            CEntry entry;
+            entry.keyBegin   = buffer.size();
+            entry.valueBegin = entry.keyBegin + ReadBytes(s);
+            entry.valueEnd   = entry.valueBegin + ReadBytes(s);
+            // undo data of older versions may log a key more than once, all its entries are kept
+            keyIndex.emplace(HashKey(entry.keyBegin, entry.valueBegin), entries.size());
+            entries.push_back(entry);
+        }
+    }
+
+    string ToString() const {
+        string str;
+        for (const auto &entry : entries) {
+            str += strprintf("key: %s, value: %s;",
+                             HexStr(buffer.begin() + entry.keyBegin, buffer.begin() + entry.valueBegin),
+                             HexStr(buffer.begin() + entry.valueBegin, buffer.begin() + entry.valueEnd));
+        }
+        return str;
+    }
+
+private:
+    /** Index the key serialized at keyBegin to the end of buffer, false if the tx logged it already */
+    bool AddKey(uint32_t keyBegin) {
+        uint32_t keySize = buffer.size() - keyBegin;
+        uint64_t hash    = HashKey(keyBegin, buffer.size());
+        auto range       = keyIndex.equal_range(hash);
+        for (auto it = range.first; it != range.second; it++) {
+            const CEntry &entry = entries[it->second];
+            if (entry.valueBegin - entry.keyBegin == keySize &&
+                buffer.compare(entry.keyBegin, keySize, buffer, keyBegin, keySize) == 0)
+                return false;
+        }
+
+        keyIndex.emplace(hash, entries.size());
+        return true;
+    }
+
+    /** FNV-1a of buffer[begin, end) */
+    uint64_t HashKey(uint32_t begin, uint32_t end) const {
+        uint64_t hash = 14695981039346656037ULL;
+        for (uint32_t i = begin; i < end; i++) {
+            hash ^= (uint8_t)buffer[i];
+            hash *= 1099511628211ULL;
+        }
+        return hash;
+    }
+
+    /** Read a size-prefixed byte string to the end of buffer, return its size */
+    template<typename Stream>
+    uint32_t ReadBytes(Stream &s) {
+        uint64_t size = ReadCompactSize(s);
+        size_t pos    = buffer.size();
+        buffer.resize(pos + size);
+        if (size > 0)
+            s.read(&buffer[pos], size);
+        return size;
+    }
+};
 
 class CDBOpLogMap {
 public:
@@ -96,10 +249,20 @@ public:
         return nullptr;
     }
 
-    void AddOpLog(dbk::PrefixType prefixType, const CDbOpLog& dbOpLogIn) {
+    // for key-value
+    template<typename K, typename V>
+    void AddOpLog(dbk::PrefixType prefixType, const K &key, const V &oldValue) {
+        assert(prefixType != dbk::EMPTY);
+        const string& prefix = dbk::GetKeyPrefix(prefixType);
+        mapDbOpLogs[prefix].Add(key, oldValue);
+    }
+
+    // for single value
+    template<typename V>
+    void AddOpLog(dbk::PrefixType prefixType, const V &oldValue) {
         assert(prefixType != dbk::EMPTY);
         const string& prefix = dbk::GetKeyPrefix(prefixType);
-        mapDbOpLogs[prefix].push_back(dbOpLogIn);
+        mapDbOpLogs[prefix].Add(oldValue);
     }
 
     void Clear() { mapDbOpLogs.clear(); }
@@ -113,6 +276,35 @@ private:
     mutable map<string, CDbOpLogs> mapDbOpLogs; // dbName -> dbOpLogs
 };
 
+/** Cached entries flushed to the database per prefix, clean ones are skipped and only dirty ones written */
+struct CDBFlushStats {
+    std::atomic<uint64_t> vClean[dbk::PREFIX_COUNT];
+    std::atomic<uint64_t> vDirty[dbk::PREFIX_COUNT];
+    // since the last Report()
+    std::atomic<uint64_t> vCleanPending[dbk::PREFIX_COUNT];
+    std::atomic<uint64_t> vDirtyPending[dbk::PREFIX_COUNT];
+
+    CDBFlushStats() {
+        for (int32_t i = 0; i < dbk::PREFIX_COUNT; i++)
+            vClean[i] = vDirty[i] = vCleanPending[i] = vDirtyPending[i] = 0;
+    }
+
+    void Add(dbk::PrefixType prefixType, uint64_t nClean, uint64_t nDirty) {
+        assert(prefixType >= 0 && prefixType < dbk::PREFIX_COUNT);
+        vClean[prefixType] += nClean;
+        vDirty[prefixType] += nDirty;
+        vCleanPending[prefixType] += nClean;
+        vDirtyPending[prefixType] += nDirty;
+    }
+
+    /** Per prefix clean/dirty counts since the last report, empty if nothing was flushed */
+    std::string Report();
+
+    Object ToJson() const;
+};
+
+extern CDBFlushStats dbFlushStats;
+
 class leveldb_error : public runtime_error
 {
 public:
@@ -127,16 +319,14 @@ class CLevelDBBatch {
 
 private:
     leveldb::WriteBatch batch;
+    string valueBuffer;  // reused by the writes of the batch, which copies the values
 
 public:
     template<typename V>
     void Write(const std::string &key, const V& value) {
-    	leveldb::Slice slKey(key);
-        CDataStream ssValue(SER_DISK, CLIENT_VERSION);
-        ssValue.reserve(ssValue.GetSerializeSize(value));
-        ssValue << value;
-        leveldb::Slice slValue(&ssValue[0], ssValue.size());
-        batch.Put(slKey, slValue);
+        valueBuffer.clear();
+        CStringWriter(valueBuffer, SER_DISK, CLIENT_VERSION) << value;
+        batch.Put(leveldb::Slice(key), leveldb::Slice(valueBuffer));
     }
 
     void Erase(const std::string &key) {
@@ -173,11 +363,11 @@ public:
     ~CLevelDBWrapper();
 
     template<typename V>
-    bool Read(std::string key, V &value) {
+    bool Read(std::string key, V &value, const leveldb::Snapshot *pSnapshot = nullptr) {
     	leveldb::Slice slKey(key);
 
         string strValue;
-        leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        leveldb::Status status = pdb->Get(GetReadOptions(readoptions, pSnapshot), slKey, &strValue);
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
@@ -185,7 +375,7 @@ public:
             ThrowError(status);
         }
         try {
-            CDataStream ssValue(strValue.data(), strValue.data() + strValue.size(), SER_DISK, CLIENT_VERSION);
+            CSpanReader ssValue(strValue, SER_DISK, CLIENT_VERSION);
             ssValue >> value;
         } catch(std::exception &e) {
             return false;
@@ -200,10 +390,10 @@ public:
         return WriteBatch(batch, fSync);
     }
 
-    bool Exists(const std::string &key) {
+    bool Exists(const std::string &key, const leveldb::Snapshot *pSnapshot = nullptr) {
     	leveldb::Slice slKey(key);
         string strValue;
-        leveldb::Status status = pdb->Get(readoptions, slKey, &strValue);
+        leveldb::Status status = pdb->Get(GetReadOptions(readoptions, pSnapshot), slKey, &strValue);
         if (!status.ok()) {
             if (status.IsNotFound())
                 return false;
@@ -232,11 +422,39 @@ public:
     }
 
     // not exactly clean encapsulation, but it's easiest for now
-    leveldb::Iterator *NewIterator() {
-        return pdb->NewIterator(iteroptions);
+    leveldb::Iterator *NewIterator(const leveldb::Snapshot *pSnapshot = nullptr) {
+        return pdb->NewIterator(GetReadOptions(iteroptions, pSnapshot));
     }
+
+    /** Reads given this snapshot see the database as it is now, must be released by ReleaseSnapshot(). */
+    const leveldb::Snapshot *GetSnapshot() { return pdb->GetSnapshot(); }
+    void ReleaseSnapshot(const leveldb::Snapshot *pSnapshot) { pdb->ReleaseSnapshot(pSnapshot); }
+
     int64_t GetDbCount();
    // Object ToJsonObj();
+
+private:
+    static leveldb::ReadOptions GetReadOptions(const leveldb::ReadOptions &options, const leveldb::Snapshot *pSnapshot) {
+        leveldb::ReadOptions ret = options;
+        ret.snapshot             = pSnapshot;
+        return ret;
+    }
+};
+
+/** A LevelDB snapshot which keeps its database open and is released with the last reference to it. */
+class CLevelDBSnapshot {
+public:
+    CLevelDBSnapshot(const std::shared_ptr<CLevelDBWrapper> &pDbIn) : pDb(pDbIn), pSnapshot(pDbIn->GetSnapshot()) {}
+    ~CLevelDBSnapshot() { pDb->ReleaseSnapshot(pSnapshot); }
+
+    const leveldb::Snapshot *Get() const { return pSnapshot; }
+
+private:
+    CLevelDBSnapshot(const CLevelDBSnapshot &);
+    CLevelDBSnapshot &operator=(const CLevelDBSnapshot &);
+
+    std::shared_ptr<CLevelDBWrapper> pDb;
+    const leveldb::Snapshot *pSnapshot;
 };
 
 #endif // PERSIST_LEVELDBWRAPPER_H
@@ -0,0 +1,123 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "memcachedb.h"
+
+#include "config/chainparams.h"
+#include "crypto/hash.h"
+#include "persistence/pricefeeddb.h"
+#include "persistence/txdb.h"
+
+#include <openssl/rand.h>
+
+#include <boost/filesystem.hpp>
+
+CMemCacheDB::CMemCacheDB() { pathMemCache = GetDataDir() / "memcaches.dat"; }
+
+bool CMemCacheDB::Write(const uint256 &bestBlockHash, CTxMemCache &txCache, CPricePointMemCache &ppCache) {
+    // Generate random temporary filename
+    unsigned short randv = 0;
+    RAND_bytes((unsigned char *)&randv, sizeof(randv));
+    string tmpfn = strprintf("memcaches.dat.%04x", randv);
+
+    // the tx hash sets are written as vectors
+    map<uint256, vector<uint256> > mapBlockTxHashes;
+    for (const auto &item : txCache.GetTxHashCache())
+        mapBlockTxHashes[item.first].assign(item.second.begin(), item.second.end());
+
+    // serialize the caches after the best block they belong to, then append the checksum
+    CDataStream ssCache(SER_DISK, CLIENT_VERSION);
+    ssCache << FLATDATA(SysCfg().MessageStart());
+    ssCache << bestBlockHash;
+    ssCache << mapBlockTxHashes;
+    ssCache << ppCache;
+    uint256 hash = Hash(ssCache.begin(), ssCache.end());
+    ssCache << hash;
+
+    boost::filesystem::path pathTmp = GetDataDir() / tmpfn;
+    FILE *file                      = fopen(pathTmp.string().c_str(), "wb");
+    CAutoFile fileout               = CAutoFile(file, SER_DISK, CLIENT_VERSION);
+    if (!fileout)
+        return ERRORMSG("%s : Failed to open file %s", __func__, pathTmp.string());
+
+    try {
+        fileout << ssCache;
+    } catch (std::exception &e) {
+        return ERRORMSG("%s : Serialize or I/O error - %s", __func__, e.what());
+    }
+    FileCommit(fileout);
+    fileout.fclose();
+
+    if (!RenameOver(pathTmp, pathMemCache))
+        return ERRORMSG("%s : Rename-into-place failed", __func__);
+
+    return true;
+}
+
+bool CMemCacheDB::Read(const uint256 &bestBlockHash, CTxMemCache &txCache, CPricePointMemCache &ppCache) {
+    if (!boost::filesystem::exists(pathMemCache))
+        return false;
+
+    // read the whole file at once
+    vector<unsigned char> vchData;
+    uint256 hashIn;
+    {
+        FILE *file       = fopen(pathMemCache.string().c_str(), "rb");
+        CAutoFile filein = CAutoFile(file, SER_DISK, CLIENT_VERSION);
+        if (!filein)
+            return ERRORMSG("%s : Failed to open file %s", __func__, pathMemCache.string());
+
+        int64_t dataSize = (int64_t)boost::filesystem::file_size(pathMemCache) - (int64_t)sizeof(uint256);
+        vchData.resize(std::max<int64_t>(dataSize, 0));
+        try {
+            filein.read((char *)vchData.data(), vchData.size());
+            filein >> hashIn;
+        } catch (std::exception &e) {
+            return ERRORMSG("%s : Deserialize or I/O error - %s", __func__, e.what());
+        }
+    }
+
+    // The caches change with every block connected from now on, drop the snapshot so that it
+    // can't be loaded after an unclean shutdown.
+    boost::filesystem::remove(pathMemCache);
+
+    CDataStream ssCache(vchData, SER_DISK, CLIENT_VERSION);
+    if (hashIn != Hash(ssCache.begin(), ssCache.end()))
+        return ERRORMSG("%s : Checksum mismatch, data corrupted", __func__);
+
+    map<uint256, vector<uint256> > mapBlockTxHashes;
+    CPricePointMemCache ppCacheIn;
+    try {
+        unsigned char pchMsgTmp[4];
+        ssCache >> FLATDATA(pchMsgTmp);
+        if (memcmp(pchMsgTmp, SysCfg().MessageStart(), sizeof(pchMsgTmp)))
+            return ERRORMSG("%s : Invalid network magic number", __func__);
+
+        uint256 snapshotBlockHash;
+        ssCache >> snapshotBlockHash;
+        if (snapshotBlockHash != bestBlockHash) {
+            LogPrint("INFO", "%s : snapshot taken at block %s, not at the best block %s\n", __func__,
+                     snapshotBlockHash.GetHex(), bestBlockHash.GetHex());
+            return false;
+        }
+
+        ssCache >> mapBlockTxHashes;
+        ssCache >> ppCacheIn;
+    } catch (std::exception &e) {
+        return ERRORMSG("%s : Deserialize or I/O error - %s", __func__, e.what());
+    }
+
+    map<uint256, UnorderedHashSet> mapBlockTxHashSet;
+    for (const auto &item : mapBlockTxHashes)
+        mapBlockTxHashSet[item.first].insert(item.second.begin(), item.second.end());
+    txCache.SetTxHashCache(mapBlockTxHashSet);
+
+    // the base view pointer brings the median prices of the base, set the loaded ones after the flush
+    map<CoinPricePair, uint64_t> latestBlockMedianPricePoints = ppCacheIn.latestBlockMedianPricePoints;
+    ppCacheIn.SetBaseViewPtr(&ppCache);
+    ppCacheIn.Flush();
+    ppCache.SetLatestBlockMedianPricePoints(latestBlockMedianPricePoints);
+
+    return true;
+}
@@ -0,0 +1,32 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef PERSIST_MEMCACHEDB_H
+#define PERSIST_MEMCACHEDB_H
+
+#include "commons/uint256.h"
+
+#include <boost/filesystem/path.hpp>
+
+class CTxMemCache;
+class CPricePointMemCache;
+
+/**
+ * Snapshot of the tx and price point memory caches (memcaches.dat), written on clean shutdown so that
+ * the next startup loads them in one sequential read instead of rereading the latest blocks.
+ * The snapshot is only valid for the best block it was taken at and is removed once read, so a
+ * node that does not shut down cleanly rebuilds its caches from the blocks.
+ */
+class CMemCacheDB {
+private:
+    boost::filesystem::path pathMemCache;
+
+public:
+    CMemCacheDB();
+    bool Write(const uint256 &bestBlockHash, CTxMemCache &txCache, CPricePointMemCache &ppCache);
+    /** Load the snapshot into the empty caches, fails if it was not taken at bestBlockHash */
+    bool Read(const uint256 &bestBlockHash, CTxMemCache &txCache, CPricePointMemCache &ppCache);
+};
+
+#endif  // PERSIST_MEMCACHEDB_H
@@ -33,6 +33,10 @@ public:
 
 public:
     BlockUserPriceMap mapBlockUserPrices;
+
+    IMPLEMENT_SERIALIZE(
+        READWRITE(mapBlockUserPrices);
+    )
 };
 
 class CPricePointMemCache {
@@ -60,6 +64,12 @@ public:
     void Flush();
     void Reset();
 
+    // for the snapshot written on shutdown
+    IMPLEMENT_SERIALIZE(
+        READWRITE(latestBlockMedianPricePoints);
+        READWRITE(mapCoinPricePointCache);
+    )
+
 private:
     bool ExistBlockUserPrice(const int32_t blockHeight, const CRegID &regId, const CoinPricePair &coinPricePair);
 
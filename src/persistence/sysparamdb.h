@@ -51,5 +51,5 @@ private:
 /*  ----------------   -------------------------   -----------------------  ------------------   ------------------------ */
     /////////// SysParamDB
     // order tx id -> active order
-    CCompositeKVCache< dbk::SYS_PARAM,             string,                 uint64_t >              sysParamCache;
+    CCompositeKVCache< dbk::SYS_PARAM,             string,                 uint64_t, CacheLayout::HASHED> sysParamCache;
 };
\ No newline at end of file
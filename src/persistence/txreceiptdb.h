@@ -44,7 +44,7 @@ private:
 /*  ----------------   -------------------------   -----------------------  ------------------   ------------------------ */
     /////////// SysParamDB
     // txid -> vector<CReceipt>
-    CCompositeKVCache< dbk::TX_RECEIPT,            TxID,                   vector<CReceipt> >     txReceiptCache;
+    CCompositeKVCache< dbk::TX_RECEIPT,            TxID,                   vector<CReceipt>, CacheLayout::HASHED> txReceiptCache;
 };
 
 #endif // PERSIST_RECEIPTDB_H
\ No newline at end of file
@@ -517,12 +517,15 @@ void HTTPEvent::trigger(struct timeval* tv) {
         evtimer_add(ev, tv);  // trigger after timeval passed
 }
 
-HTTPRequest::HTTPRequest(struct evhttp_request* _req) : req(_req), replySent(false) {
+HTTPRequest::HTTPRequest(struct evhttp_request* _req) : req(_req), replySent(false), chunkedReply(false) {
 
 }
 
 HTTPRequest::~HTTPRequest() {
-    if (!replySent) {
+    if (!replySent && chunkedReply) {
+        LogPrint("ERROR", "%s: Unfinished chunked reply\n", __func__);
+        EndChunkedReply();
+    } else if (!replySent) {
         // Keep track of whether reply was sent to avoid request leaks
         LogPrint("ERROR", "%s: Unhandled request\n", __func__);
         WriteReply(HTTP_INTERNAL, "Unhandled request");
@@ -564,6 +567,21 @@ void HTTPRequest::WriteHeader(const std::string& hdr, const std::string& value)
     evhttp_add_header(headers, hdr.c_str(), value.c_str());
 }
 
+/** Re-enable reading from the socket once the reply is out. This is the second
+ * part of the libevent workaround in http_request_cb.
+ */
+static void ReenableReading(struct evhttp_request* req) {
+    if (event_get_version_number() >= 0x02010600 && event_get_version_number() < 0x02020001) {
+        evhttp_connection* conn = evhttp_request_get_connection(req);
+        if (conn) {
+            bufferevent* bev = evhttp_connection_get_bufferevent(conn);
+            if (bev) {
+                bufferevent_enable(bev, EV_READ | EV_WRITE);
+            }
+        }
+    }
+}
+
 /** Closure sent to main thread to request a reply to be sent to
  * a HTTP request.
  * Replies must be sent in the main loop in the main http thread,
@@ -581,17 +599,48 @@ void HTTPRequest::WriteReply(int nStatus, const std::string& strReply) {
     auto req_copy = req;
     HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, nStatus] {
         evhttp_send_reply(req_copy, nStatus, nullptr, nullptr);
-        // Re-enable reading from the socket. This is the second part of the libevent
-        // workaround above.
-        if (event_get_version_number() >= 0x02010600 && event_get_version_number() < 0x02020001) {
-            evhttp_connection* conn = evhttp_request_get_connection(req_copy);
-            if (conn) {
-                bufferevent* bev = evhttp_connection_get_bufferevent(conn);
-                if (bev) {
-                    bufferevent_enable(bev, EV_READ | EV_WRITE);
-                }
-            }
-        }
+        ReenableReading(req_copy);
+    });
+    ev->trigger(nullptr);
+    replySent = true;
+    req       = nullptr;  // transferred back to main thread
+}
+
+/** The chunks are sent by events of the main http thread too, libevent runs
+ * them in the order they are triggered.
+ */
+void HTTPRequest::StartChunkedReply(int nStatus) {
+    assert(!replySent && !chunkedReply && req);
+    if (ShutdownRequested()) {
+        WriteHeader("Connection", "close");
+    }
+    auto req_copy = req;
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, nStatus] {
+        evhttp_send_reply_start(req_copy, nStatus, nullptr);
+    });
+    ev->trigger(nullptr);
+    chunkedReply = true;
+}
+
+void HTTPRequest::WriteReplyChunk(const std::string& strChunk) {
+    assert(!replySent && chunkedReply && req);
+    struct evbuffer* evb = evbuffer_new();
+    assert(evb);
+    evbuffer_add(evb, strChunk.data(), strChunk.size());
+    auto req_copy = req;
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy, evb] {
+        evhttp_send_reply_chunk(req_copy, evb);
+        evbuffer_free(evb);
+    });
+    ev->trigger(nullptr);
+}
+
+void HTTPRequest::EndChunkedReply() {
+    assert(!replySent && chunkedReply && req);
+    auto req_copy = req;
+    HTTPEvent* ev = new HTTPEvent(eventBase, true, [req_copy] {
+        evhttp_send_reply_end(req_copy);
+        ReenableReading(req_copy);
     });
     ev->trigger(nullptr);
     replySent = true;
@@ -59,6 +59,7 @@ class HTTPRequest
 private:
     struct evhttp_request* req;
     bool replySent;
+    bool chunkedReply;
 
 public:
     explicit HTTPRequest(struct evhttp_request* req);
@@ -114,6 +115,26 @@ public:
      * main thread, do not call any other HTTPRequest methods after calling this.
      */
     void WriteReply(int nStatus, const std::string& strReply = "");
+
+    /**
+     * Start a chunked HTTP reply, the body follows with WriteReplyChunk().
+     *
+     * @note Write the headers before calling this. Instead of WriteReply, the
+     * request is given back to the main thread by EndChunkedReply.
+     */
+    void StartChunkedReply(int nStatus);
+
+    /**
+     * Send a part of the body of a chunked reply.
+     *
+     * @note The chunk is queued to libevent right away without waiting for the
+     * client to read it, so a slow client makes the node buffer the whole reply.
+     * Callers holding a lock while writing should keep the reply bounded.
+     */
+    void WriteReplyChunk(const std::string& strChunk);
+
+    /** Finish a chunked reply, do not call any other HTTPRequest methods after this. */
+    void EndChunkedReply();
 };
 
 /** Event handler closure.
@@ -0,0 +1,90 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "jsonstream.h"
+
+#include "commons/json/json_spirit_writer_template.h"
+
+#include <cassert>
+
+CJsonStreamWriter::CJsonStreamWriter(const FlushFunc &flushFuncIn, size_t nFlushSizeIn)
+    : flushFunc(flushFuncIn), nFlushSize(nFlushSizeIn), fAfterKey(false), nWrittenBytes(0) {
+    buffer.reserve(nFlushSize);
+}
+
+void CJsonStreamWriter::BeginObject() {
+    BeginValue();
+    Append("{");
+    vFirstElement.push_back(true);
+}
+
+void CJsonStreamWriter::EndObject() {
+    assert(!vFirstElement.empty() && !fAfterKey);
+    vFirstElement.pop_back();
+    Append("}");
+}
+
+void CJsonStreamWriter::BeginArray() {
+    BeginValue();
+    Append("[");
+    vFirstElement.push_back(true);
+}
+
+void CJsonStreamWriter::EndArray() {
+    assert(!vFirstElement.empty() && !fAfterKey);
+    vFirstElement.pop_back();
+    Append("]");
+}
+
+void CJsonStreamWriter::Key(const std::string &key) {
+    assert(!vFirstElement.empty() && !fAfterKey);
+    BeginValue();
+    Append(json_spirit::write_string(json_spirit::Value(key), false));
+    Append(":");
+    fAfterKey = true;
+}
+
+void CJsonStreamWriter::Write(const json_spirit::Value &value) {
+    BeginValue();
+    Append(json_spirit::write_string(value, false));
+}
+
+void CJsonStreamWriter::WriteRaw(const std::string &text) {
+    Append(text);
+}
+
+void CJsonStreamWriter::Flush() {
+    if (buffer.empty())
+        return;
+
+    flushFunc(buffer);
+    buffer.clear();
+}
+
+std::string CJsonStreamWriter::TakeBuffer() {
+    std::string ret;
+    ret.swap(buffer);
+    return ret;
+}
+
+// write the separator in front of a value, a key is followed by its value without one
+void CJsonStreamWriter::BeginValue() {
+    if (fAfterKey) {
+        fAfterKey = false;
+        return;
+    }
+    if (vFirstElement.empty())
+        return;
+
+    if (!vFirstElement.back())
+        Append(",");
+    vFirstElement.back() = false;
+}
+
+void CJsonStreamWriter::Append(const std::string &text) {
+    buffer += text;
+    nWrittenBytes += text.size();
+    if (buffer.size() >= nFlushSize)
+        Flush();
+}
@@ -0,0 +1,63 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef RPC_CORE_JSONSTREAM_H
+#define RPC_CORE_JSONSTREAM_H
+
+#include "commons/json/json_spirit_value.h"
+
+#include <functional>
+#include <string>
+#include <vector>
+
+/**
+ * Incremental JSON writer. The document is written token by token into a small text buffer which
+ * is handed to the flush function whenever it grows beyond the flush size, so a large RPC result
+ * never exists as a json_spirit tree nor as a single string. Leaf values and small sub trees are
+ * written with json_spirit.
+ */
+class CJsonStreamWriter {
+public:
+    typedef std::function<void(const std::string &)> FlushFunc;
+
+private:
+    FlushFunc flushFunc;
+    size_t nFlushSize;
+    std::string buffer;
+    std::vector<bool> vFirstElement;  // one per open container
+    bool fAfterKey;
+    uint64_t nWrittenBytes;
+
+public:
+    CJsonStreamWriter(const FlushFunc &flushFuncIn, size_t nFlushSizeIn);
+
+    void BeginObject();
+    void EndObject();
+    void BeginArray();
+    void EndArray();
+
+    /** Write the key of the next value of the current object */
+    void Key(const std::string &key);
+    /** Write a value into the current array, or as the value of the last key */
+    void Write(const json_spirit::Value &value);
+    void Pair(const std::string &key, const json_spirit::Value &value) {
+        Key(key);
+        Write(value);
+    }
+    /** Append text as is, e.g. the newline after the document */
+    void WriteRaw(const std::string &text);
+
+    /** Hand the buffered text to the flush function */
+    void Flush();
+    /** Take the buffered text that has not been flushed yet */
+    std::string TakeBuffer();
+
+    uint64_t GetWrittenBytes() const { return nWrittenBytes; }
+
+private:
+    void BeginValue();
+    void Append(const std::string &text);
+};
+
+#endif  // RPC_CORE_JSONSTREAM_H
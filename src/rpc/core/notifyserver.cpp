@@ -0,0 +1,338 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "notifyserver.h"
+
+#include "commons/json/json_spirit_utils.h"
+#include "commons/json/json_spirit_writer_template.h"
+#include "commons/util.h"
+#include "config/configuration.h"
+#include "config/const.h"
+#include "main.h"
+#include "tx/tx.h"
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <thread>
+
+#include <event2/buffer.h>
+#include <event2/bufferevent.h>
+#include <event2/event.h>
+#include <event2/listener.h>
+#include <event2/thread.h>
+#include <event2/util.h>
+
+#ifndef WIN32
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#endif
+
+using namespace json_spirit;
+
+namespace {
+
+/** Max. length of a command line sent by a subscriber */
+static const size_t MAX_NOTIFY_COMMAND_SIZE = 1024;
+
+class CNotifyServer;
+
+struct CSubscriber {
+    CNotifyServer *pServer;
+    struct bufferevent *bev;
+    std::set<std::string> topics;  // empty for all topics
+    uint64_t nDropped;
+};
+
+/**
+ * Publishes the chain events to the subscribers. The validation thread only appends each message
+ * to the output buffers of the subscribers, the event thread writes them to the sockets.
+ */
+class CNotifyServer : public CChainEventListener {
+private:
+    size_t nMaxQueueBytes;
+    struct event_base *base;
+    struct evconnlistener *listener;
+    std::thread thread;
+
+    std::mutex cs;                     // guards subscribers and nSequence
+    std::list<CSubscriber *> subscribers;
+    std::atomic<uint32_t> nSubscribers;
+    uint64_t nSequence;
+
+public:
+    CNotifyServer(size_t nMaxQueueBytesIn)
+        : nMaxQueueBytes(nMaxQueueBytesIn), base(nullptr), listener(nullptr), nSubscribers(0), nSequence(0) {}
+
+    bool Start(uint16_t nPort);
+    void Stop();
+
+protected:
+    void BlockConnected(const CBlock &block, const CBlockIndex *pIndex) override;
+    void BlockDisconnected(const CBlock &block, const CBlockIndex *pIndex) override;
+    void TxAddedToMempool(const uint256 &hash, const CBaseTx *pBaseTx) override;
+    void TxRemovedFromMempool(const uint256 &hash) override;
+
+private:
+    void Publish(const std::string &topic, const Object &data);
+    void RemoveSubscriber(CSubscriber *pSubscriber);
+
+    static void AcceptCallback(struct evconnlistener *listener, evutil_socket_t fd, struct sockaddr *addr,
+                               int socklen, void *arg);
+    static void ReadCallback(struct bufferevent *bev, void *arg);
+    static void EventCallback(struct bufferevent *bev, short events, void *arg);
+};
+
+std::unique_ptr<CNotifyServer> pNotifyServer;
+
+// the events of the txs of a block which integrations keep track of, by tx type
+static const char *GetTxEventTopic(TxType txType) {
+    switch (txType) {
+        case DEX_LIMIT_BUY_ORDER_TX:
+        case DEX_LIMIT_SELL_ORDER_TX:
+        case DEX_MARKET_BUY_ORDER_TX:
+        case DEX_MARKET_SELL_ORDER_TX:  return "dex_order_created";
+        case DEX_CANCEL_ORDER_TX:       return "dex_order_canceled";
+        case DEX_TRADE_SETTLE_TX:       return "dex_trade_settled";
+        case CDP_LIQUIDATE_TX:          return "cdp_liquidated";
+        default:                        return nullptr;
+    }
+}
+
+static Object BlockToNotifyJSON(const CBlock &block, const CBlockIndex *pIndex) {
+    Object obj;
+    obj.push_back(Pair("hash",     pIndex->GetBlockHash().GetHex()));
+    obj.push_back(Pair("height",   pIndex->height));
+    obj.push_back(Pair("time",     (int64_t)block.GetBlockTime()));
+    obj.push_back(Pair("tx_count", (int64_t)block.vptx.size()));
+    return obj;
+}
+
+bool CNotifyServer::Start(uint16_t nPort) {
+#ifdef WIN32
+    evthread_use_windows_threads();
+#else
+    evthread_use_pthreads();
+#endif
+    base = event_base_new();
+    if (!base)
+        return ERRORMSG("CNotifyServer::Start() : failed to create event base");
+
+    // local subscribers only
+    struct sockaddr_in sin;
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family      = AF_INET;
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    sin.sin_port        = htons(nPort);
+    listener = evconnlistener_new_bind(base, AcceptCallback, this, LEV_OPT_CLOSE_ON_FREE | LEV_OPT_REUSEABLE, -1,
+                                       (struct sockaddr *)&sin, sizeof(sin));
+    if (!listener) {
+        event_base_free(base);
+        base = nullptr;
+        return ERRORMSG("CNotifyServer::Start() : failed to bind to 127.0.0.1:%d", nPort);
+    }
+
+    thread = std::thread([this] {
+        RenameThread("coin-notify");
+        event_base_loop(base, EVLOOP_NO_EXIT_ON_EMPTY);
+    });
+    RegisterChainEventListener(this);
+    LogPrint("INFO", "Publishing chain events on 127.0.0.1:%d\n", nPort);
+    return true;
+}
+
+// The caller holds cs_main, which every event is published under, so no Publish() call is still
+// running with the subscribers once the listener is unregistered.
+void CNotifyServer::Stop() {
+    UnregisterChainEventListener(this);
+    if (!base)
+        return;
+
+    event_base_loopbreak(base);
+    if (thread.joinable())
+        thread.join();
+
+    std::list<CSubscriber *> stopped;
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        stopped.swap(subscribers);
+        nSubscribers = 0;
+    }
+    for (auto pSubscriber : stopped) {
+        bufferevent_free(pSubscriber->bev);
+        delete pSubscriber;
+    }
+
+    evconnlistener_free(listener);
+    listener = nullptr;
+    event_base_free(base);
+    base = nullptr;
+}
+
+void CNotifyServer::Publish(const std::string &topic, const Object &data) {
+    std::string strData = write_string(Value(data), false);
+
+    std::lock_guard<std::mutex> lock(cs);
+    std::string strMsg = strprintf("{\"topic\":\"%s\",\"seq\":%d,\"data\":%s}\n", topic, ++nSequence, strData);
+    for (auto pSubscriber : subscribers) {
+        if (!pSubscriber->topics.empty() && !pSubscriber->topics.count(topic))
+            continue;
+
+        // never wait for a slow subscriber, drop its messages until it catches up
+        struct evbuffer *output = bufferevent_get_output(pSubscriber->bev);
+        if (evbuffer_get_length(output) + strMsg.size() > nMaxQueueBytes) {
+            if (pSubscriber->nDropped++ == 0)
+                LogPrint("NOTIFY", "CNotifyServer::Publish() : subscriber queue is full, dropping messages\n");
+            continue;
+        }
+        if (pSubscriber->nDropped > 0) {
+            LogPrint("NOTIFY", "CNotifyServer::Publish() : %d messages dropped for a slow subscriber\n",
+                     pSubscriber->nDropped);
+            pSubscriber->nDropped = 0;
+        }
+        bufferevent_write(pSubscriber->bev, strMsg.data(), strMsg.size());
+    }
+}
+
+void CNotifyServer::BlockConnected(const CBlock &block, const CBlockIndex *pIndex) {
+    if (nSubscribers == 0)
+        return;
+
+    Publish("block_connected", BlockToNotifyJSON(block, pIndex));
+    for (const auto &pTx : block.vptx) {
+        const char *topic = GetTxEventTopic(pTx->nTxType);
+        if (topic == nullptr)
+            continue;
+
+        Object obj;
+        obj.push_back(Pair("txid",       pTx->GetHash().GetHex()));
+        obj.push_back(Pair("tx_type",    GetTxType(pTx->nTxType)));
+        obj.push_back(Pair("height",     pIndex->height));
+        obj.push_back(Pair("block_hash", pIndex->GetBlockHash().GetHex()));
+        Publish(topic, obj);
+    }
+}
+
+// the dex and cdp events of the block are undone with it
+void CNotifyServer::BlockDisconnected(const CBlock &block, const CBlockIndex *pIndex) {
+    if (nSubscribers == 0)
+        return;
+
+    Publish("block_disconnected", BlockToNotifyJSON(block, pIndex));
+}
+
+void CNotifyServer::TxAddedToMempool(const uint256 &hash, const CBaseTx *pBaseTx) {
+    if (nSubscribers == 0)
+        return;
+
+    Object obj;
+    obj.push_back(Pair("txid",    hash.GetHex()));
+    obj.push_back(Pair("tx_type", GetTxType(pBaseTx->nTxType)));
+    Publish("tx_added", obj);
+}
+
+void CNotifyServer::TxRemovedFromMempool(const uint256 &hash) {
+    if (nSubscribers == 0)
+        return;
+
+    Object obj;
+    obj.push_back(Pair("txid", hash.GetHex()));
+    Publish("tx_removed", obj);
+}
+
+void CNotifyServer::RemoveSubscriber(CSubscriber *pSubscriber) {
+    {
+        std::lock_guard<std::mutex> lock(cs);
+        subscribers.remove(pSubscriber);
+        nSubscribers = subscribers.size();
+    }
+    bufferevent_free(pSubscriber->bev);
+    delete pSubscriber;
+}
+
+void CNotifyServer::AcceptCallback(struct evconnlistener *listener, evutil_socket_t fd, struct sockaddr *addr,
+                                   int socklen, void *arg) {
+    CNotifyServer *pServer = static_cast<CNotifyServer *>(arg);
+    if (pServer->nSubscribers >= MAX_NOTIFY_SUBSCRIBERS) {
+        LogPrint("NOTIFY", "CNotifyServer::AcceptCallback() : too many subscribers, connection refused\n");
+        evutil_closesocket(fd);
+        return;
+    }
+
+    // callbacks run without the lock of the bufferevent, Publish() takes cs before that lock
+    struct bufferevent *bev = bufferevent_socket_new(pServer->base, fd,
+        BEV_OPT_CLOSE_ON_FREE | BEV_OPT_THREADSAFE | BEV_OPT_DEFER_CALLBACKS | BEV_OPT_UNLOCK_CALLBACKS);
+    if (!bev) {
+        evutil_closesocket(fd);
+        return;
+    }
+
+    CSubscriber *pSubscriber = new CSubscriber{pServer, bev, {}, 0};
+    bufferevent_setcb(bev, ReadCallback, nullptr, EventCallback, pSubscriber);
+    bufferevent_enable(bev, EV_READ | EV_WRITE);
+
+    std::lock_guard<std::mutex> lock(pServer->cs);
+    pServer->subscribers.push_back(pSubscriber);
+    pServer->nSubscribers = pServer->subscribers.size();
+    LogPrint("NOTIFY", "CNotifyServer::AcceptCallback() : new subscriber, %d connected\n",
+             pServer->subscribers.size());
+}
+
+// handle the "subscribe <topic>" and "unsubscribe <topic>" lines of a subscriber
+void CNotifyServer::ReadCallback(struct bufferevent *bev, void *arg) {
+    CSubscriber *pSubscriber = static_cast<CSubscriber *>(arg);
+    struct evbuffer *input   = bufferevent_get_input(bev);
+
+    size_t len;
+    char *line;
+    while ((line = evbuffer_readln(input, &len, EVBUFFER_EOL_ANY)) != nullptr) {
+        std::string strLine(line, len);
+        free(line);
+
+        std::lock_guard<std::mutex> lock(pSubscriber->pServer->cs);
+        if (strLine.compare(0, 10, "subscribe ") == 0)
+            pSubscriber->topics.insert(strLine.substr(10));
+        else if (strLine.compare(0, 12, "unsubscribe ") == 0)
+            pSubscriber->topics.erase(strLine.substr(12));
+    }
+
+    if (evbuffer_get_length(input) > MAX_NOTIFY_COMMAND_SIZE)
+        pSubscriber->pServer->RemoveSubscriber(pSubscriber);
+}
+
+void CNotifyServer::EventCallback(struct bufferevent *bev, short events, void *arg) {
+    if (events & (BEV_EVENT_EOF | BEV_EVENT_ERROR)) {
+        CSubscriber *pSubscriber = static_cast<CSubscriber *>(arg);
+        pSubscriber->pServer->RemoveSubscriber(pSubscriber);
+    }
+}
+
+}  // namespace
+
+bool StartNotifyServer() {
+    int64_t nPort = SysCfg().GetArg("-notifyport", 0);
+    if (nPort <= 0)
+        return true;
+    if (nPort > 65535)
+        return ERRORMSG("StartNotifyServer() : invalid -notifyport=%d", nPort);
+
+    int64_t nQueueSize = std::max<int64_t>(1, SysCfg().GetArg("-notifyqueuesize", DEFAULT_NOTIFY_QUEUE_SIZE));
+    pNotifyServer.reset(new CNotifyServer(nQueueSize << 20));
+    if (!pNotifyServer->Start(nPort)) {
+        pNotifyServer.reset();
+        return false;
+    }
+    return true;
+}
+
+void StopNotifyServer() {
+    if (!pNotifyServer)
+        return;
+
+    pNotifyServer->Stop();
+    pNotifyServer.reset();
+}
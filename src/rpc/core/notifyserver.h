@@ -0,0 +1,23 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef COIN_NOTIFYSERVER_H
+#define COIN_NOTIFYSERVER_H
+
+/**
+ * Publish chain, mempool and DEX/CDP events to local subscribers.
+ *
+ * A subscriber connects to 127.0.0.1:-notifyport and reads one compact JSON message per line:
+ *     {"topic":"block_connected","seq":42,"data":{...}}
+ * Every subscriber gets all topics until it sends "subscribe <topic>" lines, "unsubscribe <topic>"
+ * removes one again. Messages of a subscriber that does not keep up with its -notifyqueuesize
+ * are dropped, which shows as a gap in seq, so it never blocks the validation.
+ */
+
+/** Start publishing, does nothing if -notifyport is not set */
+bool StartNotifyServer();
+/** Stop publishing and disconnect all subscribers, requires cs_main */
+void StopNotifyServer();
+
+#endif  // COIN_NOTIFYSERVER_H
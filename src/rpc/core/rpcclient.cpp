@@ -133,12 +133,14 @@ Array RPCConvertValues(const string &strMethod, const vector<string> &strParams)
     if (strMethod == "createmulsig"           && n > 0) ConvertTo<int64_t>(params[0]);
     if (strMethod == "createmulsig"           && n > 1) ConvertTo<Array>(params[1]);
     if (strMethod == "signtxraw"              && n > 1) ConvertTo<Array>(params[1]);
+    if (strMethod == "submittxrawbatch"       && n > 0) ConvertTo<Array>(params[0]);
 
     if (strMethod == "getblock"               && n > 1) ConvertTo<bool>(params[1]);
     if (strMethod == "getchaininfo"          && n > 0) ConvertTo<int32_t>(params[0]);
     if (strMethod == "verifychain"            && n > 0) ConvertTo<int64_t>(params[0]);
     if (strMethod == "verifychain"            && n > 1) ConvertTo<int64_t>(params[1]);
     if (strMethod == "getrawmempool"          && n > 0) ConvertTo<bool>(params[0]);
+    if (strMethod == "getrawmempool"          && n > 1) ConvertTo<int64_t>(params[1]);
     if (strMethod == "getnewaddr"             && n > 0) ConvertTo<bool>(params[0]);
 
     if (strMethod == "submitaccountregistertx"      && n > 1) ConvertTo<int64_t>(params[1]);
@@ -162,6 +164,8 @@ Array RPCConvertValues(const string &strMethod, const vector<string> &strParams)
     if (strMethod == "disconnectblock"        && n > 0) ConvertTo<int32_t>(params[0]);
 
     if (strMethod == "listcontracts"          && n > 0) ConvertTo<bool>(params[0]);
+    if (strMethod == "listcontracts"          && n > 1) ConvertTo<int64_t>(params[1]);
+    if (strMethod == "listtxcache"            && n > 0) ConvertTo<int64_t>(params[0]);
     if (strMethod == "getblock"               && n > 0) { if (params[0].get_str().size()<32) ConvertTo<int32_t>(params[0]);}
 
     /****** generate a digitally signed raw transaction for network submission via submittxraw  **********/
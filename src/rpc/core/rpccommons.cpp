@@ -201,13 +201,19 @@ string RegIDToAddress(CUserID &userId) {
 }
 
 bool GetKeyId(const string &addr, CKeyID &keyId) {
-    if (!CRegID::GetKeyId(addr, keyId)) {
-        keyId = CKeyID(addr);
-        if (keyId.IsEmpty())
-            return false;
+    return GetKeyId(*pCdMan->pAccountCache, addr, keyId);
+}
+
+bool GetKeyId(const CAccountDBCache &accountCache, const string &addr, CKeyID &keyId) {
+    CRegID regId(addr);
+    if (!regId.IsEmpty()) {
+        keyId = regId.GetKeyId(accountCache);
+        if (!keyId.IsEmpty())
+            return true;
     }
 
-    return true;
+    keyId = CKeyID(addr);
+    return !keyId.IsEmpty();
 }
 
 Object GetTxDetailJSON(const uint256& txid) {
@@ -219,13 +225,11 @@ Object GetTxDetailJSON(const uint256& txid) {
         if (SysCfg().IsTxIndex()) {
             CDiskTxPos postx;
             if (pCdMan->pBlockCache->ReadTxIndex(txid, postx)) {
-                CAutoFile file(OpenBlockFile(postx, true), SER_DISK, CLIENT_VERSION);
                 CBlockHeader header;
+                if (!ReadTxFromDisk(postx, header, pBaseTx))
+                    throw runtime_error(tfm::format("%s : failed to read tx %s from disk", __func__, txid.GetHex()).c_str());
 
                 try {
-                    file >> header;
-                    fseek(file, postx.nTxOffset, SEEK_CUR);
-                    file >> pBaseTx;
                     obj = pBaseTx->ToJson(*pCdMan->pAccountCache);
 
                     obj.push_back(Pair("confirmations",     chainActive.Height() - (int32_t)header.GetHeight()));
@@ -525,6 +529,14 @@ CAccount RPC_PARAM::GetUserAccount(CAccountDBCache &accountCache, const CUserID
     return account;
 }
 
+std::shared_ptr<const CChainSnapshot> RPC_PARAM::GetChainSnapshot() {
+    std::shared_ptr<const CChainSnapshot> pSnapshot = ::GetChainSnapshot();
+    if (!pSnapshot)
+        throw JSONRPCError(RPC_CLIENT_IN_INITIAL_DOWNLOAD, "The chain state is not loaded yet");
+
+    return pSnapshot;
+}
+
 TokenSymbol RPC_PARAM::GetOrderCoinSymbol(const Value &jsonValue) {
     return jsonValue.get_str();
 }
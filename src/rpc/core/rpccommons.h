@@ -14,6 +14,7 @@
 #include "entities/asset.h"
 #include "entities/account.h"
 #include "tx/tx.h"
+#include "persistence/chainsnapshot.h"
 #include "persistence/dexdb.h"
 
 using namespace std;
@@ -21,6 +22,8 @@ using namespace json_spirit;
 
 string RegIDToAddress(CUserID &userId);
 bool GetKeyId(const string &addr, CKeyID &keyId);
+/** Resolve an address or regid through the given account cache, e.g. the one of a chain snapshot */
+bool GetKeyId(const CAccountDBCache &accountCache, const string &addr, CKeyID &keyId);
 Object GetTxDetailJSON(const uint256& txid);
 Array GetTxAddressDetail(std::shared_ptr<CBaseTx> pBaseTx);
 
@@ -51,6 +54,9 @@ namespace RPC_PARAM {
 
     CAccount GetUserAccount(CAccountDBCache &accountCache, const CUserID &userId);
 
+    // latest chain snapshot, for RPCs which don't hold cs_main
+    std::shared_ptr<const CChainSnapshot> GetChainSnapshot();
+
     // will throw error it check failed
     TokenSymbol GetOrderCoinSymbol(const Value &jsonValue);
     TokenSymbol GetOrderAssetSymbol(const Value &jsonValue);
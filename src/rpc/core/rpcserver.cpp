@@ -221,136 +221,138 @@ Value stop(const Array& params, bool fHelp) {
 //
 
 static const CRPCCommand vRPCCommands[] =
-{ //  name                      actor (function)         okSafeMode threadSafe reqWallet
-  //  ------------------------  -----------------------  ---------- ---------- ---------
+{ //  name                      actor (function)         okSafeMode threadSafe reqWallet streamActor
+  //  ------------------------  -----------------------  ---------- ---------- --------- ----------------------
     /* Overall control/query calls */
-    { "help",                   &help,                   true,      true,       false },
-    { "getinfo",                &getinfo,                true,      false,      false }, /* uses wallet if enabled */
-    { "stop",                   &stop,                   true,      true,       false },
-    { "validateaddr",           &validateaddr,           true,      true,       false },
-    { "createmulsig",           &createmulsig,           true,      true ,      false },
+    { "help",                   &help,                   true,      true,       false, nullptr },
+    { "getinfo",                &getinfo,                true,      false,      false, nullptr }, /* uses wallet if enabled */
+    { "stop",                   &stop,                   true,      true,       false, nullptr },
+    { "validateaddr",           &validateaddr,           true,      true,       false, nullptr },
+    { "createmulsig",           &createmulsig,           true,      true ,      false, nullptr },
 
     /* P2P networking */
-    { "getnetworkinfo",         &getnetworkinfo,         true,      false,      false },
-    { "addnode",                &addnode,                true,      true,       false },
-    { "getaddednodeinfo",       &getaddednodeinfo,       true,      true,       false },
-    { "getconnectioncount",     &getconnectioncount,     true,      false,      false },
-    { "getnettotals",           &getnettotals,           true,      true,       false },
-    { "getpeerinfo",            &getpeerinfo,            true,      false,      false },
-    { "ping",                   &ping,                   true,      false,      false },
-    { "getchaininfo",          &getchaininfo,          false,     false,      false },
+    { "getnetworkinfo",         &getnetworkinfo,         true,      false,      false, nullptr },
+    { "addnode",                &addnode,                true,      true,       false, nullptr },
+    { "getaddednodeinfo",       &getaddednodeinfo,       true,      true,       false, nullptr },
+    { "getconnectioncount",     &getconnectioncount,     true,      false,      false, nullptr },
+    { "getnettotals",           &getnettotals,           true,      true,       false, nullptr },
+    { "getpeerinfo",            &getpeerinfo,            true,      false,      false, nullptr },
+    { "ping",                   &ping,                   true,      false,      false, nullptr },
+    { "getchaininfo",          &getchaininfo,          false,     false,      false, nullptr },
 
     /* Block chain and UTXO */
-    { "getfcoingenesistxinfo",  &getfcoingenesistxinfo,  true,      true,       false },
-    { "getblockcount",          &getblockcount,          true,      true,       false },
-    { "getblock",               &getblock,               false,     false,      false },
-    { "getrawmempool",          &getrawmempool,          true,      false,      false },
-    { "verifychain",            &verifychain,            true,      false,      false },
+    { "getfcoingenesistxinfo",  &getfcoingenesistxinfo,  true,      true,       false, nullptr },
+    { "getblockcount",          &getblockcount,          true,      true,       false, nullptr },
+    { "getblock",               &getblock,               false,     true,       false, nullptr },
+    { "getaddresstxids",        &getaddresstxids,        true,      true,       false, nullptr },
+    { "getrawmempool",          &StreamedRPC<&getrawmempool>, true,      false,      false, &getrawmempool },
+    { "verifychain",            &verifychain,            true,      false,      false, nullptr },
 
-    { "gettotalcoins",          &gettotalcoins,          false,     false,      false },
-    { "invalidateblock",        &invalidateblock,        true,      true,       false },
-    { "reconsiderblock",        &reconsiderblock,        true,      true,       false },
+    { "gettotalcoins",          &gettotalcoins,          false,     false,      false, nullptr },
+    { "invalidateblock",        &invalidateblock,        true,      true,       false, nullptr },
+    { "reconsiderblock",        &reconsiderblock,        true,      true,       false, nullptr },
 
     /* Mining */
-    { "getmininginfo",          &getmininginfo,          true,      false,      false },
-    { "submitblock",            &submitblock,            true,      false,      false },
-    { "getminedblocks",         &getminedblocks,         true,      true,       false },
+    { "getmininginfo",          &getmininginfo,          true,      false,      false, nullptr },
+    { "submitblock",            &submitblock,            true,      false,      false, nullptr },
+    { "getminedblocks",         &getminedblocks,         true,      true,       false, nullptr },
 
     /* Raw transactions */
-    { "genmulsigtx",            &genmulsigtx,            false,     false,     false },
+    { "genmulsigtx",            &genmulsigtx,            false,     false,     false, nullptr },
 
     /* uses wallet if enabled */
-    { "addmulsigaddr",          &addmulsigaddr,          false,     false,      true },
-    { "backupwallet",           &backupwallet,           true,      false,      true },
-    { "dumpprivkey",            &dumpprivkey,            true,      false,      true },
-    { "dumpwallet",             &dumpwallet,             true,      false,      true },
-    { "encryptwallet",          &encryptwallet,          false,     false,      true },
-    { "getaccountinfo",         &getaccountinfo,         true,      false,      true },
-    { "getnewaddr",             &getnewaddr,             true,      false,      true },
-    { "gettxdetail",            &gettxdetail,            true,      false,      true },
-    { "getwalletinfo",          &getwalletinfo,          true,      false,      true },
-    { "importprivkey",          &importprivkey,          false,     false,      true },
-    { "dropminerkeys",          &dropminerkeys,          false,     false,      true },
-    { "dropprivkey",            &dropprivkey,            false,     false,      true },
-
-    { "importwallet",           &importwallet,           false,     false,      true },
-    { "listaddr",               &listaddr,               true,      false,      true },
-    { "listtx",                 &listtx,                 true,      false,      true },
-
-    { "walletlock",             &walletlock,             true,      false,      true },
-    { "walletpassphrasechange", &walletpassphrasechange, false,     false,      true },
-    { "walletpassphrase",       &walletpassphrase,       true,      false,      true },
-    { "setgenerate",            &setgenerate,            true,      true,       false},
-    { "listcontracts",          &listcontracts,          true,      false,      true },
-    { "getcontractinfo",        &getcontractinfo,        true,      false,      true },
-    { "listtxcache",            &listtxcache,            true,      false,      true },
-    { "getcontractdata",        &getcontractdata,        true,      false,      true },
-    { "signmessage",            &signmessage,            false,     false,      true },
-    { "verifymessage",          &verifymessage,          false,     false,      false },
-    { "getcoinunitinfo",        &getcoinunitinfo,        false,     false,      false},
-    { "getcontractassets",      &getcontractassets,      false,     false,      true },
-    { "listcontractassets",     &listcontractassets,     false,     false,      true },
-
-    { "signtxraw",              &signtxraw,              true,      false,      true },
-    { "getcontractaccountinfo", &getcontractaccountinfo, true,      false,      true },
-    { "getsignature",           &getsignature,           true,      false,      true },
-    { "listdelegates",          &listdelegates,          true,      false,      true },
-    { "decodetxraw",            &decodetxraw,            false,     false,      false},
-    { "decodemulsigscript",     &decodemulsigscript,     false,     false,      false },
+    { "addmulsigaddr",          &addmulsigaddr,          false,     false,      true, nullptr },
+    { "backupwallet",           &backupwallet,           true,      false,      true, nullptr },
+    { "dumpprivkey",            &dumpprivkey,            true,      false,      true, nullptr },
+    { "dumpwallet",             &dumpwallet,             true,      false,      true, nullptr },
+    { "encryptwallet",          &encryptwallet,          false,     false,      true, nullptr },
+    { "getaccountinfo",         &getaccountinfo,         true,      true,       false, nullptr }, /* uses wallet if enabled */
+    { "getnewaddr",             &getnewaddr,             true,      false,      true, nullptr },
+    { "gettxdetail",            &gettxdetail,            true,      false,      true, nullptr },
+    { "getwalletinfo",          &getwalletinfo,          true,      false,      true, nullptr },
+    { "importprivkey",          &importprivkey,          false,     false,      true, nullptr },
+    { "dropminerkeys",          &dropminerkeys,          false,     false,      true, nullptr },
+    { "dropprivkey",            &dropprivkey,            false,     false,      true, nullptr },
+
+    { "importwallet",           &importwallet,           false,     false,      true, nullptr },
+    { "listaddr",               &listaddr,               true,      false,      true, nullptr },
+    { "listtx",                 &listtx,                 true,      false,      true, nullptr },
+
+    { "walletlock",             &walletlock,             true,      false,      true, nullptr },
+    { "walletpassphrasechange", &walletpassphrasechange, false,     false,      true, nullptr },
+    { "walletpassphrase",       &walletpassphrase,       true,      false,      true, nullptr },
+    { "setgenerate",            &setgenerate,            true,      true,       false, nullptr},
+    { "listcontracts",          &StreamedRPC<&listcontracts>, true,      false,      true, &listcontracts },
+    { "getcontractinfo",        &getcontractinfo,        true,      false,      true, nullptr },
+    { "listtxcache",            &StreamedRPC<&listtxcache>, true,      false,      true, &listtxcache },
+    { "getcontractdata",        &getcontractdata,        true,      true,       true, nullptr },
+    { "signmessage",            &signmessage,            false,     false,      true, nullptr },
+    { "verifymessage",          &verifymessage,          false,     false,      false, nullptr },
+    { "getcoinunitinfo",        &getcoinunitinfo,        false,     false,      false, nullptr},
+    { "getcontractassets",      &getcontractassets,      false,     false,      true, nullptr },
+    { "listcontractassets",     &listcontractassets,     false,     false,      true, nullptr },
+
+    { "signtxraw",              &signtxraw,              true,      false,      true, nullptr },
+    { "getcontractaccountinfo", &getcontractaccountinfo, true,      false,      true, nullptr },
+    { "getsignature",           &getsignature,           true,      false,      true, nullptr },
+    { "listdelegates",          &listdelegates,          true,      false,      true, nullptr },
+    { "decodetxraw",            &decodetxraw,            false,     false,      false, nullptr},
+    { "decodemulsigscript",     &decodemulsigscript,     false,     false,      false, nullptr },
 
     /* submit raw tx */
-    { "submittxraw",            &submittxraw,              true,      false,    false},
+    { "submittxraw",            &submittxraw,              true,      false,    false, nullptr},
+    { "submittxrawbatch",       &submittxrawbatch,         true,      true,     false, nullptr},
 
     /* basic tx */
-    { "submitsendtx",           &submitsendtx,           false,     false,      true },
-    { "submitaccountregistertx",&submitaccountregistertx,false,     false,      true },
-    { "submitcontractdeploytx", &submitcontractdeploytx, false,     false,      true },
-    { "submitcontractcalltx",   &submitcontractcalltx,   false,     false,      true },
-    { "submitdelegatevotetx",   &submitdelegatevotetx,   false,     false,      true },
-    { "submituniversalcontractdeploytx", &submituniversalcontractdeploytx, false,     false,      true },
-    { "submituniversalcontractcalltx",   &submituniversalcontractcalltx,   false,     false,      true },
+    { "submitsendtx",           &submitsendtx,           false,     false,      true, nullptr },
+    { "submitaccountregistertx",&submitaccountregistertx,false,     false,      true, nullptr },
+    { "submitcontractdeploytx", &submitcontractdeploytx, false,     false,      true, nullptr },
+    { "submitcontractcalltx",   &submitcontractcalltx,   false,     false,      true, nullptr },
+    { "submitdelegatevotetx",   &submitdelegatevotetx,   false,     false,      true, nullptr },
+    { "submituniversalcontractdeploytx", &submituniversalcontractdeploytx, false,     false,      true, nullptr },
+    { "submituniversalcontractcalltx",   &submituniversalcontractcalltx,   false,     false,      true, nullptr },
 
     /* for CDP */
-    { "submitpricefeedtx",      &submitpricefeedtx,      true,      false,      true },
-    { "submitcoinstaketx",      &submitcoinstaketx,      true,      false,      true },
-    { "submitcdpstaketx",       &submitcdpstaketx,       true,      false,      true },
-    { "submitcdpredeemtx",      &submitcdpredeemtx,      true,      false,      true },
-    { "submitcdpliquidatetx",   &submitcdpliquidatetx,   true,      false,      true },
+    { "submitpricefeedtx",      &submitpricefeedtx,      true,      false,      true, nullptr },
+    { "submitcoinstaketx",      &submitcoinstaketx,      true,      false,      true, nullptr },
+    { "submitcdpstaketx",       &submitcdpstaketx,       true,      false,      true, nullptr },
+    { "submitcdpredeemtx",      &submitcdpredeemtx,      true,      false,      true, nullptr },
+    { "submitcdpliquidatetx",   &submitcdpliquidatetx,   true,      false,      true, nullptr },
 
-    { "getscoininfo",           &getscoininfo,          false,     false,      false },
-    { "getcdp",                 &getcdp,                false,     false,      false },
-    { "getusercdp",             &getusercdp,            false,     false,      false },
+    { "getscoininfo",           &getscoininfo,          false,     false,      false, nullptr },
+    { "getcdp",                 &getcdp,                false,     true,       false, nullptr },
+    { "getusercdp",             &getusercdp,            false,     false,      false, nullptr },
 
     /* for dex */
-    { "submitdexbuylimitordertx",   &submitdexbuylimitordertx,   true,     false,      false },
-    { "submitdexselllimitordertx",  &submitdexselllimitordertx,  true,     false,      false },
-    { "submitdexbuymarketordertx",  &submitdexbuymarketordertx,  true,     false,      false },
-    { "submitdexsellmarketordertx", &submitdexsellmarketordertx, true,     false,      false },
-    { "submitdexsettletx",          &submitdexsettletx,          true,     false,      false },
-    { "submitdexcancelordertx",     &submitdexcancelordertx,     true,     false,      false },
+    { "submitdexbuylimitordertx",   &submitdexbuylimitordertx,   true,     false,      false, nullptr },
+    { "submitdexselllimitordertx",  &submitdexselllimitordertx,  true,     false,      false, nullptr },
+    { "submitdexbuymarketordertx",  &submitdexbuymarketordertx,  true,     false,      false, nullptr },
+    { "submitdexsellmarketordertx", &submitdexsellmarketordertx, true,     false,      false, nullptr },
+    { "submitdexsettletx",          &submitdexsettletx,          true,     false,      false, nullptr },
+    { "submitdexcancelordertx",     &submitdexcancelordertx,     true,     false,      false, nullptr },
 
-    { "getdexorder",                &getdexorder,                true,     false,      false },
-    { "getdexsysorders",            &getdexsysorders,            true,     false,      false },
-    { "getdexorders",               &getdexorders,               true,     false,      false },
+    { "getdexorder",                &getdexorder,                true,     false,      false, nullptr },
+    { "getdexsysorders",            &getdexsysorders,            true,     false,      false, nullptr },
+    { "getdexorders",               &getdexorders,               true,     true,       false, nullptr },
 
     /* for asset */
-    { "submitassetissuetx",         &submitassetissuetx,         true,     false,      false },
-    { "submitassetupdatetx",        &submitassetupdatetx,        true,     false,      false },
-    { "getasset",                   &getasset,                   true,     false,      false },
-    { "getassets",                  &getassets,                  true,     false,      false },
+    { "submitassetissuetx",         &submitassetissuetx,         true,     false,      false, nullptr },
+    { "submitassetupdatetx",        &submitassetupdatetx,        true,     false,      false, nullptr },
+    { "getasset",                   &getasset,                   true,     false,      false, nullptr },
+    { "getassets",                  &getassets,                  true,     false,      false, nullptr },
 
     /* for test code */
-    { "disconnectblock",        &disconnectblock,        true,      false,      true },
-    { "reloadtxcache",          &reloadtxcache,          true,      false,      true },
-    { "getcontractregid",       &getcontractregid,       true,      false,      false},
-    { "saveblocktofile",        &saveblocktofile,        true,      false,      true },
-    { "gethash",                &gethash,                true,      false,      true },
-    { "startcommontpstest",     &startcommontpstest,     true,      true,       false},
-    { "startcontracttpstest",   &startcontracttpstest,   true,      true,       false},
-    { "getblockfailures",       &getblockfailures,       false,     false,      false},
+    { "disconnectblock",        &disconnectblock,        true,      false,      true, nullptr },
+    { "reloadtxcache",          &reloadtxcache,          true,      false,      true, nullptr },
+    { "getcontractregid",       &getcontractregid,       true,      false,      false, nullptr},
+    { "saveblocktofile",        &saveblocktofile,        true,      false,      true, nullptr },
+    { "gethash",                &gethash,                true,      false,      true, nullptr },
+    { "startcommontpstest",     &startcommontpstest,     true,      true,       false, nullptr},
+    { "startcontracttpstest",   &startcontracttpstest,   true,      true,       false, nullptr},
+    { "getblockfailures",       &getblockfailures,       false,     false,      false, nullptr},
 
     /* vm functions work in vm simulator */
-    { "vmexecutescript",        &vmexecutescript,        true,      true,       true},
+    { "vmexecutescript",        &vmexecutescript,        true,      true,       true, nullptr},
 };
 
 CRPCTable::CRPCTable() {
@@ -556,8 +558,7 @@ string JSONRPCExecBatch(const Array& vReq) {
     return write_string(Value(ret), false) + "\n";
 }
 
-json_spirit::Value CRPCTable::execute(const string& strMethod,
-                                      const json_spirit::Array& params) const {
+const CRPCCommand* CRPCTable::GetCommand(const string& strMethod) const {
     // Find method
     const CRPCCommand* pcmd = tableRPC[strMethod];
     if (!pcmd) throw JSONRPCError(RPC_METHOD_NOT_FOUND, "Method not found");
@@ -570,6 +571,13 @@ json_spirit::Value CRPCTable::execute(const string& strMethod,
     if (strWarning != "" && !SysCfg().GetBoolArg("-disablesafemode", false) && !pcmd->okSafeMode)
         throw JSONRPCError(RPC_FORBIDDEN_BY_SAFE_MODE, string("Safe mode: ") + strWarning);
 
+    return pcmd;
+}
+
+json_spirit::Value CRPCTable::execute(const string& strMethod,
+                                      const json_spirit::Array& params) const {
+    const CRPCCommand* pcmd = GetCommand(strMethod);
+
     try {
         // Execute
         Value result;
@@ -591,6 +599,28 @@ json_spirit::Value CRPCTable::execute(const string& strMethod,
     }
 }
 
+bool CRPCTable::executeStream(const string& strMethod, const json_spirit::Array& params,
+                              CJsonStreamWriter& writer) const {
+    const CRPCCommand* pcmd = GetCommand(strMethod);
+    if (pcmd->streamActor == nullptr)
+        return false;
+
+    try {
+        if (pcmd->threadSafe)
+            pcmd->streamActor(params, false, writer);
+        else if (!pWalletMain) {
+            LOCK(cs_main);
+            pcmd->streamActor(params, false, writer);
+        } else {
+            LOCK2(cs_main, pWalletMain->cs_wallet);
+            pcmd->streamActor(params, false, writer);
+        }
+        return true;
+    } catch (std::exception& e) {
+        throw JSONRPCError(RPC_MISC_ERROR, e.what());
+    }
+}
+
 string HelpExampleCli(string methodname, string args) {
     return "> ./coind " + methodname + " " + args + "\n";
 }
@@ -604,6 +634,56 @@ string HelpExampleRpc(string methodname, string args) {
 
 const CRPCTable tableRPC;
 
+/**
+ * Reply to a single request of a method with a stream actor. The reply goes out in chunks as the
+ * result is written, a result smaller than one chunk is sent as a plain reply. Errors raised
+ * before the first chunk are thrown to the caller, later ones can only cut the reply short.
+ * @returns false if the method has no stream actor.
+ */
+static bool StreamJSONRPCReply(HTTPRequest* req, const JSONRequest& jreq) {
+    const CRPCCommand* pcmd = tableRPC[jreq.strMethod];
+    if (!pcmd || pcmd->streamActor == nullptr)
+        return false;
+
+    bool fStarted = false;
+    auto flushFunc = [req, &fStarted](const string& chunk) {
+        if (!fStarted) {
+            req->WriteHeader("Content-Type", "application/json");
+            req->StartChunkedReply(HTTP_OK);
+            fStarted = true;
+        }
+        req->WriteReplyChunk(chunk);
+    };
+    CJsonStreamWriter writer(flushFunc, RPC_STREAM_CHUNK_SIZE);
+
+    try {
+        writer.BeginObject();
+        writer.Key("result");
+        tableRPC.executeStream(jreq.strMethod, jreq.params, writer);
+        writer.Pair("error", Value::null);
+        writer.Pair("id", jreq.id);
+        writer.EndObject();
+        writer.WriteRaw("\n");
+    } catch (...) {
+        if (!fStarted)
+            throw;
+
+        LogPrint("ERROR", "StreamJSONRPCReply() : %s failed after %u bytes were sent\n", jreq.strMethod,
+                 writer.GetWrittenBytes());
+        req->EndChunkedReply();
+        return true;
+    }
+
+    if (fStarted) {
+        writer.Flush();
+        req->EndChunkedReply();
+    } else {
+        req->WriteHeader("Content-Type", "application/json");
+        req->WriteReply(HTTP_OK, writer.TakeBuffer());
+    }
+    return true;
+}
+
 /** json rpc handler registered to http server */
 static bool JsonRPCHandler(HTTPRequest* req, const std::string&) {
     // JSONRPC handles only POST or GET
@@ -649,6 +729,9 @@ static bool JsonRPCHandler(HTTPRequest* req, const std::string&) {
         if (valRequest.type() == obj_type) {
             jreq.parse(valRequest);
 
+            if (StreamJSONRPCReply(req, jreq))
+                return true;
+
             Value result = tableRPC.execute(jreq.strMethod, jreq.params);
 
             // Send reply
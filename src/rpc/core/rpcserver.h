@@ -7,7 +7,9 @@
 #define _COINRPC_SERVER_H_
 
 #include "rpcprotocol.h"
+#include "jsonstream.h"
 #include "commons/uint256.h"
+#include "config/const.h"
 
 #include <stdint.h>
 #include <list>
@@ -52,6 +54,8 @@ void RPCTypeCheck(const json_spirit::Object& o,
 void RPCRunLater(const std::string& name, std::function<void()> func, int64_t nSeconds);
 
 typedef json_spirit::Value (*rpcfn_type)(const json_spirit::Array& params, bool fHelp);
+/** An RPC writing its result into a stream instead of returning it */
+typedef void (*rpcstreamfn_type)(const json_spirit::Array& params, bool fHelp, CJsonStreamWriter& writer);
 
 class CRPCCommand {
 public:
@@ -60,8 +64,26 @@ public:
     bool okSafeMode;
     bool threadSafe;
     bool reqWallet;
+    rpcstreamfn_type streamActor;  // optional, used for single requests over http
 };
 
+/**
+ * Run a streaming RPC as a plain one, used by help and batch requests.
+ * The streamed result is parsed back into a json_spirit value.
+ */
+template<rpcstreamfn_type STREAM_ACTOR>
+json_spirit::Value StreamedRPC(const json_spirit::Array& params, bool fHelp) {
+    string strResult;
+    CJsonStreamWriter writer([&strResult](const string& chunk) { strResult += chunk; }, RPC_STREAM_CHUNK_SIZE);
+    STREAM_ACTOR(params, fHelp, writer);
+    writer.Flush();
+
+    json_spirit::Value result;
+    if (!json_spirit::read_string(strResult, result))
+        throw JSONRPCError(RPC_INTERNAL_ERROR, "Invalid streamed result");
+    return result;
+}
+
 /**
  * Coin RPC command dispatcher.
  */
@@ -82,6 +104,16 @@ public:
      * @throws an exception (json_spirit::Value) when an error happens.
      */
     json_spirit::Value execute(const string& method, const json_spirit::Array& params) const;
+
+    /**
+     * Execute a method having a stream actor, writing the result into writer.
+     * @returns false if the method has no stream actor.
+     * @throws an exception (json_spirit::Value) when an error happens.
+     */
+    bool executeStream(const string& method, const json_spirit::Array& params, CJsonStreamWriter& writer) const;
+
+private:
+    const CRPCCommand* GetCommand(const string& method) const;
 };
 
 extern const CRPCTable tableRPC;
@@ -150,6 +182,7 @@ extern json_spirit::Value submitsendtx(const json_spirit::Array& params, bool fH
 extern json_spirit::Value genmulsigtx(const json_spirit::Array& params, bool fHelp);
 
 extern json_spirit::Value submittxraw(const json_spirit::Array& params, bool fHelp);
+extern json_spirit::Value submittxrawbatch(const json_spirit::Array& params, bool fHelp);
 
 extern json_spirit::Value signtxraw(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value decodetxraw(const json_spirit::Array& params, bool fHelp);
@@ -158,7 +191,7 @@ extern json_spirit::Value decodemulsigscript(const json_spirit::Array& params, b
 extern json_spirit::Value getfcoingenesistxinfo(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getblockcount(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getdifficulty(const json_spirit::Array& params, bool fHelp);
-extern json_spirit::Value getrawmempool(const json_spirit::Array& params, bool fHelp);
+extern void getrawmempool(const json_spirit::Array& params, bool fHelp, CJsonStreamWriter& writer);
 extern json_spirit::Value getblock(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value verifychain(const json_spirit::Array& params, bool fHelp);
 extern json_spirit::Value getcontractregid(const json_spirit::Array& params, bool fHelp);
@@ -13,6 +13,7 @@
 #include "init.h"
 #include "commons/json/json_spirit_value.h"
 #include "main.h"
+#include "rpc/core/rpccommons.h"
 #include "rpc/core/rpcserver.h"
 #include "sync.h"
 #include "tx/merkletx.h"
@@ -24,12 +25,11 @@ using namespace std;
 
 class CBaseCoinTransferTx;
 
-Object BlockToJSON(const CBlock& block, const CBlockIndex* pBlockIndex) {
+Object BlockToJSON(const CBlock& block, const CBlockIndex* pBlockIndex, const CChainSnapshot& snapshot) {
     Object result;
     result.push_back(Pair("block_hash",     block.GetHash().GetHex()));
-    CMerkleTx txGen(block.vptx[0]);
-    txGen.SetMerkleBranch(&block);
-    result.push_back(Pair("confirmations",  (int32_t)txGen.GetDepthInMainChain()));
+    int32_t confirmations = snapshot.Contains(pBlockIndex) ? snapshot.Height() - pBlockIndex->height + 1 : -1;
+    result.push_back(Pair("confirmations",  confirmations));
     result.push_back(Pair("size",           (int32_t)::GetSerializeSize(block, SER_NETWORK, PROTOCOL_VERSION)));
     result.push_back(Pair("height",         (int32_t)block.GetHeight()));
     result.push_back(Pair("version",        block.GetVersion()));
@@ -44,7 +44,7 @@ Object BlockToJSON(const CBlock& block, const CBlockIndex* pBlockIndex) {
 
     if (pBlockIndex->pprev)
         result.push_back(Pair("previous_block_hash", pBlockIndex->pprev->GetBlockHash().GetHex()));
-    CBlockIndex* pNext = chainActive.Next(pBlockIndex);
+    CBlockIndex* pNext = snapshot.Next(pBlockIndex);
     if (pNext)
         result.push_back(Pair("next_block_hash", pNext->GetBlockHash().GetHex()));
 
@@ -104,15 +104,16 @@ Value getfcoingenesistxinfo(const Array& params, bool fHelp) {
     return output;
 }
 
-Value getrawmempool(const Array& params, bool fHelp)
-{
-    if (fHelp || params.size() > 1)
+void getrawmempool(const Array& params, bool fHelp, CJsonStreamWriter& writer) {
+    if (fHelp || params.size() > 3)
         throw runtime_error(
-            "getrawmempool ( verbose )\n"
+            "getrawmempool ( verbose max_count \"last_txid\" )\n"
             "\nReturns all transaction ids in memory pool as a json or an array of string transaction ids.\n"
             "\nArguments:\n"
             "1. verbose           (boolean, optional, default=false) true for a json object, false for array of "
             "transaction ids\n"
+            "2. max_count         (numeric, optional, default=0) the max transaction count to get, 0 for all\n"
+            "3. \"last_txid\"       (string, optional) list the transactions after this txid, in txid order\n"
             "\nResult: (for verbose = false):\n"
             "[                     (json array of string)\n"
             "  \"txid\"     (string) The transaction id\n"
@@ -136,34 +137,45 @@ Value getrawmempool(const Array& params, bool fHelp)
     if (params.size() > 0)
         fVerbose = params[0].get_bool();
 
-    if (fVerbose) {
-        LOCK(mempool.cs);
-        Object obj;
-        for (const auto& entry : mempool.memPoolTxs) {
-            const uint256& hash      = entry.first;
-            const CTxMemPoolEntry& e = entry.second;
-            Object info;
-            info.push_back(Pair("size",         (int)e.GetTxSize()));
-            info.push_back(Pair("fees_type",    std::get<0>(e.GetFees())));
-            info.push_back(Pair("fees",         ValueFromAmount(std::get<1>(e.GetFees()))));
-            info.push_back(Pair("time",         e.GetTime()));
-            info.push_back(Pair("height",       (int)e.GetHeight()));
-            info.push_back(Pair("priority",     e.GetPriority()));
-
-            obj.push_back(Pair(hash.ToString(), info));
-        }
-        return obj;
-    } else {
-        vector<uint256> txids;
-        mempool.QueryHash(txids);
+    int64_t maxCount = 0;
+    if (params.size() > 1) {
+        maxCount = params[1].get_int64();
+        if (maxCount < 0)
+            throw JSONRPCError(RPC_INVALID_PARAMS, strprintf("max_count=%d must >= 0", maxCount));
+    }
+
+    LOCK(mempool.cs);
+    auto it = mempool.memPoolTxs.begin();
+    if (params.size() > 2 && !params[2].get_str().empty())
+        it = mempool.memPoolTxs.upper_bound(ParseHashV(params[2], "last_txid"));
+
+    if (fVerbose)
+        writer.BeginObject();
+    else
+        writer.BeginArray();
 
-        Array arr;
-        for (const auto& hash : txids) {
-            arr.push_back(hash.ToString());
+    for (int64_t count = 0; it != mempool.memPoolTxs.end() && (maxCount == 0 || count < maxCount); ++it, ++count) {
+        const uint256& hash = it->first;
+        if (!fVerbose) {
+            writer.Write(hash.ToString());
+            continue;
         }
 
-        return arr;
-    }
+        const CTxMemPoolEntry& e = it->second;
+        Object info;
+        info.push_back(Pair("size",         (int)e.GetTxSize()));
+        info.push_back(Pair("fees_type",    std::get<0>(e.GetFees())));
+        info.push_back(Pair("fees",         ValueFromAmount(std::get<1>(e.GetFees()))));
+        info.push_back(Pair("time",         e.GetTime()));
+        info.push_back(Pair("height",       (int)e.GetHeight()));
+        info.push_back(Pair("priority",     e.GetPriority()));
+        writer.Pair(hash.ToString(), info);
+    }
+
+    if (fVerbose)
+        writer.EndObject();
+    else
+        writer.EndArray();
 }
 
 Value getblock(const Array& params, bool fHelp) {
@@ -207,28 +219,27 @@ Value getblock(const Array& params, bool fHelp) {
 
     // RPCTypeCheck(params, boost::assign::list_of(str_type)(bool_type)); disable this to allow either string or int argument
 
-    std::string strHash;
+    // runs without cs_main against the latest chain snapshot
+    std::shared_ptr<const CChainSnapshot> pSnapshot = RPC_PARAM::GetChainSnapshot();
+
+    CBlockIndex* pBlockIndex = nullptr;
     if (int_type == params[0].type()) {
         int height = params[0].get_int();
-        if (height < 0 || height > chainActive.Height())
+        if (height < 0 || height > pSnapshot->Height())
             throw JSONRPCError(RPC_INVALID_PARAMETER, "Block height out of range.");
 
-        CBlockIndex* pBlockIndex = chainActive[height];
-        strHash                  = pBlockIndex->GetBlockHash().GetHex();
+        pBlockIndex = (*pSnapshot)[height];
     } else {
-        strHash = params[0].get_str();
+        pBlockIndex = CChainSnapshot::LookupBlockIndex(uint256S(params[0].get_str()));
+        if (pBlockIndex == nullptr)
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
     }
-    uint256 hash(uint256S(strHash));
 
     bool fVerbose = true;
     if (params.size() > 1)
         fVerbose = params[1].get_bool();
 
-    if (mapBlockIndex.count(hash) == 0)
-        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
-
     CBlock block;
-    CBlockIndex* pBlockIndex = mapBlockIndex[hash];
     if (!ReadBlockFromDisk(pBlockIndex, block)) {
         throw JSONRPCError(RPC_INTERNAL_ERROR, "Can't read block from disk");
     }
@@ -240,7 +251,7 @@ Value getblock(const Array& params, bool fHelp) {
         return strHex;
     }
 
-    return BlockToJSON(block, pBlockIndex);
+    return BlockToJSON(block, pBlockIndex, *pSnapshot);
 }
 
 Value verifychain(const Array& params, bool fHelp) {
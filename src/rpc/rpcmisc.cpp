@@ -90,6 +90,9 @@ Value getinfo(const Array& params, bool fHelp) {
             "  \"tipblock_height\": xxxxx ,     (numeric) the number of blocks contained the most work in the network\n"
             "  \"syncblock_height\": xxxxx ,    (numeric) the block height of the loggest chain found in the network\n"
             "  \"connections\": xxxxx,          (numeric) the number of connections\n"
+            "  \"block_persist_latency\": {...},  (object) time in microseconds to write a block and its undo data and commit them with the chain state\n"
+            "  \"regid_lookups\": {...},        (object) regid to account resolutions by the cache layer that answered them\n"
+            "  \"db_flush\": {...},             (object) cached entries flushed to the database by prefix, clean ones are not written\n"
             "  \"errors\": \"xxxxx\"            (string) any error messages\n"
             "}\n"
             "\nExamples:\n" +
@@ -127,6 +130,24 @@ Value getinfo(const Array& params, bool fHelp) {
     obj.push_back(Pair("tipblock_height",       chainActive.Height()));
     obj.push_back(Pair("syncblock_height",      nSyncTipHeight));
     obj.push_back(Pair("connections",           (int32_t)vNodes.size()));
+
+    Object latency;
+    latency.push_back(Pair("count",             blockPersistLatency.GetCount()));
+    latency.push_back(Pair("avg_micros",        blockPersistLatency.GetAverage()));
+    latency.push_back(Pair("p50_micros",        blockPersistLatency.GetPercentile(50)));
+    latency.push_back(Pair("p99_micros",        blockPersistLatency.GetPercentile(99)));
+    latency.push_back(Pair("max_micros",        blockPersistLatency.GetMax()));
+    obj.push_back(Pair("block_persist_latency", latency));
+
+    Array regIdHits;
+    for (const auto &hits : regIdLookupStats.vHits)
+        regIdHits.push_back((uint64_t)hits);
+    Object regIdLookups;
+    regIdLookups.push_back(Pair("hits_by_depth",    regIdHits));
+    regIdLookups.push_back(Pair("db_reads",         (uint64_t)regIdLookupStats.nDbReads));
+    regIdLookups.push_back(Pair("misses",           (uint64_t)regIdLookupStats.nMisses));
+    obj.push_back(Pair("regid_lookups",         regIdLookups));
+    obj.push_back(Pair("db_flush",              dbFlushStats.ToJson()));
     obj.push_back(Pair("errors",                GetWarnings("statusbar")));
 
     return obj;
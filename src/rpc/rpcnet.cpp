@@ -8,6 +8,7 @@
 #include "main.h"
 #include "net.h"
 #include "netbase.h"
+#include "p2p/compactblock.h"
 #include "protocol.h"
 #include "sync.h"
 #include "commons/util.h"
@@ -310,7 +311,25 @@ Value getnettotals(const Array& params, bool fHelp) {
             "{\n"
             "  \"totalbytesrecv\": n,   (numeric) Total bytes received\n"
             "  \"totalbytessent\": n,   (numeric) Total bytes sent\n"
-            "  \"timemillis\": t        (numeric) Total cpu time\n"
+            "  \"timemillis\": t,       (numeric) Total cpu time\n"
+            "  \"recvtoprocess\": {     (object) Latency from a message being received to being processed\n"
+            "    \"count\": n,          (numeric) Number of processed messages\n"
+            "    \"avgmicros\": n,      (numeric) Average latency in microseconds\n"
+            "    \"p50micros\": n,      (numeric) Upper bound of the median latency in microseconds\n"
+            "    \"p99micros\": n,      (numeric) Upper bound of the 99th percentile latency in microseconds\n"
+            "    \"maxmicros\": n       (numeric) Maximum latency in microseconds\n"
+            "  },\n"
+            "  \"compactblocks\": {     (object) Compact block relay\n"
+            "    \"sent\": n,           (numeric) Compact blocks served to peers\n"
+            "    \"sentbytessaved\": n, (numeric) Bytes not sent thanks to compact blocks\n"
+            "    \"received\": n,       (numeric) Compact blocks received\n"
+            "    \"reconstructed\": n,  (numeric) Blocks reconstructed from the mempool alone\n"
+            "    \"roundtrip\": n,      (numeric) Blocks reconstructed after requesting missing txs\n"
+            "    \"failed\": n,         (numeric) Compact blocks that fell back to a full block download\n"
+            "    \"reconstructrate\": x.xx, (numeric) Ratio of received compact blocks reconstructed without a round trip\n"
+            "    \"txrequested\": n,    (numeric) Missing txs requested from peers\n"
+            "    \"bytessaved\": n      (numeric) Bytes not received thanks to compact blocks\n"
+            "  }\n"
             "}\n"
             "\nExamples:\n" +
             HelpExampleCli("getnettotals", "") + "\nAs json rpc\n" + HelpExampleRpc("getnettotals", ""));
@@ -319,6 +338,28 @@ Value getnettotals(const Array& params, bool fHelp) {
     obj.push_back(Pair("totalbytesrecv",    CNode::GetTotalBytesRecv()));
     obj.push_back(Pair("totalbytessent",    CNode::GetTotalBytesSent()));
     obj.push_back(Pair("timemillis",        GetTimeMillis()));
+
+    Object latency;
+    latency.push_back(Pair("count",         recvToProcessLatency.GetCount()));
+    latency.push_back(Pair("avgmicros",     recvToProcessLatency.GetAverage()));
+    latency.push_back(Pair("p50micros",     recvToProcessLatency.GetPercentile(50)));
+    latency.push_back(Pair("p99micros",     recvToProcessLatency.GetPercentile(99)));
+    latency.push_back(Pair("maxmicros",     recvToProcessLatency.GetMax()));
+    obj.push_back(Pair("recvtoprocess",     latency));
+
+    uint64_t nCmpctReceived      = compactBlockStats.nReceived;
+    uint64_t nCmpctReconstructed = compactBlockStats.nReconstructed;
+    Object cmpct;
+    cmpct.push_back(Pair("sent",            (uint64_t)compactBlockStats.nSent));
+    cmpct.push_back(Pair("sentbytessaved",  (uint64_t)compactBlockStats.nSentBytesSaved));
+    cmpct.push_back(Pair("received",        nCmpctReceived));
+    cmpct.push_back(Pair("reconstructed",   nCmpctReconstructed));
+    cmpct.push_back(Pair("roundtrip",       (uint64_t)compactBlockStats.nReconstructedRoundTrip));
+    cmpct.push_back(Pair("failed",          (uint64_t)compactBlockStats.nFailed));
+    cmpct.push_back(Pair("reconstructrate", nCmpctReceived > 0 ? (double)nCmpctReconstructed / nCmpctReceived : 0.0));
+    cmpct.push_back(Pair("txrequested",     (uint64_t)compactBlockStats.nTxRequested));
+    cmpct.push_back(Pair("bytessaved",      (uint64_t)compactBlockStats.nBytesSaved));
+    obj.push_back(Pair("compactblocks",     cmpct));
     return obj;
 }
 
@@ -429,15 +429,15 @@ Value getcdp(const Array& params, bool fHelp){
         );
     }
 
-    int32_t height = chainActive.Height();
-    uint64_t slideWindow;
-    pCdMan->pSysParamCache->GetParam(SysParamType::MEDIAN_PRICE_SLIDE_WINDOW_BLOCKCOUNT, slideWindow);
+    // runs without cs_main against the latest chain snapshot
+    std::shared_ptr<const CChainSnapshot> pSnapshot = RPC_PARAM::GetChainSnapshot();
     // TODO: multi stable coin
-    uint64_t bcoinMedianPrice = pCdMan->pPpCache->GetMedianPrice(height, slideWindow, CoinPricePair(SYMB::WICC, SYMB::USD));
+    uint64_t bcoinMedianPrice = pSnapshot->GetMedianPrice(CoinPricePair(SYMB::WICC, SYMB::USD));
 
     uint256 cdpTxId(uint256S(params[0].get_str()));
     CUserCDP cdp;
-    if (!pCdMan->pCdpCache->GetCDP(cdpTxId, cdp)) {
+    CCdpDBCache cdpCache(pSnapshot->pCdpDb.get());
+    if (!cdpCache.GetCDP(cdpTxId, cdp)) {
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, strprintf("CDP (%s) does not exist!", cdpTxId.GetHex()));
     }
 
@@ -805,7 +805,9 @@ extern Value getdexorders(const Array& params, bool fHelp) {
         );
     }
 
-    int64_t tipHeight = chainActive.Height();
+    // runs without cs_main against the latest chain snapshot
+    std::shared_ptr<const CChainSnapshot> pSnapshot = RPC_PARAM::GetChainSnapshot();
+    int64_t tipHeight = pSnapshot->Height();
     int64_t beginHeight = 0;
     if (params.size() > 0)
         beginHeight = params[0].get_int64();
@@ -832,7 +834,7 @@ extern Value getdexorders(const Array& params, bool fHelp) {
     DEXBlockOrdersCache::KeyType lastKey;
     if (params.size() > 3) {
         string lastPosInfo = RPC_PARAM::GetBinStrFromHex(params[3], "last_pos_info");
-        auto err = DEX_DB::ParseLastPos(lastPosInfo, lastKey);
+        auto err = DEX_DB::ParseLastPos(*pSnapshot, lastPosInfo, lastKey);
         if (err)
             throw JSONRPCError(RPC_INVALID_PARAMS, strprintf("Invalid last_pos_info! %s", *err));
         uint32_t lastHeight = DEX_DB::GetHeight(lastKey);
@@ -843,7 +845,8 @@ extern Value getdexorders(const Array& params, bool fHelp) {
                                          beginHeight, endHeight));
     }
 
-    auto pGetter = pCdMan->pDexCache->CreateOrdersGetter();
+    CDexDBCache dexCache(pSnapshot->pDexDb.get());
+    auto pGetter = dexCache.CreateOrdersGetter();
     if (!pGetter->Execute(beginHeight, endHeight, maxCount, lastKey)) {
         throw JSONRPCError(RPC_INVALID_PARAMS, strprintf("get all active orders error! begin_height=%d, end_height=%d",
             beginHeight, endHeight));
@@ -851,7 +854,7 @@ extern Value getdexorders(const Array& params, bool fHelp) {
 
     string newLastPosInfo;
     if (pGetter->has_more) {
-        auto err = DEX_DB::MakeLastPos(pGetter->last_key, newLastPosInfo);
+        auto err = DEX_DB::MakeLastPos(*pSnapshot, pGetter->last_key, newLastPosInfo);
         if (err)
             throw JSONRPCError(RPC_INVALID_PARAMS, strprintf("Make new last_pos_info error! %s", *err));
     }
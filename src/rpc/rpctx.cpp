@@ -17,11 +17,13 @@
 #include "config/configuration.h"
 #include "miner/miner.h"
 #include "main.h"
+#include "p2p/txvalidator.h"
 
 #include <boost/assign/list_of.hpp>
 #include "commons/json/json_spirit_utils.h"
 #include "commons/json/json_spirit_value.h"
 #include "commons/json/json_spirit_reader.h"
+#include <limits>
 
 #define revert(height) ((height<<24) | (height << 8 & 0xff0000) |  (height>>8 & 0xff00) | (height >> 24))
 
@@ -47,6 +49,118 @@ Value gettxdetail(const Array& params, bool fHelp) {
     return GetTxDetailJSON(uint256S(params[0].get_str()));
 }
 
+static const int64_t MAX_ADDRESS_TXIDS_COUNT = 10000;
+static const int64_t DEFAULT_LIST_PAGE_COUNT = 100;
+
+Value getaddresstxids(const Array& params, bool fHelp) {
+    if (fHelp || params.size() < 1 || params.size() > 5)
+        throw runtime_error(
+            "getaddresstxids \"addr\" [\"begin_height\"] [\"end_height\"] [\"max_count\"] [\"last_pos_info\"]\n"
+            "\nget the transactions involving the address by block height range, requires -addressindex.\n"
+            "\nArguments:\n"
+            "1.\"addr\":            (string, required) the address or regid\n"
+            "2.\"begin_height\":    (numeric, optional) the begin block height, default is 0\n"
+            "3.\"end_height\":      (numeric, optional) the end block height, default is current tip block height\n"
+            "4.\"max_count\":       (numeric, optional) the max tx count to get, default is 500, at least 1 and at most 10000\n"
+            "5.\"last_pos_info\":   (string, optional) the last position info to get more txs, default is empty\n"
+            "\nResult:\n"
+            "\"has_more\"           (bool) has more txs in db.\n"
+            "\"last_pos_info\"      (string) the last position info to get more txs.\n"
+            "\"count\"              (numeric) the count of returned txs.\n"
+            "\"txs\"                (array) the txs in chain order, with their txid, height and index in the block.\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getaddresstxids", "\"WT52jPi8DhHUC85MPYK8y8Ajs8J7CshgaB\" 0 100 500")
+            + "\nAs json rpc call\n"
+            + HelpExampleRpc("getaddresstxids", "\"WT52jPi8DhHUC85MPYK8y8Ajs8J7CshgaB\", 0, 100, 500"));
+
+    if (!SysCfg().IsAddressIndex())
+        throw JSONRPCError(RPC_MISC_ERROR, "Address index is disabled, restart with -addressindex");
+
+    // runs without cs_main against the latest chain snapshot
+    std::shared_ptr<const CChainSnapshot> pSnapshot = RPC_PARAM::GetChainSnapshot();
+    CAccountDBCache accountCache(pSnapshot->pAccountDb.get());
+
+    CKeyID keyId;
+    if (!GetKeyId(accountCache, params[0].get_str(), keyId))
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
+
+    int64_t tipHeight = pSnapshot->Height();
+    int64_t beginHeight = 0;
+    if (params.size() > 1)
+        beginHeight = params[1].get_int64();
+    if (beginHeight < 0 || beginHeight > tipHeight)
+        throw JSONRPCError(RPC_INVALID_PARAMS, strprintf("begin_height=%d must >= 0 and <= tip_height=%d", beginHeight, tipHeight));
+
+    int64_t endHeight = tipHeight;
+    if (params.size() > 2)
+        endHeight = params[2].get_int64();
+    if (endHeight < beginHeight || endHeight > tipHeight)
+        throw JSONRPCError(RPC_INVALID_PARAMS, strprintf("end_height=%d must >= begin_height=%d and <= tip_height=%d",
+            endHeight, beginHeight, tipHeight));
+
+    int64_t maxCount = 500;
+    if (params.size() > 3) {
+        maxCount = params[3].get_int64();
+        if (maxCount < 1 || maxCount > MAX_ADDRESS_TXIDS_COUNT)
+            throw JSONRPCError(RPC_INVALID_PARAMS, strprintf("max_count=%d must >= 1 and <= %d",
+                maxCount, MAX_ADDRESS_TXIDS_COUNT));
+    }
+
+    CAddressTxKey fromKey(keyId, beginHeight, 0);
+    if (params.size() > 4) {
+        string lastPosInfo = RPC_PARAM::GetBinStrFromHex(params[4], "last_pos_info");
+        CAddressTxKey lastKey;
+        try {
+            CDataStream ss(lastPosInfo, SER_DISK, CLIENT_VERSION);
+            ss >> lastKey;
+        } catch (std::exception &e) {
+            throw JSONRPCError(RPC_INVALID_PARAMS, "Invalid last_pos_info!");
+        }
+        if (lastKey.keyId != keyId || lastKey.height < beginHeight || lastKey.height > endHeight)
+            throw JSONRPCError(RPC_INVALID_PARAMS, strprintf("Invalid last_pos_info! it is not of the address or "
+                                                             "not in range(begin=%d,end=%d)", beginHeight, endHeight));
+        // continue right after the last tx, at the next height if it had the largest index
+        if (lastKey.index < std::numeric_limits<uint32_t>::max())
+            fromKey = CAddressTxKey(keyId, lastKey.height, lastKey.index + 1);
+        else
+            fromKey = CAddressTxKey(keyId, lastKey.height + 1, 0);
+    }
+
+    // one more than requested tells whether there are more txs in range
+    CBlockDBCache blockCache(pSnapshot->pBlockDb.get());
+    vector<pair<CAddressTxKey, uint256> > txs;
+    blockCache.GetTxHashByAddress(fromKey, maxCount + 1, txs);
+    while (!txs.empty() && txs.back().first.height > endHeight)
+        txs.pop_back();
+
+    bool hasMore = txs.size() > (size_t)maxCount;
+    if (hasMore)
+        txs.resize(maxCount);
+
+    string newLastPosInfo;
+    if (hasMore && !txs.empty()) {
+        CDataStream ss(SER_DISK, CLIENT_VERSION);
+        ss << txs.back().first;
+        newLastPosInfo = ss.str();
+    }
+
+    Array txArray;
+    for (const auto &item : txs) {
+        Object txObj;
+        txObj.push_back(Pair("txid", item.second.GetHex()));
+        txObj.push_back(Pair("height", (int64_t)item.first.height));
+        txObj.push_back(Pair("index", (int64_t)item.first.index));
+        txArray.push_back(txObj);
+    }
+
+    Object obj;
+    obj.push_back(Pair("has_more", hasMore));
+    obj.push_back(Pair("last_pos_info", HexStr(newLastPosInfo)));
+    obj.push_back(Pair("count", (int64_t)txArray.size()));
+    obj.push_back(Pair("txs", txArray));
+    return obj;
+}
+
 Value submitaccountregistertx(const Array& params, bool fHelp) {
     if (fHelp || params.size() == 0)
         throw runtime_error("submitaccountregistertx \"addr\" [\"fee\"]\n"
@@ -438,7 +552,7 @@ Value listaddr(const Array& params, bool fHelp) {
             obj.push_back(Pair("regid_mature",  account.regid.IsMature(chainActive.Height())));
 
             Object tokenMapObj;
-            for (auto tokenPair : account.tokens) {
+            for (auto tokenPair : account.GetTokens()) {
                 Object tokenObj;
                 const CAccountToken& token = tokenPair.second;
                 tokenObj.push_back(Pair("free_amount",      token.free_amount));
@@ -490,10 +604,14 @@ if (fHelp || params.size() > 2) {
     Array confirmedTxArray;
     int32_t nCount = 0;
     map<int32_t, uint256, std::greater<int32_t> > blockInfoMap;
-    for (auto const &wtx : pWalletMain->mapInBlockTx) {
-        CBlockIndex *pIndex = mapBlockIndex[wtx.first];
-        if (pIndex != nullptr)
-            blockInfoMap.insert(make_pair(pIndex->height, wtx.first));
+    {
+        // blocks of the wallet may be unknown to or erased from the block index
+        LOCK(cs_mapBlockIndex);
+        for (auto const &wtx : pWalletMain->mapInBlockTx) {
+            auto mi = mapBlockIndex.find(wtx.first);
+            if (mi != mapBlockIndex.end() && mi->second != nullptr)
+                blockInfoMap.insert(make_pair(mi->second->height, wtx.first));
+        }
     }
     bool bUpLimited = false;
     for (auto const &blockInfo : blockInfoMap) {
@@ -553,10 +671,16 @@ Value getaccountinfo(const Array& params, bool fHelp) {
     }
 
     RPCTypeCheck(params, list_of(str_type));
+
+    // runs without cs_main against the latest chain snapshot
+    std::shared_ptr<const CChainSnapshot> pSnapshot = RPC_PARAM::GetChainSnapshot();
+    CAccountDBCache accountCache(pSnapshot->pAccountDb.get());
+    CDelegateDBCache delegateCache(pSnapshot->pDelegateDb.get());
+
     CKeyID keyid;
     CUserID userId;
     string addr = params[0].get_str();
-    if (!GetKeyId(addr, keyid)) {
+    if (!GetKeyId(accountCache, addr, keyid)) {
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
@@ -564,13 +688,21 @@ Value getaccountinfo(const Array& params, bool fHelp) {
     Object obj;
     bool found = false;
 
+    // the wallet is optional, it only fills in the pubkeys of accounts not registered yet
+    CPubKey pubKey;
+    CPubKey minerPubKey;
+    bool inWallet = false;
+    if (pWalletMain) {
+        LOCK(pWalletMain->cs_wallet);
+        inWallet = pWalletMain->GetPubKey(keyid, pubKey);
+        if (inWallet)
+            pWalletMain->GetPubKey(keyid, minerPubKey, true);
+    }
+
     CAccount account;
-    if (pCdMan->pAccountCache->GetAccount(userId, account)) {
+    if (accountCache.GetAccount(userId, account)) {
         if (!account.owner_pubkey.IsValid()) {
-            CPubKey pubKey;
-            CPubKey minerPubKey;
-            if (pWalletMain->GetPubKey(keyid, pubKey)) {
-                pWalletMain->GetPubKey(keyid, minerPubKey, true);
+            if (inWallet) {
                 account.owner_pubkey = pubKey;
                 account.keyid        = pubKey.GetKeyId();
                 if (pubKey != minerPubKey && !account.miner_pubkey.IsValid()) {
@@ -578,21 +710,18 @@ Value getaccountinfo(const Array& params, bool fHelp) {
                 }
             }
         }
-        obj = account.ToJsonObj();
+        obj = account.ToJsonObj(delegateCache, pSnapshot->Height());
         obj.push_back(Pair("position", "inblock"));
 
         found = true;
     } else {  // unregistered keyid
-        CPubKey pubKey;
-        CPubKey minerPubKey;
-        if (pWalletMain->GetPubKey(keyid, pubKey)) {
-            pWalletMain->GetPubKey(keyid, minerPubKey, true);
+        if (inWallet) {
             account.owner_pubkey = pubKey;
             account.keyid        = pubKey.GetKeyId();
             if (minerPubKey != pubKey) {
                 account.miner_pubkey = minerPubKey;
             }
-            obj = account.ToJsonObj();
+            obj = account.ToJsonObj(delegateCache, pSnapshot->Height());
             obj.push_back(Pair("position", "inwallet"));
 
             found = true;
@@ -600,15 +729,12 @@ Value getaccountinfo(const Array& params, bool fHelp) {
     }
 
     if (found) {
-        int32_t height       = chainActive.Height();
-        uint64_t slideWindow = 0;
-        pCdMan->pSysParamCache->GetParam(SysParamType::MEDIAN_PRICE_SLIDE_WINDOW_BLOCKCOUNT, slideWindow);
         // TODO: multi stable coin
-        uint64_t bcoinMedianPrice =
-            pCdMan->pPpCache->GetMedianPrice(height, slideWindow, CoinPricePair(SYMB::WICC, SYMB::USD));
+        uint64_t bcoinMedianPrice = pSnapshot->GetMedianPrice(CoinPricePair(SYMB::WICC, SYMB::USD));
         Array cdps;
         vector<CUserCDP> userCdps;
-        if (pCdMan->pCdpCache->GetCDPList(account.regid, userCdps)) {
+        CCdpDBCache cdpCache(pSnapshot->pCdpDb.get());
+        if (cdpCache.GetCDPList(account.regid, userCdps)) {
             for (auto& cdp : userCdps) {
                 cdps.push_back(cdp.ToJson(bcoinMedianPrice));
             }
@@ -638,7 +764,10 @@ static Value TestDisconnectBlock(int32_t number) {
                 return false;
             if (!pCdMan->pBlockIndexDb->EraseBlockIndex(pTipIndex->GetBlockHash()))
                 return false;
-            mapBlockIndex.erase(pTipIndex->GetBlockHash());
+            {
+                LOCK(cs_mapBlockIndex);
+                mapBlockIndex.erase(pTipIndex->GetBlockHash());
+            }
         } while (--number);
     }
 
@@ -667,33 +796,53 @@ Value disconnectblock(const Array& params, bool fHelp) {
     return te;
 }
 
-Value listcontracts(const Array& params, bool fHelp) {
-    if (fHelp || params.size() != 1) {
+void listcontracts(const Array& params, bool fHelp, CJsonStreamWriter& writer) {
+    if (fHelp || params.size() < 1 || params.size() > 3) {
         throw runtime_error(
-            "listcontracts \"show detail\"\n"
+            "listcontracts \"show detail\" [\"max_count\"] [\"last_contract_regid\"]\n"
             "\nget the list of all contracts\n"
             "\nArguments:\n"
             "1. show detail  (boolean, required) show contract in detail if true.\n"
+            "2. max_count    (numeric, optional) the max contract count to get, default is 100, 0 for all contracts\n"
+            "3. last_contract_regid (string, optional) list the contracts after this regid, default is empty\n"
             "\nReturn an object contains all contracts\n"
             "\nResult:\n"
+            "\"contracts\"          (array) the contracts ordered by regid.\n"
+            "\"count\"              (numeric) the count of returned contracts.\n"
+            "\"has_more\"           (bool) has more contracts in db.\n"
+            "\"last_contract_regid\" (string) the last_contract_regid to get more contracts.\n"
             "\nExamples:\n" +
             HelpExampleCli("listcontracts", "true") + "\nAs json rpc call\n" + HelpExampleRpc("listcontracts", "true"));
     }
 
     bool showDetail = params[0].get_bool();
 
-    map<string, CUniversalContract> contracts;
-    if (!pCdMan->pContractCache->GetContracts(contracts)) {
-        throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to acquire contracts from db.");
+    // a bounded page by default, the reply is streamed to the client while cs_main is held
+    int64_t maxCount = DEFAULT_LIST_PAGE_COUNT;
+    if (params.size() > 1) {
+        maxCount = params[1].get_int64();
+        if (maxCount < 0)
+            throw JSONRPCError(RPC_INVALID_PARAMS, strprintf("max_count=%d must >= 0", maxCount));
     }
 
-    Object obj;
-    Array contractArray;
-    for (const auto &item : contracts) {
+    CRegID lastRegid;
+    if (params.size() > 2 && !params[2].get_str().empty()) {
+        lastRegid = CRegID(params[2].get_str());
+        if (lastRegid.IsEmpty())
+            throw JSONRPCError(RPC_INVALID_PARAMS, "Invalid last_contract_regid.");
+    }
+
+    auto pGetter = pCdMan->pContractCache->CreateContractsGetter(maxCount, lastRegid);
+
+    // the contracts, code included, go out one by one instead of being loaded all together
+    uint32_t count = 0;
+    writer.BeginObject();
+    writer.Key("contracts");
+    writer.BeginArray();
+    bool success = pGetter->ForEach([&](const string &key, const CUniversalContract &contract) {
         Object contractObject;
-        const CUniversalContract &contract = item.second;
-        CRegID regid(item.first);
-        contractObject.push_back(Pair("contract_regid", regid.ToString()));
+        lastRegid = CRegID(key);
+        contractObject.push_back(Pair("contract_regid", lastRegid.ToString()));
         contractObject.push_back(Pair("memo",           HexStr(contract.memo)));
 
         if (showDetail) {
@@ -703,13 +852,18 @@ Value listcontracts(const Array& params, bool fHelp) {
             contractObject.push_back(Pair("abi",        contract.abi));
         }
 
-        contractArray.push_back(contractObject);
-    }
-
-    obj.push_back(Pair("count",     contracts.size()));
-    obj.push_back(Pair("contracts", contractArray));
+        writer.Write(contractObject);
+        count++;
+        return true;
+    });
+    if (!success)
+        throw JSONRPCError(RPC_DATABASE_ERROR, "Failed to acquire contracts from db.");
 
-    return obj;
+    writer.EndArray();
+    writer.Pair("count",    (int64_t)count);
+    writer.Pair("has_more", pGetter->have_next);
+    writer.Pair("last_contract_regid", pGetter->have_next ? lastRegid.ToString() : "");
+    writer.EndObject();
 }
 
 Value getcontractinfo(const Array& params, bool fHelp) {
@@ -745,29 +899,58 @@ Value getcontractinfo(const Array& params, bool fHelp) {
     return obj;
 }
 
-Value listtxcache(const Array& params, bool fHelp) {
-    if (fHelp || params.size() != 0) {
-        throw runtime_error("listtxcache\n"
+void listtxcache(const Array& params, bool fHelp, CJsonStreamWriter& writer) {
+    if (fHelp || params.size() > 2) {
+        throw runtime_error("listtxcache [\"max_count\"] [\"last_block_hash\"]\n"
                 "\nget all transactions in cache\n"
                 "\nArguments:\n"
+                "1. max_count        (numeric, optional) the max block count to get, default is 100, 0 for all blocks\n"
+                "2. last_block_hash  (string, optional) list the blocks after this block hash, default is empty\n"
+                "\nReturn an object with a page of the blocks, in block hash order, and their cached txids\n"
                 "\nResult:\n"
-                "\"txcache\"  (string)\n"
+                "\"blocks\"           (array) the blocks, each with its \"blockhash\" and \"txcache\" array of txids.\n"
+                "\"count\"            (numeric) the count of returned blocks.\n"
+                "\"has_more\"         (bool) has more blocks in the tx cache.\n"
+                "\"last_block_hash\"  (string) the last_block_hash to get more blocks.\n"
                 "\nExamples:\n" + HelpExampleCli("listtxcache", "")+ HelpExampleRpc("listtxcache", ""));
     }
-    const map<uint256, UnorderedHashSet> &mapBlockTxHashSet = pCdMan->pTxCache->GetTxHashCache();
 
-    Array retTxHashArray;
-    for (auto &item : mapBlockTxHashSet) {
-        Object blockObj;
-        Array txHashArray;
-        blockObj.push_back(Pair("blockhash", item.first.GetHex()));
-        for (auto &txid : item.second)
-            txHashArray.push_back(txid.GetHex());
-        blockObj.push_back(Pair("txcache", txHashArray));
-        retTxHashArray.push_back(blockObj);
+    int64_t maxCount = DEFAULT_LIST_PAGE_COUNT;
+    if (params.size() > 0) {
+        maxCount = params[0].get_int64();
+        if (maxCount < 0)
+            throw JSONRPCError(RPC_INVALID_PARAMS, strprintf("max_count=%d must >= 0", maxCount));
     }
 
-    return retTxHashArray;
+    const map<uint256, UnorderedHashSet> &mapBlockTxHashSet = pCdMan->pTxCache->GetTxHashCache();
+    auto it = mapBlockTxHashSet.begin();
+    if (params.size() > 1 && !params[1].get_str().empty())
+        it = mapBlockTxHashSet.upper_bound(ParseHashV(params[1], "last_block_hash"));
+
+    // a page of blocks at a time, the caller continues from last_block_hash while has_more is set
+    int64_t count = 0;
+    uint256 lastBlockHash;
+    writer.BeginObject();
+    writer.Key("blocks");
+    writer.BeginArray();
+    for (; it != mapBlockTxHashSet.end() && (maxCount == 0 || count < maxCount); ++it, ++count) {
+        writer.BeginObject();
+        writer.Pair("blockhash", it->first.GetHex());
+        writer.Key("txcache");
+        writer.BeginArray();
+        for (auto &txid : it->second)
+            writer.Write(txid.GetHex());
+        writer.EndArray();
+        writer.EndObject();
+        lastBlockHash = it->first;
+    }
+    writer.EndArray();
+
+    bool hasMore = it != mapBlockTxHashSet.end();
+    writer.Pair("count",    count);
+    writer.Pair("has_more", hasMore);
+    writer.Pair("last_block_hash", hasMore ? lastBlockHash.GetHex() : "");
+    writer.EndObject();
 }
 
 Value reloadtxcache(const Array& params, bool fHelp) {
@@ -832,8 +1015,12 @@ Value getcontractdata(const Array& params, bool fHelp) {
     } else {
         key = params[1].get_str();
     }
+    // runs without cs_main against the latest chain snapshot
+    std::shared_ptr<const CChainSnapshot> pSnapshot = RPC_PARAM::GetChainSnapshot();
+    CContractDBCache contractCache(pSnapshot->pContractDb.get());
+
     string value;
-    if (!pCdMan->pContractCache->GetContractData(regId, key, value)) {
+    if (!contractCache.GetContractData(regId, key, value)) {
         throw JSONRPCError(RPC_INVALID_PARAMETER, "Failed to acquire contract data");
     }
 
@@ -863,10 +1050,14 @@ Value saveblocktofile(const Array& params, bool fHelp) {
     }
     string strblockhash = params[0].get_str();
     uint256 blockHash(uint256S(params[0].get_str()));
-    if(0 == mapBlockIndex.count(blockHash)) {
-        throw JSONRPCError(RPC_MISC_ERROR, "block hash is not exist!");
+    CBlockIndex *pIndex = nullptr;
+    {
+        LOCK(cs_mapBlockIndex);
+        auto mi = mapBlockIndex.find(blockHash);
+        if (mi == mapBlockIndex.end())
+            throw JSONRPCError(RPC_MISC_ERROR, "block hash is not exist!");
+        pIndex = mi->second;
     }
-    CBlockIndex *pIndex = mapBlockIndex[blockHash];
     CBlock blockInfo;
     if (!pIndex || !ReadBlockFromDisk(pIndex, blockInfo))
         throw runtime_error(_("Failed to read block"));
@@ -925,6 +1116,96 @@ Value submittxraw(const Array& params, bool fHelp) {
     return obj;
 }
 
+/**
+ * Commit a raw tx through the wallet when there is one, so it is kept as unconfirmed, or straight
+ * to the mempool under -disablewallet. Requires cs_main.
+ */
+static std::tuple<bool, string> CommitRawTx(CBaseTx *pTx) {
+    if (pWalletMain)
+        return pWalletMain->CommitTx(pTx);
+
+    CValidationState state;
+    if (!::AcceptToMemoryPool(mempool, state, pTx, true))
+        return std::make_tuple(false, state.GetRejectReason());
+
+    uint256 txid = pTx->GetHash();
+    ::RelayTransaction(pTx, txid);
+    return std::make_tuple(true, txid.ToString());
+}
+
+Value submittxrawbatch(const Array& params, bool fHelp) {
+    if (fHelp || params.size() != 1) {
+        throw runtime_error(
+            "submittxrawbatch [\"rawtx\",...]\n"
+            "\nsubmit raw transactions (hex format) in one call, the signatures are checked in parallel and the\n"
+            "transactions are admitted to the mempool in the given order\n"
+            "\nArguments:\n"
+            "1.[\"rawtx\",...]:   (array of string, required) The raw transactions, at most " +
+            strprintf("%u", MAX_RPC_TX_BATCH_SIZE) + "\n"
+            "\nResult:\n"
+            "[{\"txid\": \"txid\", \"accepted\": true|false, \"error\": \"reason\"},...]  (array) in the order of the\n"
+            "raw transactions, the error is present only for rejected ones\n"
+            "\nExamples:\n" +
+            HelpExampleCli("submittxrawbatch", "'[\"0b0184...\",\"0b0184...\"]'") +
+            "\nAs json rpc call\n" +
+            HelpExampleRpc("submittxrawbatch", "[\"0b0184...\",\"0b0184...\"]"));
+    }
+
+    const Array& rawTxs = params[0].get_array();
+    if (rawTxs.empty() || rawTxs.size() > MAX_RPC_TX_BATCH_SIZE)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, strprintf("Expect 1 to %u raw transactions", MAX_RPC_TX_BATCH_SIZE));
+
+    // decode all raw txs first, a malformed one only fails its own entry
+    vector<std::shared_ptr<CBaseTx> > vTxs(rawTxs.size());
+    vector<string> vErrors(rawTxs.size());
+    vector<std::shared_ptr<CBaseTx> > vDecodedTxs;
+    for (size_t i = 0; i < rawTxs.size(); i++) {
+        try {
+            vector<uint8_t> vch(ParseHex(rawTxs[i].get_str()));
+            if (vch.empty() || vch.size() > MAX_RPC_SIG_STR_LEN) {
+                vErrors[i] = "invalid-rawtx-size";
+                continue;
+            }
+
+            CDataStream stream(vch, SER_DISK, CLIENT_VERSION);
+            stream >> vTxs[i];
+        } catch (std::exception& e) {
+            vTxs[i] = nullptr;
+        }
+
+        if (vTxs[i] == nullptr) {
+            vErrors[i] = "rawtx-decode-failed";
+            continue;
+        }
+        vDecodedTxs.push_back(vTxs[i]);
+    }
+
+    int32_t nThreads = std::min<int32_t>(MAX_TX_VALIDATION_THREADS, boost::thread::hardware_concurrency());
+    nThreads = std::min<int32_t>(nThreads, (vDecodedTxs.size() + TX_VALIDATION_BATCH_SIZE - 1) / TX_VALIDATION_BATCH_SIZE);
+    PrecheckTxSignatures(vDecodedTxs, nThreads);
+
+    Array arr;
+    {
+        LOCK(cs_main);
+        for (size_t i = 0; i < vTxs.size(); i++) {
+            Object obj;
+            if (vTxs[i] != nullptr) {
+                std::tuple<bool, string> ret = CommitRawTx(vTxs[i].get());
+                obj.push_back(Pair("txid", vTxs[i]->GetHash().GetHex()));
+                if (!std::get<0>(ret))
+                    vErrors[i] = std::get<1>(ret);
+            }
+            obj.push_back(Pair("accepted", vErrors[i].empty()));
+            if (!vErrors[i].empty())
+                obj.push_back(Pair("error", vErrors[i]));
+
+            arr.push_back(obj);
+        }
+    }
+
+    return arr;
+}
+
 Value signtxraw(const Array& params, bool fHelp) {
     if (fHelp || params.size() != 2) {
         throw runtime_error(
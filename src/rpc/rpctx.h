@@ -14,6 +14,7 @@ using namespace std;
 using namespace json_spirit;
 
 class CBaseTx;
+class CJsonStreamWriter;
 
 extern Value submitaccountregistertx(const Array& params, bool fHelp);
 extern Value submitcontractdeploytx(const Array& params, bool fHelp);
@@ -23,6 +24,7 @@ extern Value submituniversalcontractdeploytx(const Array& params, bool fHelp);
 extern Value submituniversalcontractcalltx(const Array& params, bool fHelp);
 
 extern Value gettxdetail(const Array& params, bool fHelp);
+extern Value getaddresstxids(const Array& params, bool fHelp);
 extern Value sign(const Array& params, bool fHelp);
 extern Value getaccountinfo(const Array& params, bool fHelp);
 extern Value disconnectblock(const Array& params, bool fHelp);
@@ -43,8 +45,8 @@ extern Value getsignature(const Array& params, bool fHelp);
 extern Value listaddr(const Array& params, bool fHelp);
 extern Value listtx(const Array& params, bool fHelp);
 extern Value listcontractassets(const Array& params, bool fHelp);
-extern Value listcontracts(const Array& params, bool fHelp);
-extern Value listtxcache(const Array& params, bool fHelp);
+extern void listcontracts(const Array& params, bool fHelp, CJsonStreamWriter& writer);
+extern void listtxcache(const Array& params, bool fHelp, CJsonStreamWriter& writer);
 extern Value listdelegates(const Array& params, bool fHelp);
 
 #endif  // RPC_RPCTX_H
@@ -0,0 +1,223 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "persistence/accountdb.h"
+#include "commons/random.h"
+
+#include <boost/test/unit_test.hpp>
+
+using namespace std;
+
+static CKeyID RandomKeyId() {
+    CKeyID keyId;
+    GetRandBytes(keyId.begin(), keyId.size());
+    return keyId;
+}
+
+static uint64_t GetFree(const CAccount &account, const TokenSymbol &tokenSymbol) {
+    return account.GetToken(tokenSymbol).free_amount;
+}
+
+BOOST_AUTO_TEST_SUITE(accountdb_tests)
+
+// the identity and the balance records are written apart and read back as one account
+BOOST_AUTO_TEST_CASE(save_load_erase_split_balances) {
+    CDBAccess dbAccess(DBNameType::ACCOUNT, true, true);
+    CKeyID keyId = RandomKeyId();
+    {
+        CAccountDBCache dbCache(&dbAccess);
+        CAccount account(keyId);
+        BOOST_CHECK(account.OperateBalance(SYMB::WICC, ADD_FREE, 100));
+        BOOST_CHECK(account.OperateBalance(SYMB::WUSD, ADD_FREE, 5));
+        BOOST_CHECK(dbCache.SetAccount(keyId, account));
+        dbCache.Flush();
+    }
+
+    CAccountDBCache dbCache(&dbAccess);
+    CAccount account;
+    BOOST_REQUIRE(dbCache.GetAccount(keyId, account));
+    BOOST_CHECK(account.token_symbols == set<TokenSymbol>({SYMB::WICC, SYMB::WUSD}));
+    BOOST_CHECK_EQUAL(account.GetTokens().size(), 2U);
+    BOOST_CHECK_EQUAL(GetFree(account, SYMB::WICC), 100U);
+    BOOST_CHECK_EQUAL(GetFree(account, SYMB::WUSD), 5U);
+
+    CAccountToken accountToken;
+    BOOST_CHECK(dbCache.GetAccountToken(keyId, SYMB::WUSD, accountToken) && accountToken.free_amount == 5);
+    BOOST_CHECK_EQUAL(dbCache.GetAccountFreeAmount(keyId, SYMB::WICC), 100U);
+
+    BOOST_CHECK(dbCache.EraseAccount(keyId));
+    BOOST_CHECK(!dbCache.GetAccount(keyId, account));
+    BOOST_CHECK(!dbCache.GetAccountToken(keyId, SYMB::WICC, accountToken));
+    BOOST_CHECK(!dbCache.GetAccountToken(keyId, SYMB::WUSD, accountToken));
+}
+
+// an account read through a tx cache keeps its balances after that cache is gone
+BOOST_AUTO_TEST_CASE(account_outlives_cache) {
+    CDBAccess dbAccess(DBNameType::ACCOUNT, true, true);
+    CAccountDBCache dbCache(&dbAccess);
+    CKeyID keyId = RandomKeyId();
+    CAccount saved(keyId);
+    saved.OperateBalance(SYMB::WICC, ADD_FREE, 42);
+    dbCache.SetAccount(keyId, saved);
+
+    CAccount account;
+    {
+        CAccountDBCache txCache(&dbCache);
+        BOOST_REQUIRE(txCache.GetAccount(keyId, account));
+    }
+    BOOST_CHECK_EQUAL(GetFree(account, SYMB::WICC), 42U);
+    BOOST_CHECK_EQUAL(account.GetTokens().size(), 1U);
+}
+
+// two copies of an account saved one after the other: the last one wins as a whole
+BOOST_AUTO_TEST_CASE(last_saved_account_wins) {
+    CDBAccess dbAccess(DBNameType::ACCOUNT, true, true);
+    CAccountDBCache dbCache(&dbAccess);
+    CKeyID keyId = RandomKeyId();
+    CAccount saved(keyId);
+    saved.OperateBalance(SYMB::WICC, ADD_FREE, 100);
+    saved.OperateBalance(SYMB::WUSD, ADD_FREE, 5);
+    dbCache.SetAccount(keyId, saved);
+
+    CAccount first, second;
+    BOOST_REQUIRE(dbCache.GetAccount(keyId, first));
+    BOOST_REQUIRE(dbCache.GetAccount(keyId, second));
+    first.OperateBalance(SYMB::WICC, ADD_FREE, 10);
+    first.OperateBalance(SYMB::WGRT, ADD_FREE, 3);
+    second.OperateBalance(SYMB::WUSD, ADD_FREE, 1);
+    dbCache.SetAccount(keyId, first);
+    dbCache.SetAccount(keyId, second);
+
+    CAccount account;
+    BOOST_REQUIRE(dbCache.GetAccount(keyId, account));
+    BOOST_CHECK_EQUAL(GetFree(account, SYMB::WICC), 100U);
+    BOOST_CHECK_EQUAL(GetFree(account, SYMB::WUSD), 6U);
+    BOOST_CHECK(!account.token_symbols.count(SYMB::WGRT));
+
+    CAccountToken accountToken;
+    BOOST_CHECK(!dbCache.GetAccountToken(keyId, SYMB::WGRT, accountToken));
+}
+
+// a transfer reads and writes back only the balances it moves, the copy saved last wins for these
+BOOST_AUTO_TEST_CASE(load_used_balances_only) {
+    CDBAccess dbAccess(DBNameType::ACCOUNT, true, true);
+    CAccountDBCache dbCache(&dbAccess);
+    CKeyID keyId = RandomKeyId();
+    CAccount saved(keyId);
+    saved.OperateBalance(SYMB::WICC, ADD_FREE, 100);
+    saved.OperateBalance(SYMB::WUSD, ADD_FREE, 5);
+    saved.OperateBalance(SYMB::WGRT, ADD_FREE, 7);
+    dbCache.SetAccount(keyId, saved);
+
+    CAccountDBCache txCache(&dbCache);
+    CAccount first, second;
+    BOOST_REQUIRE(txCache.GetAccount(CUserID(keyId), first, {SYMB::WICC, SYMB::WUSD}));
+    BOOST_REQUIRE(txCache.GetAccount(CUserID(keyId), second, {SYMB::WUSD}));
+    BOOST_CHECK_EQUAL(first.GetTokens().size(), 2U);
+    BOOST_CHECK(first.token_symbols == saved.token_symbols);
+    BOOST_CHECK(!first.IsTokenLoaded(SYMB::WGRT));
+    BOOST_CHECK(!second.IsTokenLoaded(SYMB::WICC));
+
+    first.OperateBalance(SYMB::WICC, SUB_FREE, 10);
+    second.OperateBalance(SYMB::WUSD, ADD_FREE, 1);
+    BOOST_CHECK(txCache.SaveAccount(second));
+    BOOST_CHECK(txCache.SaveAccount(first));
+    txCache.Flush();
+
+    CAccount account;
+    BOOST_REQUIRE(dbCache.GetAccount(keyId, account));
+    BOOST_CHECK_EQUAL(GetFree(account, SYMB::WICC), 90U);
+    BOOST_CHECK_EQUAL(GetFree(account, SYMB::WUSD), 5U);
+    BOOST_CHECK_EQUAL(GetFree(account, SYMB::WGRT), 7U);
+
+    // the regid lookups read the identity record alone
+    CAccount identity;
+    BOOST_REQUIRE(dbCache.GetAccount(CUserID(keyId), identity, {}));
+    BOOST_CHECK(identity.GetTokens().empty());
+    BOOST_CHECK(identity.IsSameIdentity(account));
+}
+
+static CAccount MakeRegisteredAccount(const CRegID &regId) {
+    CAccount account(RandomKeyId());
+    account.regid = regId;
+    return account;
+}
+
+// a regid undone by a reorg and registered again to another keyid resolves to the new keyid, also at
+// the layer which had resolved it to the old one
+BOOST_AUTO_TEST_CASE(regid_registered_again_after_undo) {
+    CDBAccess dbAccess(DBNameType::ACCOUNT, true, true);
+    CAccountDBCache dbCache(&dbAccess);
+    CRegID regId(100, 1);
+    CAccount first = MakeRegisteredAccount(regId), second = MakeRegisteredAccount(regId);
+
+    CDBOpLogMap dbOpLogMap;
+    {
+        CAccountDBCache blockCache(&dbCache);
+        blockCache.SetDbOpLogMap(&dbOpLogMap);
+        BOOST_CHECK(blockCache.SaveAccount(first));
+        blockCache.Flush();
+    }
+    CKeyID keyId;
+    BOOST_CHECK(dbCache.GetKeyId(regId, keyId) && keyId == first.keyid);
+
+    {
+        CAccountDBCache undoCache(&dbCache);
+        undoCache.SetDbOpLogMap(&dbOpLogMap);
+        BOOST_CHECK(undoCache.UndoData());
+        BOOST_CHECK(!undoCache.GetKeyId(regId, keyId));
+        undoCache.Flush();
+    }
+    BOOST_CHECK(!dbCache.GetKeyId(regId, keyId));
+
+    {
+        CAccountDBCache blockCache(&dbCache);
+        BOOST_CHECK(blockCache.SaveAccount(second));
+        BOOST_CHECK(blockCache.GetKeyId(regId, keyId) && keyId == second.keyid);
+        blockCache.Flush();
+    }
+    CAccount account;
+    BOOST_CHECK(dbCache.GetKeyId(regId, keyId) && keyId == second.keyid);
+    BOOST_CHECK(dbCache.GetAccount(regId, account) && account.keyid == second.keyid);
+
+    dbCache.Flush();
+    CAccountDBCache readCache(&dbAccess);
+    BOOST_CHECK(readCache.GetKeyId(regId, keyId) && keyId == second.keyid);
+}
+
+// a child layer resolves a regid which its base maps to another keyid than the db, both before and
+// after the base flushes the change
+BOOST_AUTO_TEST_CASE(child_resolves_regid_changed_at_base) {
+    CDBAccess dbAccess(DBNameType::ACCOUNT, true, true);
+    CAccountDBCache dbCache(&dbAccess);
+    CRegID regId(200, 3);
+    CKeyID oldKeyId = RandomKeyId(), newKeyId = RandomKeyId();
+    BOOST_CHECK(dbCache.SetKeyId(regId, oldKeyId));
+    dbCache.Flush();
+
+    CKeyID keyId;
+    BOOST_CHECK(dbCache.GetKeyId(regId, keyId) && keyId == oldKeyId);
+
+    CAccountDBCache blockCache(&dbCache);
+    BOOST_CHECK(blockCache.GetKeyId(regId, keyId) && keyId == oldKeyId);
+    BOOST_CHECK(blockCache.SetKeyId(regId, newKeyId));
+    {
+        CAccountDBCache txCache(&blockCache);
+        BOOST_CHECK(txCache.GetKeyId(regId, keyId) && keyId == newKeyId);
+    }
+    BOOST_CHECK(dbCache.GetKeyId(regId, keyId) && keyId == oldKeyId);
+
+    blockCache.Flush();
+    {
+        CAccountDBCache txCache(&blockCache);
+        BOOST_CHECK(txCache.GetKeyId(regId, keyId) && keyId == newKeyId);
+    }
+    {
+        CAccountDBCache otherCache(&dbCache);
+        BOOST_CHECK(otherCache.GetKeyId(regId, keyId) && keyId == newKeyId);
+    }
+    BOOST_CHECK(dbCache.GetKeyId(regId, keyId) && keyId == newKeyId);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
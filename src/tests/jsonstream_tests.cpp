@@ -0,0 +1,65 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "rpc/core/jsonstream.h"
+#include "commons/util.h"
+#include "commons/json/json_spirit_reader_template.h"
+#include "commons/json/json_spirit_utils.h"
+#include "commons/json/json_spirit_writer_template.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+
+using namespace std;
+using namespace json_spirit;
+
+BOOST_AUTO_TEST_SUITE(jsonstream_tests)
+
+// the streamed document must be the one json_spirit writes for the same tree
+BOOST_AUTO_TEST_CASE(stream_matches_tree) {
+    vector<string> vChunks;
+    CJsonStreamWriter writer([&vChunks](const string &chunk) { vChunks.push_back(chunk); }, 64);
+
+    Object expected;
+    Array items;
+    writer.BeginObject();
+    writer.Key("items");
+    writer.BeginArray();
+    for (int32_t i = 0; i < 20; i++) {
+        Object item;
+        item.push_back(Pair("index", i));
+        item.push_back(Pair("name",  strprintf("item \"%d\"", i)));
+        items.push_back(item);
+        writer.Write(item);
+    }
+    writer.EndArray();
+    expected.push_back(Pair("items", items));
+
+    writer.Key("empty");
+    writer.BeginObject();
+    writer.EndObject();
+    expected.push_back(Pair("empty", Object()));
+
+    writer.Pair("count", 20);
+    writer.Pair("error", Value::null);
+    expected.push_back(Pair("count", 20));
+    expected.push_back(Pair("error", Value::null));
+    writer.EndObject();
+
+    string strStreamed;
+    for (const auto &chunk : vChunks)
+        strStreamed += chunk;
+    strStreamed += writer.TakeBuffer();
+
+    BOOST_CHECK(vChunks.size() > 1);
+    BOOST_CHECK_EQUAL(strStreamed, write_string(Value(expected), false));
+    BOOST_CHECK_EQUAL(writer.GetWrittenBytes(), strStreamed.size());
+
+    Value parsed;
+    BOOST_CHECK(read_string(strStreamed, parsed) && parsed.type() == obj_type);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,219 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "entities/account.h"
+#include "persistence/dbaccess.h"
+#include "commons/random.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+typedef std::pair<CKeyID, TokenSymbol> TokenKey;
+
+template<CacheLayout LAYOUT>
+using TokenCache = CCompositeKVCache<dbk::KEYID_ACCOUNT_TOKEN, TokenKey, CAccountToken, LAYOUT>;
+
+static CKeyID RandomKeyId() {
+    CKeyID keyId;
+    GetRandBytes(keyId.begin(), keyId.size());
+    return keyId;
+}
+
+static CAccountToken MakeToken(uint64_t freeAmount) {
+    CAccountToken token;
+    token.free_amount = freeAmount;
+    return token;
+}
+
+// a tx layer over a block layer over the db, as ConnectBlock runs a transfer
+template<CacheLayout LAYOUT>
+static void CheckLayers() {
+    CDBAccess dbAccess(DBNameType::ACCOUNT, true, true);
+    TokenCache<LAYOUT> dbCache(&dbAccess);
+
+    vector<TokenKey> vKeys;
+    for (int32_t i = 0; i < 100; i++) {
+        vKeys.push_back(TokenKey(RandomKeyId(), SYMB::WICC));
+        BOOST_CHECK(dbCache.SetData(vKeys.back(), MakeToken(i + 1)));
+    }
+    dbCache.Flush();
+
+    TokenCache<LAYOUT> blockCache(&dbCache);
+    {
+        TokenCache<LAYOUT> txCache(&blockCache);
+        CAccountToken token;
+        BOOST_CHECK(txCache.GetData(vKeys[0], token) && token.free_amount == 1);
+        BOOST_CHECK(txCache.SetData(vKeys[0], MakeToken(1000)));
+        BOOST_CHECK(txCache.EraseData(vKeys[1]));
+        BOOST_CHECK(!txCache.HaveData(vKeys[1]));
+
+        TokenKey newKey(RandomKeyId(), SYMB::WUSD);
+        BOOST_CHECK(!txCache.HaveData(newKey));
+        BOOST_CHECK(txCache.SetData(newKey, MakeToken(7)));
+        vKeys.push_back(newKey);
+
+        // nothing reaches the block layer before the flush
+        BOOST_CHECK(blockCache.GetData(vKeys[0], token) && token.free_amount == 1);
+        BOOST_CHECK(blockCache.HaveData(vKeys[1]));
+        txCache.Flush();
+    }
+
+    CAccountToken token;
+    BOOST_CHECK(blockCache.GetData(vKeys[0], token) && token.free_amount == 1000);
+    BOOST_CHECK(!blockCache.HaveData(vKeys[1]));
+    BOOST_CHECK(blockCache.GetData(vKeys.back(), token) && token.free_amount == 7);
+    BOOST_CHECK(dbCache.GetData(vKeys[0], token) && token.free_amount == 1);
+
+    blockCache.Flush();
+    dbCache.Flush();
+
+    TokenCache<LAYOUT> readCache(&dbAccess);
+    BOOST_CHECK(readCache.GetData(vKeys[0], token) && token.free_amount == 1000);
+    BOOST_CHECK(!readCache.HaveData(vKeys[1]));
+    BOOST_CHECK(readCache.GetData(vKeys[2], token) && token.free_amount == 3);
+    BOOST_CHECK(readCache.GetData(vKeys.back(), token) && token.free_amount == 7);
+}
+
+// only the entries changed at a layer are written back, the ones it just read don't overwrite newer
+// values of the layer or the db below
+template<CacheLayout LAYOUT>
+static void CheckDirtyFlush() {
+    CDBAccess dbAccess(DBNameType::ACCOUNT, true, true);
+    TokenKey readKey(RandomKeyId(), SYMB::WICC), setKey(RandomKeyId(), SYMB::WICC);
+    {
+        TokenCache<LAYOUT> dbCache(&dbAccess);
+        dbCache.SetData(readKey, MakeToken(1));
+        dbCache.SetData(setKey, MakeToken(1));
+        dbCache.Flush();
+    }
+
+    CAccountToken token;
+    TokenCache<LAYOUT> dbCache(&dbAccess);
+    TokenCache<LAYOUT> blockCache(&dbCache);
+    {
+        TokenCache<LAYOUT> txCache(&blockCache);
+        BOOST_CHECK(txCache.GetData(readKey, token) && token.free_amount == 1);
+        BOOST_CHECK(txCache.SetData(setKey, MakeToken(2)));
+
+        BOOST_CHECK(blockCache.SetData(readKey, MakeToken(5)));
+        txCache.Flush();
+    }
+    BOOST_CHECK(blockCache.GetData(readKey, token) && token.free_amount == 5);
+    BOOST_CHECK(blockCache.GetData(setKey, token) && token.free_amount == 2);
+
+    // the top-level cache read readKey through the block layer, another writer changes it in the db
+    BOOST_CHECK(dbCache.GetData(readKey, token) && token.free_amount == 1);
+    {
+        TokenCache<LAYOUT> writeCache(&dbAccess);
+        writeCache.SetData(readKey, MakeToken(9));
+        writeCache.Flush();
+    }
+    dbCache.SetData(setKey, MakeToken(3));
+    dbCache.Flush();
+
+    TokenCache<LAYOUT> readCache(&dbAccess);
+    BOOST_CHECK(readCache.GetData(readKey, token) && token.free_amount == 9);
+    BOOST_CHECK(readCache.GetData(setKey, token) && token.free_amount == 3);
+}
+
+BOOST_AUTO_TEST_SUITE(kvcache_tests)
+
+BOOST_AUTO_TEST_CASE(hashed_layers) {
+    CheckLayers<CacheLayout::ORDERED>();
+    CheckLayers<CacheLayout::HASHED>();
+}
+
+BOOST_AUTO_TEST_CASE(dirty_flush) {
+    CheckDirtyFlush<CacheLayout::ORDERED>();
+    CheckDirtyFlush<CacheLayout::HASHED>();
+}
+
+// a top-level cache keeps the flushed entries as clean ones, evicting the least recently used to
+// stay within the cache budget of its db
+BOOST_AUTO_TEST_CASE(keep_flushed_entries) {
+    CDBAccess dbAccess(DBNameType::ACCOUNT, true, true);
+    TokenCache<CacheLayout::ORDERED> dbCache(&dbAccess);
+    vector<TokenKey> vKeys;
+    for (int32_t i = 0; i < 100; i++) {
+        vKeys.push_back(TokenKey(RandomKeyId(), SYMB::WICC));
+        dbCache.SetData(vKeys.back(), MakeToken(i + 1));
+    }
+
+    // without a budget nothing is kept
+    dbCache.Flush();
+    BOOST_CHECK(dbCache.GetMapData().empty());
+    BOOST_CHECK_EQUAL(dbAccess.GetCachedSize(), 0U);
+
+    CAccountToken token;
+    for (const auto &key : vKeys)
+        BOOST_CHECK(dbCache.GetData(key, token));
+    uint64_t nEntrySize = ::GetSerializeSize(vKeys[0], SER_DISK, CLIENT_VERSION) +
+                          ::GetSerializeSize(token, SER_DISK, CLIENT_VERSION);
+    dbAccess.SetCacheBudget(nEntrySize * 10);
+    for (int32_t i = 0; i < 100; i++)
+        dbCache.SetData(vKeys[i], MakeToken(i + 2));
+    dbCache.Flush();
+
+    // up to the budget of entries stay with the flushed values, the evicted ones are read again
+    BOOST_CHECK(!dbCache.GetMapData().empty());
+    BOOST_CHECK(dbCache.GetMapData().size() <= 10);
+    BOOST_CHECK(dbAccess.GetCachedSize() <= dbAccess.GetCacheBudget());
+    for (int32_t i = 0; i < 100; i++) {
+        auto it = dbCache.GetMapData().find(vKeys[i]);
+        if (it != dbCache.GetMapData().end())
+            BOOST_CHECK_EQUAL(it->second.free_amount, (uint64_t)i + 2);
+    }
+    for (int32_t i = 0; i < 100; i++)
+        BOOST_CHECK(dbCache.GetData(vKeys[i], token) && token.free_amount == (uint64_t)i + 2);
+
+    dbCache.Clear();
+    BOOST_CHECK_EQUAL(dbAccess.GetCachedSize(), 0U);
+}
+
+// a copy of a top-level cache, as CCacheWrapper::CopyFrom makes for a fork, keeps its dirty entries
+// only and accounts its own clean entries to the db
+BOOST_AUTO_TEST_CASE(copy_top_level_cache) {
+    CDBAccess dbAccess(DBNameType::ACCOUNT, true, true);
+    dbAccess.SetCacheBudget(1 << 20);
+    TokenCache<CacheLayout::ORDERED> dbCache(&dbAccess);
+    vector<TokenKey> vKeys;
+    for (int32_t i = 0; i < 10; i++) {
+        vKeys.push_back(TokenKey(RandomKeyId(), SYMB::WICC));
+        dbCache.SetData(vKeys.back(), MakeToken(i + 1));
+    }
+    dbCache.Flush();
+    BOOST_CHECK(dbCache.SetData(vKeys[0], MakeToken(100)));
+    uint64_t nCachedSize = dbAccess.GetCachedSize();
+    BOOST_CHECK(nCachedSize > 0);
+
+    CAccountToken token;
+    {
+        TokenCache<CacheLayout::ORDERED> forkCache(dbCache);
+        BOOST_CHECK_EQUAL(forkCache.GetMapData().size(), 1U);
+        BOOST_CHECK_EQUAL(dbAccess.GetCachedSize(), nCachedSize);
+        for (int32_t i = 0; i < 10; i++)
+            BOOST_CHECK(forkCache.GetData(vKeys[i], token) && token.free_amount == (i == 0 ? 100U : (uint64_t)i + 1));
+
+        BOOST_CHECK(forkCache.SetData(vKeys[1], MakeToken(200)));
+        forkCache.Flush();
+        BOOST_CHECK(dbAccess.GetCachedSize() > nCachedSize);
+    }
+    // the fork copy released the size of its clean entries, the source lru list is untouched
+    BOOST_CHECK_EQUAL(dbAccess.GetCachedSize(), nCachedSize);
+    for (int32_t i = 2; i < 10; i++)
+        BOOST_CHECK(dbCache.GetData(vKeys[i], token) && token.free_amount == (uint64_t)i + 1);
+
+    TokenCache<CacheLayout::ORDERED> assigned;
+    assigned = dbCache;
+    BOOST_CHECK_EQUAL(assigned.GetMapData().size(), 1U);
+    dbCache.Clear();
+    assigned.Clear();
+    BOOST_CHECK_EQUAL(dbAccess.GetCachedSize(), 0U);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,91 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "crypto/hash.h"
+#include "crypto/sha256.h"
+#include "commons/random.h"
+#include "main.h"
+#include "tx/cointransfertx.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <vector>
+
+using namespace std;
+
+static vector<uint256> RandomLeaves(size_t count) {
+    vector<uint256> vLeaves(count);
+    for (auto &leaf : vLeaves)
+        GetRandBytes(leaf.begin(), leaf.size());
+    return vLeaves;
+}
+
+// a block of count distinct transfer txs
+static void MakeBlock(size_t count, CBlock &block, vector<uint256> &vTxid) {
+    block.SetNull();
+    vTxid.clear();
+    for (size_t i = 0; i < count; i++) {
+        auto pTx = std::make_shared<CBaseCoinTransferTx>(CUserID(), CUserID(), i, COIN + i, 0, "");
+        block.vptx.push_back(pTx);
+        vTxid.push_back(pTx->GetHash());
+    }
+}
+
+BOOST_AUTO_TEST_SUITE(merkle_tests)
+
+BOOST_AUTO_TEST_CASE(batched_merkle_root) {
+    BOOST_TEST_MESSAGE("sha256 implementation: " + SHA256AutoDetect());
+
+    // odd and even counts around the 2/4/8 way kernel widths
+    for (size_t count = 1; count <= 40; count++) {
+        vector<uint256> vLeaves = RandomLeaves(count);
+        BOOST_CHECK(ComputeMerkleRoot(vLeaves) == ComputeMerkleRootPairwise(vLeaves));
+    }
+}
+
+BOOST_AUTO_TEST_CASE(block_size_merkle_root) {
+    // tx counts of an empty, a typical and a full block
+    for (size_t count : {100, 1000, 5000, 20000}) {
+        vector<uint256> vLeaves = RandomLeaves(count);
+        BOOST_CHECK(ComputeMerkleRoot(vLeaves) == ComputeMerkleRootPairwise(vLeaves));
+    }
+}
+
+// the merkle tree and branches of a block match the pairwise hashing
+BOOST_AUTO_TEST_CASE(block_merkle_tree) {
+    for (size_t count : {1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 33, 100}) {
+        CBlock block;
+        vector<uint256> vTxid;
+        MakeBlock(count, block, vTxid);
+
+        uint256 root = block.BuildMerkleTree();
+        BOOST_CHECK(root == ComputeMerkleRootPairwise(vTxid));
+        for (size_t i = 0; i < count; i++)
+            BOOST_CHECK(CBlock::CheckMerkleBranch(vTxid[i], block.GetMerkleBranch(i), i) == root);
+    }
+}
+
+// a partial merkle tree yields the pairwise root and the matched txids
+BOOST_AUTO_TEST_CASE(partial_merkle_tree) {
+    for (size_t count : {1, 2, 3, 5, 8, 13, 40, 100}) {
+        CBlock block;
+        vector<uint256> vTxid;
+        MakeBlock(count, block, vTxid);
+
+        vector<bool> vMatch;
+        vector<uint256> vMatchedTxid;
+        for (size_t i = 0; i < count; i++) {
+            vMatch.push_back(GetRand(3) == 0);
+            if (vMatch.back())
+                vMatchedTxid.push_back(vTxid[i]);
+        }
+
+        CPartialMerkleTree tree(vTxid, vMatch);
+        vector<uint256> vExtracted;
+        BOOST_CHECK(tree.ExtractMatches(vExtracted) == ComputeMerkleRootPairwise(vTxid));
+        BOOST_CHECK(vExtracted == vMatchedTxid);
+    }
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,129 @@
+// Copyright (c) 2017-2019 The WaykiChain Developers
+// Distributed under the MIT/X11 software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "rpc/core/notifyserver.h"
+#include "commons/json/json_spirit_reader_template.h"
+#include "commons/json/json_spirit_utils.h"
+#include "commons/util.h"
+#include "config/configuration.h"
+#include "main.h"
+
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+using namespace std;
+using namespace json_spirit;
+
+namespace {
+
+class CTestListener : public CChainEventListener {
+public:
+    vector<uint256> vRemoved;
+
+protected:
+    void BlockConnected(const CBlock &block, const CBlockIndex *pIndex) override {}
+    void BlockDisconnected(const CBlock &block, const CBlockIndex *pIndex) override {}
+    void TxAddedToMempool(const uint256 &hash, const CBaseTx *pBaseTx) override {}
+    void TxRemovedFromMempool(const uint256 &hash) override { vRemoved.push_back(hash); }
+};
+
+static int ConnectSubscriber(uint16_t nPort) {
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+        return -1;
+
+    struct timeval timeout = {0, 100 * 1000};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+
+    struct sockaddr_in sin;
+    memset(&sin, 0, sizeof(sin));
+    sin.sin_family      = AF_INET;
+    sin.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    sin.sin_port        = htons(nPort);
+    if (connect(fd, (struct sockaddr *)&sin, sizeof(sin)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// read one message line, false on timeout or a closed connection
+static bool ReadMessage(int fd, string &strLine) {
+    strLine.clear();
+    char ch;
+    while (recv(fd, &ch, 1, 0) == 1) {
+        if (ch == '\n')
+            return true;
+        strLine += ch;
+    }
+    return false;
+}
+
+}  // namespace
+
+BOOST_AUTO_TEST_SUITE(notifyserver_tests)
+
+BOOST_AUTO_TEST_CASE(chain_event_listener) {
+    CTestListener listener;
+    uint256 hash = uint256S("0x01");
+
+    RegisterChainEventListener(&listener);
+    NotifyTxRemovedFromMempool(hash);
+    UnregisterChainEventListener(&listener);
+    NotifyTxRemovedFromMempool(hash);
+
+    BOOST_CHECK_EQUAL(listener.vRemoved.size(), 1U);
+    BOOST_CHECK(listener.vRemoved[0] == hash);
+}
+
+BOOST_AUTO_TEST_CASE(publish_and_stop) {
+    const uint16_t nPort = 18979;
+    SysCfg().SoftSetArgCover("-notifyport", strprintf("%d", nPort));
+    BOOST_REQUIRE(StartNotifyServer());
+
+    int fd = ConnectSubscriber(nPort);
+    BOOST_REQUIRE(fd >= 0);
+
+    // the subscriber is added by the event thread, publish until it gets the event
+    uint256 hash = uint256S("0x02");
+    string strLine;
+    bool fReceived = false;
+    for (int32_t i = 0; i < 50 && !fReceived; i++) {
+        {
+            LOCK(cs_main);
+            NotifyTxRemovedFromMempool(hash);
+        }
+        fReceived = ReadMessage(fd, strLine);
+    }
+    BOOST_REQUIRE(fReceived);
+
+    Value msg;
+    BOOST_REQUIRE(read_string(strLine, msg));
+    BOOST_CHECK_EQUAL(find_value(msg.get_obj(), "topic").get_str(), "tx_removed");
+    BOOST_CHECK(find_value(msg.get_obj(), "seq").get_int64() > 0);
+    BOOST_CHECK_EQUAL(find_value(find_value(msg.get_obj(), "data").get_obj(), "txid").get_str(), hash.GetHex());
+
+    // stopping disconnects the subscriber, later events go nowhere
+    {
+        LOCK(cs_main);
+        StopNotifyServer();
+        NotifyTxRemovedFromMempool(hash);
+    }
+    char ch;
+    ssize_t nRead;
+    while ((nRead = recv(fd, &ch, 1, 0)) == 1)
+        continue;  // events published before the first one was read
+    BOOST_CHECK_EQUAL(nRead, 0);
+
+    close(fd);
+    SysCfg().EraseArg("-notifyport");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -24,8 +24,9 @@ bool CBaseCoinTransferTx::CheckTx(CTxExecuteContext &context) {
         return state.DoS(100, ERRORMSG("CBaseCoinTransferTx::CheckTx, public key is invalid"), REJECT_INVALID,
                          "bad-publickey");
 
+    // the signature check needs the owner pubkey only
     CAccount srcAccount;
-    if (!cw.accountCache.GetAccount(txUid, srcAccount))
+    if (!cw.accountCache.GetAccount(txUid, srcAccount, {}))
         return state.DoS(100, ERRORMSG("CBaseCoinTransferTx::CheckTx, read account failed"), REJECT_INVALID,
                          "bad-getaccount");
 
@@ -38,7 +39,7 @@ bool CBaseCoinTransferTx::CheckTx(CTxExecuteContext &context) {
 bool CBaseCoinTransferTx::ExecuteTx(CTxExecuteContext &context) {
     CCacheWrapper &cw = *context.pCw; CValidationState &state = *context.pState;
     CAccount srcAccount;
-    if (!cw.accountCache.GetAccount(txUid, srcAccount)) {
+    if (!cw.accountCache.GetAccount(txUid, srcAccount, {SYMB::WICC})) {
         return state.DoS(100, ERRORMSG("CBaseCoinTransferTx::ExecuteTx, read source addr account info error"),
                          READ_ACCOUNT_FAIL, "bad-read-accountdb");
     }
@@ -58,7 +59,7 @@ bool CBaseCoinTransferTx::ExecuteTx(CTxExecuteContext &context) {
                          "bad-write-accountdb");
 
     CAccount desAccount;
-    if (!cw.accountCache.GetAccount(toUid, desAccount)) {
+    if (!cw.accountCache.GetAccount(toUid, desAccount, {SYMB::WICC})) {
         if (toUid.type() == typeid(CKeyID)) {  // first involved in transaction
             desAccount.keyid = toUid.get<CKeyID>();
         } else {
@@ -162,8 +163,9 @@ bool CCoinTransferTx::CheckTx(CTxExecuteContext &context) {
         return state.DoS(100, ERRORMSG("CCoinTransferTx::CheckTx, public key is invalid"), REJECT_INVALID,
                          "bad-publickey");
 
+    // the signature check needs the owner pubkey only
     CAccount srcAccount;
-    if (!cw.accountCache.GetAccount(txUid, srcAccount))
+    if (!cw.accountCache.GetAccount(txUid, srcAccount, {}))
         return state.DoS(100, ERRORMSG("CCoinTransferTx::CheckTx, read account failed"), REJECT_INVALID,
                          "bad-getaccount");
 
@@ -175,8 +177,14 @@ bool CCoinTransferTx::CheckTx(CTxExecuteContext &context) {
 
 bool CCoinTransferTx::ExecuteTx(CTxExecuteContext &context) {
     CCacheWrapper &cw = *context.pCw; CValidationState &state = *context.pState;
+    // only the balances this tx moves are read and written back. Every copy of an account saved
+    // below loads the balances any other copy of it changes, so the copy saved last still wins
+    set<TokenSymbol> tokenSymbols = {fee_symbol};
+    for (const auto &transfer : transfers)
+        tokenSymbols.insert(transfer.coin_symbol);
+
     CAccount srcAccount;
-    if (!cw.accountCache.GetAccount(txUid, srcAccount))
+    if (!cw.accountCache.GetAccount(txUid, srcAccount, tokenSymbols))
         return state.DoS(100, ERRORMSG("CCoinTransferTx::ExecuteTx, read txUid %s account info error",
                         txUid.ToString()), UCOIN_STAKE_FAIL, "bad-read-accountdb");
 
@@ -211,7 +219,8 @@ bool CCoinTransferTx::ExecuteTx(CTxExecuteContext &context) {
                 actualCoinsToSend -= reserveFeeScoins;
 
                 CAccount fcoinGenesisAccount;
-                if (!cw.accountCache.GetFcoinGenesisAccount(fcoinGenesisAccount)) {
+                if (!cw.accountCache.GetAccount(CUserID(SysCfg().GetFcoinGenesisRegId()), fcoinGenesisAccount,
+                                                {SYMB::WUSD})) {
                     return state.DoS(100, ERRORMSG("CCoinTransferTx::ExecuteTx, transfers[%d],"
                         " read fcoinGenesisUid %s account info error",
                         i, SysCfg().GetFcoinGenesisRegId().ToString()), READ_ACCOUNT_FAIL, "bad-read-accountdb");
@@ -239,7 +248,7 @@ bool CCoinTransferTx::ExecuteTx(CTxExecuteContext &context) {
             }
         } else {
             CAccount desAccount;
-            if (!cw.accountCache.GetAccount(transfer.to_uid, desAccount)) { // first involved in transacion
+            if (!cw.accountCache.GetAccount(transfer.to_uid, desAccount, {transfer.coin_symbol})) { // first involved in transacion
                 if (transfer.to_uid.is<CKeyID>()) {
                     desAccount = CAccount(transfer.to_uid.get<CKeyID>());
                 } else {
@@ -63,6 +63,7 @@ void CTxMemPool::Remove(CBaseTx *pBaseTx, list<std::shared_ptr<CBaseTx> > &remov
         removed.push_front(std::shared_ptr<CBaseTx>(memPoolTxs[txid].GetTransaction()));
         memPoolTxs.erase(txid);
         EraseTransaction(txid);
+        NotifyTxRemovedFromMempool(txid);
         nTransactionsUpdated++;
     }
 }
@@ -138,6 +139,7 @@ void CTxMemPool::ReScanMemPoolTx(CCacheDBManager *pCdManIn) {
             uint256 txid = iterTx->first;
             iterTx       = memPoolTxs.erase(iterTx++);
             EraseTransaction(txid);
+            NotifyTxRemovedFromMempool(txid);
             continue;
         }
         ++iterTx;
@@ -25,7 +25,7 @@ using namespace boost;
 // CWalletDB
 //
 
-bool ReadKeyValue(CWallet* pWallet, CDataStream& ssKey, CDataStream& ssValue, string& strType, string& strErr,
+bool ReadKeyValue(CWallet* pWallet, CSecureDataStream& ssKey, CSecureDataStream& ssValue, string& strType, string& strErr,
                   int32_t MinVersion) {
     try {
         // Unserialize
@@ -125,8 +125,8 @@ DBErrors CWalletDB::LoadWallet(CWallet* pWallet) {
 
         while (true) {
             // Read next record
-            CDataStream ssKey(SER_DISK, CLIENT_VERSION);
-            CDataStream ssValue(SER_DISK, CLIENT_VERSION);
+            CSecureDataStream ssKey(SER_DISK, CLIENT_VERSION);
+            CSecureDataStream ssValue(SER_DISK, CLIENT_VERSION);
             int32_t ret = ReadAtCursor(pCursor, ssKey, ssValue);
             if (ret == DB_NOTFOUND)
                 break;
@@ -247,8 +247,8 @@ bool CWalletDB::Recover(CDBEnv& dbenv, string filename, bool fOnlyKeys) {
     DbTxn* ptxn = dbenv.TxnBegin();
     for (auto& row : salvagedData) {
         if (fOnlyKeys) {
-            CDataStream ssKey(row.first, SER_DISK, CLIENT_VERSION);
-            CDataStream ssValue(row.second, SER_DISK, CLIENT_VERSION);
+            CSecureDataStream ssKey(row.first, SER_DISK, CLIENT_VERSION);
+            CSecureDataStream ssValue(row.second, SER_DISK, CLIENT_VERSION);
             string strType, strErr;
             bool fReadOK = ReadKeyValue(nullptr, ssKey, ssValue, strType, strErr, -1);
             if (strType != "keystore")